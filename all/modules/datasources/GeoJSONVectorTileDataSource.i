@@ -0,0 +1,39 @@
+#ifndef _GEOJSONVECTORTILEDATASOURCE_I
+#define _GEOJSONVECTORTILEDATASOURCE_I
+
+%module(directors="1") GeoJSONVectorTileDataSource
+
+!proxy_imports(carto::GeoJSONVectorTileDataSource, core.MapBounds, core.MapTile, core.StringMap, datasources.TileDataSource, datasources.components.TileData, geometry.Feature, geometry.FeatureCollection, projections.Projection)
+
+%{
+#include "datasources/GeoJSONVectorTileDataSource.h"
+#include "components/Exceptions.h"
+#include <memory>
+%}
+
+%include <std_shared_ptr.i>
+%include <std_string.i>
+%include <cartoswig.i>
+
+%import "core/MapBounds.i"
+%import "core/MapTile.i"
+%import "datasources/TileDataSource.i"
+%import "datasources/components/TileData.i"
+%import "geometry/Feature.i"
+%import "geometry/FeatureCollection.i"
+%import "projections/Projection.i"
+
+!polymorphic_shared_ptr(carto::GeoJSONVectorTileDataSource, datasources.GeoJSONVectorTileDataSource)
+
+%attributeval(carto::GeoJSONVectorTileDataSource, carto::MapBounds, DataExtent, getDataExtent)
+%std_exceptions(carto::GeoJSONVectorTileDataSource::deleteLayer)
+%std_exceptions(carto::GeoJSONVectorTileDataSource::setLayerFeatureCollection)
+%std_exceptions(carto::GeoJSONVectorTileDataSource::addLayerFeatureCollection)
+%std_exceptions(carto::GeoJSONVectorTileDataSource::addLayerFeature)
+%std_exceptions(carto::GeoJSONVectorTileDataSource::removeLayerFeature)
+
+%feature("director") carto::GeoJSONVectorTileDataSource;
+
+%include "datasources/GeoJSONVectorTileDataSource.h"
+
+#endif
@@ -23,7 +23,13 @@
 !attributestring_polymorphic(carto::GeoJSONGeometryReader, projections.Projection, TargetProjection, getTargetProjection, setTargetProjection)
 %std_exceptions(carto::GeoJSONGeometryReader::readGeometry)
 %std_exceptions(carto::GeoJSONGeometryReader::readFeature)
+%attribute(carto::GeoJSONGeometryReader, int, ConversionThreadCount, getConversionThreadCount, setConversionThreadCount)
+%std_exceptions(carto::GeoJSONGeometryReader::setConversionThreadCount)
 %std_exceptions(carto::GeoJSONGeometryReader::readFeatureCollection)
+%std_exceptions(carto::GeoJSONGeometryReader::readFeatureCollectionFile)
+%ignore carto::GeoJSONGeometryReader::FeatureBatchHandler;
+%ignore carto::GeoJSONGeometryReader::readFeatureCollection(const std::string&, const FeatureBatchHandler&, std::size_t) const;
+%ignore carto::GeoJSONGeometryReader::readFeatureCollectionFile(const std::string&, const FeatureBatchHandler&, std::size_t) const;
 
 %include "geometry/GeoJSONGeometryReader.h"
 
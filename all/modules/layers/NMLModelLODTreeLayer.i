@@ -25,7 +25,9 @@
 !attributestring_polymorphic(carto::NMLModelLODTreeLayer, datasources.NMLModelLODTreeDataSource, DataSource, getDataSource);
 %attribute(carto::NMLModelLODTreeLayer, std::size_t, MaxMemorySize, getMaxMemorySize, setMaxMemorySize)
 %attribute(carto::NMLModelLODTreeLayer, float, LODResolutionFactor, getLODResolutionFactor, setLODResolutionFactor)
+%attribute(carto::NMLModelLODTreeLayer, int, FetchThreadCount, getFetchThreadCount, setFetchThreadCount)
 %std_exceptions(carto::NMLModelLODTreeLayer::NMLModelLODTreeLayer)
+%std_exceptions(carto::NMLModelLODTreeLayer::setFetchThreadCount)
 
 %include "layers/NMLModelLODTreeLayer.h"
 
@@ -42,6 +42,7 @@ using std::uint64_t;
 %ignore carto::PackageManager::unregisterOnChangeListener;
 %ignore carto::PackageManager::loadTile;
 %ignore carto::PackageManager::accessPackageFiles;
+%ignore carto::PackageManager::getLocalPackageFilePath;
 !standard_equals(carto::PackageManager);
 
 %include "packagemanager/PackageManager.h"
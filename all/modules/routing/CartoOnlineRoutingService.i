@@ -5,7 +5,7 @@
 
 #ifdef _CARTO_ROUTING_SUPPORT
 
-!proxy_imports(carto::CartoOnlineRoutingService, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult)
+!proxy_imports(carto::CartoOnlineRoutingService, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RoutingMatrixRequest, routing.RoutingMatrixResult)
 
 %{
 #include "routing/CartoOnlineRoutingService.h"
@@ -5,7 +5,7 @@
 
 #if defined(_CARTO_ROUTING_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
-!proxy_imports(carto::OSRMOfflineRoutingService, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult)
+!proxy_imports(carto::OSRMOfflineRoutingService, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RoutingMatrixRequest, routing.RoutingMatrixResult)
 
 %{
 #include "routing/OSRMOfflineRoutingService.h"
@@ -22,6 +22,7 @@
 
 %std_io_exceptions(carto::OSRMOfflineRoutingService::OSRMOfflineRoutingService)
 %std_io_exceptions(carto::OSRMOfflineRoutingService::calculateRoute)
+%std_io_exceptions(carto::OSRMOfflineRoutingService::calculateMatrix)
 
 %feature("director") carto::OSRMOfflineRoutingService;
 
@@ -5,7 +5,7 @@
 
 #if defined(_CARTO_ROUTING_SUPPORT) && defined(_CARTO_PACKAGEMANAGER_SUPPORT)
 
-!proxy_imports(carto::PackageManagerRoutingService, packagemanager.PackageManager, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult)
+!proxy_imports(carto::PackageManagerRoutingService, packagemanager.PackageManager, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RoutingMatrixRequest, routing.RoutingMatrixResult)
 
 %{
 #include "routing/PackageManagerRoutingService.h"
@@ -23,6 +23,7 @@
 
 %std_exceptions(carto::PackageManagerRoutingService::PackageManagerRoutingService)
 %std_io_exceptions(carto::PackageManagerRoutingService::calculateRoute)
+%std_io_exceptions(carto::PackageManagerRoutingService::calculateMatrix)
 
 %feature("director") carto::PackageManagerRoutingService;
 
@@ -0,0 +1,33 @@
+#ifndef _ROUTINGMATRIXRESULT_I
+#define _ROUTINGMATRIXRESULT_I
+
+#pragma SWIG nowarn=325
+
+%module RoutingMatrixResult
+
+#ifdef _CARTO_ROUTING_SUPPORT
+
+!proxy_imports(carto::RoutingMatrixResult)
+
+%{
+#include "routing/RoutingMatrixResult.h"
+#include "components/Exceptions.h"
+#include <memory>
+%}
+
+%include <std_shared_ptr.i>
+%include <cartoswig.i>
+
+!shared_ptr(carto::RoutingMatrixResult, routing.RoutingMatrixResult)
+
+%attribute(carto::RoutingMatrixResult, int, SourceCount, getSourceCount)
+%attribute(carto::RoutingMatrixResult, int, TargetCount, getTargetCount)
+%std_exceptions(carto::RoutingMatrixResult::getTime)
+%ignore carto::RoutingMatrixResult::RoutingMatrixResult;
+!standard_equals(carto::RoutingMatrixResult);
+
+%include "routing/RoutingMatrixResult.h"
+
+#endif
+
+#endif
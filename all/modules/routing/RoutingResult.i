@@ -16,6 +16,7 @@
 %}
 
 %include <std_shared_ptr.i>
+%include <std_vector.i>
 %include <cartoswig.i>
 
 %import "core/MapPos.i"
@@ -23,10 +24,12 @@
 %import "routing/RoutingInstruction.i"
 
 !shared_ptr(carto::RoutingResult, routing.RoutingResult)
+!value_type(std::vector<std::shared_ptr<carto::RoutingResult> >, routing.RoutingResultVector)
 
 %attributestring(carto::RoutingResult, std::shared_ptr<carto::Projection>, Projection, getProjection)
 %attributeval(carto::RoutingResult, std::vector<carto::MapPos>, Points, getPoints)
 %attributeval(carto::RoutingResult, std::vector<carto::RoutingInstruction>, Instructions, getInstructions)
+%attributeval(carto::RoutingResult, std::vector<std::shared_ptr<carto::RoutingResult> >, Alternatives, getAlternatives)
 %attribute(carto::RoutingResult, double, TotalDistance, getTotalDistance)
 %attribute(carto::RoutingResult, double, TotalTime, getTotalTime)
 %std_exceptions(carto::RoutingResult::RoutingResult)
@@ -34,6 +37,8 @@
 
 %include "routing/RoutingResult.h"
 
+!value_template(std::vector<std::shared_ptr<carto::RoutingResult> >, routing.RoutingResultVector)
+
 #endif
 
 #endif
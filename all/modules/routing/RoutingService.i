@@ -8,7 +8,7 @@
 
 #ifdef _CARTO_ROUTING_SUPPORT
 
-!proxy_imports(carto::RoutingService, routing.RoutingRequest, routing.RoutingResult)
+!proxy_imports(carto::RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RoutingMatrixRequest, routing.RoutingMatrixResult)
 
 %{
 #include "routing/RoutingService.h"
@@ -21,10 +21,13 @@
 
 %import "routing/RoutingRequest.i"
 %import "routing/RoutingResult.i"
+%import "routing/RoutingMatrixRequest.i"
+%import "routing/RoutingMatrixResult.i"
 
 !polymorphic_shared_ptr(carto::RoutingService, routing.RoutingService)
 
 %std_io_exceptions(carto::RoutingService::calculateRoute)
+%std_io_exceptions(carto::RoutingService::calculateMatrix)
 
 %feature("director") carto::RoutingService;
 
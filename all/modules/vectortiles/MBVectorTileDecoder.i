@@ -29,6 +29,10 @@
 %attribute(carto::MBVectorTileDecoder, bool, FeatureIdOverride, isFeatureIdOverride, setFeatureIdOverride)
 %attribute(carto::MBVectorTileDecoder, bool, CartoCSSLayerNamesIgnored, isCartoCSSLayerNamesIgnored, setCartoCSSLayerNamesIgnored)
 %attributestring(carto::MBVectorTileDecoder, std::string, LayerNameOverride, getLayerNameOverride, setLayerNameOverride)
+%attribute(carto::MBVectorTileDecoder, std::size_t, DecoderCacheCapacity, getDecoderCacheCapacity, setDecoderCacheCapacity)
+%attribute(carto::MBVectorTileDecoder, long long, DecoderCacheHitCount, getDecoderCacheHitCount)
+%attribute(carto::MBVectorTileDecoder, long long, DecoderCacheMissCount, getDecoderCacheMissCount)
+%attribute(carto::MBVectorTileDecoder, int, LayerBuildThreadCount, getLayerBuildThreadCount, setLayerBuildThreadCount)
 %std_exceptions(carto::MBVectorTileDecoder::MBVectorTileDecoder)
 %std_exceptions(carto::MBVectorTileDecoder::setCompiledStyleSet)
 %std_exceptions(carto::MBVectorTileDecoder::setCartoCSSStyleSet)
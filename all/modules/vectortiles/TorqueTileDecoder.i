@@ -26,6 +26,7 @@
 %std_exceptions(carto::TorqueTileDecoder::setStyleSet)
 %ignore carto::TorqueTileDecoder::decodeFeature;
 %ignore carto::TorqueTileDecoder::decodeTile;
+%ignore carto::TorqueTileDecoder::createTileFrameDecoder;
 %ignore carto::TorqueTileDecoder::getBackgroundColor;
 %ignore carto::TorqueTileDecoder::getBackgroundPattern;
 
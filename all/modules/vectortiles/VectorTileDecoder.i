@@ -26,9 +26,11 @@
 %attribute(carto::VectorTileDecoder, int, MaxZoom, getMaxZoom)
 %ignore carto::VectorTileDecoder::decodeFeature;
 %ignore carto::VectorTileDecoder::decodeTile;
+%ignore carto::VectorTileDecoder::createTileFrameDecoder;
 %ignore carto::VectorTileDecoder::getBackgroundColor;
 %ignore carto::VectorTileDecoder::getBackgroundPattern;
 %ignore carto::VectorTileDecoder::OnChangeListener;
+%ignore carto::VectorTileDecoder::TileFrameDecoder;
 %ignore carto::VectorTileDecoder::registerOnChangeListener;
 %ignore carto::VectorTileDecoder::unregisterOnChangeListener;
 !standard_equals(carto::VectorTileDecoder);
@@ -4,17 +4,43 @@
 
 #include "core/MapPos.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace carto {
 
     CancelableThreadPool::CancelableThreadPool() :
+        CancelableThreadPool(SchedulingMode::PRIORITY_QUEUE)
+    {
+    }
+
+    CancelableThreadPool::CancelableThreadPool(SchedulingMode schedulingMode) :
+        _schedulingMode(schedulingMode),
         _poolSize(0),
         _taskCount(0),
         _stop(false),
         _taskRecords(),
+        _workQueues(),
+        _workQueueCount(0),
+        _freeWorkQueueIndices(),
+        _workQueueTaskCount(0),
         _workers(),
         _threads(),
-        _mutex()
+        _shrinkPending(false),
+        _executedTaskCount(0),
+        _stealCount(0),
+        _totalWaitTime(0),
+        _maxWaitTime(0),
+        _mutex(),
+        _idleWorkerCount(0)
     {
+        if (_schedulingMode == SchedulingMode::WORK_STEALING) {
+            // Tasks may be submitted before any workers are started, so the first queue always exists
+            _workQueues.resize(MAX_WORK_QUEUE_COUNT);
+            _workQueues[0].reset(new WorkQueue());
+            _workQueueCount = 1;
+            _freeWorkQueueIndices.push_back(0);
+        }
     }
     
     CancelableThreadPool::~CancelableThreadPool() {
@@ -32,6 +58,10 @@ namespace carto {
             std::lock_guard<std::mutex> lock(_mutex);
             _condition.notify_all();
         }
+        {
+            std::lock_guard<std::mutex> lock(_idleMutex);
+            _idleCondition.notify_all();
+        }
         
         for (const std::shared_ptr<std::thread>& thread : _threads) {
             thread->detach();
@@ -40,6 +70,10 @@ namespace carto {
         _workers.clear();
         _threads.clear();
     }
+
+    CancelableThreadPool::SchedulingMode CancelableThreadPool::getSchedulingMode() const {
+        return _schedulingMode;
+    }
     
     int CancelableThreadPool::getPoolSize() const {
         std::lock_guard<std::mutex> lock(_mutex);
@@ -55,11 +89,13 @@ namespace carto {
     
         // Add threads
         for (int i = _poolSize; i < poolSize; i++) {
-            _workers.push_back(std::make_shared<TaskWorker>(shared_from_this()));
+            int queueIndex = (_schedulingMode == SchedulingMode::WORK_STEALING ? acquireWorkQueueIndex() : 0);
+            _workers.push_back(std::make_shared<TaskWorker>(shared_from_this(), queueIndex));
             _threads.push_back(std::make_shared<std::thread>(&TaskWorker::operator(), _workers.back()));
         }
     
         _poolSize = poolSize;
+        _shrinkPending = static_cast<int>(_threads.size()) > _poolSize;
     }
     
     void CancelableThreadPool::execute(std::shared_ptr<CancelableTask> task) {
@@ -67,23 +103,66 @@ namespace carto {
     }
     
     void CancelableThreadPool::execute(std::shared_ptr<CancelableTask> task, int priority) {
-        if (!task->isCanceled()) {
-            std::lock_guard<std::mutex> lock(_mutex);
-            
+        if (task->isCanceled()) {
+            return;
+        }
+
+        if (_schedulingMode == SchedulingMode::WORK_STEALING) {
             if (_stop) {
                 return;
             }
-    
-            // Push task to queue, increase global task count
-            _taskRecords.push(TaskRecord(task, priority, _taskCount));
-            _taskCount++;
-    
-            // If there are any waiting threads, notify one of them
-            _condition.notify_one();
+
+            // Distribute tasks between worker queues, only the selected queue is locked.
+            // The task is counted before it becomes visible, so the count never drops below the number of queued tasks
+            long long sequence = _taskCount++;
+            WorkQueue& workQueue = *_workQueues[static_cast<std::size_t>(sequence % _workQueueCount)];
+            {
+                std::lock_guard<std::mutex> lock(workQueue._mutex);
+                _workQueueTaskCount++;
+                workQueue._bands[priority].push_back(TaskRecord(task, priority, sequence));
+                workQueue._topPriority = workQueue._bands.rbegin()->first;
+            }
+
+            // Wake up one of the idle workers, if there are any. Idle workers check the task count after registering
+            // themselves, so either the worker sees the new task or we see the worker and the idle lock guarantees that the notification is not lost
+            if (_idleWorkerCount > 0) {
+                std::lock_guard<std::mutex> lock(_idleMutex);
+                _idleCondition.notify_one();
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        
+        if (_stop) {
+            return;
         }
+
+        // Push task to queue, increase global task count
+        _taskRecords.push(TaskRecord(task, priority, _taskCount++));
+
+        // If there are any waiting threads, notify one of them
+        _condition.notify_one();
     }
     
     void CancelableThreadPool::cancelAll() {
+        if (_schedulingMode == SchedulingMode::WORK_STEALING) {
+            int queueCount = _workQueueCount;
+            for (int i = 0; i < queueCount; i++) {
+                WorkQueue& workQueue = *_workQueues[i];
+                std::lock_guard<std::mutex> lock(workQueue._mutex);
+                for (const std::pair<const int, std::deque<TaskRecord> >& band : workQueue._bands) {
+                    for (const TaskRecord& taskRecord : band.second) {
+                        taskRecord._task->cancel();
+                    }
+                    _workQueueTaskCount -= static_cast<long long>(band.second.size());
+                }
+                workQueue._bands.clear();
+                workQueue._topPriority = EMPTY_QUEUE_PRIORITY;
+            }
+            return;
+        }
+
         std::lock_guard<std::mutex> lock(_mutex);
         
         std::size_t taskRecordsSize = _taskRecords.size();
@@ -93,11 +172,29 @@ namespace carto {
             _taskRecords.pop();
         }
     }
-    
+
+    CancelableThreadPool::Statistics CancelableThreadPool::getStatistics() const {
+        Statistics stats;
+        if (_schedulingMode == SchedulingMode::WORK_STEALING) {
+            stats.queueDepth = getQueueDepthUnlocked(); // task count is atomic, no need to lock the pool
+        } else {
+            std::lock_guard<std::mutex> lock(_mutex);
+            stats.queueDepth = getQueueDepthUnlocked();
+        }
+        stats.executedTaskCount = _executedTaskCount;
+        stats.stealCount = _stealCount;
+        if (stats.executedTaskCount > 0) {
+            stats.averageWaitTime = _totalWaitTime * 1.0e-6 / stats.executedTaskCount;
+        }
+        stats.maxWaitTime = _maxWaitTime * 1.0e-6;
+        return stats;
+    }
+
     CancelableThreadPool::TaskRecord::TaskRecord(std::shared_ptr<CancelableTask> task, int priority, long long sequence) :
         _task(task),
         _priority(priority),
-        _sequence(sequence)
+        _sequence(sequence),
+        _queueTime(std::chrono::steady_clock::now())
     {
     }
     
@@ -108,9 +205,18 @@ namespace carto {
         }
         return _sequence > taskRecord._sequence;
     }
+
+    CancelableThreadPool::WorkQueue::WorkQueue() :
+        _bands(),
+        _topPriority(EMPTY_QUEUE_PRIORITY),
+        _mutex()
+    {
+    }
     
-    CancelableThreadPool::TaskWorker::TaskWorker(const std::shared_ptr<CancelableThreadPool>& threadPool) :
-        _threadPool(threadPool) {
+    CancelableThreadPool::TaskWorker::TaskWorker(const std::shared_ptr<CancelableThreadPool>& threadPool, int queueIndex) :
+        _threadPool(threadPool),
+        _queueIndex(queueIndex)
+    {
     }
         
     void CancelableThreadPool::TaskWorker::operator ()() {
@@ -122,27 +228,35 @@ namespace carto {
             }
 
             // If there are no tasks, wait until notified or exit thread if interrupted
-            {
+            if (threadPool->_schedulingMode == SchedulingMode::WORK_STEALING) {
+                // Idle workers wait on a separate lock, submitting and picking up tasks does not need the pool lock
+                std::unique_lock<std::mutex> lock(threadPool->_idleMutex);
+                threadPool->_idleWorkerCount++;
+                while (!threadPool->_stop && threadPool->_workQueueTaskCount <= 0) {
+                    threadPool->_idleCondition.wait(lock);
+                }
+                threadPool->_idleWorkerCount--;
+                if (threadPool->_stop) {
+                    return;
+                }
+            } else {
                 std::unique_lock<std::mutex> lock(threadPool->_mutex);
                 if (threadPool->_stop) {
                     return;
                 }
                 
-                if (threadPool->_taskRecords.size() == 0) {
+                if (threadPool->getQueueDepthUnlocked() == 0) {
                     threadPool->_condition.wait(lock);
                 }
             }
     
             // Request another task, execute it if it's not null
             while (true) {
-                {
-                    std::lock_guard<std::mutex> lock(threadPool->_mutex);
-                    if (threadPool->_stop) {
-                        return;
-                    }
+                if (threadPool->_stop) {
+                    return;
                 }
                 
-                std::shared_ptr<CancelableTask> task = threadPool->getNextTask();
+                std::shared_ptr<CancelableTask> task = threadPool->getNextTask(*this);
                 if (task) {
                     task->operator ()();
                 } else {
@@ -159,19 +273,115 @@ namespace carto {
         }
     }
     
-    std::shared_ptr<CancelableTask> CancelableThreadPool::getNextTask() {
+    std::shared_ptr<CancelableTask> CancelableThreadPool::getNextTask(const TaskWorker& worker) {
+        if (_schedulingMode == SchedulingMode::WORK_STEALING) {
+            return stealNextTask(worker);
+        }
+
         std::lock_guard<std::mutex> lock(_mutex);
     
         // Return the next highest priority task from the task queue
         std::shared_ptr<CancelableTask> task;
         if (_taskRecords.size() > 0) {
+            updateWaitStatistics(_taskRecords.top());
             task = _taskRecords.top()._task;
             _taskRecords.pop();
         }
         return task;
     }
-    
+
+    std::shared_ptr<CancelableTask> CancelableThreadPool::stealNextTask(const TaskWorker& worker) {
+        // Pick the queue with the highest priority band without locking. The scan starts from worker's own queue,
+        // so the worker pops its own queue unless another queue has higher priority tasks, in that case the task is stolen.
+        // The queue may be drained concurrently by another worker, in that case retry.
+        int queueCount = _workQueueCount;
+        for (int attempt = 0; attempt < queueCount; attempt++) {
+            int bestIndex = -1;
+            int bestPriority = EMPTY_QUEUE_PRIORITY;
+            for (int i = 0; i < queueCount; i++) {
+                int index = (worker._queueIndex + i) % queueCount;
+                int priority = _workQueues[index]->_topPriority;
+                if (priority != EMPTY_QUEUE_PRIORITY && (bestIndex < 0 || priority > bestPriority)) {
+                    bestIndex = index;
+                    bestPriority = priority;
+                }
+            }
+            if (bestIndex < 0) {
+                return std::shared_ptr<CancelableTask>();
+            }
+
+            WorkQueue& workQueue = *_workQueues[bestIndex];
+            std::lock_guard<std::mutex> lock(workQueue._mutex);
+            if (workQueue._bands.empty()) {
+                continue;
+            }
+            auto bandIt = std::prev(workQueue._bands.end());
+            TaskRecord taskRecord = bandIt->second.front();
+            bandIt->second.pop_front();
+            if (bandIt->second.empty()) {
+                workQueue._bands.erase(bandIt);
+            }
+            workQueue._topPriority = (workQueue._bands.empty() ? EMPTY_QUEUE_PRIORITY : workQueue._bands.rbegin()->first);
+            _workQueueTaskCount--;
+
+            if (bestIndex != worker._queueIndex) {
+                _stealCount++;
+            }
+            updateWaitStatistics(taskRecord);
+            return taskRecord._task;
+        }
+        return std::shared_ptr<CancelableTask>();
+    }
+
+    std::size_t CancelableThreadPool::getQueueDepthUnlocked() const {
+        if (_schedulingMode == SchedulingMode::WORK_STEALING) {
+            return static_cast<std::size_t>(std::max(0LL, static_cast<long long>(_workQueueTaskCount)));
+        }
+        return _taskRecords.size();
+    }
+
+    void CancelableThreadPool::updateWaitStatistics(const TaskRecord& taskRecord) {
+        long long waitTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - taskRecord._queueTime).count();
+        _executedTaskCount++;
+        _totalWaitTime += waitTime;
+        long long maxWaitTime = _maxWaitTime;
+        while (waitTime > maxWaitTime && !_maxWaitTime.compare_exchange_weak(maxWaitTime, waitTime)) {
+        }
+    }
+
+    int CancelableThreadPool::acquireWorkQueueIndex() {
+        // Reuse queues of terminated workers first, tasks left in these are executed by the new worker
+        if (!_freeWorkQueueIndices.empty()) {
+            int queueIndex = _freeWorkQueueIndices.back();
+            _freeWorkQueueIndices.pop_back();
+            return queueIndex;
+        }
+        int queueCount = _workQueueCount;
+        if (queueCount < MAX_WORK_QUEUE_COUNT) {
+            _workQueues[queueCount].reset(new WorkQueue());
+            _workQueueCount = queueCount + 1; // publish the queue only after it is created
+            return queueCount;
+        }
+        // Very large pools share the queues
+        return static_cast<int>(_workers.size()) % MAX_WORK_QUEUE_COUNT;
+    }
+
+    void CancelableThreadPool::releaseWorkQueueIndex(int queueIndex) {
+        // The queue stays visible to other workers, so queued tasks are stolen by them
+        for (const std::shared_ptr<TaskWorker>& worker : _workers) {
+            if (worker->_queueIndex == queueIndex) {
+                return;
+            }
+        }
+        _freeWorkQueueIndices.push_back(queueIndex);
+    }
+
     bool CancelableThreadPool::shouldTerminateWorker(TaskWorker& worker) {
+        // Avoid taking the pool lock after each task, unless the pool is stopped or shrunk
+        if (!_stop && !_shrinkPending) {
+            return false;
+        }
+
         std::lock_guard<std::mutex> lock(_mutex);
         
         if (_stop) {
@@ -187,18 +397,28 @@ namespace carto {
             for (it = _workers.begin(); it != _workers.end(); ++it) {
                 const std::shared_ptr<TaskWorker>& listWorker = *it;
                 if (listWorker.get() == &worker) {
-                    // Remove thread and worker
+                    // Remove thread and worker. The thread is exiting, detach it as it can not be joined from itself
                     _workers.erase(it);
+                    _threads[index]->detach();
                     _threads.erase(_threads.begin() + index);
                     break;
                 }
                 index++;
             }
     
+            if (_schedulingMode == SchedulingMode::WORK_STEALING) {
+                releaseWorkQueueIndex(worker._queueIndex);
+            }
+            _shrinkPending = static_cast<int>(_threads.size()) > _poolSize;
+
             return true;
         }
+
+        _shrinkPending = false;
     
         return false;
     }
+
+    const int CancelableThreadPool::EMPTY_QUEUE_PRIORITY = std::numeric_limits<int>::min();
     
 }
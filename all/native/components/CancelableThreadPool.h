@@ -10,19 +10,42 @@
 #include "components/CancelableTask.h"
 #include "components/ThreadWorker.h"
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory>
 #include <queue>
 #include <thread>
+#include <vector>
 
 namespace carto {
 
     class CancelableThreadPool : public std::enable_shared_from_this<CancelableThreadPool> {
     public:
+        enum class SchedulingMode {
+            PRIORITY_QUEUE, // single shared priority queue, strict priority and submission order
+            WORK_STEALING   // per-worker queues with priority bands, idle workers steal from other queues
+        };
+
+        struct Statistics {
+            std::size_t queueDepth;
+            long long executedTaskCount;
+            long long stealCount;
+            double averageWaitTime; // in seconds
+            double maxWaitTime; // in seconds
+
+            Statistics() : queueDepth(0), executedTaskCount(0), stealCount(0), averageWaitTime(0), maxWaitTime(0) { }
+        };
+
         CancelableThreadPool();
+        explicit CancelableThreadPool(SchedulingMode schedulingMode);
         virtual ~CancelableThreadPool();
         void deinit();
     
+        SchedulingMode getSchedulingMode() const;
+
         int getPoolSize() const;
         void setPoolSize(int threadCount);
     
@@ -30,6 +53,8 @@ namespace carto {
         void execute(std::shared_ptr<CancelableTask>, int priority);
     
         void cancelAll();
+
+        Statistics getStatistics() const;
         
     private:
         struct TaskRecord {
@@ -40,37 +65,73 @@ namespace carto {
             std::shared_ptr<CancelableTask> _task;
             int _priority;
             long long _sequence;
+            std::chrono::steady_clock::time_point _queueTime;
+        };
+
+        struct WorkQueue {
+            WorkQueue();
+
+            std::map<int, std::deque<TaskRecord> > _bands; // tasks by priority, each band in submission order
+            std::atomic<int> _topPriority; // priority of the highest non-empty band, EMPTY_QUEUE_PRIORITY if empty
+            std::mutex _mutex;
         };
     
         struct TaskWorker : public ThreadWorker {
-            TaskWorker(const std::shared_ptr<CancelableThreadPool>& threadPool);
+            TaskWorker(const std::shared_ptr<CancelableThreadPool>& threadPool, int queueIndex);
     
             void operator()();
     
             std::weak_ptr<CancelableThreadPool> _threadPool;
+            int _queueIndex;
         };
     
         typedef std::priority_queue<TaskRecord> TaskRecordQueue;
         typedef std::vector<std::shared_ptr<TaskWorker> > WorkerList;
         typedef std::vector<std::shared_ptr<std::thread> > ThreadList;
     
-        std::shared_ptr<CancelableTask> getNextTask();
+        std::shared_ptr<CancelableTask> getNextTask(const TaskWorker& worker);
+        std::shared_ptr<CancelableTask> stealNextTask(const TaskWorker& worker);
+
+        std::size_t getQueueDepthUnlocked() const;
+
+        void updateWaitStatistics(const TaskRecord& taskRecord);
+
+        int acquireWorkQueueIndex();
+        void releaseWorkQueueIndex(int queueIndex);
     
         bool shouldTerminateWorker(TaskWorker& worker);
     
         static const int DEFAULT_PRIORITY = 0;
+        static const int MAX_WORK_QUEUE_COUNT = 64;
+        static const int EMPTY_QUEUE_PRIORITY;
     
+        const SchedulingMode _schedulingMode;
+
         int _poolSize;
-        long long _taskCount;
+        std::atomic<long long> _taskCount;
         
-        bool _stop;
+        std::atomic<bool> _stop;
     
         TaskRecordQueue _taskRecords;
+        std::vector<std::unique_ptr<WorkQueue> > _workQueues; // fixed size, queues are created for new workers and never released
+        std::atomic<int> _workQueueCount;
+        std::vector<int> _freeWorkQueueIndices;
+        std::atomic<long long> _workQueueTaskCount;
         WorkerList _workers;
         ThreadList _threads;
+        std::atomic<bool> _shrinkPending;
+
+        std::atomic<long long> _executedTaskCount;
+        std::atomic<long long> _stealCount;
+        std::atomic<long long> _totalWaitTime; // in microseconds
+        std::atomic<long long> _maxWaitTime; // in microseconds
     
         mutable std::mutex _mutex;
         std::condition_variable _condition;
+
+        std::atomic<int> _idleWorkerCount;
+        std::mutex _idleMutex;
+        std::condition_variable _idleCondition;
     };
     
 }
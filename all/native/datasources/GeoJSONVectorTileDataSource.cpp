@@ -0,0 +1,574 @@
+#include "GeoJSONVectorTileDataSource.h"
+#include "core/BinaryData.h"
+#include "components/Exceptions.h"
+#include "geometry/Feature.h"
+#include "geometry/FeatureCollection.h"
+#include "geometry/Geometry.h"
+#include "geometry/PointGeometry.h"
+#include "geometry/LineGeometry.h"
+#include "geometry/PolygonGeometry.h"
+#include "geometry/MultiGeometry.h"
+#include "geometry/utils/KDTreeSpatialIndex.h"
+#include "projections/Projection.h"
+#include "projections/EPSG3857.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <cglib/vec.h>
+
+#include <mapnikvt/MBVTTileBuilder.h>
+
+namespace {
+
+    typedef std::vector<cglib::vec2<double> > Vertices;
+
+    void clipLine(const Vertices& vertices, int axis, double k1, double k2, std::vector<Vertices>& clippedVerticesList) {
+        // Liang-Barsky style clipping of each segment against a single axis slab, visible parts are stitched together
+        Vertices slice;
+        for (std::size_t i = 1; i < vertices.size(); i++) {
+            const cglib::vec2<double>& a = vertices[i - 1];
+            const cglib::vec2<double>& b = vertices[i];
+            double d = b(axis) - a(axis);
+            double t0 = 0, t1 = 1;
+            if (d == 0) {
+                if (a(axis) < k1 || a(axis) > k2) {
+                    t0 = 1;
+                    t1 = 0;
+                }
+            } else {
+                double tk1 = (k1 - a(axis)) / d;
+                double tk2 = (k2 - a(axis)) / d;
+                t0 = std::max(t0, std::min(tk1, tk2));
+                t1 = std::min(t1, std::max(tk1, tk2));
+            }
+            if (t0 > t1) {
+                if (slice.size() >= 2) {
+                    clippedVerticesList.push_back(std::move(slice));
+                }
+                slice.clear();
+                continue;
+            }
+
+            cglib::vec2<double> p0 = (t0 > 0 ? a + (b - a) * t0 : a);
+            cglib::vec2<double> p1 = (t1 < 1 ? a + (b - a) * t1 : b);
+            if (slice.empty() || slice.back() != p0) {
+                if (slice.size() >= 2) {
+                    clippedVerticesList.push_back(std::move(slice));
+                }
+                slice.clear();
+                slice.push_back(p0);
+            }
+            slice.push_back(p1);
+        }
+        if (slice.size() >= 2) {
+            clippedVerticesList.push_back(std::move(slice));
+        }
+    }
+
+    Vertices clipRing(const Vertices& vertices, int axis, double k, bool keepGreater) {
+        // Sutherland-Hodgman clipping against a single half-plane
+        Vertices clippedVertices;
+        clippedVertices.reserve(vertices.size() + 4);
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            const cglib::vec2<double>& a = vertices[i];
+            const cglib::vec2<double>& b = vertices[(i + 1) % vertices.size()];
+            bool aInside = keepGreater ? a(axis) >= k : a(axis) <= k;
+            bool bInside = keepGreater ? b(axis) >= k : b(axis) <= k;
+            if (aInside) {
+                clippedVertices.push_back(a);
+            }
+            if (aInside != bInside) {
+                double t = (k - a(axis)) / (b(axis) - a(axis));
+                clippedVertices.push_back(a + (b - a) * t);
+            }
+        }
+        return clippedVertices;
+    }
+
+    void calculateImportances(const Vertices& vertices, std::vector<double>& importances) {
+        // Douglas-Peucker run without tolerance, importance of each vertex is the squared tolerance at which it would be dropped
+        importances.assign(vertices.size(), 0.0);
+        if (vertices.empty()) {
+            return;
+        }
+        importances.front() = importances.back() = std::numeric_limits<double>::infinity();
+
+        struct Segment {
+            std::size_t first;
+            std::size_t last;
+            double importance;
+        };
+        std::vector<Segment> stack;
+        stack.push_back(Segment { 0, vertices.size() - 1, std::numeric_limits<double>::infinity() });
+        while (!stack.empty()) {
+            Segment segment = stack.back();
+            stack.pop_back();
+            if (segment.last <= segment.first + 1) {
+                continue;
+            }
+
+            const cglib::vec2<double>& p0 = vertices[segment.first];
+            cglib::vec2<double> dp = vertices[segment.last] - p0;
+            double len2 = cglib::dot_product(dp, dp);
+            double maxDist2 = -1;
+            std::size_t index = segment.first;
+            for (std::size_t i = segment.first + 1; i < segment.last; i++) {
+                cglib::vec2<double> d = vertices[i] - p0;
+                if (len2 > 0) {
+                    double t = std::max(0.0, std::min(1.0, cglib::dot_product(d, dp) / len2));
+                    d = d - dp * t;
+                }
+                double dist2 = cglib::dot_product(d, d);
+                if (dist2 > maxDist2) {
+                    maxDist2 = dist2;
+                    index = i;
+                }
+            }
+
+            // Clamp to the parent importance, so that simplification at any tolerance equals Douglas-Peucker result
+            double importance = std::min(maxDist2, segment.importance);
+            importances[index] = importance;
+            stack.push_back(Segment { segment.first, index, importance });
+            stack.push_back(Segment { index, segment.last, importance });
+        }
+    }
+
+}
+
+namespace carto {
+
+    struct GeoJSONVectorTileDataSource::IndexedFeature {
+        struct Ring {
+            Vertices vertices;
+            std::vector<double> importances;
+            MapBounds bounds;
+        };
+
+        int layerIndex;
+        long long id;
+        MapBounds bounds;
+        mvt::MBVTTileBuilder::Properties properties;
+        Vertices points;
+        std::vector<Ring> lines;
+        std::vector<std::vector<Ring> > polygons;
+
+        IndexedFeature(int layerIndex, long long id) : layerIndex(layerIndex), id(id), bounds(), properties(), points(), lines(), polygons() { }
+
+        bool empty() const {
+            return points.empty() && lines.empty() && polygons.empty();
+        }
+
+        Ring createRing(const std::vector<MapPos>& mapPoses, const Projection* proj, const Projection& tileProj) {
+            MapBounds tileProjBounds = tileProj.getBounds();
+
+            Ring ring;
+            ring.vertices.reserve(mapPoses.size());
+            for (const MapPos& mapPos : mapPoses) {
+                MapPos tileProjPos = proj ? tileProj.fromWgs84(proj->toWgs84(mapPos)) : mapPos;
+                double x = (tileProjPos.getX() - tileProjBounds.getMin().getX()) / tileProjBounds.getDelta().getX();
+                double y = (tileProjBounds.getMax().getY() - tileProjPos.getY()) / tileProjBounds.getDelta().getY();
+                ring.vertices.emplace_back(x, y);
+                ring.bounds.expandToContain(MapPos(x, y));
+            }
+            bounds.expandToContain(ring.bounds);
+            return ring;
+        }
+
+        void addGeometry(const std::shared_ptr<Geometry>& geometry, const Projection* proj, const Projection& tileProj) {
+            if (auto pointGeometry = std::dynamic_pointer_cast<PointGeometry>(geometry)) {
+                Ring ring = createRing(std::vector<MapPos> { pointGeometry->getPos() }, proj, tileProj);
+                points.insert(points.end(), ring.vertices.begin(), ring.vertices.end());
+            } else if (auto lineGeometry = std::dynamic_pointer_cast<LineGeometry>(geometry)) {
+                lines.push_back(createRing(lineGeometry->getPoses(), proj, tileProj));
+                calculateImportances(lines.back().vertices, lines.back().importances);
+            } else if (auto polygonGeometry = std::dynamic_pointer_cast<PolygonGeometry>(geometry)) {
+                std::vector<Ring> rings;
+                for (const std::vector<MapPos>& mapPoses : polygonGeometry->getRings()) {
+                    rings.push_back(createRing(mapPoses, proj, tileProj));
+                    calculateImportances(rings.back().vertices, rings.back().importances);
+                }
+                polygons.push_back(std::move(rings));
+            } else if (auto multiGeometry = std::dynamic_pointer_cast<MultiGeometry>(geometry)) {
+                for (int i = 0; i < multiGeometry->getGeometryCount(); i++) {
+                    addGeometry(multiGeometry->getGeometry(i), proj, tileProj);
+                }
+            }
+        }
+
+        void addProperties(const Variant& variant) {
+            for (const std::string& key : variant.getObjectKeys()) {
+                Variant value = variant.getObjectElement(key);
+                switch (value.getType()) {
+                case VariantType::VARIANT_TYPE_STRING:
+                    properties.emplace_back(key, mvt::Value(value.getString()));
+                    break;
+                case VariantType::VARIANT_TYPE_BOOL:
+                    properties.emplace_back(key, mvt::Value(value.getBool()));
+                    break;
+                case VariantType::VARIANT_TYPE_INTEGER:
+                    properties.emplace_back(key, mvt::Value(value.getLong()));
+                    break;
+                case VariantType::VARIANT_TYPE_DOUBLE:
+                    properties.emplace_back(key, mvt::Value(value.getDouble()));
+                    break;
+                case VariantType::VARIANT_TYPE_ARRAY:
+                case VariantType::VARIANT_TYPE_OBJECT:
+                    properties.emplace_back(key, mvt::Value(value.toString()));
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        static Vertices SimplifyRing(const Ring& ring, double tolerance2) {
+            Vertices vertices;
+            vertices.reserve(ring.vertices.size());
+            for (std::size_t i = 0; i < ring.vertices.size(); i++) {
+                if (ring.importances[i] > tolerance2) {
+                    vertices.push_back(ring.vertices[i]);
+                }
+            }
+            return vertices;
+        }
+    };
+
+    GeoJSONVectorTileDataSource::GeoJSONVectorTileDataSource(int minZoom, int maxZoom) :
+        TileDataSource(minZoom, maxZoom),
+        _layers(),
+        _layerCounter(0),
+        _featureCounter(0),
+        _spatialIndex(std::make_shared<KDTreeSpatialIndex<std::shared_ptr<const IndexedFeature> > >()),
+        _generation(0),
+        _tileCache(TILE_CACHE_SIZE),
+        _mutex()
+    {
+    }
+
+    GeoJSONVectorTileDataSource::~GeoJSONVectorTileDataSource() {
+    }
+
+    int GeoJSONVectorTileDataSource::createLayer(const std::string& name) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        int layerIndex = _layerCounter++;
+        _layers[layerIndex].name = name;
+        return layerIndex;
+    }
+
+    void GeoJSONVectorTileDataSource::deleteLayer(int layerIndex) {
+        MapBounds changedBounds;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            getLayer(layerIndex);
+            removeFeatures(layerIndex, changedBounds);
+            _layers.erase(layerIndex);
+            invalidateTiles(changedBounds);
+        }
+        notifyTilesChanged(false);
+    }
+
+    void GeoJSONVectorTileDataSource::setLayerFeatureCollection(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection) {
+        if (!projection) {
+            throw NullArgumentException("Null projection");
+        }
+        if (!featureCollection) {
+            throw NullArgumentException("Null featureCollection");
+        }
+
+        std::vector<std::shared_ptr<Feature> > features;
+        std::vector<std::shared_ptr<const IndexedFeature> > indexedFeatures;
+        for (int i = 0; i < featureCollection->getFeatureCount(); i++) {
+            features.push_back(featureCollection->getFeature(i));
+            indexedFeatures.push_back(createIndexedFeature(layerIndex, projection, features.back()));
+        }
+
+        MapBounds changedBounds;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            getLayer(layerIndex);
+            removeFeatures(layerIndex, changedBounds);
+            insertFeatures(layerIndex, indexedFeatures, features, changedBounds);
+            invalidateTiles(changedBounds);
+        }
+        notifyTilesChanged(false);
+    }
+
+    void GeoJSONVectorTileDataSource::addLayerFeatureCollection(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection) {
+        if (!projection) {
+            throw NullArgumentException("Null projection");
+        }
+        if (!featureCollection) {
+            throw NullArgumentException("Null featureCollection");
+        }
+
+        std::vector<std::shared_ptr<Feature> > features;
+        std::vector<std::shared_ptr<const IndexedFeature> > indexedFeatures;
+        for (int i = 0; i < featureCollection->getFeatureCount(); i++) {
+            features.push_back(featureCollection->getFeature(i));
+            indexedFeatures.push_back(createIndexedFeature(layerIndex, projection, features.back()));
+        }
+
+        MapBounds changedBounds;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            getLayer(layerIndex);
+            insertFeatures(layerIndex, indexedFeatures, features, changedBounds);
+            invalidateTiles(changedBounds);
+        }
+        notifyTilesChanged(false);
+    }
+
+    void GeoJSONVectorTileDataSource::addLayerFeature(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<Feature>& feature) {
+        if (!projection) {
+            throw NullArgumentException("Null projection");
+        }
+        if (!feature) {
+            throw NullArgumentException("Null feature");
+        }
+
+        std::vector<std::shared_ptr<Feature> > features { feature };
+        std::vector<std::shared_ptr<const IndexedFeature> > indexedFeatures { createIndexedFeature(layerIndex, projection, feature) };
+
+        MapBounds changedBounds;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            getLayer(layerIndex);
+            insertFeatures(layerIndex, indexedFeatures, features, changedBounds);
+            invalidateTiles(changedBounds);
+        }
+        notifyTilesChanged(false);
+    }
+
+    bool GeoJSONVectorTileDataSource::removeLayerFeature(int layerIndex, const std::shared_ptr<Feature>& feature) {
+        if (!feature) {
+            throw NullArgumentException("Null feature");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            Layer& layer = getLayer(layerIndex);
+            auto it = layer.features.find(feature);
+            if (it == layer.features.end()) {
+                return false;
+            }
+            MapBounds changedBounds = it->second->bounds;
+            _spatialIndex->remove(it->second->bounds, it->second);
+            layer.features.erase(it);
+            invalidateTiles(changedBounds);
+        }
+        notifyTilesChanged(false);
+        return true;
+    }
+
+    MapBounds GeoJSONVectorTileDataSource::getDataExtent() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        MapBounds projBounds = _projection->getBounds();
+        MapBounds mapBounds;
+        for (const std::shared_ptr<const IndexedFeature>& indexedFeature : _spatialIndex->getAll()) {
+            const MapBounds& bounds = indexedFeature->bounds;
+            mapBounds.expandToContain(MapPos(projBounds.getMin().getX() + bounds.getMin().getX() * projBounds.getDelta().getX(), projBounds.getMax().getY() - bounds.getMax().getY() * projBounds.getDelta().getY()));
+            mapBounds.expandToContain(MapPos(projBounds.getMin().getX() + bounds.getMax().getX() * projBounds.getDelta().getX(), projBounds.getMax().getY() - bounds.getMin().getY() * projBounds.getDelta().getY()));
+        }
+        return mapBounds;
+    }
+
+    std::shared_ptr<TileData> GeoJSONVectorTileDataSource::loadTile(const MapTile& mapTile) {
+        std::vector<std::shared_ptr<const IndexedFeature> > indexedFeatures;
+        std::map<int, std::string> layerNames;
+        unsigned int generation = 0;
+        MapBounds tileBounds;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            CachedTile cachedTile;
+            if (_tileCache.read(mapTile.getTileId(), cachedTile)) {
+                return cachedTile.second;
+            }
+
+            double tileSize = 1.0 / (1 << mapTile.getZoom());
+            double buffer = tileSize * TILE_BUFFER / TILE_EXTENT;
+            tileBounds = MapBounds(MapPos(mapTile.getX() * tileSize - buffer, mapTile.getY() * tileSize - buffer), MapPos((mapTile.getX() + 1) * tileSize + buffer, (mapTile.getY() + 1) * tileSize + buffer));
+            indexedFeatures = _spatialIndex->query(tileBounds);
+            for (const std::pair<const int, Layer>& layer : _layers) {
+                layerNames[layer.first] = layer.second.name;
+            }
+            generation = _generation;
+        }
+
+        std::shared_ptr<TileData> tileData = buildTile(mapTile, indexedFeatures, layerNames);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_generation == generation) { // do not cache the tile if features were changed meanwhile
+                _tileCache.put(mapTile.getTileId(), CachedTile(tileBounds, tileData), tileData->getData()->size() + sizeof(CachedTile));
+            }
+        }
+        return tileData;
+    }
+
+    GeoJSONVectorTileDataSource::Layer& GeoJSONVectorTileDataSource::getLayer(int layerIndex) {
+        auto it = _layers.find(layerIndex);
+        if (it == _layers.end()) {
+            throw OutOfRangeException("Layer index out of range");
+        }
+        return it->second;
+    }
+
+    std::shared_ptr<const GeoJSONVectorTileDataSource::IndexedFeature> GeoJSONVectorTileDataSource::createIndexedFeature(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<Feature>& feature) {
+        auto indexedFeature = std::make_shared<IndexedFeature>(layerIndex, ++_featureCounter);
+        const Projection* proj = std::dynamic_pointer_cast<EPSG3857>(projection) ? nullptr : projection.get(); // no conversion needed if feature projection matches the tile projection
+        indexedFeature->addGeometry(feature->getGeometry(), proj, *_projection);
+        indexedFeature->addProperties(feature->getProperties());
+        return indexedFeature;
+    }
+
+    void GeoJSONVectorTileDataSource::insertFeatures(int layerIndex, const std::vector<std::shared_ptr<const IndexedFeature> >& indexedFeatures, const std::vector<std::shared_ptr<Feature> >& features, MapBounds& changedBounds) {
+        Layer& layer = _layers[layerIndex];
+        for (std::size_t i = 0; i < features.size(); i++) {
+            auto it = layer.features.find(features[i]);
+            if (it != layer.features.end()) {
+                changedBounds.expandToContain(it->second->bounds);
+                _spatialIndex->remove(it->second->bounds, it->second);
+            }
+            layer.features[features[i]] = indexedFeatures[i];
+            if (!indexedFeatures[i]->empty()) {
+                changedBounds.expandToContain(indexedFeatures[i]->bounds);
+                _spatialIndex->insert(indexedFeatures[i]->bounds, indexedFeatures[i]);
+            }
+        }
+    }
+
+    void GeoJSONVectorTileDataSource::removeFeatures(int layerIndex, MapBounds& changedBounds) {
+        Layer& layer = _layers[layerIndex];
+        for (const std::pair<const std::shared_ptr<Feature>, std::shared_ptr<const IndexedFeature> >& feature : layer.features) {
+            changedBounds.expandToContain(feature.second->bounds);
+            _spatialIndex->remove(feature.second->bounds, feature.second);
+        }
+        layer.features.clear();
+    }
+
+    void GeoJSONVectorTileDataSource::invalidateTiles(const MapBounds& changedBounds) {
+        // Drop only the cached tiles that overlap with the changed area
+        _generation++;
+        for (long long tileId : _tileCache.keys()) {
+            CachedTile cachedTile;
+            if (_tileCache.peek(tileId, cachedTile) && cachedTile.first.intersects(changedBounds)) {
+                _tileCache.remove(tileId);
+            }
+        }
+    }
+
+    std::shared_ptr<TileData> GeoJSONVectorTileDataSource::buildTile(const MapTile& mapTile, const std::vector<std::shared_ptr<const IndexedFeature> >& indexedFeatures, const std::map<int, std::string>& layerNames) const {
+        double scale = static_cast<double>(1 << mapTile.getZoom());
+        double buffer = static_cast<double>(TILE_BUFFER) / TILE_EXTENT;
+        double tolerance = SIMPLIFY_TOLERANCE / TILE_EXTENT / scale;
+        double tolerance2 = tolerance * tolerance;
+        cglib::vec2<double> tileOrigin(mapTile.getX() / scale, mapTile.getY() / scale);
+        double k1 = -buffer / scale, k2 = (1 + buffer) / scale;
+
+        // Keep deterministic feature order within layers
+        std::vector<std::shared_ptr<const IndexedFeature> > sortedFeatures(indexedFeatures);
+        std::sort(sortedFeatures.begin(), sortedFeatures.end(), [](const std::shared_ptr<const IndexedFeature>& feature1, const std::shared_ptr<const IndexedFeature>& feature2) {
+            return feature1->layerIndex != feature2->layerIndex ? feature1->layerIndex < feature2->layerIndex : feature1->id < feature2->id;
+        });
+
+        auto toTileVertices = [&tileOrigin, scale](const Vertices& vertices) {
+            mvt::MBVTTileBuilder::Vertices tileVertices;
+            tileVertices.reserve(vertices.size());
+            for (const cglib::vec2<double>& vertex : vertices) {
+                cglib::vec2<double> tileVertex = (vertex - tileOrigin) * scale;
+                tileVertices.emplace_back(static_cast<float>(tileVertex(0)), static_cast<float>(tileVertex(1)));
+            }
+            return tileVertices;
+        };
+
+        mvt::MBVTTileBuilder tileBuilder(TILE_EXTENT);
+        std::map<int, int> builderLayerIndices;
+        for (const std::shared_ptr<const IndexedFeature>& feature : sortedFeatures) {
+            auto layerNameIt = layerNames.find(feature->layerIndex);
+            if (layerNameIt == layerNames.end()) {
+                continue;
+            }
+            auto layerIt = builderLayerIndices.find(feature->layerIndex);
+            if (layerIt == builderLayerIndices.end()) {
+                layerIt = builderLayerIndices.emplace(feature->layerIndex, tileBuilder.createLayer(layerNameIt->second)).first;
+            }
+            int layerIdx = layerIt->second;
+
+            if (!feature->points.empty()) {
+                Vertices points;
+                for (const cglib::vec2<double>& point : feature->points) {
+                    cglib::vec2<double> relPoint = point - tileOrigin;
+                    if (relPoint(0) >= k1 && relPoint(0) <= k2 && relPoint(1) >= k1 && relPoint(1) <= k2) {
+                        points.push_back(point);
+                    }
+                }
+                tileBuilder.addPoints(layerIdx, feature->id, toTileVertices(points), feature->properties);
+            }
+
+            if (!feature->lines.empty()) {
+                mvt::MBVTTileBuilder::VerticesList tileVerticesList;
+                for (const IndexedFeature::Ring& line : feature->lines) {
+                    MapBounds bounds = line.bounds;
+                    if (bounds.getMax().getX() - tileOrigin(0) < k1 || bounds.getMin().getX() - tileOrigin(0) > k2 || bounds.getMax().getY() - tileOrigin(1) < k1 || bounds.getMin().getY() - tileOrigin(1) > k2) {
+                        continue;
+                    }
+                    std::vector<Vertices> clippedX;
+                    clipLine(IndexedFeature::SimplifyRing(line, tolerance2), 0, tileOrigin(0) + k1, tileOrigin(0) + k2, clippedX);
+                    for (const Vertices& vertices : clippedX) {
+                        std::vector<Vertices> clippedXY;
+                        clipLine(vertices, 1, tileOrigin(1) + k1, tileOrigin(1) + k2, clippedXY);
+                        for (const Vertices& clippedVertices : clippedXY) {
+                            tileVerticesList.push_back(toTileVertices(clippedVertices));
+                        }
+                    }
+                }
+                tileBuilder.addLineStrings(layerIdx, feature->id, tileVerticesList, feature->properties);
+            }
+
+            if (!feature->polygons.empty()) {
+                mvt::MBVTTileBuilder::PolygonList tilePolygons;
+                for (const std::vector<IndexedFeature::Ring>& rings : feature->polygons) {
+                    if (rings.empty()) {
+                        continue;
+                    }
+                    MapBounds bounds = rings.front().bounds;
+                    if (bounds.getMax().getX() - tileOrigin(0) < k1 || bounds.getMin().getX() - tileOrigin(0) > k2 || bounds.getMax().getY() - tileOrigin(1) < k1 || bounds.getMin().getY() - tileOrigin(1) > k2) {
+                        continue;
+                    }
+                    if (bounds.getDelta().getX() < tolerance && bounds.getDelta().getY() < tolerance) {
+                        continue; // polygon too small to be visible at this zoom
+                    }
+
+                    mvt::MBVTTileBuilder::VerticesList tileRings;
+                    for (const IndexedFeature::Ring& ring : rings) {
+                        Vertices vertices = IndexedFeature::SimplifyRing(ring, tolerance2);
+                        vertices = clipRing(vertices, 0, tileOrigin(0) + k1, true);
+                        vertices = clipRing(vertices, 0, tileOrigin(0) + k2, false);
+                        vertices = clipRing(vertices, 1, tileOrigin(1) + k1, true);
+                        vertices = clipRing(vertices, 1, tileOrigin(1) + k2, false);
+                        if (vertices.size() < 3) {
+                            if (tileRings.empty()) {
+                                break; // outer ring is not visible
+                            }
+                            continue;
+                        }
+                        tileRings.push_back(toTileVertices(vertices));
+                    }
+                    if (!tileRings.empty()) {
+                        tilePolygons.push_back(std::move(tileRings));
+                    }
+                }
+                tileBuilder.addPolygons(layerIdx, feature->id, tilePolygons, feature->properties);
+            }
+        }
+
+        std::vector<unsigned char> data;
+        tileBuilder.build(data);
+        return std::make_shared<TileData>(std::make_shared<BinaryData>(std::move(data)));
+    }
+
+    const float GeoJSONVectorTileDataSource::SIMPLIFY_TOLERANCE = 3.0f;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_GEOJSONVECTORTILEDATASOURCE_H_
+#define _CARTO_GEOJSONVECTORTILEDATASOURCE_H_
+
+#include "core/MapBounds.h"
+#include "datasources/TileDataSource.h"
+#include "geometry/utils/SpatialIndex.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdext/timed_lru_cache.h>
+
+namespace carto {
+    class Feature;
+    class FeatureCollection;
+    class Projection;
+
+    /**
+     * A tile data source that generates vector tiles from features kept in local memory.
+     * Features are clipped and simplified for each requested tile and the tiles are encoded in Mapbox vector tile format,
+     * thus they can be styled using CartoCSS and displayed using VectorTileLayer with MBVectorTileDecoder.
+     * Feature properties are stored as feature attributes of the generated tiles.
+     * This is much faster than using LocalVectorDataSource when a large number of features must be displayed.
+     */
+    class GeoJSONVectorTileDataSource : public TileDataSource {
+    public:
+        /**
+         * Constructs a new GeoJSONVectorTileDataSource object.
+         * @param minZoom The minimum zoom for generated tiles.
+         * @param maxZoom The maximum zoom for generated tiles.
+         */
+        GeoJSONVectorTileDataSource(int minZoom, int maxZoom);
+        virtual ~GeoJSONVectorTileDataSource();
+
+        /**
+         * Creates a new layer for the generated tiles. The name of the layer can be used in CartoCSS styles.
+         * @param name The name of the layer.
+         * @return The index of the created layer.
+         */
+        int createLayer(const std::string& name);
+        /**
+         * Deletes the specified layer and all its features.
+         * @param layerIndex The index of the layer to delete.
+         * @throws std::out_of_range If the layer index is invalid.
+         */
+        void deleteLayer(int layerIndex);
+
+        /**
+         * Replaces all features of the specified layer with the features of the given collection.
+         * @param layerIndex The index of the layer.
+         * @param projection The projection of the feature coordinates.
+         * @param featureCollection The feature collection to use.
+         * @throws std::out_of_range If the layer index is invalid.
+         */
+        void setLayerFeatureCollection(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection);
+        /**
+         * Adds all features of the given collection to the specified layer.
+         * @param layerIndex The index of the layer.
+         * @param projection The projection of the feature coordinates.
+         * @param featureCollection The feature collection to add.
+         * @throws std::out_of_range If the layer index is invalid.
+         */
+        void addLayerFeatureCollection(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection);
+        /**
+         * Adds a feature to the specified layer. Only the tiles covering the feature are regenerated.
+         * @param layerIndex The index of the layer.
+         * @param projection The projection of the feature coordinates.
+         * @param feature The feature to add.
+         * @throws std::out_of_range If the layer index is invalid.
+         */
+        void addLayerFeature(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<Feature>& feature);
+        /**
+         * Removes a feature from the specified layer. Only the tiles covering the feature are regenerated.
+         * @param layerIndex The index of the layer.
+         * @param feature The feature to remove.
+         * @return True if the feature was removed, false if it did not exist in the layer.
+         * @throws std::out_of_range If the layer index is invalid.
+         */
+        bool removeLayerFeature(int layerIndex, const std::shared_ptr<Feature>& feature);
+
+        /**
+         * Returns the extent of this data source. Extent is the minimal bounding box encompassing all the features.
+         * @return The minimal bounding box for the features.
+         */
+        MapBounds getDataExtent() const;
+
+        virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
+
+    private:
+        struct IndexedFeature;
+
+        struct Layer {
+            std::string name;
+            std::unordered_map<std::shared_ptr<Feature>, std::shared_ptr<const IndexedFeature> > features;
+        };
+
+        typedef std::pair<MapBounds, std::shared_ptr<TileData> > CachedTile;
+
+        static const int TILE_EXTENT = 4096;
+        static const int TILE_BUFFER = 64;
+        static const float SIMPLIFY_TOLERANCE;
+        static const std::size_t TILE_CACHE_SIZE = 16 * 1024 * 1024;
+
+        Layer& getLayer(int layerIndex);
+
+        std::shared_ptr<const IndexedFeature> createIndexedFeature(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<Feature>& feature);
+        void insertFeatures(int layerIndex, const std::vector<std::shared_ptr<const IndexedFeature> >& indexedFeatures, const std::vector<std::shared_ptr<Feature> >& features, MapBounds& changedBounds);
+        void removeFeatures(int layerIndex, MapBounds& changedBounds);
+        void invalidateTiles(const MapBounds& changedBounds);
+
+        std::shared_ptr<TileData> buildTile(const MapTile& mapTile, const std::vector<std::shared_ptr<const IndexedFeature> >& indexedFeatures, const std::map<int, std::string>& layerNames) const;
+
+        std::map<int, Layer> _layers;
+        int _layerCounter;
+        std::atomic<long long> _featureCounter;
+        std::shared_ptr<SpatialIndex<std::shared_ptr<const IndexedFeature> > > _spatialIndex;
+
+        unsigned int _generation;
+        cache::timed_lru_cache<long long, CachedTile> _tileCache;
+
+        mutable std::mutex _mutex;
+    };
+
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include "geometry/GeometrySimplifier.h"
 #include "geometry/utils/KDTreeSpatialIndex.h"
 #include "geometry/utils/NullSpatialIndex.h"
+#include "geometry/utils/RTreeSpatialIndex.h"
 #include "vectorelements/Point.h"
 #include "vectorelements/Line.h"
 #include "vectorelements/Polygon.h"
@@ -26,6 +27,7 @@ namespace carto {
         VectorDataSource(projection),
         _geometrySimplifier(),
         _spatialIndex(std::make_shared<NullSpatialIndex<std::shared_ptr<VectorElement> > >()),
+        _simplifiedElementCache(),
         _elementId(0),
         _mutex()
     {
@@ -35,6 +37,7 @@ namespace carto {
         VectorDataSource(projection),
         _geometrySimplifier(),
         _spatialIndex(),
+        _simplifiedElementCache(),
         _elementId(0),
         _mutex()
     {
@@ -42,6 +45,9 @@ namespace carto {
             case LocalSpatialIndexType::LOCAL_SPATIAL_INDEX_TYPE_KDTREE:
                 _spatialIndex = std::make_shared<KDTreeSpatialIndex<std::shared_ptr<VectorElement> > >();
                 break;
+            case LocalSpatialIndexType::LOCAL_SPATIAL_INDEX_TYPE_RTREE:
+                _spatialIndex = std::make_shared<RTreeSpatialIndex<std::shared_ptr<VectorElement> > >();
+                break;
             default:
                 _spatialIndex = std::make_shared<NullSpatialIndex<std::shared_ptr<VectorElement> > >();
                 break;
@@ -55,19 +61,30 @@ namespace carto {
         std::lock_guard<std::mutex> lock(_mutex);
         std::vector<std::shared_ptr<VectorElement> > elements = _spatialIndex->query(cullState->getViewState().getFrustum());
         
-        // If geometry simplifier is specified, create new vector elements with simplified geometry
+        // If geometry simplifier is specified, create new vector elements with simplified geometry.
+        // Elements simplified at the same discrete scale are reused, cache entries of elements that are no longer visible are dropped.
         if (_geometrySimplifier) {
-            float simplifierScale = calculateGeometrySimplifierScale(cullState->getViewState());
+            float simplifierScale = calculateDiscreteGeometrySimplifierScale(cullState->getViewState());
 
+            SimplifiedElementCache simplifiedElementCache;
+            simplifiedElementCache.reserve(elements.size());
             std::vector<std::shared_ptr<VectorElement> > simplifiedElements;
             simplifiedElements.reserve(elements.size());
             for (const std::shared_ptr<VectorElement>& element : elements) {
-                std::shared_ptr<VectorElement> simplifiedElement = simplifyElement(element, simplifierScale);
+                std::shared_ptr<VectorElement> simplifiedElement;
+                auto it = _simplifiedElementCache.find(element);
+                if (it != _simplifiedElementCache.end() && it->second.first == simplifierScale) {
+                    simplifiedElement = it->second.second;
+                } else {
+                    simplifiedElement = simplifyElement(element, simplifierScale);
+                }
+                simplifiedElementCache[element] = std::make_pair(simplifierScale, simplifiedElement);
                 if (simplifiedElement) {
                     simplifiedElements.emplace_back(std::move(simplifiedElement));
                 }
             }
             std::swap(elements, simplifiedElements);
+            std::swap(_simplifiedElementCache, simplifiedElementCache);
         }
 
         return std::make_shared<VectorData>(elements);
@@ -79,6 +96,7 @@ namespace carto {
             std::lock_guard<std::mutex> lock(_mutex);
             removedElements = _spatialIndex->getAll();
             _spatialIndex->clear();
+            _simplifiedElementCache.clear();
         }
         if (!removedElements.empty()) {
             notifyElementsRemoved(removedElements);
@@ -104,7 +122,8 @@ namespace carto {
             std::unordered_set<std::shared_ptr<VectorElement> > oldElementSet(oldElements.begin(), oldElements.end());
             
             // Rebuild spatial index, create list of added and removed elements
-            _spatialIndex->clear();
+            std::vector<std::pair<MapBounds, std::shared_ptr<VectorElement> > > indexedElements;
+            indexedElements.reserve(elements.size());
             for (const std::shared_ptr<VectorElement>& element : elements) {
                 const MapBounds& bounds = element->getBounds();
                 MapBounds internalBounds(_projection->toInternal(bounds.getMin()), _projection->toInternal(bounds.getMax()));
@@ -116,9 +135,14 @@ namespace carto {
                     elementsAdded.push_back(element);
                     _elementId++;
                 }
-                _spatialIndex->insert(internalBounds, element);
+                indexedElements.emplace_back(internalBounds, element);
             }
+            _spatialIndex->clear();
+            _spatialIndex->insertAll(indexedElements);
             std::copy(oldElementSet.begin(), oldElementSet.end(), std::back_inserter(elementsRemoved));
+            for (const std::shared_ptr<VectorElement>& element : elementsRemoved) {
+                _simplifiedElementCache.erase(element);
+            }
         }
         if (!elementsAdded.empty()) {
             notifyElementsAdded(elementsAdded);
@@ -153,13 +177,16 @@ namespace carto {
 
         {
             std::lock_guard<std::mutex> lock(_mutex);
+            std::vector<std::pair<MapBounds, std::shared_ptr<VectorElement> > > indexedElements;
+            indexedElements.reserve(elements.size());
             for (const std::shared_ptr<VectorElement>& element : elements) {
                 element->setId(_elementId);
                 const MapBounds& bounds = element->getBounds();
                 MapBounds internalBounds(_projection->toInternal(bounds.getMin()), _projection->toInternal(bounds.getMax()));
-                _spatialIndex->insert(internalBounds, element);
+                indexedElements.emplace_back(internalBounds, element);
                 _elementId++;
             }
+            _spatialIndex->insertAll(indexedElements);
         }
         if (!elements.empty()) {
             notifyElementsAdded(elements);
@@ -177,6 +204,7 @@ namespace carto {
             const MapBounds& bounds = element->getBounds();
             MapBounds internalBounds(_projection->toInternal(bounds.getMin()), _projection->toInternal(bounds.getMax()));
             removed = _spatialIndex->remove(internalBounds, element);
+            _simplifiedElementCache.erase(element);
         }
         if (removed) {
             notifyElementRemoved(element);
@@ -200,6 +228,7 @@ namespace carto {
                 if (_spatialIndex->remove(internalBounds, element)) {
                     removedElements.push_back(element);
                 }
+                _simplifiedElementCache.erase(element);
             }
         }
         if (!removedElements.empty()) {
@@ -217,6 +246,7 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _geometrySimplifier = simplifier;
+            _simplifiedElementCache.clear();
         }
         notifyElementsChanged();
     }
@@ -284,6 +314,7 @@ namespace carto {
     void LocalVectorDataSource::notifyElementChanged(const std::shared_ptr<VectorElement>& element) {
         {
             std::lock_guard<std::mutex> lock(_mutex);
+            _simplifiedElementCache.erase(element);
             if (!(std::dynamic_pointer_cast<NullSpatialIndex<std::shared_ptr<VectorElement> > >(_spatialIndex))) {
                 _spatialIndex->remove(element);
                 const MapBounds& bounds = element->getBounds();
@@ -12,6 +12,8 @@
 #include "geometry/utils/SpatialIndex.h"
 
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 namespace carto {
 
@@ -28,7 +30,13 @@ namespace carto {
             /**
              * K-d tree index, element culling is exact and fast.
              */
-            LOCAL_SPATIAL_INDEX_TYPE_KDTREE
+            LOCAL_SPATIAL_INDEX_TYPE_KDTREE,
+
+            /**
+             * R-tree index, element culling is exact and fast. Uses less memory than k-d tree
+             * and is faster to build when elements are added in bulk using addAll() or setAll().
+             */
+            LOCAL_SPATIAL_INDEX_TYPE_RTREE
         };
     }
 
@@ -127,8 +135,11 @@ namespace carto {
         virtual void notifyElementChanged(const std::shared_ptr<VectorElement>& element);
 
     private:
+        typedef std::unordered_map<std::shared_ptr<VectorElement>, std::pair<float, std::shared_ptr<VectorElement> > > SimplifiedElementCache;
+
         std::shared_ptr<GeometrySimplifier> _geometrySimplifier;
         std::shared_ptr<SpatialIndex<std::shared_ptr<VectorElement> > > _spatialIndex;
+        SimplifiedElementCache _simplifiedElementCache;
         
         unsigned int _elementId;
 
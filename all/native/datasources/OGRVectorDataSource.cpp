@@ -100,6 +100,7 @@ namespace carto {
         _geometrySimplifier(),
         _localElementId(-1),
         _localElements(),
+        _simplifiedGeometryCache(),
         _dataBase(std::make_shared<OGRVectorDataBase>(fileName, false)),
         _poLayer(),
         _poLayerSpatialRef()
@@ -124,6 +125,7 @@ namespace carto {
         _geometrySimplifier(),
         _localElementId(-1),
         _localElements(),
+        _simplifiedGeometryCache(),
         _dataBase(dataBase),
         _poLayer(),
         _poLayerSpatialRef()
@@ -169,6 +171,7 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_dataBase->_mutex);
             _geometrySimplifier = simplifier;
+            _simplifiedGeometryCache.clear();
         }
         notifyElementsChanged();
     }
@@ -343,6 +346,9 @@ namespace carto {
                 it = _localElements.erase(--it);
             }
             
+            // Committed features may have new geometry
+            _simplifiedGeometryCache.clear();
+
             OGRErr err = _poLayer->SyncToDisk();
             if (err != OGRERR_NONE) {
                 Log::Errorf("OGRVectorDataSource::commit: SyncToDisk failed, error code: %d", (int)err);
@@ -463,7 +469,8 @@ namespace carto {
             return std::shared_ptr<VectorData>();
         }
 
-        float simplifierScale = calculateGeometrySimplifierScale(cullState->getViewState());
+        float simplifierScale = calculateDiscreteGeometrySimplifierScale(cullState->getViewState());
+        std::unordered_map<long long, std::pair<float, std::shared_ptr<Geometry> > > simplifiedGeometryCache;
 
         MapBounds bounds;
         for (const MapPos& mapPosInternal : cullState->getEnvelope().getConvexHull()) {
@@ -483,8 +490,32 @@ namespace carto {
                 continue;
             }
 
-            OGRGeometry* poGeometry = poFeature->GetGeometryRef();
-            if (!poGeometry) {
+            // Simplified geometry is reused while the discrete simplifier scale stays the same. Features without FIDs are not cached, as these can not be told apart
+            std::shared_ptr<Geometry> geometry;
+            if (_geometrySimplifier) {
+                bool cacheable = poFeature->GetFID() != OGRNullFID;
+                auto geometryIt = (cacheable ? _simplifiedGeometryCache.find(poFeature->GetFID()) : _simplifiedGeometryCache.end());
+                if (geometryIt != _simplifiedGeometryCache.end() && geometryIt->second.first == simplifierScale) {
+                    geometry = geometryIt->second.second;
+                } else {
+                    OGRGeometry* poGeometry = poFeature->GetGeometryRef();
+                    if (poGeometry) {
+                        geometry = createGeometry(poGeometry);
+                        if (geometry) {
+                            geometry = _geometrySimplifier->simplify(geometry, simplifierScale);
+                        }
+                    }
+                }
+                if (cacheable) {
+                    simplifiedGeometryCache[poFeature->GetFID()] = std::make_pair(simplifierScale, geometry);
+                }
+            } else {
+                OGRGeometry* poGeometry = poFeature->GetGeometryRef();
+                if (poGeometry) {
+                    geometry = createGeometry(poGeometry);
+                }
+            }
+            if (!geometry) {
                 continue;
             }
 
@@ -520,23 +551,16 @@ namespace carto {
                     metaData[poFDefn->GetFieldDefn(i)->GetNameRef()] = value;
                 }
             }
-                
-            std::shared_ptr<Geometry> geometry = createGeometry(poGeometry);
-            if (_geometrySimplifier) {
-                if (geometry) {
-                    geometry = _geometrySimplifier->simplify(geometry, simplifierScale);
-                }
-            }
-            if (geometry) {
-                std::shared_ptr<VectorElement> vectorElement = createVectorElement(cullState->getViewState(), geometry, metaData);
-                if (vectorElement) {
-                    vectorElement->setId(poFeature->GetFID());
-                    vectorElement->setMetaData(metaData);
-                    attachElement(vectorElement);
-                    elements.push_back(std::move(vectorElement));
-                }
+
+            std::shared_ptr<VectorElement> vectorElement = createVectorElement(cullState->getViewState(), geometry, metaData);
+            if (vectorElement) {
+                vectorElement->setId(poFeature->GetFID());
+                vectorElement->setMetaData(metaData);
+                attachElement(vectorElement);
+                elements.push_back(std::move(vectorElement));
             }
         }
+        std::swap(_simplifiedGeometryCache, simplifiedGeometryCache);
         
         for (auto elementIt = _localElements.begin(); elementIt != _localElements.end(); elementIt++) {
             if (elementIt->first < 0 && elementIt->second) {
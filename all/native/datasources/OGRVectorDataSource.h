@@ -14,6 +14,8 @@
 #include "datasources/OGRVectorDataBase.h"
 
 #include <map>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 class OGRGeometry;
@@ -224,6 +226,8 @@ namespace carto {
         long long _localElementId;
         std::map<long long, std::shared_ptr<VectorElement> > _localElements;
 
+        std::unordered_map<long long, std::pair<float, std::shared_ptr<Geometry> > > _simplifiedGeometryCache;
+
         std::shared_ptr<OGRVectorDataBase> _dataBase;
         OGRLayer* _poLayer;
         std::shared_ptr<LayerSpatialReference> _poLayerSpatialRef;
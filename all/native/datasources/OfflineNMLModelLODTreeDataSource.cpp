@@ -12,18 +12,44 @@
 
 #include <cglib/frustum3.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace carto {
 
     OfflineNMLModelLODTreeDataSource::OfflineNMLModelLODTreeDataSource(const std::string& fileName) :
         NMLModelLODTreeDataSource(std::make_shared<EPSG3857>()),
-        _db()
+        _db(),
+        _mapTileRecords(),
+        _mapTileNodeBounds(),
+        _mapTileLevelOffsets(),
+        _modelLODTreeQuery(),
+        _proxyBindingsQuery(),
+        _meshBindingsQuery(),
+        _textureBindingsQuery()
     {
         try {
             _db.reset(new sqlite3pp::database(fileName.c_str()));
             _db->execute("PRAGMA encoding='UTF-8'");
+
+            _modelLODTreeQuery.reset(new sqlite3pp::query(*_db, "SELECT id, LENGTH(nmlmodellodtree), nmlmodellodtree FROM ModelLODTrees WHERE id=:id"));
+            _proxyBindingsQuery.reset(new sqlite3pp::query(*_db, "SELECT * FROM ModelInfo WHERE modellodtree_id=:modellodtree_id"));
+            _textureBindingsQuery.reset(new sqlite3pp::query(*_db, "SELECT node_id, local_id, texture_id, level FROM ModelLODTreeNodeTextures WHERE modellodtree_id=:modellodtree_id"));
         } catch (const std::exception& e) {
             throw FileException("Failed to open database", fileName);
         }
+
+        try {
+            _meshBindingsQuery.reset(new sqlite3pp::query(*_db, "SELECT node_id, local_id, mesh_id, LENGTH(nmlmeshop), nmlmeshop FROM ModelLODTreeNodeMeshes WHERE modellodtree_id=:modellodtree_id"));
+        } catch (const sqlite3pp::database_error& ) {
+            Log::Error("OfflineNMLModelLODTreeDataSource: Mesh query failed. Legacy database without 'nmlmeshop' column?");
+        }
+
+        try {
+            buildMapTileIndex();
+        } catch (const std::exception& e) {
+            throw FileException("Failed to read map tiles from database", fileName);
+        }
     }
     
     OfflineNMLModelLODTreeDataSource::~OfflineNMLModelLODTreeDataSource() {
@@ -48,36 +74,31 @@ namespace carto {
         Frustum frustum(cglib::gl_projection_frustum(cullState->getViewState().getModelviewProjectionMat()));
     
         MapBounds bounds(_projection->fromInternal(cullState->getEnvelope().getBounds().getMin()), _projection->fromInternal(cullState->getEnvelope().getBounds().getMax()));
-        
-        sqlite3pp::query query(*_db, "SELECT id, modellodtree_id, mappos_x, mappos_y, groundheight, mapbounds_x0, mapbounds_y0, mapbounds_x1, mapbounds_y1 FROM MapTiles WHERE ((mapbounds_x1>=:x0 AND mapbounds_x0<=:x1) OR (mapbounds_x1>=:x0 + :width AND mapbounds_x0<=:x1 + :width) OR (mapbounds_x1>=:x0 - :width AND mapbounds_x0<=:x1 - :width)) AND (mapbounds_y1>=:y0 AND mapbounds_y0<=:y1)");
-        query.bind(":x0", bounds.getMin().getX());
-        query.bind(":y0", bounds.getMin().getY());
-        query.bind(":x1", bounds.getMax().getX());
-        query.bind(":y1", bounds.getMax().getY());
-        query.bind(":width", _projection->getBounds().getDelta().getX());
-        for (auto qit = query.begin(); qit != query.end(); qit++) {
-            long long mapTileId = (*qit).get<uint64_t>(0);
-            
-            long long modelLODTreeId = (*qit).get<uint64_t>(1);
-            double mapPosX = (*qit).get<double>(2);
-            double mapPosY = (*qit).get<double>(3);
-            double mapPosZ = (*qit).get<double>(4);
-            double mapBoundsX0 = (*qit).get<double>(5);
-            double mapBoundsY0 = (*qit).get<double>(6);
-            double mapBoundsX1 = (*qit).get<double>(7);
-            double mapBoundsY1 = (*qit).get<double>(8);
-    
-            MapPos intMinPos(_projection->toInternal(MapPos(mapBoundsX0, mapBoundsY0, mapPosZ)));
-            MapPos intMaxPos(_projection->toInternal(MapPos(mapBoundsX1, mapBoundsY1, mapPosZ + MAX_HEIGHT)));
+
+        // Query the index for the view bounds and for the bounds wrapped over the date line
+        double width = _projection->getBounds().getDelta().getX();
+        std::vector<std::size_t> recordIndices;
+        for (int i = -1; i <= 1; i++) {
+            MapPos minPos(bounds.getMin().getX() + i * width, bounds.getMin().getY());
+            MapPos maxPos(bounds.getMax().getX() + i * width, bounds.getMax().getY());
+            queryMapTileIndex(MapBounds(minPos, maxPos), recordIndices);
+        }
+        std::sort(recordIndices.begin(), recordIndices.end());
+        recordIndices.erase(std::unique(recordIndices.begin(), recordIndices.end()), recordIndices.end());
+
+        for (std::size_t recordIndex : recordIndices) {
+            const MapTileRecord& record = _mapTileRecords[recordIndex];
+            double mapPosZ = record.mapTile.mapPos.getZ();
+    
+            MapPos intMinPos(_projection->toInternal(MapPos(record.mapBounds.getMin().getX(), record.mapBounds.getMin().getY(), mapPosZ)));
+            MapPos intMaxPos(_projection->toInternal(MapPos(record.mapBounds.getMax().getX(), record.mapBounds.getMax().getY(), mapPosZ + MAX_HEIGHT)));
             BoundingBox bbox(Point(intMinPos.getX(), intMinPos.getY(), intMinPos.getZ()), Point(intMaxPos.getX(), intMaxPos.getY(), intMaxPos.getZ()));
             if (!frustum.inside(bbox)) {
                 continue;
             }
     
-            MapTile mapTile(mapTileId, MapPos(mapPosX, mapPosY, mapPosZ), modelLODTreeId);
-            mapTiles.push_back(mapTile);
+            mapTiles.push_back(record.mapTile);
         }
-        query.finish();
         return mapTiles;
     }
     
@@ -89,15 +110,18 @@ namespace carto {
             return std::shared_ptr<NMLModelLODTree>();
         }
     
-        sqlite3pp::query query(*_db, "SELECT id, LENGTH(nmlmodellodtree), nmlmodellodtree FROM ModelLODTrees WHERE id=:id");
+        sqlite3pp::query& query = *_modelLODTreeQuery;
+        query.reset();
         query.bind(":id", static_cast<uint64_t>(mapTile.modelLODTreeId));
         for (auto qit = query.begin(); qit != query.end(); qit++) {
             long long modelLODTreeId = (*qit).get<uint64_t>(0);
             std::size_t nmlModelLODTreeSize = (*qit).get<uint32_t>(1);
             const void * nmlModelLODTreeData = (*qit).get<const void *>(2);
             std::shared_ptr<nml::ModelLODTree> sourceModelLODTree = std::make_shared<nml::ModelLODTree>(protobuf::message(nmlModelLODTreeData, nmlModelLODTreeSize));
+            query.reset();
     
-            sqlite3pp::query queryProxyBindings(*_db, "SELECT * FROM ModelInfo WHERE modellodtree_id=:modellodtree_id");
+            sqlite3pp::query& queryProxyBindings = *_proxyBindingsQuery;
+            queryProxyBindings.reset();
             queryProxyBindings.bind(":modellodtree_id", static_cast<uint64_t>(modelLODTreeId));
             NMLModelLODTree::ProxyMap proxyMap;
             for (auto qitProxyBindings = queryProxyBindings.begin(); qitProxyBindings != queryProxyBindings.end(); qitProxyBindings++) {
@@ -121,11 +145,12 @@ namespace carto {
     
                 proxyMap.emplace(modelId, NMLModelLODTree::Proxy(modelId, mapPos, metaData));
             }
-            queryProxyBindings.finish();
+            queryProxyBindings.reset();
     
             NMLModelLODTree::MeshBindingsMap meshBindingsMap;
-            try {
-                sqlite3pp::query queryMeshBindings(*_db, "SELECT node_id, local_id, mesh_id, LENGTH(nmlmeshop), nmlmeshop FROM ModelLODTreeNodeMeshes WHERE modellodtree_id=:modellodtree_id");
+            if (_meshBindingsQuery) {
+                sqlite3pp::query& queryMeshBindings = *_meshBindingsQuery;
+                queryMeshBindings.reset();
                 queryMeshBindings.bind(":modellodtree_id", static_cast<uint64_t>(modelLODTreeId));
                 for (auto qitMeshBindings = queryMeshBindings.begin(); qitMeshBindings != queryMeshBindings.end(); qitMeshBindings++) {
                     int nodeId = (*qitMeshBindings).get<uint32_t>(0);
@@ -140,12 +165,11 @@ namespace carto {
                         meshBindingsMap[nodeId].push_back(NMLModelLODTree::MeshBinding(meshId, localId));
                     }
                 }
-                queryMeshBindings.finish();
-            } catch (const sqlite3pp::database_error& ) {
-                Log::Error("OfflineNMLModelLODTreeDataSource: Mesh query failed. Legacy database without 'nmlmeshop' column?");
+                queryMeshBindings.reset();
             }
     
-            sqlite3pp::query queryTexBindings(*_db, "SELECT node_id, local_id, texture_id, level FROM ModelLODTreeNodeTextures WHERE modellodtree_id=:modellodtree_id");
+            sqlite3pp::query& queryTexBindings = *_textureBindingsQuery;
+            queryTexBindings.reset();
             queryTexBindings.bind(":modellodtree_id", static_cast<uint64_t>(modelLODTreeId));
             NMLModelLODTree::TextureBindingsMap textureBindingsMap;
             for (auto qitTexBindings = queryTexBindings.begin(); qitTexBindings != queryTexBindings.end(); qitTexBindings++) {
@@ -155,54 +179,159 @@ namespace carto {
                 int level = (*qitTexBindings).get<uint32_t>(3);
                 textureBindingsMap[nodeId].push_back(NMLModelLODTree::TextureBinding(textureId, level, localId));
             }
-            queryTexBindings.finish();
+            queryTexBindings.reset();
     
             std::shared_ptr<NMLModelLODTree> modelLODTree = std::make_shared<NMLModelLODTree>(modelLODTreeId, mapTile.mapPos, _projection, sourceModelLODTree, proxyMap, meshBindingsMap, textureBindingsMap);
             return modelLODTree;
         }
-        query.finish();
+        query.reset();
         return std::shared_ptr<NMLModelLODTree>();
     }
     
     std::shared_ptr<nml::Mesh> OfflineNMLModelLODTreeDataSource::loadMesh(long long meshId) {
-        std::lock_guard<std::mutex> lock(_mutex);
+        // Only read the blob while holding the lock, decoding can run in parallel with other loaders
+        std::string nmlMeshData;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
     
-        if (!_db) {
-            Log::Error("OfflineNMLModelLODTreeDataSource::loadMesh: Failed to load mesh, could not connect to database");
-            return std::shared_ptr<nml::Mesh>();
-        }
+            if (!_db) {
+                Log::Error("OfflineNMLModelLODTreeDataSource::loadMesh: Failed to load mesh, could not connect to database");
+                return std::shared_ptr<nml::Mesh>();
+            }
     
-        sqlite3pp::query query(*_db, "SELECT LENGTH(nmlmesh), nmlmesh FROM Meshes WHERE id=:source_id");
-        query.bind(":source_id", static_cast<uint64_t>(meshId));
-        for (auto qit = query.begin(); qit != query.end(); qit++) {
+            sqlite3pp::query query(*_db, "SELECT LENGTH(nmlmesh), nmlmesh FROM Meshes WHERE id=:source_id");
+            query.bind(":source_id", static_cast<uint64_t>(meshId));
+            auto qit = query.begin();
+            if (qit == query.end()) {
+                return std::shared_ptr<nml::Mesh>();
+            }
             std::size_t nmlMeshSize = (*qit).get<uint32_t>(0);
-            const void * nmlMeshData = (*qit).get<const void *>(1);
-            std::shared_ptr<nml::Mesh> mesh = std::make_shared<nml::Mesh>(protobuf::message(nmlMeshData, nmlMeshSize));
-            return mesh;
+            const char * nmlMeshBytes = static_cast<const char *>((*qit).get<const void *>(1));
+            nmlMeshData.assign(nmlMeshBytes, nmlMeshBytes + nmlMeshSize);
+            query.finish();
         }
-        query.finish();
-        return std::shared_ptr<nml::Mesh>();
+
+        return std::make_shared<nml::Mesh>(protobuf::message(nmlMeshData.data(), nmlMeshData.size()));
     }
     
     std::shared_ptr<nml::Texture> OfflineNMLModelLODTreeDataSource::loadTexture(long long textureId, int level) {
-        std::lock_guard<std::mutex> lock(_mutex);
+        // Only read the blob while holding the lock, decoding can run in parallel with other loaders
+        std::string nmlTextureData;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
     
-        if (!_db) {
-            Log::Error("OfflineNMLModelLODTreeDataSource::loadTexture: Failed to load texture, could not connect to database");
-            return std::shared_ptr<nml::Texture>();
-        }
+            if (!_db) {
+                Log::Error("OfflineNMLModelLODTreeDataSource::loadTexture: Failed to load texture, could not connect to database");
+                return std::shared_ptr<nml::Texture>();
+            }
     
-        sqlite3pp::query query(*_db, "SELECT LENGTH(nmltexture), nmltexture FROM Textures WHERE id=:source_id AND textures.level=:level ORDER BY textures.level ASC");
-        query.bind(":source_id", static_cast<uint64_t>(textureId));
-        query.bind(":level", level);
-        for (auto qit = query.begin(); qit != query.end(); qit++) {
+            sqlite3pp::query query(*_db, "SELECT LENGTH(nmltexture), nmltexture FROM Textures WHERE id=:source_id AND textures.level=:level ORDER BY textures.level ASC");
+            query.bind(":source_id", static_cast<uint64_t>(textureId));
+            query.bind(":level", level);
+            auto qit = query.begin();
+            if (qit == query.end()) {
+                return std::shared_ptr<nml::Texture>();
+            }
             std::size_t nmlTextureSize = (*qit).get<uint32_t>(0);
-            const void * nmlTextureData = (*qit).get<const void *>(1);
-            std::shared_ptr<nml::Texture> texture = std::make_shared<nml::Texture>(protobuf::message(nmlTextureData, nmlTextureSize));
-            return texture;
+            const char * nmlTextureBytes = static_cast<const char *>((*qit).get<const void *>(1));
+            nmlTextureData.assign(nmlTextureBytes, nmlTextureBytes + nmlTextureSize);
+            query.finish();
+        }
+
+        return std::make_shared<nml::Texture>(protobuf::message(nmlTextureData.data(), nmlTextureData.size()));
+    }
+
+    void OfflineNMLModelLODTreeDataSource::buildMapTileIndex() {
+        sqlite3pp::query query(*_db, "SELECT id, modellodtree_id, mappos_x, mappos_y, groundheight, mapbounds_x0, mapbounds_y0, mapbounds_x1, mapbounds_y1 FROM MapTiles");
+        for (auto qit = query.begin(); qit != query.end(); qit++) {
+            long long mapTileId = (*qit).get<uint64_t>(0);
+            long long modelLODTreeId = (*qit).get<uint64_t>(1);
+            MapPos mapPos((*qit).get<double>(2), (*qit).get<double>(3), (*qit).get<double>(4));
+            MapBounds mapBounds(MapPos((*qit).get<double>(5), (*qit).get<double>(6)), MapPos((*qit).get<double>(7), (*qit).get<double>(8)));
+            _mapTileRecords.emplace_back(MapTile(mapTileId, mapPos, modelLODTreeId), mapBounds);
         }
         query.finish();
-        return std::shared_ptr<nml::Texture>();
+
+        if (_mapTileRecords.empty()) {
+            return;
+        }
+
+        // Sort-tile-recursive packing: sort records into vertical slices by x coordinate, then each slice by y coordinate
+        std::size_t leafCount = (_mapTileRecords.size() + MAP_TILE_INDEX_NODE_SIZE - 1) / MAP_TILE_INDEX_NODE_SIZE;
+        std::size_t sliceCount = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leafCount))));
+        std::size_t sliceSize = sliceCount * MAP_TILE_INDEX_NODE_SIZE;
+        std::sort(_mapTileRecords.begin(), _mapTileRecords.end(), [](const MapTileRecord& record1, const MapTileRecord& record2) {
+            return record1.mapBounds.getCenter().getX() < record2.mapBounds.getCenter().getX();
+        });
+        for (std::size_t i = 0; i < _mapTileRecords.size(); i += sliceSize) {
+            auto sliceEnd = (_mapTileRecords.size() - i > sliceSize ? _mapTileRecords.begin() + i + sliceSize : _mapTileRecords.end());
+            std::sort(_mapTileRecords.begin() + i, sliceEnd, [](const MapTileRecord& record1, const MapTileRecord& record2) {
+                return record1.mapBounds.getCenter().getY() < record2.mapBounds.getCenter().getY();
+            });
+        }
+
+        // Build node levels bottom-up, each node covering up to MAP_TILE_INDEX_NODE_SIZE consecutive entries of the level below
+        _mapTileLevelOffsets.push_back(0);
+        for (std::size_t i = 0; i < _mapTileRecords.size(); i++) {
+            if (i % MAP_TILE_INDEX_NODE_SIZE == 0) {
+                _mapTileNodeBounds.push_back(_mapTileRecords[i].mapBounds);
+            } else {
+                _mapTileNodeBounds.back().expandToContain(_mapTileRecords[i].mapBounds);
+            }
+        }
+        _mapTileLevelOffsets.push_back(_mapTileNodeBounds.size());
+        while (_mapTileLevelOffsets[_mapTileLevelOffsets.size() - 1] - _mapTileLevelOffsets[_mapTileLevelOffsets.size() - 2] > 1) {
+            std::size_t levelBegin = _mapTileLevelOffsets[_mapTileLevelOffsets.size() - 2];
+            std::size_t levelEnd = _mapTileLevelOffsets[_mapTileLevelOffsets.size() - 1];
+            for (std::size_t i = levelBegin; i < levelEnd; i++) {
+                if ((i - levelBegin) % MAP_TILE_INDEX_NODE_SIZE == 0) {
+                    _mapTileNodeBounds.push_back(_mapTileNodeBounds[i]);
+                } else {
+                    _mapTileNodeBounds.back().expandToContain(_mapTileNodeBounds[i]);
+                }
+            }
+            _mapTileLevelOffsets.push_back(_mapTileNodeBounds.size());
+        }
+    }
+
+    void OfflineNMLModelLODTreeDataSource::queryMapTileIndex(const MapBounds& bounds, std::vector<std::size_t>& recordIndices) const {
+        if (_mapTileRecords.empty()) {
+            return;
+        }
+
+        // Traverse from the root node, which is the single node of the topmost level
+        std::vector<std::pair<std::size_t, std::size_t> > nodeStack; // level, node index within level
+        nodeStack.emplace_back(_mapTileLevelOffsets.size() - 2, 0);
+        while (!nodeStack.empty()) {
+            std::size_t level = nodeStack.back().first;
+            std::size_t nodeIndex = nodeStack.back().second;
+            nodeStack.pop_back();
+
+            if (!bounds.intersects(_mapTileNodeBounds[_mapTileLevelOffsets[level] + nodeIndex])) {
+                continue;
+            }
+
+            std::size_t childBegin = nodeIndex * MAP_TILE_INDEX_NODE_SIZE;
+            if (level == 0) {
+                std::size_t childEnd = childBegin + MAP_TILE_INDEX_NODE_SIZE;
+                if (childEnd > _mapTileRecords.size()) {
+                    childEnd = _mapTileRecords.size();
+                }
+                for (std::size_t i = childBegin; i < childEnd; i++) {
+                    if (bounds.intersects(_mapTileRecords[i].mapBounds)) {
+                        recordIndices.push_back(i);
+                    }
+                }
+            } else {
+                std::size_t childEnd = childBegin + MAP_TILE_INDEX_NODE_SIZE;
+                if (childEnd > _mapTileLevelOffsets[level] - _mapTileLevelOffsets[level - 1]) {
+                    childEnd = _mapTileLevelOffsets[level] - _mapTileLevelOffsets[level - 1];
+                }
+                for (std::size_t i = childBegin; i < childEnd; i++) {
+                    nodeStack.emplace_back(level - 1, i);
+                }
+            }
+        }
     }
     
 }
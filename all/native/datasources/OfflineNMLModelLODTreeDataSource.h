@@ -10,9 +10,13 @@
 #if defined(_CARTO_NMLMODELLODTREE_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
 #include "datasources/NMLModelLODTreeDataSource.h"
+#include "core/MapBounds.h"
+
+#include <vector>
 
 namespace sqlite3pp {
     class database;
+    class query;
 }
 
 namespace carto {
@@ -37,7 +41,30 @@ namespace carto {
         virtual std::shared_ptr<nml::Texture> loadTexture(long long textureId, int level);
 
     private:
+        struct MapTileRecord {
+            MapTile mapTile;
+            MapBounds mapBounds;
+
+            MapTileRecord(const MapTile& mapTile, const MapBounds& mapBounds) : mapTile(mapTile), mapBounds(mapBounds) { }
+        };
+
+        static const std::size_t MAP_TILE_INDEX_NODE_SIZE = 16;
+
+        void buildMapTileIndex();
+        void queryMapTileIndex(const MapBounds& bounds, std::vector<std::size_t>& recordIndices) const;
+
         std::unique_ptr<sqlite3pp::database> _db;
+
+        // Packed R-tree over all map tiles, built when the database is opened. Records are stored in packing order,
+        // node bounds are stored level by level, starting from the leaf level.
+        std::vector<MapTileRecord> _mapTileRecords;
+        std::vector<MapBounds> _mapTileNodeBounds;
+        std::vector<std::size_t> _mapTileLevelOffsets;
+
+        std::unique_ptr<sqlite3pp::query> _modelLODTreeQuery;
+        std::unique_ptr<sqlite3pp::query> _proxyBindingsQuery;
+        std::unique_ptr<sqlite3pp::query> _meshBindingsQuery;
+        std::unique_ptr<sqlite3pp::query> _textureBindingsQuery;
     };
 
 }
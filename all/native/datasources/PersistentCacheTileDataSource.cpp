@@ -3,6 +3,9 @@
 #include "core/MapTile.h"
 #include "utils/Log.h"
 
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
 
 #include <sqlite3pp.h>
@@ -11,10 +14,31 @@ namespace carto {
     
     PersistentCacheTileDataSource::PersistentCacheTileDataSource(const std::shared_ptr<TileDataSource>& dataSource, const std::string& databasePath) :
         CacheTileDataSource(dataSource),
+        _databasePath(databasePath),
         _database(),
+        _insertCommand(),
+        _deleteCommand(),
+        _databaseMutex(),
         _cacheOnlyMode(false),
         _cache(DEFAULT_CAPACITY),
-        _mutex()
+        _mutex(),
+        _indexState(IndexState::NOT_LOADED),
+        _indexEntries(),
+        _indexSequences(),
+        _indexSequence(0),
+        _indexRemovedTileIds(),
+        _rebuiltIndexEntries(),
+        _indexRebuilt(false),
+        _indexRebuildCanceled(false),
+        _indexRebuildThread(),
+        _indexMutex(),
+        _stagedTiles(),
+        _stagedDataSize(0),
+        _stagedSequence(0),
+        _writerStopped(false),
+        _writerThread(),
+        _stagingMutex(),
+        _stagingCondition()
     {
         openDatabase(databasePath);
     }
@@ -41,6 +65,8 @@ namespace carto {
         if (!_database) {
             Log::Error("PersistentCacheTileDataSource::loadTile: Could not connect to the database, loading tile without caching");
         }
+
+        updateIndex();
         
         std::shared_ptr<TileData> tileData;
 
@@ -51,8 +77,20 @@ namespace carto {
                 if (tileData->getMaxAge() != 0) {
                     return tileData;
                 }
+            } else {
+                Log::Error("PersistentCacheTileDataSource::loadTile: Inconsistency, tile data does not exist in the database");
             }
             _cache.remove(mapTile.getTileId());
+            tileIdPtr.reset();
+        } else if (_indexState != IndexState::LOADED) {
+            // Index is not available yet, check the database directly
+            tileData = get(mapTile.getTileId());
+            if (tileData) {
+                if (tileData->getMaxAge() != 0) {
+                    addIndexEntry(mapTile.getTileId(), createTileId(mapTile.getTileId()), tileData->getData()->size());
+                    return tileData;
+                }
+            }
         }
         
         if (!_cacheOnlyMode) {
@@ -63,9 +101,10 @@ namespace carto {
     
         if (tileData) {
             if (tileData->getMaxAge() != 0 && !tileData->isReplaceWithParent() && tileData->getData()) {
-                _cache.put(mapTile.getTileId(), createTileId(mapTile.getTileId()), tileData->getData()->size());
-                if (_cache.exists(mapTile.getTileId())) { // make sure the tile was added
-                    store(mapTile.getTileId(), tileData);
+                if (addIndexEntry(mapTile.getTileId(), createTileId(mapTile.getTileId()), tileData->getData()->size())) {
+                    if (!store(mapTile.getTileId(), tileData)) {
+                        _cache.remove(mapTile.getTileId()); // tile was not cached, this also removes any older version from the database
+                    }
                 }
             }
         } else {
@@ -83,7 +122,45 @@ namespace carto {
     void PersistentCacheTileDataSource::clear() {
         try {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
-            _cache.clear(); // forces all elements to be removed, but can be slow
+            if (!_database) {
+                _cache.clear();
+                return;
+            }
+
+            // Cancel index rebuilding, the rebuilt index would refer to removed tiles
+            _indexRebuildCanceled = true;
+            if (_indexRebuildThread) {
+                _indexRebuildThread->join();
+                _indexRebuildThread.reset();
+            }
+            {
+                std::lock_guard<std::mutex> indexLock(_indexMutex);
+                _indexRebuilt = false;
+                std::vector<IndexEntry>().swap(_rebuiltIndexEntries);
+            }
+
+            // Removed tiles are staged for deletion here, but the staging area is dropped below anyway
+            _cache.clear();
+            _indexEntries.clear();
+            _indexSequences.clear();
+            _indexRemovedTileIds.clear();
+            _indexState = IndexState::LOADED;
+
+            // Drop staged tiles and all stored tiles, including the index snapshot, so that nothing is reloaded later
+            std::lock_guard<std::mutex> databaseLock(_databaseMutex);
+            {
+                std::lock_guard<std::mutex> stagingLock(_stagingMutex);
+                _stagedTiles.clear();
+                _stagedDataSize = 0;
+            }
+            sqlite3pp::transaction xct(*_database);
+            {
+                sqlite3pp::command command1(*_database, "DELETE FROM persistent_cache");
+                command1.execute();
+                sqlite3pp::command command2(*_database, "DELETE FROM persistent_cache_index");
+                command2.execute();
+                xct.commit();
+            }
         } catch (const std::exception& e) {
             Log::Errorf("PersistentCacheTileDataSource::clear: Failed to clear cache: %s", e.what());
         }
@@ -113,10 +190,18 @@ namespace carto {
             command1.execute();
             command1.finish();
             
-            sqlite3pp::command command2(*_database, "PRAGMA cache_size=1"); // use minimal amount of cache
+            sqlite3pp::command command2(*_database, "PRAGMA cache_size=256"); // use small amount of cache, writes are batched anyway
             command2.execute();
             command2.finish();
 
+            sqlite3pp::query query0(*_database, "PRAGMA journal_mode=WAL");
+            for (auto it0 = query0.begin(); it0 != query0.end(); ++it0);
+            query0.finish();
+
+            sqlite3pp::command command4(*_database, "PRAGMA synchronous=NORMAL"); // safe in WAL mode, only last transactions may be lost
+            command4.execute();
+            command4.finish();
+
             try {
                 sqlite3pp::query query1(*_database, "SELECT name FROM sqlite_master WHERE type='table' AND name='persistent_cache'");
                 for (auto it1 = query1.begin(); it1 != query1.end(); ++it1) {
@@ -130,32 +215,35 @@ namespace carto {
                 sqlite3pp::command command(*_database, "DROP TABLE IF EXISTS persistent_cache");
                 command.execute();
                 command.finish();
+                sqlite3pp::command commandIndex(*_database, "DROP TABLE IF EXISTS persistent_cache_index");
+                commandIndex.execute();
+                commandIndex.finish();
             }
 
             sqlite3pp::command command3(*_database, "CREATE TABLE IF NOT EXISTS persistent_cache(tileId INTEGER NOT NULL PRIMARY KEY, compressed BLOB, time INTEGER, expirationTime INTEGER)");
             command3.execute();
             command3.finish();
+
+            sqlite3pp::command command5(*_database, "CREATE TABLE IF NOT EXISTS persistent_cache_index(entries BLOB)");
+            command5.execute();
+            command5.finish();
+
+            _insertCommand.reset(new sqlite3pp::command(*_database, "INSERT OR REPLACE INTO persistent_cache(tileId, compressed, time, expirationTime) VALUES (:tileId, :compressed, :time, :expirationTime)"));
+            _deleteCommand.reset(new sqlite3pp::command(*_database, "DELETE FROM persistent_cache WHERE tileId=:tileId"));
         } catch (const std::exception& e) {
             Log::Errorf("PersistentCacheTileDataSource::openDatabase: Failed to initialize database: %s", e.what());
+            _insertCommand.reset();
+            _deleteCommand.reset();
             _database.reset();
             return;
         }
         
-        // Get tile ids and sizes ordered by the timestamp from the database
-        try {
-            sqlite3pp::query query(*_database, "SELECT tileId, LENGTH(compressed) FROM persistent_cache ORDER BY time ASC");
-            for (auto it = query.begin(); it != query.end(); ++it) {
-                long long tileId = (*it).get<uint64_t>(0);
-                int tileSize = (*it).get<int>(1);
-                if (_cache.capacity() < _cache.size() + tileSize) {
-                    _cache.resize(_cache.size() + tileSize); // if cache size is not configured yet, just increase the capacity until everything can be loaded
-                }
-                _cache.put(tileId, createTileId(tileId), tileSize);
-            }
-            query.finish();
-        } catch (const std::exception& e) {
-            Log::Errorf("PersistentCacheTileDataSource::openDatabase: Failed to query tile set from the database: %s", e.what());
-        }
+        // The index is loaded lazily when the first tile is requested
+        _indexState = IndexState::NOT_LOADED;
+
+        // Start the background writer
+        _writerStopped = false;
+        _writerThread = std::make_shared<std::thread>(std::bind(&PersistentCacheTileDataSource::run, this));
     }
     
     void PersistentCacheTileDataSource::closeDatabase() {
@@ -163,7 +251,32 @@ namespace carto {
             return;
         }
 
+        // Cancel index rebuilding, if still in progress
+        _indexRebuildCanceled = true;
+        if (_indexRebuildThread) {
+            _indexRebuildThread->join();
+            _indexRebuildThread.reset();
+        }
+
+        // Stop the writer, it will flush all staged tiles before exiting
+        {
+            std::lock_guard<std::mutex> lock(_stagingMutex);
+            _writerStopped = true;
+            _stagingCondition.notify_all();
+        }
+        if (_writerThread) {
+            _writerThread->join();
+            _writerThread.reset();
+        }
+
+        // All changes are now written, so the index can be stored for the next session
+        if (_indexState == IndexState::LOADED) {
+            saveIndex();
+        }
+
         try {
+            _insertCommand.reset();
+            _deleteCommand.reset();
             if (_database->disconnect() != SQLITE_OK) {
                 Log::Error("PersistentCacheTileDataSource::closeDatabase: Failed to close database");
             }
@@ -174,21 +287,43 @@ namespace carto {
         }
 
         _cache.clear(); // NOTE: as the database is closed at this point, elements are not removed
+        _indexEntries.clear();
+        _indexSequences.clear();
+        _indexRemovedTileIds.clear();
     }
     
     std::shared_ptr<TileData> PersistentCacheTileDataSource::get(long long tileId) {
         if (!_database) {
             return std::shared_ptr<TileData>();
         }
+
+        // Check staged tiles first, these are not yet written to the database
+        {
+            std::lock_guard<std::mutex> lock(_stagingMutex);
+            auto it = _stagedTiles.find(tileId);
+            if (it != _stagedTiles.end()) {
+                const StagedTile& stagedTile = it->second;
+                if (!stagedTile.data) {
+                    return std::shared_ptr<TileData>();
+                }
+                auto tileData = std::make_shared<TileData>(stagedTile.data);
+                if (stagedTile.expirationTime != 0) {
+                    long long maxAge = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::time_point(std::chrono::milliseconds(stagedTile.expirationTime)) - std::chrono::system_clock::now()).count();
+                    tileData->setMaxAge(maxAge > 0 ? maxAge : 0);
+                }
+                return tileData;
+            }
+        }
     
         try {
+            std::lock_guard<std::mutex> lock(_databaseMutex);
+
             // Get the tile from the database
             sqlite3pp::query query(*_database, "SELECT compressed, LENGTH(compressed), expirationTime FROM persistent_cache WHERE tileId=:tileId");
             query.bind(":tileId", static_cast<uint64_t>(tileId));
             auto qit = query.begin();
             if (qit == query.end()) {
                 // No data exists for this tile in the database
-                Log::Error("PersistentCacheTileDataSource::get: Inconsistency, tile data does not exist in the database");
                 return std::shared_ptr<TileData>();
             }
             
@@ -211,9 +346,9 @@ namespace carto {
         }
     }
     
-    void PersistentCacheTileDataSource::store(long long tileId, const std::shared_ptr<TileData>& tileData) {
+    bool PersistentCacheTileDataSource::store(long long tileId, const std::shared_ptr<TileData>& tileData) {
         if (!_database) {
-            return;
+            return false;
         }
         
         long long time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
@@ -222,35 +357,341 @@ namespace carto {
             expirationTime = std::chrono::duration_cast<std::chrono::milliseconds>((std::chrono::system_clock::now() + std::chrono::milliseconds(tileData->getMaxAge())).time_since_epoch()).count();
         }
 
-        // Add tile to the database
-        try {
-            sqlite3pp::command command(*_database, "INSERT OR REPLACE INTO persistent_cache(tileId, compressed, time, expirationTime) VALUES (:tileId, :compressed, :time, :expirationTime)");
-            command.bind(":tileId", static_cast<uint64_t>(tileId));
-            command.bind(":compressed", tileData->getData()->data(), static_cast<unsigned int>(tileData->getData()->size()));
-            command.bind(":time", static_cast<uint64_t>(time));
-            command.bind(":expirationTime", static_cast<uint64_t>(expirationTime));
-            command.execute();
-            command.finish();
-        } catch (const std::exception& e) {
-            Log::Errorf("PersistentCacheTileDataSource::store: Failed to store tile data in the database: %s", e.what());
-        }
+        StagedTile stagedTile;
+        stagedTile.data = tileData->getData();
+        stagedTile.time = time;
+        stagedTile.expirationTime = expirationTime;
+        return stage(tileId, stagedTile);
     }
 
     void PersistentCacheTileDataSource::remove(long long tileId) {
         if (!_database) {
             return;
         }
+
+        auto it = _indexSequences.find(tileId);
+        if (it != _indexSequences.end()) {
+            _indexEntries.erase(it->second);
+            _indexSequences.erase(it);
+        }
+        if (_indexState == IndexState::REBUILDING) {
+            _indexRemovedTileIds.insert(tileId);
+        }
         
+        StagedTile stagedTile;
+        stagedTile.time = 0;
+        stagedTile.expirationTime = 0;
+        stage(tileId, stagedTile);
+    }
+
+    bool PersistentCacheTileDataSource::stage(long long tileId, const StagedTile& stagedTile) {
+        std::lock_guard<std::mutex> lock(_stagingMutex);
+
+        std::size_t oldDataSize = 0;
+        auto it = _stagedTiles.find(tileId);
+        if (it != _stagedTiles.end() && it->second.data) {
+            oldDataSize = it->second.data->size();
+        }
+
+        // If writes keep failing, the staging area would grow without limit. Drop new tiles once it is full, removals carry no data and are always staged
+        if (stagedTile.data && _stagedDataSize - oldDataSize + stagedTile.data->size() > MAX_STAGED_DATA_SIZE) {
+            Log::Warnf("PersistentCacheTileDataSource::stage: Staging area is full, not caching tile %lld", tileId);
+            return false;
+        }
+
+        _stagedDataSize -= oldDataSize;
+        StagedTile& newStagedTile = _stagedTiles[tileId];
+        newStagedTile = stagedTile;
+        newStagedTile.sequence = _stagedSequence++;
+        if (newStagedTile.data) {
+            _stagedDataSize += newStagedTile.data->size();
+        }
+
+        if (_stagedDataSize >= FLUSH_DATA_SIZE || _stagedTiles.size() >= FLUSH_TILE_COUNT) {
+            _stagingCondition.notify_one();
+        }
+        return true;
+    }
+
+    bool PersistentCacheTileDataSource::flush() {
+        std::map<long long, StagedTile> stagedTiles;
+        {
+            std::lock_guard<std::mutex> lock(_stagingMutex);
+            stagedTiles = _stagedTiles;
+        }
+
+        // Write staged tiles in small transactions, so that readers are not blocked for the duration of the whole flush
+        std::vector<std::pair<long long, StagedTile> > batch;
+        std::size_t batchDataSize = 0;
+        for (auto it = stagedTiles.begin(); it != stagedTiles.end(); ) {
+            batch.push_back(*it);
+            if (it->second.data) {
+                batchDataSize += it->second.data->size();
+            }
+            it++;
+
+            if (batchDataSize >= TRANSACTION_DATA_SIZE || batch.size() >= TRANSACTION_TILE_COUNT || it == stagedTiles.end()) {
+                if (!writeStagedTiles(batch)) {
+                    return false;
+                }
+                batch.clear();
+                batchDataSize = 0;
+            }
+        }
+        return true;
+    }
+
+    bool PersistentCacheTileDataSource::writeStagedTiles(const std::vector<std::pair<long long, StagedTile> >& stagedTiles) {
+        // Tiles stay staged until committed, so readers always see them
+        {
+            std::lock_guard<std::mutex> lock(_databaseMutex);
+            try {
+                sqlite3pp::transaction xct(*_database);
+                {
+                    for (auto it = stagedTiles.begin(); it != stagedTiles.end(); it++) {
+                        // Skip tiles that were dropped by clear or restaged meanwhile, the restaged version is written by the next flush
+                        {
+                            std::lock_guard<std::mutex> stagingLock(_stagingMutex);
+                            auto it2 = _stagedTiles.find(it->first);
+                            if (it2 == _stagedTiles.end() || it2->second.sequence != it->second.sequence) {
+                                continue;
+                            }
+                        }
+
+                        const StagedTile& stagedTile = it->second;
+                        if (stagedTile.data) {
+                            _insertCommand->bind(":tileId", static_cast<uint64_t>(it->first));
+                            _insertCommand->bind(":compressed", stagedTile.data->data(), static_cast<unsigned int>(stagedTile.data->size()));
+                            _insertCommand->bind(":time", static_cast<uint64_t>(stagedTile.time));
+                            _insertCommand->bind(":expirationTime", static_cast<uint64_t>(stagedTile.expirationTime));
+                            _insertCommand->execute();
+                            _insertCommand->reset();
+                        } else {
+                            _deleteCommand->bind(":tileId", static_cast<uint64_t>(it->first));
+                            _deleteCommand->execute();
+                            _deleteCommand->reset();
+                        }
+                    }
+                    xct.commit();
+                }
+            } catch (const std::exception& e) {
+                Log::Errorf("PersistentCacheTileDataSource::writeStagedTiles: Failed to write tiles to the database: %s", e.what());
+                _insertCommand->reset();
+                _deleteCommand->reset();
+                return false;
+            }
+        }
+
+        // Remove committed tiles from the staging area, unless they were updated in the meantime
+        std::lock_guard<std::mutex> lock(_stagingMutex);
+        for (auto it = stagedTiles.begin(); it != stagedTiles.end(); it++) {
+            auto it2 = _stagedTiles.find(it->first);
+            if (it2 != _stagedTiles.end() && it2->second.sequence == it->second.sequence) {
+                if (it2->second.data) {
+                    _stagedDataSize -= it2->second.data->size();
+                }
+                _stagedTiles.erase(it2);
+            }
+        }
+        return true;
+    }
+
+    void PersistentCacheTileDataSource::run() {
+        bool flushed = true;
+        while (true) {
+            bool stopped = false;
+            {
+                std::unique_lock<std::mutex> lock(_stagingMutex);
+                // After a failed write, wait before retrying even if the staging area is full
+                if (!_writerStopped && (!flushed || (_stagedDataSize < FLUSH_DATA_SIZE && _stagedTiles.size() < FLUSH_TILE_COUNT))) {
+                    _stagingCondition.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL));
+                }
+                stopped = _writerStopped;
+            }
+
+            flushed = flush();
+
+            if (stopped) {
+                break;
+            }
+        }
+    }
+    
+    void PersistentCacheTileDataSource::updateIndex() {
+        if (!_database) {
+            return;
+        }
+
+        if (_indexState == IndexState::NOT_LOADED) {
+            loadIndex();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_indexMutex);
+            if (!_indexRebuilt) {
+                return;
+            }
+            _indexRebuilt = false;
+        }
+        if (_indexRebuildThread) {
+            _indexRebuildThread->join();
+            _indexRebuildThread.reset();
+        }
+
+        // Tiles added while the index was rebuilt are newer than any rebuilt entry, so they are readded last
+        std::vector<std::pair<IndexEntry, std::shared_ptr<long long> > > recentEntries;
+        for (auto it = _indexEntries.begin(); it != _indexEntries.end(); it++) {
+            std::shared_ptr<long long> tileIdPtr;
+            if (_cache.read(it->second.tileId, tileIdPtr)) {
+                recentEntries.emplace_back(it->second, tileIdPtr);
+            }
+        }
+        for (const std::pair<IndexEntry, std::shared_ptr<long long> >& recentEntry : recentEntries) {
+            _cache.remove(recentEntry.first.tileId); // tile is not removed from the database, as we keep a reference
+        }
+        _indexEntries.clear();
+        _indexSequences.clear();
+
+        std::unordered_set<long long> skippedTileIds;
+        skippedTileIds.swap(_indexRemovedTileIds);
+        for (const std::pair<IndexEntry, std::shared_ptr<long long> >& recentEntry : recentEntries) {
+            skippedTileIds.insert(recentEntry.first.tileId);
+        }
+        _indexState = IndexState::LOADED;
+
+        for (const IndexEntry& entry : _rebuiltIndexEntries) {
+            if (skippedTileIds.count(entry.tileId) == 0) {
+                addIndexEntry(entry.tileId, createTileId(entry.tileId), entry.size);
+            }
+        }
+        for (const std::pair<IndexEntry, std::shared_ptr<long long> >& recentEntry : recentEntries) {
+            addIndexEntry(recentEntry.first.tileId, recentEntry.second, recentEntry.first.size);
+        }
+        std::vector<IndexEntry>().swap(_rebuiltIndexEntries);
+    }
+
+    void PersistentCacheTileDataSource::loadIndex() {
+        // Try to load the index snapshot. The snapshot is removed immediately, so a stale snapshot is never used after an unclean shutdown
+        std::vector<IndexEntry> entries;
+        bool snapshotLoaded = false;
         try {
-            sqlite3pp::command command(*_database, "DELETE FROM persistent_cache WHERE tileId=:tileId");
-            command.bind(":tileId", static_cast<uint64_t>(tileId));
+            std::lock_guard<std::mutex> lock(_databaseMutex);
+            sqlite3pp::query query(*_database, "SELECT entries, LENGTH(entries) FROM persistent_cache_index");
+            for (auto qit = query.begin(); qit != query.end(); ++qit) {
+                const unsigned char* dataPtr = static_cast<const unsigned char*>((*qit).get<const void*>(0));
+                std::size_t dataSize = (*qit).get<int>(1);
+                entries.resize(dataSize / (sizeof(std::int64_t) + sizeof(std::uint32_t)));
+                for (std::size_t i = 0; i < entries.size(); i++) {
+                    std::int64_t tileId = 0;
+                    std::uint32_t size = 0;
+                    std::memcpy(&tileId, dataPtr, sizeof(tileId));
+                    dataPtr += sizeof(tileId);
+                    std::memcpy(&size, dataPtr, sizeof(size));
+                    dataPtr += sizeof(size);
+                    entries[i].tileId = tileId;
+                    entries[i].size = size;
+                }
+                snapshotLoaded = true;
+            }
+            query.finish();
+
+            sqlite3pp::command command(*_database, "DELETE FROM persistent_cache_index");
             command.execute();
             command.finish();
         } catch (const std::exception& e) {
-            Log::Errorf("PersistentCacheTileDataSource::remove: Failed to remove tile from the database: %s", e.what());
+            Log::Errorf("PersistentCacheTileDataSource::loadIndex: Failed to load index from the database: %s", e.what());
+            snapshotLoaded = false;
+        }
+
+        if (!snapshotLoaded) {
+            // Rebuild the index in the background, tiles are loaded directly from the database meanwhile
+            Log::Info("PersistentCacheTileDataSource::loadIndex: Rebuilding index");
+            _indexState = IndexState::REBUILDING;
+            _indexRebuilt = false;
+            _indexRebuildCanceled = false;
+            _indexRebuildThread = std::make_shared<std::thread>(std::bind(&PersistentCacheTileDataSource::rebuildIndex, this));
+            return;
+        }
+
+        _indexState = IndexState::LOADED;
+        for (const IndexEntry& entry : entries) {
+            addIndexEntry(entry.tileId, createTileId(entry.tileId), entry.size);
         }
     }
-    
+
+    void PersistentCacheTileDataSource::saveIndex() {
+        std::vector<unsigned char> data;
+        data.reserve(_indexEntries.size() * (sizeof(std::int64_t) + sizeof(std::uint32_t)));
+        for (auto it = _indexEntries.begin(); it != _indexEntries.end(); it++) {
+            std::int64_t tileId = it->second.tileId;
+            std::uint32_t size = static_cast<std::uint32_t>(it->second.size);
+            const unsigned char* tileIdPtr = reinterpret_cast<const unsigned char*>(&tileId);
+            data.insert(data.end(), tileIdPtr, tileIdPtr + sizeof(tileId));
+            const unsigned char* sizePtr = reinterpret_cast<const unsigned char*>(&size);
+            data.insert(data.end(), sizePtr, sizePtr + sizeof(size));
+        }
+
+        try {
+            std::lock_guard<std::mutex> lock(_databaseMutex);
+            sqlite3pp::transaction xct(*_database);
+            {
+                sqlite3pp::command command1(*_database, "DELETE FROM persistent_cache_index");
+                command1.execute();
+                sqlite3pp::command command2(*_database, "INSERT INTO persistent_cache_index(entries) VALUES (:entries)");
+                command2.bind(":entries", data.empty() ? nullptr : &data[0], static_cast<unsigned int>(data.size()));
+                command2.execute();
+                xct.commit();
+            }
+        } catch (const std::exception& e) {
+            Log::Errorf("PersistentCacheTileDataSource::saveIndex: Failed to store index in the database: %s", e.what());
+        }
+    }
+
+    void PersistentCacheTileDataSource::rebuildIndex() {
+        // Use a separate connection, so that tiles can be read concurrently
+        std::vector<IndexEntry> entries;
+        try {
+            sqlite3pp::database database(_databasePath.c_str());
+            sqlite3pp::query query(database, "SELECT tileId, LENGTH(compressed) FROM persistent_cache ORDER BY time ASC");
+            for (auto it = query.begin(); it != query.end(); ++it) {
+                if (_indexRebuildCanceled) {
+                    return;
+                }
+                IndexEntry entry;
+                entry.tileId = (*it).get<uint64_t>(0);
+                entry.size = (*it).get<int>(1);
+                entries.push_back(entry);
+            }
+            query.finish();
+            database.disconnect();
+        } catch (const std::exception& e) {
+            Log::Errorf("PersistentCacheTileDataSource::rebuildIndex: Failed to query tile set from the database: %s", e.what());
+        }
+
+        std::lock_guard<std::mutex> lock(_indexMutex);
+        _rebuiltIndexEntries.swap(entries);
+        _indexRebuilt = true;
+    }
+
+    bool PersistentCacheTileDataSource::addIndexEntry(long long tileId, const std::shared_ptr<long long>& tileIdPtr, std::size_t size) {
+        _cache.put(tileId, tileIdPtr, size);
+        if (!_cache.exists(tileId)) { // make sure the tile was added
+            return false;
+        }
+
+        auto it = _indexSequences.find(tileId);
+        if (it != _indexSequences.end()) {
+            _indexEntries.erase(it->second);
+        }
+        IndexEntry entry;
+        entry.tileId = tileId;
+        entry.size = size;
+        _indexEntries[_indexSequence] = entry;
+        _indexSequences[tileId] = _indexSequence++;
+        return true;
+    }
+
     std::shared_ptr<long long> PersistentCacheTileDataSource::createTileId(long long tileId) {
         std::weak_ptr<PersistentCacheTileDataSource> cacheWeak(std::static_pointer_cast<PersistentCacheTileDataSource>(shared_from_this()));
         auto tileIdDeleter = [cacheWeak](long long* tileIdPtr) {
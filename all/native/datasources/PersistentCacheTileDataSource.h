@@ -9,12 +9,21 @@
 
 #include "datasources/CacheTileDataSource.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <stdext/timed_lru_cache.h>
 
 namespace sqlite3pp {
     class database;
+    class command;
 }
 
 namespace carto {
@@ -27,6 +36,10 @@ namespace carto {
      * "tileId" (tile id), "compressed" (compressed tile image),
      * "time" (the time the tile was cached in milliseconds from epoch).
      * Default cache capacity is 50MB.
+     * Tiles are written to the database in batches by a background thread,
+     * tiles that are not yet written are served from memory.
+     * The cache index is stored in table "persistent_cache_index" when the datasource is closed
+     * and is used to speed up the next startup.
      */
     class PersistentCacheTileDataSource : public CacheTileDataSource {
     public:
@@ -68,23 +81,81 @@ namespace carto {
         virtual void setCapacity(std::size_t capacityInBytes);
 
     protected:
+        enum class IndexState {
+            NOT_LOADED,
+            REBUILDING,
+            LOADED
+        };
+
+        struct IndexEntry {
+            long long tileId;
+            std::size_t size;
+        };
+
+        struct StagedTile {
+            std::shared_ptr<BinaryData> data; // null if the tile should be removed
+            long long time;
+            long long expirationTime;
+            long long sequence;
+        };
+
         static const int DEFAULT_CAPACITY = 50 * 1024 * 1024;
+        static const std::size_t FLUSH_DATA_SIZE = 1024 * 1024;
+        static const std::size_t FLUSH_TILE_COUNT = 256;
+        static const int FLUSH_INTERVAL = 500; // in milliseconds
+        static const std::size_t MAX_STAGED_DATA_SIZE = 16 * 1024 * 1024;
+        static const std::size_t TRANSACTION_DATA_SIZE = 256 * 1024;
+        static const std::size_t TRANSACTION_TILE_COUNT = 32;
 
         void openDatabase(const std::string& databasePath);
         void closeDatabase();
         
         std::shared_ptr<TileData> get(long long tileId);
-        void store(long long tileId, const std::shared_ptr<TileData>& tileData);
+        bool store(long long tileId, const std::shared_ptr<TileData>& tileData);
         void remove(long long tileId);
 
+        bool stage(long long tileId, const StagedTile& stagedTile);
+        bool flush();
+        bool writeStagedTiles(const std::vector<std::pair<long long, StagedTile> >& stagedTiles);
+        void run();
+
+        void updateIndex();
+        void loadIndex();
+        void saveIndex();
+        void rebuildIndex();
+        bool addIndexEntry(long long tileId, const std::shared_ptr<long long>& tileIdPtr, std::size_t size);
+
         std::shared_ptr<long long> createTileId(long long tileId);
         
+        std::string _databasePath;
         std::unique_ptr<sqlite3pp::database> _database;
+        std::unique_ptr<sqlite3pp::command> _insertCommand;
+        std::unique_ptr<sqlite3pp::command> _deleteCommand;
+        std::mutex _databaseMutex;
         
         bool _cacheOnlyMode;
         
         cache::timed_lru_cache<long long, std::shared_ptr<long long> > _cache;
         mutable std::recursive_mutex _mutex;
+
+        IndexState _indexState;
+        std::map<long long, IndexEntry> _indexEntries; // ordered by insertion sequence
+        std::unordered_map<long long, long long> _indexSequences;
+        long long _indexSequence;
+        std::unordered_set<long long> _indexRemovedTileIds;
+        std::vector<IndexEntry> _rebuiltIndexEntries;
+        bool _indexRebuilt;
+        std::atomic<bool> _indexRebuildCanceled;
+        std::shared_ptr<std::thread> _indexRebuildThread;
+        std::mutex _indexMutex;
+
+        std::map<long long, StagedTile> _stagedTiles;
+        std::size_t _stagedDataSize;
+        long long _stagedSequence;
+        bool _writerStopped;
+        std::shared_ptr<std::thread> _writerThread;
+        std::mutex _stagingMutex;
+        std::condition_variable _stagingCondition;
     };
 
 }
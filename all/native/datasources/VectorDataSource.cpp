@@ -5,6 +5,7 @@
 #include "utils/Log.h"
 
 #include <algorithm>
+#include <cmath>
 
 namespace carto {
     
@@ -33,6 +34,15 @@ namespace carto {
         MapVec dp = _projection->fromInternal(p1) - _projection->fromInternal(p0);
         return static_cast<float>(dp.length());
     }
+
+    float VectorDataSource::calculateDiscreteGeometrySimplifierScale(const ViewState& viewState) const {
+        // Round down to the nearest power of two, this gives one level per zoom level and simplified geometry can be reused while the level stays the same
+        float scale = calculateGeometrySimplifierScale(viewState);
+        if (!(scale > 0)) {
+            return scale;
+        }
+        return std::pow(2.0f, std::floor(std::log2(scale)));
+    }
     
     void VectorDataSource::notifyElementsChanged() {
         std::shared_ptr<std::vector<std::shared_ptr<OnChangeListener> > > onChangeListeners;
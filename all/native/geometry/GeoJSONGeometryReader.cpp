@@ -13,18 +13,379 @@
 #include "projections/Projection.h"
 #include "utils/Log.h"
 
+#include <cstdio>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <stdexcept>
 
 #include <rapidjson/rapidjson.h>
-#include <rapidjson/writer.h>
-#include <rapidjson/stringbuffer.h>
+#include <rapidjson/reader.h>
 #include <rapidjson/document.h>
+#include <rapidjson/filereadstream.h>
 #include <rapidjson/error/en.h>
 
+#include <stdext/utf8_filesystem.h>
+
 namespace carto {
 
+    class GeoJSONGeometryReader::FeatureCollectionHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, FeatureCollectionHandler> {
+    public:
+        FeatureCollectionHandler(const std::shared_ptr<Projection>& proj, int threadCount, const FeatureBatchHandler& handler, std::size_t batchSize) :
+            _projection(proj),
+            _threadCount(std::max(1, std::thread::hardware_concurrency() > 0 ? std::min(threadCount, static_cast<int>(std::thread::hardware_concurrency())) : threadCount)),
+            _handler(handler),
+            _batchSize(std::max(batchSize, static_cast<std::size_t>(1))),
+            _depth(0),
+            _rootKey(),
+            _typeRead(false),
+            _featuresDepth(-1),
+            _featureDoc(),
+            _valueStack(),
+            _key(),
+            _featureDocs(),
+            _stopped(false),
+            _exception(),
+            _workers(),
+            _workersStopped(false),
+            _batchFeatures(nullptr),
+            _sliceSize(0),
+            _sliceCount(0),
+            _nextSlice(0),
+            _completedSlices(0),
+            _sliceException(),
+            _workerMutex(),
+            _workerCondition(),
+            _batchCondition()
+        {
+        }
+
+        ~FeatureCollectionHandler() {
+            {
+                std::lock_guard<std::mutex> lock(_workerMutex);
+                _workersStopped = true;
+                _workerCondition.notify_all();
+            }
+            for (std::thread& worker : _workers) {
+                worker.join();
+            }
+        }
+
+        bool isStopped() const {
+            return _stopped;
+        }
+
+        std::exception_ptr getException() const {
+            return _exception;
+        }
+
+        bool finish() {
+            if (!_typeRead) {
+                throw ParseException("Missing type information from feature collection");
+            }
+            return flushFeatures();
+        }
+
+        bool Null() {
+            rapidjson::Value value;
+            return addValue(value);
+        }
+
+        bool Bool(bool b) {
+            rapidjson::Value value(b);
+            return addValue(value);
+        }
+
+        bool Int(int i) {
+            rapidjson::Value value(i);
+            return addValue(value);
+        }
+
+        bool Uint(unsigned int u) {
+            rapidjson::Value value(u);
+            return addValue(value);
+        }
+
+        bool Int64(int64_t i) {
+            rapidjson::Value value(i);
+            return addValue(value);
+        }
+
+        bool Uint64(uint64_t u) {
+            rapidjson::Value value(u);
+            return addValue(value);
+        }
+
+        bool Double(double d) {
+            rapidjson::Value value(d);
+            return addValue(value);
+        }
+
+        bool String(const char* str, rapidjson::SizeType length, bool copy) {
+            if (_featureDoc) {
+                rapidjson::Value value(str, length, _featureDoc->GetAllocator());
+                return addValue(value);
+            }
+            if (_depth == 1 && _rootKey == "type") {
+                if (std::string(str, length) != "FeatureCollection") {
+                    return fail("Illegal type for the feature collection");
+                }
+                _typeRead = true;
+                return true;
+            }
+            return Default();
+        }
+
+        bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+            if (_featureDoc) {
+                _key.assign(str, length);
+            } else if (_depth == 1) {
+                _rootKey.assign(str, length);
+            }
+            return true;
+        }
+
+        bool StartObject() {
+            if (_featureDoc) {
+                rapidjson::Value value(rapidjson::kObjectType);
+                return addValue(value);
+            }
+            if (_depth == 0) {
+                _depth++;
+                return true;
+            }
+            if (_depth == _featuresDepth) {
+                _featureDoc.reset(new rapidjson::Document());
+                _featureDoc->SetObject();
+                _valueStack.push_back(_featureDoc.get());
+                return true;
+            }
+            _depth++;
+            return true;
+        }
+
+        bool EndObject(rapidjson::SizeType memberCount) {
+            if (_featureDoc) {
+                return endValue();
+            }
+            _depth--;
+            return true;
+        }
+
+        bool StartArray() {
+            if (_featureDoc) {
+                rapidjson::Value value(rapidjson::kArrayType);
+                return addValue(value);
+            }
+            if (_depth == 0) {
+                return fail("Wrong JSON type for feature collection");
+            }
+            if (_depth == _featuresDepth) {
+                return fail("Wrong JSON type for feature");
+            }
+            _depth++;
+            if (_depth == 2 && _rootKey == "features") {
+                _featuresDepth = _depth;
+            }
+            return true;
+        }
+
+        bool EndArray(rapidjson::SizeType elementCount) {
+            if (_featureDoc) {
+                return endValue();
+            }
+            if (_depth == _featuresDepth) {
+                _featuresDepth = -1;
+            }
+            _depth--;
+            return true;
+        }
+
+        bool Default() {
+            if (_depth == 0) {
+                return fail("Wrong JSON type for feature collection");
+            }
+            if (_depth == _featuresDepth) {
+                return fail("Wrong JSON type for feature");
+            }
+            return true;
+        }
+
+    private:
+        bool addValue(rapidjson::Value& value) {
+            if (!_featureDoc) {
+                return Default();
+            }
+
+            // Add the value to the current container. Containers are also pushed to the stack.
+            bool container = value.IsObject() || value.IsArray();
+            rapidjson::Value* parent = _valueStack.back();
+            rapidjson::Value* child = nullptr;
+            if (parent->IsObject()) {
+                rapidjson::Value name(_key.c_str(), static_cast<rapidjson::SizeType>(_key.size()), _featureDoc->GetAllocator());
+                parent->AddMember(name, value, _featureDoc->GetAllocator());
+                child = &(parent->MemberEnd() - 1)->value;
+            } else {
+                parent->PushBack(value, _featureDoc->GetAllocator());
+                child = &(*parent)[parent->Size() - 1];
+            }
+            if (container) {
+                _valueStack.push_back(child);
+            }
+            return true;
+        }
+
+        bool endValue() {
+            _valueStack.pop_back();
+            if (!_valueStack.empty()) {
+                return true;
+            }
+
+            _featureDocs.push_back(std::move(_featureDoc));
+            if (_featureDocs.size() >= _batchSize) {
+                return flushFeatures();
+            }
+            return true;
+        }
+
+        bool flushFeatures() {
+            if (_featureDocs.empty()) {
+                return true;
+            }
+
+            std::vector<std::shared_ptr<Feature> > features(_featureDocs.size());
+            try {
+                const Projection* proj = _projection.get();
+                std::size_t threadCount = std::min(static_cast<std::size_t>(_threadCount), _featureDocs.size() / MIN_FEATURES_PER_THREAD);
+                if (threadCount > 1) {
+                    // Convert the batch in equal slices using the worker threads, the calling thread converts slices, too
+                    while (_workers.size() + 1 < threadCount) {
+                        _workers.emplace_back(&FeatureCollectionHandler::runWorker, this);
+                    }
+                    std::exception_ptr exception;
+                    {
+                        std::unique_lock<std::mutex> lock(_workerMutex);
+                        _batchFeatures = &features;
+                        _sliceSize = (_featureDocs.size() + threadCount - 1) / threadCount;
+                        _sliceCount = (_featureDocs.size() + _sliceSize - 1) / _sliceSize;
+                        _nextSlice = 0;
+                        _completedSlices = 0;
+                        _sliceException = std::exception_ptr();
+                        _workerCondition.notify_all();
+
+                        convertSlices(lock);
+                        _batchCondition.wait(lock, [this]() { return _completedSlices == _sliceCount; });
+
+                        exception = _sliceException;
+                        _batchFeatures = nullptr;
+                        _sliceCount = _nextSlice = _completedSlices = 0;
+                    }
+                    if (exception) {
+                        std::rethrow_exception(exception);
+                    }
+                } else {
+                    for (std::size_t i = 0; i < _featureDocs.size(); i++) {
+                        features[i] = ReadFeature(*_featureDocs[i], proj);
+                    }
+                }
+                _featureDocs.clear();
+
+                if (!_handler(features)) {
+                    _stopped = true;
+                    return false;
+                }
+            }
+            catch (...) {
+                _exception = std::current_exception();
+                return false;
+            }
+            return true;
+        }
+
+        bool fail(const std::string& msg) {
+            _exception = std::make_exception_ptr(ParseException(msg));
+            return false;
+        }
+
+        void convertSlices(std::unique_lock<std::mutex>& lock) {
+            const Projection* proj = _projection.get();
+            while (_nextSlice < _sliceCount) {
+                std::size_t begin = _nextSlice++ * _sliceSize;
+                std::size_t end = std::min(begin + _sliceSize, _featureDocs.size());
+                std::vector<std::shared_ptr<Feature> >& features = *_batchFeatures;
+                lock.unlock();
+
+                std::exception_ptr exception;
+                try {
+                    for (std::size_t i = begin; i < end; i++) {
+                        features[i] = ReadFeature(*_featureDocs[i], proj);
+                    }
+                }
+                catch (...) {
+                    exception = std::current_exception();
+                }
+
+                lock.lock();
+                if (exception && !_sliceException) {
+                    _sliceException = exception;
+                }
+                if (++_completedSlices == _sliceCount) {
+                    _batchCondition.notify_all();
+                }
+            }
+        }
+
+        void runWorker() {
+            std::unique_lock<std::mutex> lock(_workerMutex);
+            while (true) {
+                _workerCondition.wait(lock, [this]() { return _workersStopped || _nextSlice < _sliceCount; });
+                if (_workersStopped) {
+                    break;
+                }
+                convertSlices(lock);
+            }
+        }
+
+        static const std::size_t MIN_FEATURES_PER_THREAD = 64;
+
+        std::shared_ptr<Projection> _projection;
+        int _threadCount;
+        const FeatureBatchHandler& _handler;
+        std::size_t _batchSize;
+
+        int _depth;
+        std::string _rootKey;
+        bool _typeRead;
+        int _featuresDepth;
+
+        std::unique_ptr<rapidjson::Document> _featureDoc;
+        std::vector<rapidjson::Value*> _valueStack;
+        std::string _key;
+        std::vector<std::unique_ptr<rapidjson::Document> > _featureDocs;
+
+        bool _stopped;
+        std::exception_ptr _exception;
+
+        std::vector<std::thread> _workers;
+        bool _workersStopped;
+        std::vector<std::shared_ptr<Feature> >* _batchFeatures;
+        std::size_t _sliceSize;
+        std::size_t _sliceCount;
+        std::size_t _nextSlice;
+        std::size_t _completedSlices;
+        std::exception_ptr _sliceException;
+        std::mutex _workerMutex;
+        std::condition_variable _workerCondition;
+        std::condition_variable _batchCondition;
+    };
+
     GeoJSONGeometryReader::GeoJSONGeometryReader() :
-        _targetProjection(), _mutex()
+        _targetProjection(),
+        _conversionThreadCount(1),
+        _mutex()
     {
     }
     
@@ -38,8 +399,22 @@ namespace carto {
         _targetProjection = proj;
     }
 
-    std::shared_ptr<Geometry> GeoJSONGeometryReader::readGeometry(const std::string& geoJSON) const {
+    int GeoJSONGeometryReader::getConversionThreadCount() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _conversionThreadCount;
+    }
+
+    void GeoJSONGeometryReader::setConversionThreadCount(int threadCount) {
+        if (threadCount < 1) {
+            throw InvalidArgumentException("Conversion thread count must be at least 1");
+        }
+
         std::lock_guard<std::mutex> lock(_mutex);
+        _conversionThreadCount = threadCount;
+    }
+
+    std::shared_ptr<Geometry> GeoJSONGeometryReader::readGeometry(const std::string& geoJSON) const {
+        std::shared_ptr<Projection> proj = getTargetProjection();
 
         rapidjson::Document geometryDoc;
         if (geometryDoc.Parse<rapidjson::kParseDefaultFlags>(geoJSON.c_str()).HasParseError()) {
@@ -47,11 +422,11 @@ namespace carto {
             throw ParseException(err, geoJSON, static_cast<int>(geometryDoc.GetErrorOffset()));
         }
 
-        return readGeometry(geometryDoc);
+        return ReadGeometry(geometryDoc, proj.get());
     }
 
     std::shared_ptr<Feature> GeoJSONGeometryReader::readFeature(const std::string& geoJSON) const {
-        std::lock_guard<std::mutex> lock(_mutex);
+        std::shared_ptr<Projection> proj = getTargetProjection();
 
         rapidjson::Document featureDoc;
         if (featureDoc.Parse<rapidjson::kParseDefaultFlags>(geoJSON.c_str()).HasParseError()) {
@@ -59,45 +434,83 @@ namespace carto {
             throw ParseException(err, geoJSON, static_cast<int>(featureDoc.GetErrorOffset()));
         }
 
-        return readFeature(featureDoc);
+        return ReadFeature(featureDoc, proj.get());
     }
 
     std::shared_ptr<FeatureCollection> GeoJSONGeometryReader::readFeatureCollection(const std::string& geoJSON) const {
-        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<std::shared_ptr<Feature> > features;
+        readFeatureCollection(geoJSON, [&features](const std::vector<std::shared_ptr<Feature> >& batch) {
+            features.insert(features.end(), batch.begin(), batch.end());
+            return true;
+        }, FEATURE_BATCH_SIZE);
+        return std::make_shared<FeatureCollection>(features);
+    }
 
-        rapidjson::Document featureCollectionDoc;
-        if (featureCollectionDoc.Parse<rapidjson::kParseDefaultFlags>(geoJSON.c_str()).HasParseError()) {
-            std::string err = rapidjson::GetParseError_En(featureCollectionDoc.GetParseError());
-            throw ParseException(err, geoJSON, static_cast<int>(featureCollectionDoc.GetErrorOffset()));
+    std::shared_ptr<FeatureCollection> GeoJSONGeometryReader::readFeatureCollectionFile(const std::string& fileName) const {
+        std::vector<std::shared_ptr<Feature> > features;
+        readFeatureCollectionFile(fileName, [&features](const std::vector<std::shared_ptr<Feature> >& batch) {
+            features.insert(features.end(), batch.begin(), batch.end());
+            return true;
+        }, FEATURE_BATCH_SIZE);
+        return std::make_shared<FeatureCollection>(features);
+    }
+
+    void GeoJSONGeometryReader::readFeatureCollection(const std::string& geoJSON, const FeatureBatchHandler& handler, std::size_t batchSize) const {
+        if (!handler) {
+            throw NullArgumentException("Null handler");
         }
 
-        return readFeatureCollection(featureCollectionDoc);
+        FeatureCollectionHandler featureCollectionHandler(getTargetProjection(), getConversionThreadCount(), handler, batchSize);
+        rapidjson::Reader reader;
+        rapidjson::StringStream stream(geoJSON.c_str());
+        rapidjson::ParseResult result = reader.Parse<rapidjson::kParseDefaultFlags>(stream, featureCollectionHandler);
+        if (featureCollectionHandler.getException()) {
+            std::rethrow_exception(featureCollectionHandler.getException());
+        }
+        if (featureCollectionHandler.isStopped()) {
+            return;
+        }
+        if (result.IsError()) {
+            std::string err = rapidjson::GetParseError_En(result.Code());
+            throw ParseException(err, geoJSON, static_cast<int>(result.Offset()));
+        }
+        if (!featureCollectionHandler.finish() && featureCollectionHandler.getException()) {
+            std::rethrow_exception(featureCollectionHandler.getException());
+        }
     }
 
-    std::shared_ptr<FeatureCollection> GeoJSONGeometryReader::readFeatureCollection(const rapidjson::Value& value) const {
-        if (!value.IsObject()) {
-            throw ParseException("Wrong JSON type for feature collection");
+    void GeoJSONGeometryReader::readFeatureCollectionFile(const std::string& fileName, const FeatureBatchHandler& handler, std::size_t batchSize) const {
+        if (!handler) {
+            throw NullArgumentException("Null handler");
         }
 
-        if (!value.HasMember("type")) {
-            throw ParseException("Missing type information from feature collection");
-        }
-        std::string type = value["type"].GetString();
-        if (type != "FeatureCollection") {
-             throw ParseException("Illegal type for the feature collection");
+        FILE* fp = utf8_filesystem::fopen(fileName.c_str(), "rb");
+        if (!fp) {
+            throw FileException("Failed to open GeoJSON file", fileName);
         }
+        std::shared_ptr<FILE> fpGuard(fp, std::fclose);
 
-        const rapidjson::Value& featuresValue = value["features"];
-        std::vector<std::shared_ptr<Feature> > features;
-        features.reserve(featuresValue.Size());
-        for (rapidjson::SizeType i = 0; i < featuresValue.Size(); i++) {
-            std::shared_ptr<Feature> feature = readFeature(featuresValue[i]);
-            features.push_back(feature);
+        FeatureCollectionHandler featureCollectionHandler(getTargetProjection(), getConversionThreadCount(), handler, batchSize);
+        rapidjson::Reader reader;
+        std::vector<char> buffer(FILE_BUFFER_SIZE);
+        rapidjson::FileReadStream stream(fp, buffer.data(), buffer.size());
+        rapidjson::ParseResult result = reader.Parse<rapidjson::kParseDefaultFlags>(stream, featureCollectionHandler);
+        if (featureCollectionHandler.getException()) {
+            std::rethrow_exception(featureCollectionHandler.getException());
+        }
+        if (featureCollectionHandler.isStopped()) {
+            return;
+        }
+        if (result.IsError()) {
+            std::string err = rapidjson::GetParseError_En(result.Code());
+            throw ParseException(err + " in file " + fileName, "", static_cast<int>(result.Offset()));
+        }
+        if (!featureCollectionHandler.finish() && featureCollectionHandler.getException()) {
+            std::rethrow_exception(featureCollectionHandler.getException());
         }
-        return std::make_shared<FeatureCollection>(features);
     }
 
-    std::shared_ptr<Feature> GeoJSONGeometryReader::readFeature(const rapidjson::Value& value) const {
+    std::shared_ptr<Feature> GeoJSONGeometryReader::ReadFeature(const rapidjson::Value& value, const Projection* proj) {
         if (!value.IsObject()) {
             throw ParseException("Wrong JSON type for feature");
         }
@@ -110,15 +523,15 @@ namespace carto {
              throw ParseException("Illegal type for the feature");
         }
 
-        std::shared_ptr<Geometry> geometry = readGeometry(value["geometry"]);
+        std::shared_ptr<Geometry> geometry = ReadGeometry(value["geometry"], proj);
         Variant properties;
         if (value.HasMember("properties")) {
-            properties = readProperties(value["properties"]);
+            properties = ReadProperties(value["properties"]);
         }
         return std::make_shared<Feature>(geometry, properties);
     }
 
-    std::shared_ptr<Geometry> GeoJSONGeometryReader::readGeometry(const rapidjson::Value& value) const {
+    std::shared_ptr<Geometry> GeoJSONGeometryReader::ReadGeometry(const rapidjson::Value& value, const Projection* proj) {
         if (!value.IsObject()) {
             throw ParseException("Wrong JSON type for geometry");
         }
@@ -128,31 +541,27 @@ namespace carto {
         }
         std::string type = value["type"].GetString();
         if (type == "Point") {
-            return std::make_shared<PointGeometry>(readPoint(value["coordinates"]));
+            std::vector<MapPos> mapPoses(1, ReadPoint(value["coordinates"]));
+            ProjectPoints(mapPoses, proj);
+            return std::make_shared<PointGeometry>(mapPoses.front());
         } else if (type == "LineString") {
-            return std::make_shared<LineGeometry>(readRing(value["coordinates"]));
+            return std::make_shared<LineGeometry>(ReadRing(value["coordinates"], proj));
         } else if (type == "Polygon") {
-            return std::make_shared<PolygonGeometry>(readRings(value["coordinates"]));
+            return std::make_shared<PolygonGeometry>(ReadRings(value["coordinates"], proj));
         } else if (type == "MultiPoint") {
-            const rapidjson::Value& coordinates = value["coordinates"];
-            if (!coordinates.IsArray()) {
-                throw ParseException("Wrong JSON type for coordinates");
-            }
+            std::vector<MapPos> mapPoses = ReadRing(value["coordinates"], proj);
             std::vector<std::shared_ptr<PointGeometry> > points;
-            points.reserve(coordinates.Size());
-            for (rapidjson::SizeType i = 0; i < coordinates.Size(); i++) {
-                points.push_back(std::make_shared<PointGeometry>(readPoint(coordinates[i])));
+            points.reserve(mapPoses.size());
+            for (const MapPos& mapPos : mapPoses) {
+                points.push_back(std::make_shared<PointGeometry>(mapPos));
             }
             return std::make_shared<MultiPointGeometry>(points);
         } else if (type == "MultiLineString") {
-            const rapidjson::Value& coordinates = value["coordinates"];
-            if (!coordinates.IsArray()) {
-                throw ParseException("Wrong JSON type for coordinates");
-            }
+            std::vector<std::vector<MapPos> > rings = ReadRings(value["coordinates"], proj);
             std::vector<std::shared_ptr<LineGeometry> > lines;
-            lines.reserve(coordinates.Size());
-            for (rapidjson::SizeType i = 0; i < coordinates.Size(); i++) {
-                lines.push_back(std::make_shared<LineGeometry>(readRing(coordinates[i])));
+            lines.reserve(rings.size());
+            for (const std::vector<MapPos>& ring : rings) {
+                lines.push_back(std::make_shared<LineGeometry>(ring));
             }
             return std::make_shared<MultiLineGeometry>(lines);
         } else if (type == "MultiPolygon") {
@@ -163,7 +572,7 @@ namespace carto {
             std::vector<std::shared_ptr<PolygonGeometry> > polygons;
             polygons.reserve(coordinates.Size());
             for (rapidjson::SizeType i = 0; i < coordinates.Size(); i++) {
-                polygons.push_back(std::make_shared<PolygonGeometry>(readRings(coordinates[i])));
+                polygons.push_back(std::make_shared<PolygonGeometry>(ReadRings(coordinates[i], proj)));
             }
             return std::make_shared<MultiPolygonGeometry>(polygons);
         } else if (type == "GeometryCollection") {
@@ -174,7 +583,7 @@ namespace carto {
             std::vector<std::shared_ptr<Geometry> > geometryList;
             geometryList.reserve(geometries.Size());
             for (rapidjson::SizeType i = 0; i < geometries.Size(); i++) {
-                geometryList.push_back(readGeometry(geometries[i]));
+                geometryList.push_back(ReadGeometry(geometries[i], proj));
             }
             return std::make_shared<MultiGeometry>(geometryList);
         } else {
@@ -182,49 +591,75 @@ namespace carto {
         }
     }
 
-    Variant GeoJSONGeometryReader::readProperties(const rapidjson::Value& value) const {
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        value.Accept(writer);
-        return Variant::FromString(buffer.GetString());
+    Variant GeoJSONGeometryReader::ReadProperties(const rapidjson::Value& value) {
+        // Convert directly instead of serializing the value and parsing it again
+        if (value.IsBool()) {
+            return Variant(value.GetBool());
+        } else if (value.IsInt64()) {
+            return Variant(static_cast<long long>(value.GetInt64()));
+        } else if (value.IsNumber()) {
+            return Variant(value.GetDouble());
+        } else if (value.IsString()) {
+            return Variant(std::string(value.GetString(), value.GetStringLength()));
+        } else if (value.IsArray()) {
+            std::vector<Variant> array;
+            array.reserve(value.Size());
+            for (rapidjson::SizeType i = 0; i < value.Size(); i++) {
+                array.push_back(ReadProperties(value[i]));
+            }
+            return Variant(array);
+        } else if (value.IsObject()) {
+            std::map<std::string, Variant> object;
+            for (rapidjson::Value::ConstMemberIterator it = value.MemberBegin(); it != value.MemberEnd(); it++) {
+                object[std::string(it->name.GetString(), it->name.GetStringLength())] = ReadProperties(it->value);
+            }
+            return Variant(object);
+        }
+        return Variant();
     }
 
-    MapPos GeoJSONGeometryReader::readPoint(const rapidjson::Value& value) const {
+    MapPos GeoJSONGeometryReader::ReadPoint(const rapidjson::Value& value) {
         if (!value.IsArray()) {
             throw ParseException("Wrong JSON type for coordinates");
         }
         if (value.Size() < 2) {
             throw ParseException("Too few components in coordinates");
         }
-        MapPos mapPos(value[0].GetDouble(), value[1].GetDouble(), value.Size() > 2 ? value[2].GetDouble() : 0);
-        if (_targetProjection) {
-            mapPos = _targetProjection->fromWgs84(mapPos);
-        }
-        return mapPos;
+        return MapPos(value[0].GetDouble(), value[1].GetDouble(), value.Size() > 2 ? value[2].GetDouble() : 0);
     }
 
-    std::vector<MapPos> GeoJSONGeometryReader::readRing(const rapidjson::Value& value) const {
+    std::vector<MapPos> GeoJSONGeometryReader::ReadRing(const rapidjson::Value& value, const Projection* proj) {
         if (!value.IsArray()) {
             throw ParseException("Wrong JSON type for coordinates");
         }
         std::vector<MapPos> ring;
         ring.reserve(value.Size());
         for (rapidjson::SizeType i = 0; i < value.Size(); i++) {
-            ring.push_back(readPoint(value[i]));
+            ring.push_back(ReadPoint(value[i]));
         }
+        ProjectPoints(ring, proj);
         return ring;
     }
 
-    std::vector<std::vector<MapPos> > GeoJSONGeometryReader::readRings(const rapidjson::Value& value) const {
+    std::vector<std::vector<MapPos> > GeoJSONGeometryReader::ReadRings(const rapidjson::Value& value, const Projection* proj) {
         if (!value.IsArray()) {
             throw ParseException("Wrong JSON type for coordinates");
         }
         std::vector<std::vector<MapPos> > rings;
         rings.reserve(value.Size());
         for (rapidjson::SizeType i = 0; i < value.Size(); i++) {
-            rings.push_back(readRing(value[i]));
+            rings.push_back(ReadRing(value[i], proj));
         }
         return rings;
     }
 
+    void GeoJSONGeometryReader::ProjectPoints(std::vector<MapPos>& mapPoses, const Projection* proj) {
+        if (!proj) {
+            return;
+        }
+        for (MapPos& mapPos : mapPoses) {
+            mapPos = proj->fromWgs84(mapPos);
+        }
+    }
+
 }
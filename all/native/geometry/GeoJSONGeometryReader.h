@@ -14,6 +14,7 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <functional>
 
 namespace rapidjson {
     class CrtAllocator;
@@ -32,9 +33,16 @@ namespace carto {
     /**
      * A GeoJSON parser.
      * Parser supports Geometry, Feature and FeatureCollection inputs.
+     * Feature collections are parsed in streaming mode, so very large collections can be read in batches.
      */
     class GeoJSONGeometryReader {
     public:
+        /**
+         * Handler for feature batches read from a feature collection.
+         * The handler should return false to stop reading the rest of the collection.
+         */
+        typedef std::function<bool(const std::vector<std::shared_ptr<Feature> >&)> FeatureBatchHandler;
+
         /**
          * Constructs a new GeoJSONGeometryReader object.
          */
@@ -54,6 +62,20 @@ namespace carto {
          */
         void setTargetProjection(const std::shared_ptr<Projection>& proj);
 
+        /**
+         * Returns the number of threads used for converting features of a feature collection.
+         * @return The number of conversion threads. The default is 1.
+         */
+        int getConversionThreadCount() const;
+        /**
+         * Sets the number of threads used for converting features of a feature collection.
+         * Using multiple threads is beneficial only for large collections.
+         * The actual number of threads is limited by the number of hardware threads.
+         * @param threadCount The number of conversion threads. Must be at least 1.
+         * @throws std::invalid_argument If the thread count is less than 1.
+         */
+        void setConversionThreadCount(int threadCount);
+
         /**
          * Reads geometry from the specified GeoJSON string.
          * @param geoJSON The GeoJSON string to read.
@@ -77,17 +99,49 @@ namespace carto {
          * @throws std::runtime_error If string could not be parsed.
          */
         std::shared_ptr<FeatureCollection> readFeatureCollection(const std::string& geoJSON) const;
+        /**
+         * Reads feature collection from the specified GeoJSON file.
+         * The file is parsed in streaming mode, without loading it fully into memory.
+         * @param fileName The name of the GeoJSON file to read.
+         * @return The feature collection read from the file.
+         * @throws std::runtime_error If the file could not be opened or parsed.
+         */
+        std::shared_ptr<FeatureCollection> readFeatureCollectionFile(const std::string& fileName) const;
+
+        /**
+         * Reads features of a feature collection from the specified GeoJSON string and passes them to the handler in batches.
+         * @param geoJSON The GeoJSON string to read.
+         * @param handler The handler for the feature batches.
+         * @param batchSize The maximum number of features in a single batch.
+         * @throws std::runtime_error If string could not be parsed.
+         */
+        void readFeatureCollection(const std::string& geoJSON, const FeatureBatchHandler& handler, std::size_t batchSize) const;
+        /**
+         * Reads features of a feature collection from the specified GeoJSON file and passes them to the handler in batches.
+         * Only a single batch of features is kept in memory at any time.
+         * @param fileName The name of the GeoJSON file to read.
+         * @param handler The handler for the feature batches.
+         * @param batchSize The maximum number of features in a single batch.
+         * @throws std::runtime_error If the file could not be opened or parsed.
+         */
+        void readFeatureCollectionFile(const std::string& fileName, const FeatureBatchHandler& handler, std::size_t batchSize) const;
 
     private:
-        std::shared_ptr<FeatureCollection> readFeatureCollection(const rapidjson::Value& value) const;
-        std::shared_ptr<Feature> readFeature(const rapidjson::Value& value) const;
-        std::shared_ptr<Geometry> readGeometry(const rapidjson::Value& value) const;
-        Variant readProperties(const rapidjson::Value& value) const;
-        MapPos readPoint(const rapidjson::Value& value) const;
-        std::vector<MapPos> readRing(const rapidjson::Value& value) const;
-        std::vector<std::vector<MapPos> > readRings(const rapidjson::Value& value) const;
+        class FeatureCollectionHandler;
+
+        static const std::size_t FEATURE_BATCH_SIZE = 1024;
+        static const std::size_t FILE_BUFFER_SIZE = 65536;
+
+        static std::shared_ptr<Feature> ReadFeature(const rapidjson::Value& value, const Projection* proj);
+        static std::shared_ptr<Geometry> ReadGeometry(const rapidjson::Value& value, const Projection* proj);
+        static Variant ReadProperties(const rapidjson::Value& value);
+        static MapPos ReadPoint(const rapidjson::Value& value);
+        static std::vector<MapPos> ReadRing(const rapidjson::Value& value, const Projection* proj);
+        static std::vector<std::vector<MapPos> > ReadRings(const rapidjson::Value& value, const Projection* proj);
+        static void ProjectPoints(std::vector<MapPos>& mapPoses, const Projection* proj);
 
         std::shared_ptr<Projection> _targetProjection;
+        int _conversionThreadCount;
         mutable std::mutex _mutex;
     };
 
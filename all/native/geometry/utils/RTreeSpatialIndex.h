@@ -0,0 +1,569 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_RTREESPATIALINDEX_H_
+#define _CARTO_RTREESPATIALINDEX_H_
+
+#include "geometry/utils/SpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace carto {
+
+    /**
+     * R-tree based spatial index. Nodes and records are kept in contiguous arrays, children of each node occupy consecutive slots.
+     * Bulk inserts pack the tree using sort-tile-recursive algorithm, single inserts use standard R-tree insertion with node splitting.
+     */
+    template <typename T>
+    class RTreeSpatialIndex : public SpatialIndex<T> {
+    public:
+        RTreeSpatialIndex();
+
+        virtual std::size_t size() const;
+
+        virtual void clear();
+        virtual void insert(const MapBounds& bounds, const T& object);
+        virtual void insertAll(const std::vector<std::pair<MapBounds, T> >& objects);
+        virtual bool remove(const MapBounds& bounds, const T& object);
+        virtual bool remove(const T& object);
+
+        virtual std::vector<T> query(const Frustum& frustum) const;
+        virtual std::vector<T> query(const MapBounds& bounds) const;
+        virtual std::vector<T> getAll() const;
+
+    private:
+        typedef std::pair<MapBounds, T> Record;
+
+        class Node {
+        public:
+            Node();
+            Node(const MapBounds& bounds, std::size_t first, std::size_t count, bool leaf);
+
+            MapBounds bounds;
+            std::size_t first; // index of the first child node or the first record slot
+            std::size_t count; // number of used child node or record slots
+            bool leaf;
+        };
+
+        static const std::size_t NODE_CAPACITY = 16;
+        static const std::size_t BULK_NODE_COUNT = 12; // packed nodes are not filled completely, this leaves space for subsequent inserts
+        static const std::size_t MIN_COMPACT_SLOT_COUNT = 1024;
+
+        std::size_t allocateNodeSlots();
+        std::size_t allocateRecordSlots();
+
+        void build(std::vector<Record>& records);
+        void compact();
+
+        bool insertToNode(std::size_t nodeIndex, const MapBounds& bounds, const T& object, Node& splitNode);
+        bool removeFromNode(std::size_t nodeIndex, const MapBounds* bounds, const T& object);
+
+        void queryNode(std::size_t nodeIndex, const Frustum& frustum, std::vector<T>& results) const;
+        void queryNode(std::size_t nodeIndex, const MapBounds& bounds, std::vector<T>& results) const;
+        void getAllFromNode(std::size_t nodeIndex, std::vector<T>& results) const;
+        void getRecordsFromNode(std::size_t nodeIndex, std::vector<Record>& records) const;
+
+        template <typename E>
+        static void SortTileRecursive(std::vector<E>& entries);
+        template <typename E>
+        static std::size_t SplitEntries(std::vector<E>& entries);
+
+        static const MapBounds& GetBounds(const Node& node);
+        static const MapBounds& GetBounds(const Record& record);
+        static double GetCenter(const MapBounds& bounds, int axis);
+        static double CalculateArea(const MapBounds& bounds);
+
+        std::vector<Node> _nodes; // root node is always the first node
+        std::vector<MapBounds> _recordBounds;
+        std::vector<T> _recordObjects;
+        std::size_t _count;
+    };
+
+    template<typename T>
+    RTreeSpatialIndex<T>::RTreeSpatialIndex() :
+        _nodes(),
+        _recordBounds(),
+        _recordObjects(),
+        _count(0)
+    {
+    }
+
+    template<typename T>
+    std::size_t RTreeSpatialIndex<T>::size() const {
+        return _count;
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::clear() {
+        _nodes.clear();
+        _recordBounds.clear();
+        _recordObjects.clear();
+        _count = 0;
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::insert(const MapBounds& bounds, const T& object) {
+        if (_nodes.empty()) {
+            std::size_t first = allocateRecordSlots();
+            _nodes.push_back(Node(bounds, first, 0, true));
+        }
+
+        Node splitNode;
+        if (insertToNode(0, bounds, object, splitNode)) {
+            // Root was split, move old root and the new node under a new root
+            std::size_t first = allocateNodeSlots();
+            _nodes[first] = _nodes[0];
+            _nodes[first + 1] = splitNode;
+            MapBounds rootBounds = _nodes[0].bounds;
+            rootBounds.expandToContain(splitNode.bounds);
+            _nodes[0] = Node(rootBounds, first, 2, false);
+        }
+        _count++;
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::insertAll(const std::vector<std::pair<MapBounds, T> >& objects) {
+        // Insert small batches one by one, otherwise repack the whole tree
+        if (objects.size() < NODE_CAPACITY || objects.size() * 4 < _count) {
+            for (const Record& record : objects) {
+                insert(record.first, record.second);
+            }
+            return;
+        }
+
+        std::vector<Record> records;
+        records.reserve(_count + objects.size());
+        if (!_nodes.empty()) {
+            getRecordsFromNode(0, records);
+        }
+        records.insert(records.end(), objects.begin(), objects.end());
+        build(records);
+    }
+
+    template<typename T>
+    bool RTreeSpatialIndex<T>::remove(const MapBounds& bounds, const T& object) {
+        if (_nodes.empty()) {
+            return false;
+        }
+        if (!removeFromNode(0, &bounds, object)) {
+            return false;
+        }
+        compact();
+        return true;
+    }
+
+    template<typename T>
+    bool RTreeSpatialIndex<T>::remove(const T& object) {
+        if (_nodes.empty()) {
+            return false;
+        }
+        if (!removeFromNode(0, nullptr, object)) {
+            return false;
+        }
+        compact();
+        return true;
+    }
+
+    template<typename T>
+    std::vector<T> RTreeSpatialIndex<T>::query(const Frustum& frustum) const {
+        std::vector<T> results;
+        if (!_nodes.empty()) {
+            queryNode(0, frustum, results);
+        }
+        return results;
+    }
+
+    template<typename T>
+    std::vector<T> RTreeSpatialIndex<T>::query(const MapBounds& bounds) const {
+        std::vector<T> results;
+        if (!_nodes.empty()) {
+            queryNode(0, bounds, results);
+        }
+        return results;
+    }
+
+    template<typename T>
+    std::vector<T> RTreeSpatialIndex<T>::getAll() const {
+        std::vector<T> results;
+        results.reserve(_count);
+        if (!_nodes.empty()) {
+            getAllFromNode(0, results);
+        }
+        return results;
+    }
+
+    template<typename T>
+    RTreeSpatialIndex<T>::Node::Node() :
+        bounds(),
+        first(0),
+        count(0),
+        leaf(true)
+    {
+    }
+
+    template<typename T>
+    RTreeSpatialIndex<T>::Node::Node(const MapBounds& bounds, std::size_t first, std::size_t count, bool leaf) :
+        bounds(bounds),
+        first(first),
+        count(count),
+        leaf(leaf)
+    {
+    }
+
+    template<typename T>
+    std::size_t RTreeSpatialIndex<T>::allocateNodeSlots() {
+        std::size_t first = _nodes.size();
+        _nodes.resize(first + NODE_CAPACITY);
+        return first;
+    }
+
+    template<typename T>
+    std::size_t RTreeSpatialIndex<T>::allocateRecordSlots() {
+        std::size_t first = _recordObjects.size();
+        _recordBounds.resize(first + NODE_CAPACITY);
+        _recordObjects.resize(first + NODE_CAPACITY);
+        return first;
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::build(std::vector<Record>& records) {
+        clear();
+        if (records.empty()) {
+            return;
+        }
+        _count = records.size();
+        _nodes.resize(1);
+
+        // Pack records into leaf nodes
+        SortTileRecursive(records);
+        std::vector<Node> level;
+        level.reserve((records.size() + BULK_NODE_COUNT - 1) / BULK_NODE_COUNT);
+        for (std::size_t i = 0; i < records.size(); i += BULK_NODE_COUNT) {
+            std::size_t end = std::min(i + BULK_NODE_COUNT, records.size());
+            std::size_t first = allocateRecordSlots();
+            Node node(records[i].first, first, end - i, true);
+            for (std::size_t j = i; j < end; j++) {
+                _recordBounds[first + j - i] = records[j].first;
+                _recordObjects[first + j - i] = records[j].second;
+                node.bounds.expandToContain(records[j].first);
+            }
+            level.push_back(node);
+        }
+
+        // Pack nodes of each level into parent nodes until a single node remains
+        while (level.size() > 1) {
+            SortTileRecursive(level);
+            std::vector<Node> parentLevel;
+            parentLevel.reserve((level.size() + BULK_NODE_COUNT - 1) / BULK_NODE_COUNT);
+            for (std::size_t i = 0; i < level.size(); i += BULK_NODE_COUNT) {
+                std::size_t end = std::min(i + BULK_NODE_COUNT, level.size());
+                std::size_t first = allocateNodeSlots();
+                Node node(level[i].bounds, first, end - i, false);
+                for (std::size_t j = i; j < end; j++) {
+                    _nodes[first + j - i] = level[j];
+                    node.bounds.expandToContain(level[j].bounds);
+                }
+                parentLevel.push_back(node);
+            }
+            std::swap(level, parentLevel);
+        }
+        _nodes[0] = level.front();
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::compact() {
+        // Removed records leave unused slots behind, repack the tree once most of the slots are unused
+        if (_recordObjects.size() < MIN_COMPACT_SLOT_COUNT || _count * 4 >= _recordObjects.size()) {
+            return;
+        }
+
+        std::vector<Record> records;
+        records.reserve(_count);
+        getRecordsFromNode(0, records);
+        build(records);
+    }
+
+    template<typename T>
+    bool RTreeSpatialIndex<T>::insertToNode(std::size_t nodeIndex, const MapBounds& bounds, const T& object, Node& splitNode) {
+        if (_nodes[nodeIndex].leaf) {
+            Node& node = _nodes[nodeIndex];
+            node.bounds.expandToContain(bounds);
+            if (node.count < NODE_CAPACITY) {
+                _recordBounds[node.first + node.count] = bounds;
+                _recordObjects[node.first + node.count] = object;
+                node.count++;
+                return false;
+            }
+
+            // Leaf is full, split its records between the leaf and a new leaf
+            std::vector<Record> records;
+            records.reserve(node.count + 1);
+            for (std::size_t i = node.first; i < node.first + node.count; i++) {
+                records.emplace_back(_recordBounds[i], _recordObjects[i]);
+                _recordBounds[i] = MapBounds();
+                _recordObjects[i] = T();
+            }
+            records.emplace_back(bounds, object);
+            std::size_t splitIndex = SplitEntries(records);
+
+            std::size_t first = allocateRecordSlots();
+            node = Node(records[0].first, node.first, splitIndex, true);
+            splitNode = Node(records[splitIndex].first, first, records.size() - splitIndex, true);
+            for (std::size_t i = 0; i < records.size(); i++) {
+                Node& targetNode = (i < splitIndex ? node : splitNode);
+                std::size_t slot = targetNode.first + (i < splitIndex ? i : i - splitIndex);
+                _recordBounds[slot] = records[i].first;
+                _recordObjects[slot] = records[i].second;
+                targetNode.bounds.expandToContain(records[i].first);
+            }
+            return true;
+        }
+
+        // Choose the child that needs least enlargement, prefer smaller children in case of ties
+        std::size_t childIndex = _nodes[nodeIndex].first;
+        double bestEnlargement = 0;
+        double bestArea = 0;
+        for (std::size_t i = _nodes[nodeIndex].first; i < _nodes[nodeIndex].first + _nodes[nodeIndex].count; i++) {
+            MapBounds childBounds = _nodes[i].bounds;
+            double area = CalculateArea(childBounds);
+            childBounds.expandToContain(bounds);
+            double enlargement = CalculateArea(childBounds) - area;
+            if (i == _nodes[nodeIndex].first || enlargement < bestEnlargement || (enlargement == bestEnlargement && area < bestArea)) {
+                childIndex = i;
+                bestEnlargement = enlargement;
+                bestArea = area;
+            }
+        }
+
+        Node childSplitNode;
+        bool childSplit = insertToNode(childIndex, bounds, object, childSplitNode);
+        _nodes[nodeIndex].bounds.expandToContain(bounds);
+        if (!childSplit) {
+            return false;
+        }
+        if (_nodes[nodeIndex].count < NODE_CAPACITY) {
+            _nodes[_nodes[nodeIndex].first + _nodes[nodeIndex].count] = childSplitNode;
+            _nodes[nodeIndex].count++;
+            return false;
+        }
+
+        // Node is full, split its children between the node and a new node
+        std::vector<Node> children;
+        children.reserve(_nodes[nodeIndex].count + 1);
+        for (std::size_t i = _nodes[nodeIndex].first; i < _nodes[nodeIndex].first + _nodes[nodeIndex].count; i++) {
+            children.push_back(_nodes[i]);
+            _nodes[i] = Node();
+        }
+        children.push_back(childSplitNode);
+        std::size_t splitIndex = SplitEntries(children);
+
+        std::size_t first = allocateNodeSlots();
+        Node& node = _nodes[nodeIndex];
+        node = Node(children[0].bounds, node.first, splitIndex, false);
+        splitNode = Node(children[splitIndex].bounds, first, children.size() - splitIndex, false);
+        for (std::size_t i = 0; i < children.size(); i++) {
+            Node& targetNode = (i < splitIndex ? node : splitNode);
+            _nodes[targetNode.first + (i < splitIndex ? i : i - splitIndex)] = children[i];
+            targetNode.bounds.expandToContain(children[i].bounds);
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool RTreeSpatialIndex<T>::removeFromNode(std::size_t nodeIndex, const MapBounds* bounds, const T& object) {
+        // Check if we need to proceed
+        Node& node = _nodes[nodeIndex];
+        if (node.count == 0) {
+            return false;
+        }
+        if (bounds && !node.bounds.intersects(*bounds)) {
+            return false;
+        }
+
+        bool removed = false;
+        if (node.leaf) {
+            // Remove matching records by moving the last record of the node to their slots. Node bounds are not shrunk.
+            for (std::size_t i = node.first; i < node.first + node.count; ) {
+                if (_recordObjects[i] == object) {
+                    std::size_t last = node.first + node.count - 1;
+                    _recordBounds[i] = _recordBounds[last];
+                    _recordObjects[i] = _recordObjects[last];
+                    _recordBounds[last] = MapBounds();
+                    _recordObjects[last] = T();
+                    node.count--;
+                    _count--;
+                    removed = true;
+                } else {
+                    i++;
+                }
+            }
+            return removed;
+        }
+
+        // Recurse
+        for (std::size_t i = node.first; i < node.first + node.count; i++) {
+            if (removeFromNode(i, bounds, object)) {
+                removed = true;
+            }
+        }
+        return removed;
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::queryNode(std::size_t nodeIndex, const Frustum& frustum, std::vector<T>& results) const {
+        // Check if this node intersects with given frustum
+        const Node& node = _nodes[nodeIndex];
+        if (node.count == 0) {
+            return;
+        }
+        if (!frustum.cuboidIntersects(node.bounds)) {
+            return;
+        }
+
+        // Test for intersection of records or recurse to children
+        if (node.leaf) {
+            for (std::size_t i = node.first; i < node.first + node.count; i++) {
+                if (frustum.cuboidIntersects(_recordBounds[i])) {
+                    results.push_back(_recordObjects[i]);
+                }
+            }
+        } else {
+            for (std::size_t i = node.first; i < node.first + node.count; i++) {
+                queryNode(i, frustum, results);
+            }
+        }
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::queryNode(std::size_t nodeIndex, const MapBounds& bounds, std::vector<T>& results) const {
+        // Check if this node intersects with given envelope
+        const Node& node = _nodes[nodeIndex];
+        if (node.count == 0) {
+            return;
+        }
+        if (!bounds.intersects(node.bounds)) {
+            return;
+        }
+
+        // Test for intersection of records or recurse to children
+        if (node.leaf) {
+            for (std::size_t i = node.first; i < node.first + node.count; i++) {
+                if (bounds.intersects(_recordBounds[i])) {
+                    results.push_back(_recordObjects[i]);
+                }
+            }
+        } else {
+            for (std::size_t i = node.first; i < node.first + node.count; i++) {
+                queryNode(i, bounds, results);
+            }
+        }
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::getAllFromNode(std::size_t nodeIndex, std::vector<T>& results) const {
+        const Node& node = _nodes[nodeIndex];
+        if (node.leaf) {
+            results.insert(results.end(), _recordObjects.begin() + node.first, _recordObjects.begin() + node.first + node.count);
+        } else {
+            for (std::size_t i = node.first; i < node.first + node.count; i++) {
+                getAllFromNode(i, results);
+            }
+        }
+    }
+
+    template<typename T>
+    void RTreeSpatialIndex<T>::getRecordsFromNode(std::size_t nodeIndex, std::vector<Record>& records) const {
+        const Node& node = _nodes[nodeIndex];
+        if (node.leaf) {
+            for (std::size_t i = node.first; i < node.first + node.count; i++) {
+                records.emplace_back(_recordBounds[i], _recordObjects[i]);
+            }
+        } else {
+            for (std::size_t i = node.first; i < node.first + node.count; i++) {
+                getRecordsFromNode(i, records);
+            }
+        }
+    }
+
+    template<typename T>
+    template<typename E>
+    void RTreeSpatialIndex<T>::SortTileRecursive(std::vector<E>& entries) {
+        // Sort entries into vertical slices by x coordinate, then each slice by y coordinate. Consecutive runs of BULK_NODE_COUNT entries form the nodes.
+        std::vector<double> centersX, centersY;
+        centersX.reserve(entries.size());
+        centersY.reserve(entries.size());
+        for (const E& entry : entries) {
+            centersX.push_back(GetCenter(GetBounds(entry), 0));
+            centersY.push_back(GetCenter(GetBounds(entry), 1));
+        }
+        std::vector<std::size_t> order(entries.size());
+        for (std::size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+
+        std::size_t nodeCount = (entries.size() + BULK_NODE_COUNT - 1) / BULK_NODE_COUNT;
+        std::size_t sliceCount = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+        std::size_t sliceSize = (nodeCount + sliceCount - 1) / sliceCount * BULK_NODE_COUNT;
+        std::sort(order.begin(), order.end(), [&centersX](std::size_t index1, std::size_t index2) {
+            return centersX[index1] < centersX[index2];
+        });
+        for (std::size_t i = 0; i < order.size(); i += sliceSize) {
+            std::size_t end = std::min(i + sliceSize, order.size());
+            std::sort(order.begin() + i, order.begin() + end, [&centersY](std::size_t index1, std::size_t index2) {
+                return centersY[index1] < centersY[index2];
+            });
+        }
+
+        std::vector<E> sortedEntries;
+        sortedEntries.reserve(entries.size());
+        for (std::size_t index : order) {
+            sortedEntries.push_back(std::move(entries[index]));
+        }
+        std::swap(entries, sortedEntries);
+    }
+
+    template<typename T>
+    template<typename E>
+    std::size_t RTreeSpatialIndex<T>::SplitEntries(std::vector<E>& entries) {
+        // Sort entries along the longest axis of their bounds and split them into halves
+        MapBounds bounds = GetBounds(entries.front());
+        for (const E& entry : entries) {
+            bounds.expandToContain(GetBounds(entry));
+        }
+        int axis = (bounds.getDelta().getY() > bounds.getDelta().getX() ? 1 : 0);
+        std::sort(entries.begin(), entries.end(), [axis](const E& entry1, const E& entry2) {
+            return GetCenter(GetBounds(entry1), axis) < GetCenter(GetBounds(entry2), axis);
+        });
+        return entries.size() / 2;
+    }
+
+    template<typename T>
+    const MapBounds& RTreeSpatialIndex<T>::GetBounds(const Node& node) {
+        return node.bounds;
+    }
+
+    template<typename T>
+    const MapBounds& RTreeSpatialIndex<T>::GetBounds(const Record& record) {
+        return record.first;
+    }
+
+    template<typename T>
+    double RTreeSpatialIndex<T>::GetCenter(const MapBounds& bounds, int axis) {
+        return (bounds.getMin()[axis] + bounds.getMax()[axis]) * 0.5;
+    }
+
+    template<typename T>
+    double RTreeSpatialIndex<T>::CalculateArea(const MapBounds& bounds) {
+        const MapVec& delta = bounds.getDelta();
+        return delta.getX() * delta.getY();
+    }
+
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include "core/MapVec.h"
 #include "graphics/Frustum.h"
 
+#include <utility>
 #include <vector>
 
 namespace carto {
@@ -25,6 +26,11 @@ namespace carto {
         
         virtual void clear() = 0;
         virtual void insert(const MapBounds& bounds, const T& object) = 0;
+        virtual void insertAll(const std::vector<std::pair<MapBounds, T> >& objects) {
+            for (const std::pair<MapBounds, T>& object : objects) {
+                insert(object.first, object.second);
+            }
+        }
         virtual bool remove(const MapBounds& bounds, const T& object) = 0;
         virtual bool remove(const T& object) = 0;
         
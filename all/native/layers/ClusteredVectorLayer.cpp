@@ -17,15 +17,16 @@
 #include "utils/Const.h"
 #include "utils/Log.h"
 
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
 #include <unordered_map>
 #include <vector>
-#include <list>
 #include <stack>
 #include <memory>
 #include <utility>
-#include <numeric>
-
-#include <cglib/vec.h>
 
 namespace carto {
 
@@ -37,6 +38,8 @@ namespace carto {
         _dpiScale(1),
         _rootCluster(),
         _refreshRootCluster(true),
+        _resetRootCluster(false),
+        _changedElements(),
         _renderClusters(),
         _clusterMutex()
     {
@@ -111,8 +114,9 @@ namespace carto {
                     updated = true;
                     break;
                 }
-                clusters.push(cluster->subClusters[0]);
-                clusters.push(cluster->subClusters[1]);
+                for (const std::shared_ptr<Cluster>& subCluster : cluster->subClusters) {
+                    clusters.push(subCluster);
+                }
             }
         }
         std::shared_ptr<MapRenderer> mapRenderer;
@@ -130,6 +134,7 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_clusterMutex);
             _refreshRootCluster = true;
+            _resetRootCluster = true;
         }
         VectorLayer::refresh();
     }
@@ -150,7 +155,13 @@ namespace carto {
                 syncRendererElement(element, _lastCullState->getViewState(), remove);
             }
         }
-        refresh();
+        {
+            // Only the clusters containing this element need to be rebuilt
+            std::lock_guard<std::mutex> lock(_clusterMutex);
+            _refreshRootCluster = true;
+            _changedElements.insert(element);
+        }
+        VectorLayer::refresh();
     }
 
     std::shared_ptr<CancelableTask> ClusteredVectorLayer::createFetchTask(const std::shared_ptr<CullState>& cullState) {
@@ -170,186 +181,138 @@ namespace carto {
             layer->_dpiScale = options->getDPI() / Const::UNSCALED_DPI;
         }
 
-        std::vector<std::shared_ptr<VectorElement> > vectorElements = std::static_pointer_cast<LocalVectorDataSource>(layer->_dataSource.get())->getAll();
         bool refresh = false;
+        std::shared_ptr<Cluster> prevRootCluster;
+        std::unordered_set<std::shared_ptr<VectorElement> > changedElements;
         {
             std::lock_guard<std::mutex> lock(layer->_clusterMutex);
             refresh = layer->_refreshRootCluster;
             if (!layer->_rootCluster) {
                 refresh = true;
             }
+            if (!layer->_resetRootCluster) {
+                prevRootCluster = layer->_rootCluster;
+            }
+            std::swap(changedElements, layer->_changedElements);
             layer->_refreshRootCluster = false;
+            layer->_resetRootCluster = false;
         }
         if (refresh) {
-            std::shared_ptr<Cluster> rootCluster = layer->createClusters(vectorElements);
+            std::vector<std::shared_ptr<VectorElement> > vectorElements = std::static_pointer_cast<LocalVectorDataSource>(layer->_dataSource.get())->getAll();
+            std::shared_ptr<Cluster> rootCluster = layer->createClusters(vectorElements, prevRootCluster, changedElements);
 
             std::lock_guard<std::mutex> lock(layer->_clusterMutex);
+            LinkClusters(rootCluster);
             layer->_rootCluster = rootCluster;
         }
         return false;
     }
 
-    std::shared_ptr<ClusteredVectorLayer::Cluster> ClusteredVectorLayer::createClusters(const std::vector<std::shared_ptr<VectorElement> >& vectorElements) const {
-        if (vectorElements.empty()) {
-            return std::shared_ptr<Cluster>();
+    std::shared_ptr<ClusteredVectorLayer::Cluster> ClusteredVectorLayer::createClusters(const std::vector<std::shared_ptr<VectorElement> >& vectorElements, const std::shared_ptr<Cluster>& prevRootCluster, const std::unordered_set<std::shared_ptr<VectorElement> >& changedElements) const {
+        // Collect singleton clusters and parent links of the previous cluster tree, so that unchanged clusters can be reused
+        std::unordered_map<std::shared_ptr<VectorElement>, std::shared_ptr<Cluster> > prevSingletonClusters;
+        std::unordered_map<const Cluster*, std::shared_ptr<Cluster> > prevParentClusters;
+        std::stack<std::shared_ptr<Cluster> > prevClusters;
+        if (prevRootCluster) {
+            prevClusters.push(prevRootCluster);
+        }
+        while (!prevClusters.empty()) {
+            std::shared_ptr<Cluster> cluster = prevClusters.top();
+            prevClusters.pop();
+            if (cluster->subClusters.empty()) {
+                prevSingletonClusters[cluster->elements.front()] = cluster;
+            }
+            for (const std::shared_ptr<Cluster>& subCluster : cluster->subClusters) {
+                prevParentClusters[subCluster.get()] = cluster;
+                prevClusters.push(subCluster);
+            }
         }
 
-        // Create singleton clusters
+        // Create singleton clusters. Keep elements in id order, so that unchanged areas are clustered identically
+        std::vector<std::shared_ptr<VectorElement> > sortedElements(vectorElements);
+        std::sort(sortedElements.begin(), sortedElements.end(), [](const std::shared_ptr<VectorElement>& element1, const std::shared_ptr<VectorElement>& element2) {
+            return element1->getId() < element2->getId();
+        });
         std::vector<std::shared_ptr<Cluster> > clusters;
-        clusters.reserve(vectorElements.size());
-        for (const std::shared_ptr<VectorElement>& element : vectorElements) {
+        clusters.reserve(sortedElements.size());
+        for (const std::shared_ptr<VectorElement>& element : sortedElements) {
+            auto it = prevSingletonClusters.find(element);
+            if (it != prevSingletonClusters.end() && changedElements.find(element) == changedElements.end()) {
+                clusters.push_back(it->second);
+                continue;
+            }
             std::shared_ptr<Cluster> cluster = createSingletonCluster(element);
             if (cluster) {
                 clusters.push_back(cluster);
             }
         }
 
-        // Merge into a single cluster
-        return mergeClusters(clusters.begin(), clusters.end(), 1).front();
-    }
-
-    std::vector<std::shared_ptr<ClusteredVectorLayer::Cluster> > ClusteredVectorLayer::mergeClusters(std::vector<std::shared_ptr<Cluster> >::iterator clustersBegin, std::vector<std::shared_ptr<Cluster> >::iterator clustersEnd, std::size_t maxClusters) const {
-        struct ClusterInfo {
-            std::shared_ptr<Cluster> cluster;
-            double closestClusterDistance;
-            std::list<ClusterInfo>::iterator closestClusterInfoIt;
-        };
-        
-        std::size_t initialClusters = clustersEnd - clustersBegin;
-
-        // Find axis of bigger variance, use this axis for sorting
-        cglib::vec2<double> mean = std::accumulate(clustersBegin, clustersEnd, cglib::vec2<double>::zero(), [initialClusters](const cglib::vec2<double>& result, const std::shared_ptr<Cluster>& cluster) {
-            return result + cglib::vec2<double>(cluster->staticPos.getX() / initialClusters, cluster->staticPos.getY() / initialClusters);
-        });
-        cglib::vec2<double> variance = std::accumulate(clustersBegin, clustersEnd, cglib::vec2<double>::zero(), [mean](const cglib::vec2<double>& result, const std::shared_ptr<Cluster>& cluster) {
-            cglib::vec2<double> delta = cglib::vec2<double>(cluster->staticPos.getX(), cluster->staticPos.getY()) - mean;
-            return result + cglib::vec2<double>(delta(0) * delta(0), delta(1) * delta(1));
-        });
-
-        int axis = (variance(0) > variance(1) ? 0 : 1);
-        auto clusterComparator = [axis](const std::shared_ptr<Cluster>& cluster1, const std::shared_ptr<Cluster>& cluster2) {
-            return cluster1->staticPos[axis] < cluster2->staticPos[axis];
-        };
-
-        // Use hierarchical clustering, if size above threshold
-        std::list<ClusterInfo> clusterInfos;
-        if (initialClusters > 2 * THRESHOLD) {
-            std::vector<std::shared_ptr<ClusteredVectorLayer::Cluster> > subClusters1;
-            subClusters1.reserve(initialClusters);
-            std::vector<std::shared_ptr<ClusteredVectorLayer::Cluster> > subClusters2;
-            subClusters2.reserve(initialClusters);
-            for (auto it = clustersBegin; it != clustersEnd; it++) {
-                if ((*it)->staticPos[axis] < mean(axis)) {
-                    subClusters1.push_back(*it);
-                } else {
-                    subClusters2.push_back(*it);
+        // Merge clusters level by level, doubling the merge radius at each level. Each unmerged cluster absorbs all unmerged clusters within the radius.
+        bool levelMerged = false;
+        for (int level = 0; level <= MAX_CLUSTER_LEVEL && clusters.size() > 1; level++) {
+            // If previous level did not merge anything, skip directly to the first level that will
+            if (!levelMerged) {
+                double minDistance = CalculateMinClusterDistance(clusters);
+                if (minDistance > std::ldexp(static_cast<double>(Const::WORLD_SIZE), level - MAX_CLUSTER_LEVEL)) {
+                    int minLevel = static_cast<int>(std::ceil(std::log2(minDistance / Const::WORLD_SIZE))) + MAX_CLUSTER_LEVEL;
+                    level = std::max(level, std::min(minLevel, static_cast<int>(MAX_CLUSTER_LEVEL)));
                 }
             }
-            if (!subClusters1.empty() && !subClusters2.empty()) {
-                subClusters1 = mergeClusters(subClusters1.begin(), subClusters1.end(), THRESHOLD);
-                subClusters2 = mergeClusters(subClusters2.begin(), subClusters2.end(), THRESHOLD);
-                std::sort(subClusters1.begin(), subClusters1.end(), clusterComparator);
-                std::sort(subClusters2.begin(), subClusters2.end(), clusterComparator);
-                for (const std::shared_ptr<Cluster>& cluster : subClusters1) {
-                    ClusterInfo clusterInfo;
-                    clusterInfo.cluster = cluster;
-                    clusterInfos.push_back(clusterInfo);
-                }
-                for (const std::shared_ptr<Cluster>& cluster : subClusters2) {
-                    ClusterInfo clusterInfo;
-                    clusterInfo.cluster = cluster;
-                    clusterInfos.push_back(clusterInfo);
+            double radius = std::ldexp(static_cast<double>(Const::WORLD_SIZE), level - MAX_CLUSTER_LEVEL);
+            std::vector<std::vector<std::size_t> > neighbors = FindNeighborClusters(clusters, radius);
+
+            std::vector<bool> merged(clusters.size(), false);
+            std::vector<std::shared_ptr<Cluster> > levelClusters;
+            levelClusters.reserve(clusters.size());
+            for (std::size_t i = 0; i < clusters.size(); i++) {
+                if (merged[i]) {
+                    continue;
                 }
-            }
-        }
-        
-        // If hierarchical clustering was not needed/did not succeed, use normal sorting/create full clustering
-        if (clusterInfos.empty()) {
-            std::sort(clustersBegin, clustersEnd, clusterComparator);
-            for (auto it = clustersBegin; it != clustersEnd; it++) {
-                ClusterInfo clusterInfo;
-                clusterInfo.cluster = *it;
-                clusterInfos.push_back(clusterInfo);
-            }
-        }
-
-        // Find closest clusters. n*sqrt(n) steps avg, n^2 worst
-        for (auto it = clusterInfos.begin(); it != clusterInfos.end(); it++) {
-            it->closestClusterDistance = std::numeric_limits<double>::infinity();
-            it->closestClusterInfoIt = clusterInfos.end();
-            for (auto testIt = it; ++testIt != clusterInfos.end(); ) {
-                if (testIt->cluster->staticPos[axis] - it->cluster->staticPos[axis] >= it->closestClusterDistance) {
-                    break;
+                merged[i] = true;
+
+                std::vector<std::shared_ptr<Cluster> > subClusters(1, clusters[i]);
+                double maxDistance = clusters[i]->maxDistance;
+                for (std::size_t j : neighbors[i]) {
+                    if (!merged[j]) {
+                        merged[j] = true;
+                        subClusters.push_back(clusters[j]);
+                        maxDistance = std::max(maxDistance, std::max(clusters[j]->maxDistance, MapVec(clusters[j]->staticPosInternal - clusters[i]->staticPosInternal).length()));
+                    }
                 }
-                double distance = MapVec(testIt->cluster->staticPos - it->cluster->staticPos).length();
-                if (distance < it->closestClusterDistance) {
-                    it->closestClusterDistance = distance;
-                    it->closestClusterInfoIt = testIt;
+                if (subClusters.size() == 1) {
+                    levelClusters.push_back(clusters[i]);
+                    continue;
                 }
-            }
-        }
 
-        // Merge clusters one-by-one (n steps)
-        while (clusterInfos.size() > maxClusters) {
-            // Find closest pair. n steps
-            std::list<ClusterInfo>::iterator it1 = clusterInfos.begin();
-            for (auto it = clusterInfos.begin(); ++it != clusterInfos.end(); ) {
-                if (it->closestClusterDistance < it1->closestClusterDistance) {
-                    it1 = it;
-                }
-            }
-            std::list<ClusterInfo>::iterator it2 = it1->closestClusterInfoIt;
-
-            // Merge cluster pair
-            ClusterInfo mergedClusterInfo;
-            mergedClusterInfo.cluster = createMergedCluster(it1->cluster, it2->cluster);
-            mergedClusterInfo.closestClusterDistance = std::numeric_limits<double>::infinity();
-            mergedClusterInfo.closestClusterInfoIt = it2; // to force recalculation
-
-            // Insert cluster to sorted cluster info list. 1 steps avg, n steps worst
-            std::list<ClusterInfo>::iterator lastIt = clusterInfos.erase(it2);
-            std::list<ClusterInfo>::iterator firstIt = clusterInfos.erase(it1);
-            std::list<ClusterInfo>::iterator mergeIt;
-            for (mergeIt = firstIt; mergeIt != lastIt; mergeIt++) {
-                if (mergedClusterInfo.cluster->staticPos[axis] > mergeIt->cluster->staticPos[axis]) {
-                    break;
-                }
-            }
-            mergeIt = clusterInfos.insert(mergeIt, mergedClusterInfo);
-
-            // For all clusters, if closest cluster is one of the merged clusters, recalculate closest cluster. n/2 steps avg
-            for (auto it = clusterInfos.begin(); it != lastIt; it++) {
-                if (it->closestClusterInfoIt == it1 || it->closestClusterInfoIt == it2) {
-                    it->closestClusterDistance = std::numeric_limits<double>::infinity();
-                    it->closestClusterInfoIt = clusterInfos.end();
-                    for (auto testIt = it; ++testIt != clusterInfos.end(); ) {
-                        if (testIt->cluster->staticPos[axis] - it->cluster->staticPos[axis] >= it->closestClusterDistance) {
+                // Reuse the previous cluster (and its cluster element) if it consisted of exactly the same subclusters
+                std::shared_ptr<Cluster> cluster;
+                auto parentIt = prevParentClusters.find(subClusters.front().get());
+                if (parentIt != prevParentClusters.end() && parentIt->second->subClusters.size() == subClusters.size()) {
+                    cluster = parentIt->second;
+                    for (const std::shared_ptr<Cluster>& subCluster : subClusters) {
+                        auto it = prevParentClusters.find(subCluster.get());
+                        if (it == prevParentClusters.end() || it->second != cluster) {
+                            cluster.reset();
                             break;
                         }
-                        double distance = MapVec(testIt->cluster->staticPos - it->cluster->staticPos).length();
-                        if (distance < it->closestClusterDistance) {
-                            it->closestClusterDistance = distance;
-                            it->closestClusterInfoIt = testIt;
-                        }
                     }
                 }
-            }
-
-            // Update clusters, check if merged cluster is closer than previously closest cluster. n/2 steps avg
-            for (auto it = clusterInfos.begin(); it != mergeIt; it++) {
-                double distance = MapVec(mergeIt->cluster->staticPos - it->cluster->staticPos).length();
-                if (distance < it->closestClusterDistance) {
-                    it->closestClusterInfoIt = mergeIt;
-                    it->closestClusterDistance = distance;
+                if (!cluster) {
+                    cluster = createMergedCluster(subClusters, maxDistance);
                 }
+                levelClusters.push_back(cluster);
             }
+            levelMerged = levelClusters.size() != clusters.size();
+            std::swap(clusters, levelClusters);
         }
 
-        // Return the remaining clusters
-        std::vector<std::shared_ptr<Cluster> > clusters;
-        clusters.reserve(maxClusters);
-        std::for_each(clusterInfos.begin(), clusterInfos.end(), [&clusters](const ClusterInfo& clusterInfo) { clusters.push_back(clusterInfo.cluster); });
-        return clusters;
+        if (clusters.empty()) {
+            return std::shared_ptr<Cluster>();
+        }
+        if (clusters.size() > 1) {
+            return createMergedCluster(clusters, Const::WORLD_SIZE);
+        }
+        return clusters.front();
     }
 
     std::shared_ptr<ClusteredVectorLayer::Cluster> ClusteredVectorLayer::createSingletonCluster(const std::shared_ptr<VectorElement>& element) const {
@@ -360,34 +323,39 @@ namespace carto {
             cluster->maxDistance = 0;
             cluster->expandPx = 0;
             cluster->staticPos = cluster->transitionPos = mapPos;
-            cluster->mapBoundsInternal = MapBounds(_dataSource->getProjection()->toInternal(mapPos), _dataSource->getProjection()->toInternal(mapPos));
-            cluster->elements.insert(element);
+            cluster->staticPosInternal = _dataSource->getProjection()->toInternal(mapPos);
+            cluster->mapBoundsInternal = MapBounds(cluster->staticPosInternal, cluster->staticPosInternal);
+            cluster->elements.push_back(element);
 
-            cluster->clusterElement = _clusterElementBuilder->buildClusterElement(cluster->transitionPos, std::vector<std::shared_ptr<VectorElement> >(cluster->elements.begin(), cluster->elements.end()));
+            cluster->clusterElement = _clusterElementBuilder->buildClusterElement(cluster->transitionPos, cluster->elements);
         }
         return cluster;
     }
 
-    std::shared_ptr<ClusteredVectorLayer::Cluster> ClusteredVectorLayer::createMergedCluster(const std::shared_ptr<Cluster>& cluster1, const std::shared_ptr<Cluster>& cluster2) const {
-        int n1 = static_cast<int>(cluster1->elements.size());
-        int n2 = static_cast<int>(cluster2->elements.size());
-        MapPos mapPos((cluster1->staticPos.getX() * n1 + cluster2->staticPos.getX() * n2) / (n1 + n2), (cluster1->staticPos.getY() * n1 + cluster2->staticPos.getY() * n2) / (n1 + n2));
-        double dist = MapVec(_dataSource->getProjection()->toInternal(cluster1->staticPos) - _dataSource->getProjection()->toInternal(cluster2->staticPos)).length();
-
+    std::shared_ptr<ClusteredVectorLayer::Cluster> ClusteredVectorLayer::createMergedCluster(const std::vector<std::shared_ptr<Cluster> >& subClusters, double maxDistance) const {
         auto cluster = std::make_shared<Cluster>();
-        cluster->maxDistance = dist;
+        double x = 0, y = 0;
+        std::size_t n = 0;
+        for (const std::shared_ptr<Cluster>& subCluster : subClusters) {
+            std::size_t ni = subCluster->elements.size();
+            x += subCluster->staticPos.getX() * ni;
+            y += subCluster->staticPos.getY() * ni;
+            n += ni;
+            cluster->mapBoundsInternal.expandToContain(subCluster->mapBoundsInternal);
+        }
+        MapPos mapPos(x / n, y / n);
+
+        cluster->maxDistance = maxDistance;
         cluster->expandPx = 0;
         cluster->staticPos = cluster->transitionPos = mapPos;
-        cluster->mapBoundsInternal.expandToContain(cluster1->mapBoundsInternal);
-        cluster->mapBoundsInternal.expandToContain(cluster2->mapBoundsInternal);
-        cluster->elements.insert(cluster1->elements.begin(), cluster1->elements.end());
-        cluster->elements.insert(cluster2->elements.begin(), cluster2->elements.end());
-        cluster->subClusters[0] = cluster1;
-        cluster->subClusters[1] = cluster2;
-        cluster1->parentCluster = cluster;
-        cluster2->parentCluster = cluster;
-
-        cluster->clusterElement = _clusterElementBuilder->buildClusterElement(cluster->transitionPos, std::vector<std::shared_ptr<VectorElement> >(cluster->elements.begin(), cluster->elements.end()));
+        cluster->staticPosInternal = _dataSource->getProjection()->toInternal(mapPos);
+        cluster->elements.reserve(n);
+        for (const std::shared_ptr<Cluster>& subCluster : subClusters) {
+            cluster->elements.insert(cluster->elements.end(), subCluster->elements.begin(), subCluster->elements.end());
+        }
+        cluster->subClusters = subClusters;
+
+        cluster->clusterElement = _clusterElementBuilder->buildClusterElement(cluster->transitionPos, cluster->elements);
         return cluster;
     }
 
@@ -466,11 +434,10 @@ namespace carto {
 
         // Draw subclusters recursively
         bool refresh = false;
-        if (renderCluster(cluster->subClusters[0], viewState, renderState, deltaSeconds)) {
-            refresh = true;
-        }
-        if (renderCluster(cluster->subClusters[1], viewState, renderState, deltaSeconds)) {
-            refresh = true;
+        for (const std::shared_ptr<Cluster>& subCluster : cluster->subClusters) {
+            if (renderCluster(subCluster, viewState, renderState, deltaSeconds)) {
+                refresh = true;
+            }
         }
 
         // Undo expanded state
@@ -546,6 +513,91 @@ namespace carto {
         return _dataSource->getProjection()->fromInternal(mapPos + MapVec(std::cos(angle), std::sin(angle)) * dist);
     }
 
+    std::vector<std::vector<std::size_t> > ClusteredVectorLayer::FindNeighborClusters(const std::vector<std::shared_ptr<Cluster> >& clusters, double radius) {
+        // Sort clusters into grid cells (ordered by row, then column) with cell size equal to the radius.
+        // Neighbors are then found from 3 consecutive cells in each of the 3 surrounding rows.
+        typedef std::pair<std::pair<long long, long long>, std::size_t> ClusterCell;
+        std::vector<ClusterCell> cells;
+        cells.reserve(clusters.size());
+        for (std::size_t i = 0; i < clusters.size(); i++) {
+            const MapPos& pos = clusters[i]->staticPosInternal;
+            cells.emplace_back(std::make_pair(static_cast<long long>(std::floor(pos.getY() / radius)), static_cast<long long>(std::floor(pos.getX() / radius))), i);
+        }
+        std::sort(cells.begin(), cells.end());
+
+        std::vector<std::vector<std::size_t> > neighbors(clusters.size());
+        auto findNeighbors = [&clusters, &cells, &neighbors, radius](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; k++) {
+                std::size_t i = cells[k].second;
+                long long row = cells[k].first.first;
+                long long col = cells[k].first.second;
+                for (long long r = row - 1; r <= row + 1; r++) {
+                    auto it = std::lower_bound(cells.begin(), cells.end(), ClusterCell(std::make_pair(r, col - 1), 0));
+                    for (; it != cells.end() && it->first.first == r && it->first.second <= col + 1; it++) {
+                        std::size_t j = it->second;
+                        if (j != i && MapVec(clusters[j]->staticPosInternal - clusters[i]->staticPosInternal).length() <= radius) {
+                            neighbors[i].push_back(j);
+                        }
+                    }
+                }
+            }
+        };
+
+        // Search in parallel for large cluster counts, the calling thread takes the first slice
+        std::size_t threadCount = 1;
+        if (clusters.size() >= PARALLEL_NEIGHBOR_SEARCH_THRESHOLD) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::size_t sliceSize = (cells.size() + threadCount - 1) / threadCount;
+        std::vector<std::future<void> > futures;
+        for (std::size_t begin = sliceSize; begin < cells.size(); begin += sliceSize) {
+            futures.push_back(std::async(std::launch::async, findNeighbors, begin, std::min(begin + sliceSize, cells.size())));
+        }
+        findNeighbors(0, std::min(sliceSize, cells.size()));
+        for (std::future<void>& future : futures) {
+            future.get();
+        }
+        return neighbors;
+    }
+
+    double ClusteredVectorLayer::CalculateMinClusterDistance(const std::vector<std::shared_ptr<Cluster> >& clusters) {
+        // Sweep over clusters sorted by x coordinate
+        std::vector<MapPos> positions;
+        positions.reserve(clusters.size());
+        for (const std::shared_ptr<Cluster>& cluster : clusters) {
+            positions.push_back(cluster->staticPosInternal);
+        }
+        std::sort(positions.begin(), positions.end(), [](const MapPos& pos1, const MapPos& pos2) {
+            return pos1.getX() < pos2.getX();
+        });
+
+        double minDistance = std::numeric_limits<double>::infinity();
+        for (std::size_t i = 0; i < positions.size(); i++) {
+            for (std::size_t j = i + 1; j < positions.size() && positions[j].getX() - positions[i].getX() < minDistance; j++) {
+                minDistance = std::min(minDistance, MapVec(positions[j] - positions[i]).length());
+            }
+        }
+        return minDistance;
+    }
+
+    void ClusteredVectorLayer::LinkClusters(const std::shared_ptr<Cluster>& rootCluster) {
+        // Parent links are updated only when the tree is published, as reused clusters may still be used for rendering the previous tree
+        if (!rootCluster) {
+            return;
+        }
+        rootCluster->parentCluster.reset();
+        std::stack<std::shared_ptr<Cluster> > clusters;
+        clusters.push(rootCluster);
+        while (!clusters.empty()) {
+            std::shared_ptr<Cluster> cluster = clusters.top();
+            clusters.pop();
+            for (const std::shared_ptr<Cluster>& subCluster : cluster->subClusters) {
+                subCluster->parentCluster = cluster;
+                clusters.push(subCluster);
+            }
+        }
+    }
+
     bool ClusteredVectorLayer::GetVectorElementPos(const std::shared_ptr<VectorElement>& vectorElement, MapPos& pos) {
         std::shared_ptr<Geometry> geometry = vectorElement->getGeometry();
         if (auto pointGeometry = std::dynamic_pointer_cast<PointGeometry>(geometry)) {
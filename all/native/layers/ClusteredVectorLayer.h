@@ -14,8 +14,8 @@
 #include "layers/VectorLayer.h"
 
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
-#include <list>
 #include <memory>
 #include <utility>
 #include <mutex>
@@ -27,7 +27,8 @@ namespace carto {
 
     /**
      * A vector layer that supports clustering point-type features.
-     * A Pairwise centroid hierarchical clustering algorithm is used internally.
+     * A grid based hierarchical clustering algorithm is used internally, clusters are precomputed for discrete
+     * distance levels. When individual elements change, clusters and cluster elements of unaffected areas are reused.
      */
     class ClusteredVectorLayer : public VectorLayer {
     public:
@@ -85,12 +86,13 @@ namespace carto {
             double maxDistance;
             float expandPx;
             MapPos staticPos;
+            MapPos staticPosInternal;
             MapPos transitionPos;
             MapBounds mapBoundsInternal;
-            std::unordered_set<std::shared_ptr<VectorElement> > elements;
+            std::vector<std::shared_ptr<VectorElement> > elements;
             std::shared_ptr<VectorElement> clusterElement;
             std::weak_ptr<Cluster> parentCluster;
-            std::shared_ptr<Cluster> subClusters[2];
+            std::vector<std::shared_ptr<Cluster> > subClusters;
         };
 
         struct RenderState {
@@ -109,7 +111,8 @@ namespace carto {
             virtual bool loadElements(const std::shared_ptr<CullState>& cullState);
         };
 
-        static const std::size_t THRESHOLD = 100;
+        static const int MAX_CLUSTER_LEVEL = 32; // merge radius is doubled at each level, at this level it equals the world size
+        static const std::size_t PARALLEL_NEIGHBOR_SEARCH_THRESHOLD = 4096;
 
         const DirectorPtr<ClusterElementBuilder> _clusterElementBuilder;
 
@@ -118,8 +121,10 @@ namespace carto {
         float _dpiScale;
         std::shared_ptr<Cluster> _rootCluster;
         bool _refreshRootCluster;
+        bool _resetRootCluster;
+        std::unordered_set<std::shared_ptr<VectorElement> > _changedElements;
         std::vector<std::shared_ptr<Cluster> > _renderClusters;
-        mutable std::mutex _clusterMutex; // for _clusterDistance, _dpiScale, _rootCluster, _refreshRootCluster, _renderClusters
+        mutable std::mutex _clusterMutex; // for _clusterDistance, _dpiScale, _rootCluster, _refreshRootCluster, _resetRootCluster, _changedElements, _renderClusters
 
         virtual bool onDrawFrame(float deltaSeconds, BillboardSorter& billboardSorter, StyleTextureCache& styleCache, const ViewState& viewState);
 
@@ -127,10 +132,9 @@ namespace carto {
 
         virtual std::shared_ptr<CancelableTask> createFetchTask(const std::shared_ptr<CullState>& cullState);
 
-        std::shared_ptr<Cluster> createClusters(const std::vector<std::shared_ptr<VectorElement> >& vectorElements) const;
-        std::vector<std::shared_ptr<Cluster> > mergeClusters(std::vector<std::shared_ptr<Cluster> >::iterator clustersBegin, std::vector<std::shared_ptr<Cluster> >::iterator clustersEnd, std::size_t maxClusters) const;
+        std::shared_ptr<Cluster> createClusters(const std::vector<std::shared_ptr<VectorElement> >& vectorElements, const std::shared_ptr<Cluster>& prevRootCluster, const std::unordered_set<std::shared_ptr<VectorElement> >& changedElements) const;
         std::shared_ptr<Cluster> createSingletonCluster(const std::shared_ptr<VectorElement>& element) const;
-        std::shared_ptr<Cluster> createMergedCluster(const std::shared_ptr<Cluster>& cluster1, const std::shared_ptr<Cluster>& cluster2) const;
+        std::shared_ptr<Cluster> createMergedCluster(const std::vector<std::shared_ptr<Cluster> >& subClusters, double maxDistance) const;
 
         bool renderClusters(const ViewState& viewState, float deltaSeconds);
         bool renderCluster(const std::shared_ptr<Cluster>& cluster, const ViewState& viewState, RenderState& renderState, float deltaSeconds);
@@ -138,6 +142,10 @@ namespace carto {
         bool moveCluster(const std::shared_ptr<Cluster>& cluster, const MapPos& targetPos, const RenderState& renderState, float deltaSeconds);
         MapPos createExpandedElementPos(RenderState& renderState) const;
 
+        static std::vector<std::vector<std::size_t> > FindNeighborClusters(const std::vector<std::shared_ptr<Cluster> >& clusters, double radius);
+        static double CalculateMinClusterDistance(const std::vector<std::shared_ptr<Cluster> >& clusters);
+        static void LinkClusters(const std::shared_ptr<Cluster>& rootCluster);
+
         static bool GetVectorElementPos(const std::shared_ptr<VectorElement>& vectorElement, MapPos& pos);
         static bool SetVectorElementPos(const std::shared_ptr<VectorElement>& vectorElement, const MapPos& pos);
     };
@@ -74,7 +74,7 @@ namespace carto {
             throw NullArgumentException("Null dataSource");
         }
 
-        _fetchThreadPool->setPoolSize(1);
+        _fetchThreadPool->setPoolSize(DEFAULT_FETCH_THREAD_COUNT);
     }
     
     NMLModelLODTreeLayer::~NMLModelLODTreeLayer() {
@@ -108,6 +108,17 @@ namespace carto {
         refresh();
     }
 
+    int NMLModelLODTreeLayer::getFetchThreadCount() const {
+        return _fetchThreadPool->getPoolSize();
+    }
+
+    void NMLModelLODTreeLayer::setFetchThreadCount(int threadCount) {
+        if (threadCount < 1) {
+            throw InvalidArgumentException("Fetch thread count must be at least 1");
+        }
+        _fetchThreadPool->setPoolSize(threadCount);
+    }
+
     std::shared_ptr<NMLModelLODTreeEventListener> NMLModelLODTreeLayer::getNMLModelLODTreeEventListener() const {
         return _nmlModelLODTreeEventListener.get();
     }
@@ -715,7 +726,7 @@ namespace carto {
             return;
         }
     
-        // Load new mesh
+        // Load new texture
         std::shared_ptr<nml::Texture> texture;
         try {
             texture = layer->_dataSource->loadTexture(_binding.textureId, _binding.level);
@@ -724,6 +735,11 @@ namespace carto {
         }
 
         if (texture) {
+            // Do software decompression here instead of the rendering thread, if GPU does not support the texture format
+            if (layer->_renderer->isTextureUncompressionNeeded(*texture)) {
+                nml::GLTexture::uncompressTexture(*texture);
+            }
+
             auto glTexture = std::make_shared<nml::GLTexture>(texture);
     
             std::unique_lock<std::recursive_mutex> lock(layer->_mutex);
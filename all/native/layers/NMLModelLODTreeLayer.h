@@ -80,6 +80,19 @@ namespace carto {
          * @param factor The relative LOD resolution factor.
          */
         void setLODResolutionFactor(float factor);
+
+        /**
+         * Returns the number of worker threads used for loading and decoding models, meshes and textures.
+         * @return The number of worker threads.
+         */
+        int getFetchThreadCount() const;
+        /**
+         * Sets the number of worker threads used for loading and decoding models, meshes and textures.
+         * Decoded data is uploaded to GPU in small batches on the rendering thread. The default is 2.
+         * @param threadCount The number of worker threads. Must be at least 1.
+         * @throws std::invalid_argument If the thread count is less than 1.
+         */
+        void setFetchThreadCount(int threadCount);
     
         /**
          * Returns the NML model event listener.
@@ -209,6 +222,7 @@ namespace carto {
         static const int MESH_LOADING_PRIORITY_OFFSET = 0;
         static const int TEXTURE_LOADING_PRIORITY_OFFSET = 0;
 
+        static const int DEFAULT_FETCH_THREAD_COUNT = 2;
         static const int DEFAULT_MODELLODTREE_CACHE_SIZE = 64;
         static const int DEFAULT_MAX_MEMORY_SIZE = 40 * 1024 * 1024;
         static const int DEFAULT_MESH_CACHE_SIZE = 40 * 1024 * 1024;
@@ -17,6 +17,8 @@
 #include <vt/TileId.h>
 #include <vt/Tile.h>
 
+#include <algorithm>
+
 namespace carto {
 
     VectorTileLayer::VectorTileLayer(const std::shared_ptr<TileDataSource>& dataSource, const std::shared_ptr<VectorTileDecoder>& decoder) :
@@ -34,7 +36,9 @@ namespace carto {
         _renderer(),
         _tempDrawDatas(),
         _visibleCache(128 * 1024 * 1024), // NOTE: the limit should never be reached in normal cases
-        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE)
+        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE),
+        _prefetchingFrameTiles(),
+        _prefetchingFrameTilesMutex()
     {
         if (!decoder) {
             throw NullArgumentException("Null decoder");
@@ -201,7 +205,11 @@ namespace carto {
             _preloadingCache.read(closestTileId, tileInfo);
         }
         if (std::shared_ptr<VectorTileDecoder::TileMap> tileMap = tileInfo.getTileMap()) {
-            auto it = tileMap->find(_useTileMapMode ? closestTile.getFrameNr() : 0);
+            int frameNr = (_useTileMapMode ? closestTile.getFrameNr() : 0);
+            if (tileInfo.getFrameDecoder()) {
+                frameNr = updateTileFrames(closestTileId, tileInfo, frameNr);
+            }
+            auto it = tileMap->find(frameNr);
             if (it != tileMap->end()) {
                 std::shared_ptr<const vt::Tile> vtTile = it->second;
                 vt::TileId vtTileId(visTile.getZoom(), visTile.getX(), visTile.getY());
@@ -215,6 +223,83 @@ namespace carto {
         }
     }
     
+    std::vector<int> VectorTileLayer::GetFrameWindow(int frameNr, int frameCount) {
+        // Current frame first, then the following frames (wrapping around) and finally the previous frame
+        std::vector<int> frames;
+        if (frameCount <= 0) {
+            return frames;
+        }
+        frameNr = ((frameNr % frameCount) + frameCount) % frameCount;
+        for (int i = 0; i <= FRAME_WINDOW_SIZE && i < frameCount; i++) {
+            frames.push_back((frameNr + i) % frameCount);
+        }
+        if (frameCount > FRAME_WINDOW_SIZE + 1) {
+            frames.push_back((frameNr + frameCount - 1) % frameCount);
+        }
+        return frames;
+    }
+
+    int VectorTileLayer::updateTileFrames(long long tileId, const TileInfo& tileInfo, int frameNr) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        const std::shared_ptr<VectorTileDecoder::TileMap>& tileMap = tileInfo.getTileMap();
+        const std::shared_ptr<VectorTileDecoder::TileFrameDecoder>& frameDecoder = tileInfo.getFrameDecoder();
+        std::vector<int> frames = GetFrameWindow(frameNr, frameDecoder->getFrameCount());
+
+        // Drop frames outside of the window to keep memory usage bounded
+        bool framesDropped = false;
+        for (auto it = tileMap->begin(); it != tileMap->end(); ) {
+            if (std::find(frames.begin(), frames.end(), it->first) == frames.end()) {
+                it = tileMap->erase(it);
+                framesDropped = true;
+            } else {
+                it++;
+            }
+        }
+        if (framesDropped) {
+            updateTileSize(tileId, tileMap);
+        }
+
+        // Decode missing frames in background, current frame first. If the current frame is missing, use normal priority for the task
+        std::vector<int> missingFrames;
+        for (int frame : frames) {
+            if (tileMap->find(frame) == tileMap->end()) {
+                missingFrames.push_back(frame);
+            }
+        }
+        bool currentFrameMissing = !frames.empty() && tileMap->find(frames.front()) == tileMap->end();
+        if (!missingFrames.empty() && _tileThreadPool) {
+            bool prefetching = false;
+            {
+                std::lock_guard<std::mutex> prefetchingLock(_prefetchingFrameTilesMutex);
+                prefetching = !_prefetchingFrameTiles.insert(tileId).second;
+            }
+            if (!prefetching) {
+                auto task = std::make_shared<FramePrefetchTask>(std::static_pointer_cast<VectorTileLayer>(shared_from_this()), tileId, tileMap, frameDecoder, missingFrames);
+                _tileThreadPool->execute(task, currentFrameMissing ? getUpdatePriority() : getUpdatePriority() + PRELOADING_PRIORITY_OFFSET);
+            }
+        }
+
+        // Until the current frame is decoded, keep showing the previous frame. The frame is never decoded here, as this is called from the render thread
+        if (currentFrameMissing && frames.size() > 1 && tileMap->find(frames.back()) != tileMap->end()) {
+            return frames.back();
+        }
+        return frameNr;
+    }
+
+    void VectorTileLayer::updateTileSize(long long tileId, const std::shared_ptr<VectorTileDecoder::TileMap>& tileMap) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        // Re-put the tile, so that the cache accounts for the frames added or dropped after the tile was stored
+        TileInfo tileInfo;
+        if (_visibleCache.peek(tileId, tileInfo) && tileInfo.getTileMap() == tileMap) {
+            _visibleCache.put(tileId, tileInfo, tileInfo.getSize());
+        }
+        else if (_preloadingCache.peek(tileId, tileInfo) && tileInfo.getTileMap() == tileMap) {
+            _preloadingCache.put(tileId, tileInfo, tileInfo.getSize());
+        }
+    }
+    
     void VectorTileLayer::refreshDrawData(const std::shared_ptr<CullState>& cullState) {
         // Move tiles between caches
         {
@@ -445,10 +530,45 @@ namespace carto {
     
             vt::TileId vtTile(_tile.getZoom(), _tile.getX(), _tile.getY());
             vt::TileId vtDataSourceTile(dataSourceTile.getZoom(), dataSourceTile.getX(), dataSourceTile.getY());
-            std::shared_ptr<VectorTileDecoder::TileMap> tileMap = layer->_tileDecoder->decodeTile(vtDataSourceTile, vtTile, tileData->getData());
+            std::shared_ptr<VectorTileDecoder::TileMap> tileMap;
+            std::shared_ptr<VectorTileDecoder::TileFrameDecoder> frameDecoder;
+            if (layer->_useTileMapMode) {
+                frameDecoder = layer->_tileDecoder->createTileFrameDecoder(vtDataSourceTile, vtTile, tileData->getData());
+            }
+            if (frameDecoder) {
+                // Decode only the frames around the current frame, other frames are decoded on demand
+                tileMap = std::make_shared<VectorTileDecoder::TileMap>();
+                try {
+                    for (int frame : GetFrameWindow(layer->getFrameNr(), frameDecoder->getFrameCount())) {
+                        if (std::shared_ptr<const vt::Tile> vtFrameTile = frameDecoder->decodeFrame(frame)) {
+                            (*tileMap)[frame] = vtFrameTile;
+                        }
+                    }
+                } catch (const std::exception& ex) {
+                    Log::Errorf("VectorTileLayer::FetchTask: Exception while decoding frames: %s", ex.what());
+                    tileMap.reset();
+                }
+            } else {
+                tileMap = layer->_tileDecoder->decodeTile(vtDataSourceTile, vtTile, tileData->getData());
+            }
             if (tileMap) {
+                // Debug tile performance issues. NOTE: must be done before the tile is published, as frames may be updated concurrently after that
+                if (Log::IsShowDebug()) {
+                    int maxDrawCallCount = 0;
+                    for (auto it = tileMap->begin(); it != tileMap->end(); it++) {
+                        int drawCallCount = 0;
+                        for (const std::shared_ptr<vt::TileLayer>& vtLayer : it->second->getLayers()) {
+                            drawCallCount += static_cast<int>(vtLayer->getBitmaps().size() + vtLayer->getGeometries().size());
+                        }
+                        maxDrawCallCount = std::max(maxDrawCallCount, drawCallCount);
+                    }
+                    if (maxDrawCallCount >= 20) {
+                        Log::Debugf("VectorTileLayer::FetchTask: Tile requires %d draw calls", maxDrawCallCount);
+                    }
+                }
+
                 // Construct tile info - keep original data if interactivity is required
-                VectorTileLayer::TileInfo tileInfo(layer->calculateMapTileBounds(dataSourceTile.getFlipped()), layer->_vectorTileEventListener.get() ? tileData->getData() : std::shared_ptr<BinaryData>(), tileMap);
+                VectorTileLayer::TileInfo tileInfo(layer->calculateMapTileBounds(dataSourceTile.getFlipped()), layer->_vectorTileEventListener.get() ? tileData->getData() : std::shared_ptr<BinaryData>(), tileMap, frameDecoder);
 
                 // Store tile to cache, unless invalidated
                 if (!isInvalidated()) {
@@ -469,21 +589,6 @@ namespace carto {
                     }
                 }
                 
-                // Debug tile performance issues
-                if (Log::IsShowDebug()) {
-                    int maxDrawCallCount = 0;
-                    for (auto it = tileMap->begin(); it != tileMap->end(); it++) {
-                        int drawCallCount = 0;
-                        for (const std::shared_ptr<vt::TileLayer>& vtLayer : it->second->getLayers()) {
-                            drawCallCount += static_cast<int>(vtLayer->getBitmaps().size() + vtLayer->getGeometries().size());
-                        }
-                        maxDrawCallCount = std::max(maxDrawCallCount, drawCallCount);
-                    }
-                    if (maxDrawCallCount >= 20) {
-                        Log::Debugf("VectorTileLayer::FetchTask: Tile requires %d draw calls", maxDrawCallCount);
-                    }
-                }
-                
                 refresh = true; // NOTE: need to refresh even when invalidated
             } else {
                 Log::Error("VectorTileLayer::FetchTask: Failed to decode tile");
@@ -516,6 +621,76 @@ namespace carto {
         }
     }
 
+    VectorTileLayer::FramePrefetchTask::FramePrefetchTask(const std::shared_ptr<VectorTileLayer>& layer, long long tileId, const std::shared_ptr<VectorTileDecoder::TileMap>& tileMap, const std::shared_ptr<VectorTileDecoder::TileFrameDecoder>& frameDecoder, const std::vector<int>& frames) :
+        _layer(layer),
+        _tileId(tileId),
+        _tileMap(tileMap),
+        _frameDecoder(frameDecoder),
+        _frames(frames)
+    {
+    }
+
+    void VectorTileLayer::FramePrefetchTask::cancel() {
+        CancelableTask::cancel();
+
+        std::shared_ptr<VectorTileLayer> layer = _layer.lock();
+        if (!layer) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(layer->_prefetchingFrameTilesMutex);
+        layer->_prefetchingFrameTiles.erase(_tileId);
+    }
+
+    void VectorTileLayer::FramePrefetchTask::run() {
+        std::shared_ptr<VectorTileLayer> layer = _layer.lock();
+        if (!layer) {
+            return;
+        }
+
+        for (int frame : _frames) {
+            if (isCanceled()) {
+                break;
+            }
+
+            {
+                std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+                if (_tileMap->find(frame) != _tileMap->end()) {
+                    continue;
+                }
+            }
+
+            std::shared_ptr<const vt::Tile> vtTile;
+            try {
+                vtTile = _frameDecoder->decodeFrame(frame);
+            } catch (const std::exception& ex) {
+                Log::Errorf("VectorTileLayer::FramePrefetchTask: Exception while decoding frame: %s", ex.what());
+            }
+
+            if (vtTile) {
+                {
+                    std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+                    (*_tileMap)[frame] = vtTile;
+                    layer->updateTileSize(_tileId, _tileMap);
+                }
+                if (frame == _frames.front()) {
+                    // The previous frame may be shown in place of this frame, update draw data
+                    std::shared_ptr<MapRenderer> mapRenderer;
+                    {
+                        std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+                        mapRenderer = layer->_mapRenderer.lock();
+                    }
+                    if (mapRenderer) {
+                        mapRenderer->layerChanged(layer->shared_from_this(), false);
+                        mapRenderer->requestRedraw();
+                    }
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(layer->_prefetchingFrameTilesMutex);
+        layer->_prefetchingFrameTiles.erase(_tileId);
+    }
+
     std::size_t VectorTileLayer::TileInfo::getSize() const {
         std::size_t size = EXTRA_TILE_FOOTPRINT;
         if (_tileData) {
@@ -17,6 +17,8 @@
 
 #include <memory>
 #include <map>
+#include <mutex>
+#include <unordered_set>
 
 #include <stdext/timed_lru_cache.h>
 
@@ -181,24 +183,48 @@ namespace carto {
             ViewState _viewState;
         };
 
+        class FramePrefetchTask : public CancelableTask {
+        public:
+            FramePrefetchTask(const std::shared_ptr<VectorTileLayer>& layer, long long tileId, const std::shared_ptr<VectorTileDecoder::TileMap>& tileMap, const std::shared_ptr<VectorTileDecoder::TileFrameDecoder>& frameDecoder, const std::vector<int>& frames);
+
+            virtual void cancel();
+            virtual void run();
+
+        private:
+            std::weak_ptr<VectorTileLayer> _layer;
+            long long _tileId;
+            std::shared_ptr<VectorTileDecoder::TileMap> _tileMap;
+            std::shared_ptr<VectorTileDecoder::TileFrameDecoder> _frameDecoder;
+            std::vector<int> _frames;
+        };
+
         class TileInfo {
         public:
-            TileInfo() : _tileBounds(), _tileData(), _tileMap() { }
-            TileInfo(const MapBounds& tileBounds, const std::shared_ptr<BinaryData>& tileData, const std::shared_ptr<VectorTileDecoder::TileMap>& tileMap) : _tileBounds(tileBounds), _tileData(tileData), _tileMap(tileMap) { }
+            TileInfo() : _tileBounds(), _tileData(), _tileMap(), _frameDecoder() { }
+            TileInfo(const MapBounds& tileBounds, const std::shared_ptr<BinaryData>& tileData, const std::shared_ptr<VectorTileDecoder::TileMap>& tileMap) : _tileBounds(tileBounds), _tileData(tileData), _tileMap(tileMap), _frameDecoder() { }
+            TileInfo(const MapBounds& tileBounds, const std::shared_ptr<BinaryData>& tileData, const std::shared_ptr<VectorTileDecoder::TileMap>& tileMap, const std::shared_ptr<VectorTileDecoder::TileFrameDecoder>& frameDecoder) : _tileBounds(tileBounds), _tileData(tileData), _tileMap(tileMap), _frameDecoder(frameDecoder) { }
 
             const MapBounds& getTileBounds() const { return _tileBounds; }
             const std::shared_ptr<BinaryData>& getTileData() const { return _tileData; }
             const std::shared_ptr<VectorTileDecoder::TileMap>& getTileMap() const { return _tileMap; }
+            const std::shared_ptr<VectorTileDecoder::TileFrameDecoder>& getFrameDecoder() const { return _frameDecoder; }
 
             std::size_t getSize() const;
 
         private:
             MapBounds _tileBounds;
             std::shared_ptr<BinaryData> _tileData;
-            std::shared_ptr<VectorTileDecoder::TileMap> _tileMap;
+            std::shared_ptr<VectorTileDecoder::TileMap> _tileMap; // with frame decoder, contains only frames within the frame window
+            std::shared_ptr<VectorTileDecoder::TileFrameDecoder> _frameDecoder;
         };
+
+        static std::vector<int> GetFrameWindow(int frameNr, int frameCount);
+
+        int updateTileFrames(long long tileId, const TileInfo& tileInfo, int frameNr);
+        void updateTileSize(long long tileId, const std::shared_ptr<VectorTileDecoder::TileMap>& tileMap);
     
         static const int DEFAULT_CULL_DELAY = 200;
+        static const int FRAME_WINDOW_SIZE = 8; // number of frames decoded ahead of the current frame
         static const int PRELOADING_PRIORITY_OFFSET = -2;
         static const int EXTRA_TILE_FOOTPRINT = 4096;
         static const int DEFAULT_PRELOADING_CACHE_SIZE = 10 * 1024 * 1024;
@@ -218,6 +244,9 @@ namespace carto {
 
         cache::timed_lru_cache<long long, TileInfo> _visibleCache;
         cache::timed_lru_cache<long long, TileInfo> _preloadingCache;
+
+        std::unordered_set<long long> _prefetchingFrameTiles;
+        mutable std::mutex _prefetchingFrameTilesMutex; // separate from the layer mutex, as tasks are canceled while the thread pool is locked
     };
     
 }
@@ -5,6 +5,7 @@
 #include "components/Exceptions.h"
 #include "utils/Log.h"
 
+#include <array>
 #include <cstdint>
 #include <memory>
 #include <utility>
@@ -37,6 +38,154 @@ namespace {
         carto::Variant var = carto::Variant::FromString(metaInfo.GetString());
         return std::make_shared<carto::PackageMetaInfo>(var);
     }
+
+    const std::uint64_t PACKAGE_CHUNK_SIZE = 1024 * 1024;
+
+    // Journal of SHA-1 digests of fixed-size chunks of a package being downloaded. Chunks are hashed as they arrive,
+    // so resumed downloads can verify the already downloaded data without a separate pass when the download finishes.
+    // Note that digests are calculated from the received bytes, so they detect damage to the partial file between
+    // download sessions (for example an interrupted write), but not corruption that happened in transit.
+    class PackageChunkJournal {
+    public:
+        explicit PackageChunkJournal(const std::string& fileName) : _fileName(fileName), _journalFileName(fileName + ".chunks"), _digests(), _hash(), _chunkSize(0) { }
+
+        std::uint64_t verify(std::uint64_t fileSize) {
+            // Load the stored digests. If there is no journal (download was started by an older version), the existing data is trusted
+            bool trusted = true;
+            _digests.clear();
+            if (FILE* fpRaw = utf8_filesystem::fopen(_journalFileName.c_str(), "rb")) {
+                std::shared_ptr<FILE> fp(fpRaw, fclose);
+                trusted = false;
+                Digest digest;
+                while (fread(digest.data(), sizeof(unsigned char), digest.size(), fp.get()) == digest.size()) {
+                    _digests.push_back(digest);
+                }
+            }
+
+            _hash.Restart();
+            _chunkSize = 0;
+            std::uint64_t verifiedSize = 0;
+            if (FILE* fpRaw = utf8_filesystem::fopen(_fileName.c_str(), "rb")) {
+                std::shared_ptr<FILE> fp(fpRaw, fclose);
+                std::vector<unsigned char> chunk;
+                if (trusted) {
+                    // Hash all the existing data once to create the journal, keep the incomplete last chunk in the running hash
+                    while (verifiedSize < fileSize) {
+                        chunk.resize(static_cast<std::size_t>(std::min(PACKAGE_CHUNK_SIZE, fileSize - verifiedSize)));
+                        if (fread(chunk.data(), sizeof(unsigned char), chunk.size(), fp.get()) != chunk.size()) {
+                            break;
+                        }
+                        if (chunk.size() == PACKAGE_CHUNK_SIZE) {
+                            Digest digest;
+                            CryptoPP::SHA1().CalculateDigest(digest.data(), chunk.data(), chunk.size());
+                            _digests.push_back(digest);
+                        } else {
+                            _hash.Update(chunk.data(), chunk.size());
+                            _chunkSize = chunk.size();
+                        }
+                        verifiedSize += chunk.size();
+                    }
+                } else {
+                    // Earlier chunks were hashed when they were written. Only the last journaled chunk is re-hashed, as an interrupted
+                    // write can damage only the tail of the file. Data after the last journaled chunk has no digest and is discarded.
+                    std::size_t chunkCount = static_cast<std::size_t>(std::min(static_cast<std::uint64_t>(_digests.size()), fileSize / PACKAGE_CHUNK_SIZE));
+                    if (chunkCount > 0) {
+                        chunk.resize(static_cast<std::size_t>(PACKAGE_CHUNK_SIZE));
+                        utf8_filesystem::fseek64(fp.get(), (chunkCount - 1) * PACKAGE_CHUNK_SIZE, SEEK_SET);
+                        bool valid = false;
+                        if (fread(chunk.data(), sizeof(unsigned char), chunk.size(), fp.get()) == chunk.size()) {
+                            Digest digest;
+                            CryptoPP::SHA1().CalculateDigest(digest.data(), chunk.data(), chunk.size());
+                            valid = digest == _digests[chunkCount - 1];
+                        }
+                        if (!valid) {
+                            chunkCount--;
+                        }
+                    }
+                    _digests.resize(chunkCount);
+                    verifiedSize = chunkCount * PACKAGE_CHUNK_SIZE;
+                }
+            } else {
+                _digests.clear();
+            }
+            saveDigests();
+            return verifiedSize;
+        }
+
+        void truncate(std::uint64_t offset) {
+            std::size_t chunkCount = static_cast<std::size_t>(offset / PACKAGE_CHUNK_SIZE);
+            if (chunkCount < _digests.size()) {
+                _digests.resize(chunkCount);
+            }
+            saveDigests();
+
+            // Hash the remaining part of the last chunk again
+            _hash.Restart();
+            _chunkSize = 0;
+            std::uint64_t chunkOffset = chunkCount * PACKAGE_CHUNK_SIZE;
+            if (offset > chunkOffset) {
+                if (FILE* fpRaw = utf8_filesystem::fopen(_fileName.c_str(), "rb")) {
+                    std::shared_ptr<FILE> fp(fpRaw, fclose);
+                    std::vector<unsigned char> chunk(static_cast<std::size_t>(offset - chunkOffset));
+                    utf8_filesystem::fseek64(fp.get(), chunkOffset, SEEK_SET);
+                    _chunkSize = fread(chunk.data(), sizeof(unsigned char), chunk.size(), fp.get());
+                    _hash.Update(chunk.data(), _chunkSize);
+                }
+            }
+        }
+
+        void update(const unsigned char* buf, std::size_t size) {
+            while (size > 0) {
+                std::size_t n = static_cast<std::size_t>(std::min(static_cast<std::uint64_t>(size), PACKAGE_CHUNK_SIZE - _chunkSize));
+                _hash.Update(buf, n);
+                _chunkSize += n;
+                buf += n;
+                size -= n;
+                if (_chunkSize == PACKAGE_CHUNK_SIZE) {
+                    finishChunk();
+                }
+            }
+        }
+
+        void finish() {
+            if (_chunkSize > 0) {
+                finishChunk();
+            }
+        }
+
+        void remove() {
+            utf8_filesystem::unlink(_journalFileName.c_str());
+        }
+
+    private:
+        typedef std::array<unsigned char, CryptoPP::SHA1::DIGESTSIZE> Digest;
+
+        void finishChunk() {
+            Digest digest;
+            _hash.Final(digest.data());
+            _digests.push_back(digest);
+            _chunkSize = 0;
+            if (FILE* fpRaw = utf8_filesystem::fopen(_journalFileName.c_str(), "ab")) {
+                std::shared_ptr<FILE> fp(fpRaw, fclose);
+                fwrite(digest.data(), sizeof(unsigned char), digest.size(), fp.get());
+            }
+        }
+
+        void saveDigests() const {
+            if (FILE* fpRaw = utf8_filesystem::fopen(_journalFileName.c_str(), "wb")) {
+                std::shared_ptr<FILE> fp(fpRaw, fclose);
+                for (const Digest& digest : _digests) {
+                    fwrite(digest.data(), sizeof(unsigned char), digest.size(), fp.get());
+                }
+            }
+        }
+
+        std::string _fileName;
+        std::string _journalFileName;
+        std::vector<Digest> _digests;
+        CryptoPP::SHA1 _hash;
+        std::uint64_t _chunkSize;
+    };
 }
 
 namespace carto {
@@ -151,30 +300,61 @@ namespace carto {
 
     std::shared_ptr<BinaryData> PackageManager::loadTile(const MapTile& mapTile) const {
         try {
-            // Try all packages, check if the tile is in the package tile mask. Start with the last package (the most recently downloaded)
-            std::lock_guard<std::recursive_mutex> lock(_mutex);
-            for (auto it = _localPackages.rbegin(); it != _localPackages.rend(); it++) {
-                const std::shared_ptr<PackageInfo>& packageInfo = *it;
-                if (packageInfo->getPackageType() != PackageType::PACKAGE_TYPE_MAP) {
-                    continue;
+            // Use the current package snapshot, no need to lock the manager as the snapshot is immutable
+            std::shared_ptr<const LocalPackageSnapshot> snapshot = std::atomic_load(&_localPackageSnapshot);
+            if (!snapshot) {
+                return std::shared_ptr<BinaryData>();
+            }
+
+            // Try all packages whose tile masks contain the tile. The packages are ordered from the most recently downloaded one
+            const std::vector<int>* packageIndices = FindTileIndexPackages(snapshot->tileIndexNodes, mapTile);
+            if (!packageIndices) {
+                return std::shared_ptr<BinaryData>();
+            }
+            for (int packageIndex : *packageIndices) {
+                const LocalMapPackage& mapPackage = snapshot->mapPackages[packageIndex];
+
+                // Take an idle reader of the package or open a new one, so that concurrent threads do not share prepared statements
+                std::shared_ptr<PackageTileReader> reader;
+                {
+                    std::lock_guard<std::mutex> lock(*mapPackage.readerMutex);
+                    if (!mapPackage.idleReaders.empty()) {
+                        reader = mapPackage.idleReaders.back();
+                        mapPackage.idleReaders.pop_back();
+                    }
                 }
-                if (std::shared_ptr<PackageTileMask> tileMask = packageInfo->getTileMask()) {
-                    if (tileMask->getTileStatus(mapTile) != PackageTileStatus::PACKAGE_TILE_STATUS_MISSING) {
-                        if (std::shared_ptr<sqlite3pp::database> packageDb = getLocalPackageDb(packageInfo)) {
-                            // Try to load the tile (this could fail, as tile masks may not be complete to the last zoom level)
-                            sqlite3pp::query query(*packageDb, "SELECT tile_decrypt(tile_data, zoom_level, tile_column, tile_row) FROM tiles WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
-                            query.bind(":zoom", mapTile.getZoom());
-                            query.bind(":x", mapTile.getX());
-                            query.bind(":y", mapTile.getY());
-                            for (auto qit = query.begin(); qit != query.end(); qit++) {
-                                Log::Infof("PackageManager::loadTile: Using package %s", packageInfo->getPackageId().c_str());
-                                const unsigned char* dataPtr = reinterpret_cast<const unsigned char*>(qit->get<const void*>(0));
-                                std::size_t dataSize = qit->column_bytes(0);
-                                return std::make_shared<BinaryData>(dataPtr, dataSize);
-                            }
-                        }
+                if (!reader) {
+                    reader = createPackageTileReader(mapPackage.fileName);
+                    if (!reader) {
+                        continue;
+                    }
+                }
+
+                // Try to load the tile (this could fail, as tile masks may not be complete to the last zoom level)
+                std::shared_ptr<BinaryData> tileData;
+                reader->tileQuery->reset();
+                reader->tileQuery->bind(":zoom", mapTile.getZoom());
+                reader->tileQuery->bind(":x", mapTile.getX());
+                reader->tileQuery->bind(":y", mapTile.getY());
+                for (auto qit = reader->tileQuery->begin(); qit != reader->tileQuery->end(); qit++) {
+                    Log::Infof("PackageManager::loadTile: Using package %s", mapPackage.packageInfo->getPackageId().c_str());
+                    const unsigned char* dataPtr = reinterpret_cast<const unsigned char*>(qit->get<const void*>(0));
+                    std::size_t dataSize = qit->column_bytes(0);
+                    tileData = std::make_shared<BinaryData>(dataPtr, dataSize);
+                    break;
+                }
+                reader->tileQuery->reset();
+
+                {
+                    std::lock_guard<std::mutex> lock(*mapPackage.readerMutex);
+                    if (mapPackage.idleReaders.size() < MAX_IDLE_PACKAGE_READERS) {
+                        mapPackage.idleReaders.push_back(reader);
                     }
                 }
+
+                if (tileData) {
+                    return tileData;
+                }
             }
         }
         catch (const std::exception& ex) {
@@ -337,6 +517,17 @@ namespace carto {
         return *it;
     }
 
+    std::string PackageManager::getLocalPackageFilePath(const std::string& packageId) const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        for (auto it = _localPackages.rbegin(); it != _localPackages.rend(); it++) {
+            const std::shared_ptr<PackageInfo>& packageInfo = *it;
+            if (packageInfo->getPackageId() == packageId) {
+                return createLocalFilePath(createPackageFileName(packageInfo->getPackageId(), packageInfo->getPackageType(), packageInfo->getVersion()));
+            }
+        }
+        return std::string();
+    }
+
     std::shared_ptr<PackageStatus> PackageManager::getLocalPackageStatus(const std::string& packageId, int version) const {
         if (!_localDb) {
             return std::shared_ptr<PackageStatus>();
@@ -720,17 +911,10 @@ namespace carto {
                 }
             }
 
-            // Find package tiles and calculate tile mask
+            // Find package tile mask
             std::shared_ptr<PackageTileMask> tileMask;
             if (task.packageType == PackageType::PACKAGE_TYPE_MAP) {
-                sqlite3pp::database packageDb(packageFileName.c_str());
-                sqlite3pp::query query(packageDb, "SELECT zoom_level, tile_column, tile_row FROM tiles");
-                std::vector<PackageTileMask::Tile> tiles;
-                for (auto qit = query.begin(); qit != query.end(); qit++) {
-                    PackageTileMask::Tile tile(qit->get<int>(0), qit->get<int>(1), qit->get<int>(2));
-                    tiles.push_back(tile);
-                }
-                tileMask = std::make_shared<PackageTileMask>(tiles);
+                tileMask = CalculateTileMask(packageFileName);
             }
 
             // Get package id
@@ -804,11 +988,13 @@ namespace carto {
         // Create new package file or reuse partly downloaded file
         bool packageSizeIndeterminate = package->getSize() == 0;
         std::string packageFileName = createLocalFilePath(createPackageFileName(task.packageId, task.packageType, task.packageVersion));
+        PackageChunkJournal journal(packageFileName);
         try {
             // Try to download the package
             for (int retry = 0; true; retry++) {
                 if (retry > 0) {
                     utf8_filesystem::unlink(packageFileName.c_str());
+                    journal.remove();
                     Log::Infof("PackageManager: Retrying package %s download", task.packageId.c_str());
                 }
                 FILE* fpRaw = utf8_filesystem::fopen(packageFileName.c_str(), "ab");
@@ -819,7 +1005,17 @@ namespace carto {
                 utf8_filesystem::fseek64(fp.get(), 0, SEEK_END);
                 std::uint64_t fileOffset = utf8_filesystem::ftell64(fp.get());
                 std::uint64_t fileSize = package->getSize();
+
+                // Verify previously downloaded data against the chunk journal, discard the data that does not match
+                std::uint64_t verifiedOffset = journal.verify(fileOffset);
+                if (verifiedOffset != fileOffset) {
+                    Log::Infof("PackageManager: Discarding unverified data of package %s", task.packageId.c_str());
+                    utf8_filesystem::fseek64(fp.get(), verifiedOffset, SEEK_SET);
+                    utf8_filesystem::ftruncate64(fp.get(), verifiedOffset);
+                    fileOffset = verifiedOffset;
+                }
                 if (!packageSizeIndeterminate && fileOffset == fileSize) {
+                    journal.finish();
                     break;
                 }
                 if (fileSize > 0) {
@@ -830,7 +1026,7 @@ namespace carto {
                 if (packageURL.empty()) {
                     throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_NO_OFFLINE_PLAN, "Offline packages not available");
                 }
-                int errorCode = DownloadFile(packageURL, [this, fp, taskId, packageFileName, &fileOffset, fileSize](std::uint64_t offset, std::uint64_t length, const unsigned char* buf, std::size_t size) {
+                int errorCode = DownloadFile(packageURL, [this, fp, taskId, packageFileName, &fileOffset, fileSize, &journal](std::uint64_t offset, std::uint64_t length, const unsigned char* buf, std::size_t size) {
                     if (isTaskCancelled(taskId)) {
                         return false;
                     }
@@ -842,11 +1038,13 @@ namespace carto {
                         Log::Infof("PackageManager: Truncating file");
                         utf8_filesystem::fseek64(fp.get(), offset, SEEK_SET);
                         utf8_filesystem::ftruncate64(fp.get(), offset);
+                        journal.truncate(offset);
                     }
                     if (fwrite(buf, sizeof(unsigned char), size, fp.get()) != size) {
                         Log::Errorf("PackageManager: Storage full? Could not write to package file %s", packageFileName.c_str());
                         return false;
                     }
+                    journal.update(buf, size);
                     fileOffset = offset + size;
                     std::uint64_t realSize = fileSize;
                     if (fileSize == 0 && length != std::numeric_limits<std::uint64_t>::max()) {
@@ -861,6 +1059,7 @@ namespace carto {
                 if (errorCode == 0) {
                     if (packageSizeIndeterminate || fileOffset == fileSize) {
                         updateTaskStatus(taskId, PackageAction::PACKAGE_ACTION_DOWNLOADING, 1.0f);
+                        journal.finish();
                         break;
                     }
                     Log::Errorf("PackageManager: File size mismatch for package %s (expected %lld, actual %lld)", task.packageId.c_str(), static_cast<long long>(fileSize), static_cast<long long>(fileOffset));
@@ -907,14 +1106,7 @@ namespace carto {
                         tileMask = package->getTileMask()->getStringValue();
                     }
                     else if (package->getPackageType() == PackageType::PACKAGE_TYPE_MAP) {
-                        sqlite3pp::database packageDb(packageFileName.c_str());
-                        sqlite3pp::query query2(packageDb, "SELECT zoom_level, tile_column, tile_row FROM tiles");
-                        std::vector<PackageTileMask::Tile> tiles;
-                        for (auto qit2 = query2.begin(); qit2 != query2.end(); qit2++) {
-                            PackageTileMask::Tile tile(qit2->get<int>(0), qit2->get<int>(1), qit2->get<int>(2));
-                            tiles.push_back(tile);
-                        }
-                        tileMask = PackageTileMask(tiles).getStringValue();
+                        tileMask = CalculateTileMask(packageFileName)->getStringValue();
                     }
                     std::uint64_t fileSize = package->getSize();
                     if (packageSizeIndeterminate) {
@@ -940,16 +1132,19 @@ namespace carto {
 
             // Import download package
             importLocalPackage(id, taskId, task.packageId, task.packageType, packageFileName);
+            journal.remove();
         }
         catch (const PauseException&) {
             throw;
         }
         catch (const CancelException&) {
             utf8_filesystem::unlink(packageFileName.c_str());
+            journal.remove();
             throw;
         }
         catch (...) {
             utf8_filesystem::unlink(packageFileName.c_str());
+            journal.remove();
             throw;
         }
 
@@ -1025,9 +1220,33 @@ namespace carto {
                 packages.push_back(packageInfo);
             }
 
-            // Update packages, clear db cache
+            // Build new snapshot of the map packages for tile loading, with a combined index of the package tile masks
+            auto snapshot = std::make_shared<LocalPackageSnapshot>();
+            std::vector<TileMaskNodeRef> nodeRefs;
+            for (auto it = packages.rbegin(); it != packages.rend(); it++) {
+                const std::shared_ptr<PackageInfo>& packageInfo = *it;
+                if (packageInfo->getPackageType() != PackageType::PACKAGE_TYPE_MAP) {
+                    continue;
+                }
+                std::shared_ptr<PackageTileMask> tileMask = packageInfo->getTileMask();
+                if (!tileMask || !tileMask->_rootNode) {
+                    continue;
+                }
+
+                LocalMapPackage mapPackage;
+                mapPackage.packageInfo = packageInfo;
+                mapPackage.fileName = createLocalFilePath(createPackageFileName(packageInfo->getPackageId(), packageInfo->getPackageType(), packageInfo->getVersion()));
+                mapPackage.readerMutex = std::make_shared<std::mutex>();
+                nodeRefs.push_back(TileMaskNodeRef { static_cast<int>(snapshot->mapPackages.size()), tileMask->_rootNode, tileMask->_rootNode->inside });
+                snapshot->mapPackages.push_back(std::move(mapPackage));
+            }
+            if (!nodeRefs.empty()) {
+                BuildTileIndexNode(snapshot->tileIndexNodes, nodeRefs);
+            }
+
+            // Update packages, replace tile loading snapshot
             std::swap(_localPackages, packages);
-            _localPackageDbCache.clear();
+            std::atomic_store(&_localPackageSnapshot, std::shared_ptr<const LocalPackageSnapshot>(snapshot));
             for (auto it = _localPackageFileCache.begin(); it != _localPackageFileCache.end(); it++) {
                 it->second->close();
             }
@@ -1038,32 +1257,16 @@ namespace carto {
         }
     }
 
-    std::shared_ptr<sqlite3pp::database> PackageManager::getLocalPackageDb(const std::shared_ptr<PackageInfo>& packageInfo) const {
-        const int MAX_OPEN_PACKAGES = 4;
-
-        // Try to find already open package from the cache
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        for (std::size_t i = 0; i < _localPackageDbCache.size(); i++) {
-            if (_localPackageDbCache[i].packageId == packageInfo->getPackageId()) {
-                PackageDatabase packageDatabase = _localPackageDbCache[i];
-                if (i > 0) {
-                    _localPackageDbCache.erase(_localPackageDbCache.begin() + i);
-                    _localPackageDbCache.insert(_localPackageDbCache.begin(), packageDatabase);
-                }
-                return packageDatabase.packageDb;
-            }
-        }
-        
-        // Must open new database instance
-        std::string packageFileName = createLocalFilePath(createPackageFileName(packageInfo->getPackageId(), packageInfo->getPackageType(), packageInfo->getVersion()).c_str());
+    std::shared_ptr<PackageManager::PackageTileReader> PackageManager::createPackageTileReader(const std::string& packageFileName) const {
         try {
-            std::shared_ptr<sqlite3pp::database> packageDb = std::make_shared<sqlite3pp::database>(packageFileName.c_str());
+            auto reader = std::make_shared<PackageTileReader>();
+            reader->packageDb = std::make_shared<sqlite3pp::database>(packageFileName.c_str());
 
             // Create new sqlite decryption function. First check if the database is crypted.
             std::string encKey = _serverEncKey;
-            bool encrypted = CheckDbEncryption(*packageDb, _serverEncKey + _localEncKey); // NOTE: this is a hack - though tiles are actually encrypted with server key only, with check that local key is included in the hash also
-            std::shared_ptr<sqlite3pp::ext::function> decryptFunc = std::make_shared<sqlite3pp::ext::function>(*packageDb);
-            decryptFunc->create("tile_decrypt", [encrypted, encKey](sqlite3pp::ext::context& ctx) {
+            bool encrypted = CheckDbEncryption(*reader->packageDb, _serverEncKey + _localEncKey); // NOTE: this is a hack - though tiles are actually encrypted with server key only, with check that local key is included in the hash also
+            reader->decryptFunc = std::make_shared<sqlite3pp::ext::function>(*reader->packageDb);
+            reader->decryptFunc->create("tile_decrypt", [encrypted, encKey](sqlite3pp::ext::context& ctx) {
                 const unsigned char* encData = reinterpret_cast<const unsigned char*>(ctx.get<const void*>(0));
                 std::size_t encSize = ctx.args_bytes(0);
                 int zoom = ctx.get<int>(1);
@@ -1075,22 +1278,15 @@ namespace carto {
                 }
                 ctx.result(encVector.empty() ? nullptr : &encVector[0], static_cast<int>(encVector.size()), false);
             }, 4);
-            if (_localPackageDbCache.size() >= MAX_OPEN_PACKAGES) {
-                _localPackageDbCache.pop_back();
-            }
 
-            // Save new package database instance
-            PackageDatabase packageDatabase;
-            packageDatabase.packageId = packageInfo->getPackageId();
-            packageDatabase.packageDb = packageDb;
-            packageDatabase.decryptFunc = decryptFunc;
-            _localPackageDbCache.insert(_localPackageDbCache.begin(), packageDatabase);
-            return packageDb;
+            // Prepare the tile query once, it is reused for all tiles loaded through this reader
+            reader->tileQuery = std::make_shared<sqlite3pp::query>(*reader->packageDb, "SELECT tile_decrypt(tile_data, zoom_level, tile_column, tile_row) FROM tiles WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
+            return reader;
         }
         catch (const std::exception& ex) {
-            Log::Errorf("PackageManager::getLocalPackageDb: %s", ex.what());
+            Log::Errorf("PackageManager::createPackageTileReader: %s", ex.what());
         }
-        return std::shared_ptr<sqlite3pp::database>();
+        return std::shared_ptr<PackageTileReader>();
     }
 
     void PackageManager::importLocalPackage(int id, int taskId, const std::string& packageId, PackageType::PackageType packageType, const std::string& packageFileName) {
@@ -1344,6 +1540,80 @@ namespace carto {
         _serverPackageCache.clear();
     }
 
+    std::shared_ptr<PackageTileMask> PackageManager::CalculateTileMask(const std::string& packageFileName) {
+        sqlite3pp::database packageDb(packageFileName.c_str());
+
+        // Use the tile mask from package metadata, if available. This avoids scanning all the tiles of the package
+        try {
+            sqlite3pp::query query(packageDb, "SELECT value FROM metadata WHERE name='tile_mask'");
+            for (auto qit = query.begin(); qit != query.end(); qit++) {
+                const char* value = qit->get<const char*>(0);
+                if (value && strlen(value) != 0) {
+                    return std::make_shared<PackageTileMask>(value);
+                }
+            }
+        }
+        catch (const std::exception&) {
+            // No metadata table, fall back to scanning the tiles
+        }
+
+        sqlite3pp::query query(packageDb, "SELECT zoom_level, tile_column, tile_row FROM tiles");
+        std::vector<PackageTileMask::Tile> tiles;
+        for (auto qit = query.begin(); qit != query.end(); qit++) {
+            PackageTileMask::Tile tile(qit->get<int>(0), qit->get<int>(1), qit->get<int>(2));
+            tiles.push_back(tile);
+        }
+        return std::make_shared<PackageTileMask>(tiles);
+    }
+
+    int PackageManager::BuildTileIndexNode(std::vector<TileIndexNode>& tileIndexNodes, const std::vector<TileMaskNodeRef>& nodeRefs) {
+        int nodeIndex = static_cast<int>(tileIndexNodes.size());
+        tileIndexNodes.emplace_back();
+        for (const TileMaskNodeRef& nodeRef : nodeRefs) {
+            if (nodeRef.inside) {
+                tileIndexNodes[nodeIndex].packageIndices.push_back(nodeRef.packageIndex);
+            }
+        }
+
+        // Tiles below the last node of a package mask inherit the status of the node, so the subtree is needed only while some masks have deeper nodes
+        for (int idx = 0; idx < 4; idx++) {
+            std::vector<TileMaskNodeRef> subNodeRefs;
+            subNodeRefs.reserve(nodeRefs.size());
+            bool deeper = false;
+            for (const TileMaskNodeRef& nodeRef : nodeRefs) {
+                std::shared_ptr<PackageTileMask::TileNode> subNode = (nodeRef.node ? nodeRef.node->subNodes[idx] : std::shared_ptr<PackageTileMask::TileNode>());
+                if (subNode) {
+                    subNodeRefs.push_back(TileMaskNodeRef { nodeRef.packageIndex, subNode, subNode->inside });
+                    deeper = true;
+                }
+                else {
+                    subNodeRefs.push_back(TileMaskNodeRef { nodeRef.packageIndex, std::shared_ptr<PackageTileMask::TileNode>(), nodeRef.inside });
+                }
+            }
+            int subNodeIndex = (deeper ? BuildTileIndexNode(tileIndexNodes, subNodeRefs) : -1);
+            tileIndexNodes[nodeIndex].subNodeIndices[idx] = subNodeIndex;
+        }
+        return nodeIndex;
+    }
+
+    const std::vector<int>* PackageManager::FindTileIndexPackages(const std::vector<TileIndexNode>& tileIndexNodes, const MapTile& mapTile) {
+        if (tileIndexNodes.empty()) {
+            return nullptr;
+        }
+
+        int nodeIndex = 0;
+        for (int zoom = 1; zoom <= mapTile.getZoom(); zoom++) {
+            int dx = (mapTile.getX() >> (mapTile.getZoom() - zoom)) & 1;
+            int dy = (mapTile.getY() >> (mapTile.getZoom() - zoom)) & 1;
+            int subNodeIndex = tileIndexNodes[nodeIndex].subNodeIndices[dy * 2 + dx];
+            if (subNodeIndex == -1) {
+                break;
+            }
+            nodeIndex = subNodeIndex;
+        }
+        return &tileIndexNodes[nodeIndex].packageIndices;
+    }
+
     void PackageManager::InitializeDb(sqlite3pp::database& db, const std::string& encKey) {
         db.execute("PRAGMA encoding='UTF-8'");
         db.execute(R"SQL(
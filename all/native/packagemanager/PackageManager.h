@@ -29,6 +29,7 @@
 
 namespace sqlite3pp {
     class database;
+    class query;
     namespace ext {
         class function;
     }
@@ -117,6 +118,14 @@ namespace carto {
          */
         void accessPackageFiles(const std::vector<std::string>& packageIds, std::function<void(const std::map<std::string, std::shared_ptr<std::ifstream> >&)> callback) const;
 
+        /**
+         * Returns the path of the file of the specified local package.
+         * The file should only be accessed while the package is locked using accessPackageFiles.
+         * @param packageId The package id.
+         * @return The path of the package file or empty string if the package is not available locally.
+         */
+        std::string getLocalPackageFilePath(const std::string& packageId) const;
+
         /**
          * Returns the list of available server packages.
          * Note that the list must be retrieved from the server first, using startPackageListDownload.
@@ -232,10 +241,34 @@ namespace carto {
             std::string packageLocation;
         };
 
-        struct PackageDatabase {
-            std::string packageId;
+        struct PackageTileReader {
             std::shared_ptr<sqlite3pp::database> packageDb;
             std::shared_ptr<sqlite3pp::ext::function> decryptFunc;
+            std::shared_ptr<sqlite3pp::query> tileQuery;
+        };
+
+        struct LocalMapPackage {
+            std::shared_ptr<PackageInfo> packageInfo;
+            std::string fileName;
+            mutable std::vector<std::shared_ptr<PackageTileReader> > idleReaders; // readers not used by any thread currently
+            std::shared_ptr<std::mutex> readerMutex; // guards idleReaders
+        };
+
+        struct TileIndexNode {
+            std::vector<int> packageIndices; // packages containing the tile, most recently imported package first
+            int subNodeIndices[4];
+        };
+
+        struct TileMaskNodeRef {
+            int packageIndex;
+            std::shared_ptr<PackageTileMask::TileNode> node; // null once the package tile mask has no deeper nodes
+            bool inside;
+        };
+
+        // Immutable view of local map packages, replaced as a whole when packages change. Used for lock-free tile loading.
+        struct LocalPackageSnapshot {
+            std::vector<LocalMapPackage> mapPackages; // most recently imported package first
+            std::vector<TileIndexNode> tileIndexNodes; // combined quadtree of all package tile masks, root node first
         };
 
         class PersistentTaskQueue {
@@ -274,6 +307,8 @@ namespace carto {
             PackageErrorType::PackageErrorType _errorType;
         };
 
+        static const std::size_t MAX_IDLE_PACKAGE_READERS = 4;
+
         void run();
 
         bool downloadPackageList(int taskId);
@@ -282,7 +317,7 @@ namespace carto {
         bool removePackage(int taskId);
         
         void syncLocalPackages();
-        std::shared_ptr<sqlite3pp::database> getLocalPackageDb(const std::shared_ptr<PackageInfo>& packageInfo) const;
+        std::shared_ptr<PackageTileReader> createPackageTileReader(const std::string& packageFileName) const;
         void importLocalPackage(int id, int taskId, const std::string& packageId, PackageType::PackageType packageType, const std::string& packageFileName);
         void deleteLocalPackage(int id);
 
@@ -297,6 +332,10 @@ namespace carto {
         std::string loadPackageListJson(const std::string& jsonFileName) const;
         void savePackageListJson(const std::string& jsonFileName, const std::string& json) const;
 
+        static std::shared_ptr<PackageTileMask> CalculateTileMask(const std::string& packageFileName);
+        static int BuildTileIndexNode(std::vector<TileIndexNode>& tileIndexNodes, const std::vector<TileMaskNodeRef>& nodeRefs);
+        static const std::vector<int>* FindTileIndexPackages(const std::vector<TileIndexNode>& tileIndexNodes, const MapTile& mapTile);
+
         static void InitializeDb(sqlite3pp::database& db, const std::string& encKey);
         static bool AddDbField(sqlite3pp::database& db, const std::string& table, const std::string& field, const std::string& def);
         static bool CheckDbEncryption(sqlite3pp::database& db, const std::string& encKey);
@@ -315,7 +354,7 @@ namespace carto {
         const std::string _dataFolder;
         const std::string _serverEncKey;
         const std::string _localEncKey;
-        mutable std::vector<PackageDatabase> _localPackageDbCache;
+        std::shared_ptr<const LocalPackageSnapshot> _localPackageSnapshot; // accessed atomically
         mutable std::map<std::string, std::shared_ptr<std::ifstream> > _localPackageFileCache;
         mutable std::vector<std::shared_ptr<PackageInfo> > _serverPackageCache;
         std::vector<std::shared_ptr<PackageInfo> > _localPackages;
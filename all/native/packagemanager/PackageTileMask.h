@@ -89,6 +89,8 @@ namespace carto {
         PackageTileStatus::PackageTileStatus getTileStatus(const MapTile& mapTile) const;
 
     private:
+        friend class PackageManager;
+
         struct TileNode {
             Tile tile;
             bool inside;
@@ -13,11 +13,16 @@
 
 #include <nml/GLModel.h>
 #include <nml/GLShaderManager.h>
+#include <nml/GLTexture.h>
+#include <nml/Package.h>
+
+#include <chrono>
 
 namespace carto {
 
     NMLModelLODTreeRenderer::NMLModelLODTreeRenderer() :
         _glShaderManager(),
+        _supportedCompressedFormats(),
         _tempDrawDatas(),
         _drawRecordMap(),
         _options(),
@@ -85,8 +90,21 @@ namespace carto {
         }
     }
 
+    bool NMLModelLODTreeRenderer::isTextureUncompressionNeeded(const nml::Texture& texture) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Until the surface is created, leave the decision to the texture upload step
+        if (!_supportedCompressedFormats) {
+            return false;
+        }
+        return nml::GLTexture::isUncompressionNeeded(texture, *_supportedCompressedFormats);
+    }
+
     void NMLModelLODTreeRenderer::onSurfaceCreated(const std::shared_ptr<ShaderManager>& shaderManager, const std::shared_ptr<TextureManager>& textureManager) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
         _glShaderManager = std::make_shared<nml::GLShaderManager>();
+        _supportedCompressedFormats = std::make_shared<std::vector<int> >(nml::GLTexture::getSupportedCompressedFormats());
         _drawRecordMap.clear();
     }
 
@@ -149,7 +167,8 @@ namespace carto {
 
         cglib::mat4x4<float> projMat = cglib::mat4x4<float>::convert(viewState.getProjectionMat());
 
-        // Create new models
+        // Create new models. Upload as many models as fit into the frame time budget, but always at least one
+        auto creationStartTime = std::chrono::steady_clock::now();
         for (auto it = _drawRecordMap.begin(); it != _drawRecordMap.end(); it++) {
             ModelNodeDrawRecord& record = *it->second;
             if (!(record.used && !record.created)) {
@@ -158,7 +177,10 @@ namespace carto {
     
             record.drawData.getGLModel()->create(*_glShaderManager);
             record.created = true;
-            break;
+
+            if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - creationStartTime).count() >= MAX_MODEL_CREATION_TIME) {
+                break;
+            }
         }
     
         // If a model is used but not created, try to find its first parent that is created and mark it as used.  
@@ -34,6 +34,7 @@ namespace carto {
     namespace nml {
         class GLModel;
         class GLShaderManager;
+        class Texture;
     }
 
     class NMLModelLODTreeRenderer {
@@ -45,6 +46,8 @@ namespace carto {
         void refreshDrawData();
 
         void setOptions(const std::weak_ptr<Options>& options);
+
+        bool isTextureUncompressionNeeded(const nml::Texture& texture) const;
         
         virtual void offsetLayerHorizontally(double offset);
     
@@ -65,7 +68,10 @@ namespace carto {
             ModelNodeDrawRecord(const NMLModelLODTreeDrawData& drawData) : drawData(drawData), parent(0), children(), used(false), created(false) { }
         };
     
+        static const int MAX_MODEL_CREATION_TIME = 4; // in milliseconds, per frame
+
         std::shared_ptr<nml::GLShaderManager> _glShaderManager;
+        std::shared_ptr<std::vector<int> > _supportedCompressedFormats;
         std::vector<std::shared_ptr<NMLModelLODTreeDrawData> > _tempDrawDatas;
         std::map<long long, std::shared_ptr<ModelNodeDrawRecord> > _drawRecordMap;
         std::weak_ptr<Options> _options;
@@ -45,6 +45,8 @@ namespace carto {
         _buildingOrder(1),
         _horizontalLayerOffset(0),
         _tiles(),
+        _labelCuller(std::make_shared<vt::TileLabelCuller>(_glRendererMutex, Const::WORLD_SIZE)),
+        _labelCullerMutex(),
         _mutex()
     {
     }
@@ -211,9 +213,9 @@ namespace carto {
             visibleLabels = _glRenderer->getVisibleLabels();
         }
 
-        vt::TileLabelCuller culler(_glRendererMutex, Const::WORLD_SIZE);
-        culler.setViewState(viewState.getProjectionMat(), modelViewMat, viewState.getZoom(), viewState.getAspectRatio(), viewState.getNormalizedResolution());
-        culler.process(visibleLabels);
+        std::lock_guard<std::mutex> lock(_labelCullerMutex);
+        _labelCuller->setViewState(viewState.getProjectionMat(), modelViewMat, viewState.getZoom(), viewState.getAspectRatio(), viewState.getNormalizedResolution());
+        _labelCuller->process(visibleLabels);
         return true;
     }
     
@@ -31,6 +31,7 @@ namespace carto {
     class ViewState;
     namespace vt {
         class GLTileRenderer;
+        class TileLabelCuller;
     }
     
     class TileRenderer : public std::enable_shared_from_this<TileRenderer> {
@@ -72,6 +73,9 @@ namespace carto {
         double _horizontalLayerOffset;
         std::map<vt::TileId, std::shared_ptr<const vt::Tile> > _tiles;
 
+        std::shared_ptr<vt::TileLabelCuller> _labelCuller; // kept between passes so that unchanged views can reuse previous results
+        std::mutex _labelCullerMutex;
+
         mutable std::mutex _mutex;
     };
     
@@ -20,6 +20,7 @@ namespace carto {
         _routeFinder()
     {
         routing::Graph::Settings graphSettings;
+        graphSettings.memoryMapped = true;
         auto graph = std::make_shared<routing::Graph>(graphSettings);
         try {
             if (!graph->import(path)) {
@@ -42,6 +43,14 @@ namespace carto {
         return RoutingProxy::CalculateRoute(_routeFinder, request);
     }
 
+    std::shared_ptr<RoutingMatrixResult> OSRMOfflineRoutingService::calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const {
+        if (!request) {
+            throw NullArgumentException("Null request");
+        }
+
+        return RoutingProxy::CalculateMatrix(_routeFinder, request);
+    }
+
 }
 
 #endif
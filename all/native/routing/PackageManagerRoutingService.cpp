@@ -37,38 +37,57 @@ namespace carto {
             throw NullArgumentException("Null request");
         }
 
-        // Find all routing packages
+        // Call router via package manager
+        std::shared_ptr<RoutingResult> result;
+        _packageManager->accessPackageFiles(getRoutingPackageIds(), [this, request, &result](const std::map<std::string, std::shared_ptr<std::ifstream> >& packageFileMap) {
+            result = RoutingProxy::CalculateRoute(getRouteFinder(packageFileMap), request);
+        });
+        return result;
+    }
+
+    std::shared_ptr<RoutingMatrixResult> PackageManagerRoutingService::calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const {
+        if (!request) {
+            throw NullArgumentException("Null request");
+        }
+
+        // Call router via package manager
+        std::shared_ptr<RoutingMatrixResult> result;
+        _packageManager->accessPackageFiles(getRoutingPackageIds(), [this, request, &result](const std::map<std::string, std::shared_ptr<std::ifstream> >& packageFileMap) {
+            result = RoutingProxy::CalculateMatrix(getRouteFinder(packageFileMap), request);
+        });
+        return result;
+    }
+
+    std::vector<std::string> PackageManagerRoutingService::getRoutingPackageIds() const {
         std::vector<std::string> packageIds;
         for (const std::shared_ptr<PackageInfo>& localPackage : _packageManager->getLocalPackages()) {
             if (localPackage->getPackageType() == PackageType::PACKAGE_TYPE_ROUTING) {
                 packageIds.push_back(localPackage->getPackageId());
             }
         }
+        return packageIds;
+    }
 
-        // Call router via package manager
-        std::shared_ptr<RoutingResult> result;
-        _packageManager->accessPackageFiles(packageIds, [this, request, &result](const std::map<std::string, std::shared_ptr<std::ifstream> >& packageFileMap) {
-            std::lock_guard<std::mutex> lock(_mutex);
-            if (packageFileMap != _cachedPackageFileMap || !_cachedRouteFinder) {
-                routing::Graph::Settings graphSettings;
-                auto graph = std::make_shared<routing::Graph>(graphSettings);
-                for (auto it = packageFileMap.begin(); it != packageFileMap.end(); it++) {
-                    try {
-                        if (!graph->import(it->second)) {
-                            throw FileException("Failed to import graph " + it->first, "");
-                        }
-                    }
-                    catch (const std::exception& ex) {
-                        throw GenericException("Exception while importing graph" + it->first, ex.what());
+    std::shared_ptr<routing::RouteFinder> PackageManagerRoutingService::getRouteFinder(const std::map<std::string, std::shared_ptr<std::ifstream> >& packageFileMap) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (packageFileMap != _cachedPackageFileMap || !_cachedRouteFinder) {
+            routing::Graph::Settings graphSettings;
+            graphSettings.memoryMapped = true;
+            auto graph = std::make_shared<routing::Graph>(graphSettings);
+            for (auto it = packageFileMap.begin(); it != packageFileMap.end(); it++) {
+                try {
+                    if (!graph->import(it->second, _packageManager->getLocalPackageFilePath(it->first))) {
+                        throw FileException("Failed to import graph " + it->first, "");
                     }
                 }
-                _cachedPackageFileMap = packageFileMap;
-                _cachedRouteFinder = std::make_shared<routing::RouteFinder>(graph);
+                catch (const std::exception& ex) {
+                    throw GenericException("Exception while importing graph" + it->first, ex.what());
+                }
             }
-
-            result = RoutingProxy::CalculateRoute(_cachedRouteFinder, request);
-        });
-        return result;
+            _cachedPackageFileMap = packageFileMap;
+            _cachedRouteFinder = std::make_shared<routing::RouteFinder>(graph);
+        }
+        return _cachedRouteFinder;
     }
             
 }
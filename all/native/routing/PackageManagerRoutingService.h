@@ -15,6 +15,7 @@
 #include <string>
 #include <map>
 #include <mutex>
+#include <vector>
 
 namespace carto {
     namespace routing {
@@ -37,7 +38,13 @@ namespace carto {
 
         virtual std::shared_ptr<RoutingResult> calculateRoute(const std::shared_ptr<RoutingRequest>& request) const;
 
+        virtual std::shared_ptr<RoutingMatrixResult> calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const;
+
     protected:
+        std::vector<std::string> getRoutingPackageIds() const;
+
+        std::shared_ptr<routing::RouteFinder> getRouteFinder(const std::map<std::string, std::shared_ptr<std::ifstream> >& packageFileMap) const;
+
         std::shared_ptr<PackageManager> _packageManager;
 
         mutable std::map<std::string, std::shared_ptr<std::ifstream> > _cachedPackageFileMap;
@@ -0,0 +1,44 @@
+#ifdef _CARTO_ROUTING_SUPPORT
+
+#include "RoutingMatrixRequest.h"
+#include "components/Exceptions.h"
+
+namespace carto {
+
+    RoutingMatrixRequest::RoutingMatrixRequest(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& sourcePoints, const std::vector<MapPos>& targetPoints) :
+        _projection(projection),
+        _sourcePoints(sourcePoints),
+        _targetPoints(targetPoints),
+        _parallel(false)
+    {
+        if (!projection) {
+            throw NullArgumentException("Null projection");
+        }
+    }
+
+    RoutingMatrixRequest::~RoutingMatrixRequest() {
+    }
+
+    const std::shared_ptr<Projection>& RoutingMatrixRequest::getProjection() const {
+        return _projection;
+    }
+
+    const std::vector<MapPos>& RoutingMatrixRequest::getSourcePoints() const {
+        return _sourcePoints;
+    }
+
+    const std::vector<MapPos>& RoutingMatrixRequest::getTargetPoints() const {
+        return _targetPoints;
+    }
+
+    bool RoutingMatrixRequest::isParallel() const {
+        return _parallel;
+    }
+
+    void RoutingMatrixRequest::setParallel(bool parallel) {
+        _parallel = parallel;
+    }
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTINGMATRIXREQUEST_H_
+#define _CARTO_ROUTINGMATRIXREQUEST_H_
+
+#ifdef _CARTO_ROUTING_SUPPORT
+
+#include "core/MapPos.h"
+
+#include <memory>
+#include <vector>
+
+namespace carto {
+    class Projection;
+
+    /**
+     * A class that defines required attributes for routing matrix calculation (source and target points).
+     */
+    class RoutingMatrixRequest {
+    public:
+        /**
+         * Constructs a new RoutingMatrixRequest instance from projection, source and target points.
+         * @param projection The projection of the points.
+         * @param sourcePoints The list of source points (matrix rows).
+         * @param targetPoints The list of target points (matrix columns).
+         */
+        RoutingMatrixRequest(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& sourcePoints, const std::vector<MapPos>& targetPoints);
+        virtual ~RoutingMatrixRequest();
+
+        /**
+         * Returns the projection of the points in the request.
+         * @return The projection of the request.
+         */
+        const std::shared_ptr<Projection>& getProjection() const;
+        /**
+         * Returns the source point list of the request.
+         * @return The source point list of the request.
+         */
+        const std::vector<MapPos>& getSourcePoints() const;
+        /**
+         * Returns the target point list of the request.
+         * @return The target point list of the request.
+         */
+        const std::vector<MapPos>& getTargetPoints() const;
+
+        /**
+         * Returns true if the matrix should be calculated using multiple threads.
+         * @return True if the matrix should be calculated using multiple threads.
+         */
+        bool isParallel() const;
+        /**
+         * Sets the parallel calculation flag. If set, routing services may use all available cores for the calculation.
+         * By default the calculation is not parallel.
+         * @param parallel True if the matrix should be calculated using multiple threads.
+         */
+        void setParallel(bool parallel);
+        
+    private:
+        std::shared_ptr<Projection> _projection;
+        std::vector<MapPos> _sourcePoints;
+        std::vector<MapPos> _targetPoints;
+        bool _parallel;
+    };
+    
+}
+
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#ifdef _CARTO_ROUTING_SUPPORT
+
+#include "RoutingMatrixResult.h"
+#include "components/Exceptions.h"
+
+namespace carto {
+
+    RoutingMatrixResult::RoutingMatrixResult(int sourceCount, int targetCount, const std::vector<double>& times) :
+        _sourceCount(sourceCount),
+        _targetCount(targetCount),
+        _times(times)
+    {
+        if (sourceCount < 0 || targetCount < 0 || times.size() != static_cast<std::size_t>(sourceCount) * static_cast<std::size_t>(targetCount)) {
+            throw InvalidArgumentException("Matrix size mismatch");
+        }
+    }
+
+    RoutingMatrixResult::~RoutingMatrixResult() {
+    }
+
+    int RoutingMatrixResult::getSourceCount() const {
+        return _sourceCount;
+    }
+
+    int RoutingMatrixResult::getTargetCount() const {
+        return _targetCount;
+    }
+
+    double RoutingMatrixResult::getTime(int sourceIndex, int targetIndex) const {
+        if (sourceIndex < 0 || sourceIndex >= _sourceCount || targetIndex < 0 || targetIndex >= _targetCount) {
+            throw OutOfRangeException("Matrix index out of range");
+        }
+        return _times[static_cast<std::size_t>(sourceIndex) * _targetCount + targetIndex];
+    }
+
+}
+
+#endif
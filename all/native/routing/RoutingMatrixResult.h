@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTINGMATRIXRESULT_H_
+#define _CARTO_ROUTINGMATRIXRESULT_H_
+
+#ifdef _CARTO_ROUTING_SUPPORT
+
+#include <vector>
+
+namespace carto {
+
+    /**
+     * A class that contains travel times between each source and target point of a routing matrix request.
+     */
+    class RoutingMatrixResult {
+    public:
+        /**
+         * Constructs a new RoutingMatrixResult instance from source and target counts and travel times.
+         * @param sourceCount The number of source points.
+         * @param targetCount The number of target points.
+         * @param times The travel times in seconds, in row-major order. Negative value means that the target is not reachable.
+         */
+        RoutingMatrixResult(int sourceCount, int targetCount, const std::vector<double>& times);
+        virtual ~RoutingMatrixResult();
+
+        /**
+         * Returns the number of source points (matrix rows).
+         * @return The number of source points.
+         */
+        int getSourceCount() const;
+        /**
+         * Returns the number of target points (matrix columns).
+         * @return The number of target points.
+         */
+        int getTargetCount() const;
+
+        /**
+         * Returns the approximate travel time from the given source point to the given target point.
+         * @param sourceIndex The index of the source point.
+         * @param targetIndex The index of the target point.
+         * @return The travel time in seconds or -1 if there is no route between the points.
+         * @throws std::out_of_range If the index is out of range.
+         */
+        double getTime(int sourceIndex, int targetIndex) const;
+        
+    private:
+        int _sourceCount;
+        int _targetCount;
+        std::vector<double> _times;
+    };
+    
+}
+
+#endif
+
+#endif
@@ -10,6 +10,8 @@
 #include "utils/Const.h"
 #include "utils/Log.h"
 
+#include <thread>
+
 #include <boost/lexical_cast.hpp>
 
 #include <rapidjson/rapidjson.h>
@@ -19,6 +21,8 @@
 #include <routing/Graph.h>
 #include <routing/Query.h>
 #include <routing/Result.h>
+#include <routing/MatrixQuery.h>
+#include <routing/MatrixResult.h>
 #include <routing/Instruction.h>
 #include <routing/RouteFinder.h>
 
@@ -26,68 +30,67 @@ namespace carto {
 
     std::shared_ptr<RoutingResult> RoutingProxy::CalculateRoute(const std::shared_ptr<routing::RouteFinder>& routeFinder, const std::shared_ptr<RoutingRequest>& request) {
         std::shared_ptr<Projection> proj = request->getProjection();
-        EPSG3857 epsg3857;
 
-        std::size_t totalPoints = 0;
-        std::size_t totalInstructions = 0;
+        // All waypoints are routed with a single query, so that snapped waypoints and loaded graph blocks are shared by the legs
+        std::vector<routing::WGSPos> wgsPoints;
+        wgsPoints.reserve(request->getPoints().size());
+        for (const MapPos& point : request->getPoints()) {
+            MapPos wgsPos = proj->toWgs84(point);
+            wgsPoints.emplace_back(wgsPos.getY(), wgsPos.getX());
+        }
+        routing::Query query(std::move(wgsPoints));
         std::vector<routing::Result> results;
-        for (std::size_t i = 1; i < request->getPoints().size(); i++) {
-            MapPos p0 = proj->toWgs84(request->getPoints()[i - 1]);
-            MapPos p1 = proj->toWgs84(request->getPoints()[i]);
-            routing::Query query(routing::WGSPos(p0.getY(), p0.getX()), routing::WGSPos(p1.getY(), p1.getX()));
+        if (request->getAlternativeCount() > 0) {
+            results = routeFinder->findAlternatives(query, request->getAlternativeCount());
+        } else {
             routing::Result result = routeFinder->find(query);
-            if (result.getStatus() == routing::Result::Status::FAILED) {
-                throw GenericException("Routing failed");
+            if (result.getStatus() != routing::Result::Status::FAILED) {
+                results.push_back(std::move(result));
             }
-            totalPoints += result.getGeometry().size();
-            totalInstructions += result.getInstructions().size();
-            results.push_back(std::move(result));
+        }
+        if (results.empty()) {
+            throw GenericException("Routing failed");
         }
 
-        std::vector<MapPos> points;
-        points.reserve(totalPoints);
-        std::vector<MapPos> epsg3857Points;
-        epsg3857Points.reserve(totalPoints);
-        std::vector<RoutingInstruction> instructions;
-        instructions.reserve(totalInstructions);
-        for (std::size_t i = 0; i < results.size(); i++) {
-            const routing::Result& result = results[i];
-            if (result.getInstructions().empty()) {
-                continue;
-            }
+        // The first result is the optimal route, the rest are alternatives
+        std::vector<std::shared_ptr<RoutingResult> > alternatives;
+        for (std::size_t i = 1; i < results.size(); i++) {
+            alternatives.push_back(TranslateResult(proj, results[i], std::vector<std::shared_ptr<RoutingResult> >()));
+        }
+        return TranslateResult(proj, results.front(), alternatives);
+    }
 
-            std::size_t pointIndex = points.size();
-            for (const routing::WGSPos& pos : result.getGeometry()) {
-                points.push_back(proj->fromWgs84(MapPos(pos(1), pos(0))));
-                epsg3857Points.push_back(epsg3857.fromWgs84(MapPos(pos(1), pos(0))));
-            }
+    std::shared_ptr<RoutingMatrixResult> RoutingProxy::CalculateMatrix(const std::shared_ptr<routing::RouteFinder>& routeFinder, const std::shared_ptr<RoutingMatrixRequest>& request) {
+        std::shared_ptr<Projection> proj = request->getProjection();
 
-            for (const routing::Instruction& instr : result.getInstructions()) {
-                double distance = instr.getDistance();
-                double time = instr.getTime();
+        std::vector<routing::WGSPos> sources;
+        sources.reserve(request->getSourcePoints().size());
+        for (const MapPos& point : request->getSourcePoints()) {
+            MapPos wgsPos = proj->toWgs84(point);
+            sources.emplace_back(wgsPos.getY(), wgsPos.getX());
+        }
+        std::vector<routing::WGSPos> targets;
+        targets.reserve(request->getTargetPoints().size());
+        for (const MapPos& point : request->getTargetPoints()) {
+            MapPos wgsPos = proj->toWgs84(point);
+            targets.emplace_back(wgsPos.getY(), wgsPos.getX());
+        }
 
-                RoutingAction::RoutingAction action = RoutingAction::ROUTING_ACTION_NO_TURN;
-                TranslateInstructionCode(static_cast<int>(instr.getType()), action);
-                if (action == RoutingAction::ROUTING_ACTION_NO_TURN || action == RoutingAction::ROUTING_ACTION_STAY_ON_ROUNDABOUT) {
-                    if (!instructions.empty()) {
-                        instructions.back().setTime(instructions.back().getTime() + time);
-                        instructions.back().setDistance(instructions.back().getDistance() + distance);
-                    }
-                    continue;
-                }
-                if (action == RoutingAction::ROUTING_ACTION_FINISH && i + 1 < results.size()) {
-                    action = RoutingAction::ROUTING_ACTION_REACH_VIA_LOCATION;
-                }
+        int threadCount = 1;
+        if (request->isParallel()) {
+            threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+        routing::MatrixResult result = routeFinder->findMatrix(routing::MatrixQuery(std::move(sources), std::move(targets)), threadCount);
 
-                int posIndex = static_cast<int>(pointIndex + instr.getGeometryIndex());
-                std::string streetName = instr.getAddress();
-                float turnAngle = CalculateTurnAngle(epsg3857Points, posIndex);
-                float azimuth = CalculateAzimuth(epsg3857Points, posIndex);
-                instructions.emplace_back(action, posIndex, streetName, turnAngle, azimuth, distance, time);
+        std::vector<double> times;
+        times.reserve(result.getSourceCount() * result.getTargetCount());
+        for (std::size_t i = 0; i < result.getSourceCount(); i++) {
+            for (std::size_t j = 0; j < result.getTargetCount(); j++) {
+                double time = result.getTime(i, j);
+                times.push_back(time != std::numeric_limits<double>::infinity() ? time : -1.0);
             }
         }
-
-        return std::make_shared<RoutingResult>(proj, points, instructions);
+        return std::make_shared<RoutingMatrixResult>(static_cast<int>(result.getSourceCount()), static_cast<int>(result.getTargetCount()), times);
     }
 
     std::shared_ptr<RoutingResult> RoutingProxy::CalculateRoute(HTTPClient& httpClient, const std::string& url, const std::shared_ptr<RoutingRequest>& request) {
@@ -274,6 +277,44 @@ namespace carto {
         return points;
     }
     
+    std::shared_ptr<RoutingResult> RoutingProxy::TranslateResult(const std::shared_ptr<Projection>& proj, const routing::Result& result, const std::vector<std::shared_ptr<RoutingResult> >& alternatives) {
+        EPSG3857 epsg3857;
+
+        std::vector<MapPos> points;
+        points.reserve(result.getGeometry().size());
+        std::vector<MapPos> epsg3857Points;
+        epsg3857Points.reserve(result.getGeometry().size());
+        for (const routing::WGSPos& pos : result.getGeometry()) {
+            points.push_back(proj->fromWgs84(MapPos(pos(1), pos(0))));
+            epsg3857Points.push_back(epsg3857.fromWgs84(MapPos(pos(1), pos(0))));
+        }
+
+        std::vector<RoutingInstruction> instructions;
+        instructions.reserve(result.getInstructions().size());
+        for (const routing::Instruction& instr : result.getInstructions()) {
+            double distance = instr.getDistance();
+            double time = instr.getTime();
+
+            RoutingAction::RoutingAction action = RoutingAction::ROUTING_ACTION_NO_TURN;
+            TranslateInstructionCode(static_cast<int>(instr.getType()), action);
+            if (action == RoutingAction::ROUTING_ACTION_NO_TURN || action == RoutingAction::ROUTING_ACTION_STAY_ON_ROUNDABOUT) {
+                if (!instructions.empty()) {
+                    instructions.back().setTime(instructions.back().getTime() + time);
+                    instructions.back().setDistance(instructions.back().getDistance() + distance);
+                }
+                continue;
+            }
+
+            int posIndex = static_cast<int>(instr.getGeometryIndex());
+            std::string streetName = instr.getAddress();
+            float turnAngle = CalculateTurnAngle(epsg3857Points, posIndex);
+            float azimuth = CalculateAzimuth(epsg3857Points, posIndex);
+            instructions.emplace_back(action, posIndex, streetName, turnAngle, azimuth, distance, time);
+        }
+
+        return std::make_shared<RoutingResult>(proj, points, instructions, alternatives);
+    }
+
     RoutingProxy::RoutingProxy() {
     }
     
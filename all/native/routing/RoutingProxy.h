@@ -19,6 +19,7 @@
 namespace carto {
     namespace routing {
         class RouteFinder;
+        class Result;
     }
     
     class HTTPClient;
@@ -26,6 +27,8 @@ namespace carto {
     class RoutingProxy {
     public:
         static std::shared_ptr<RoutingResult> CalculateRoute(const std::shared_ptr<routing::RouteFinder>& routeFinder, const std::shared_ptr<RoutingRequest>& request);
+
+        static std::shared_ptr<RoutingMatrixResult> CalculateMatrix(const std::shared_ptr<routing::RouteFinder>& routeFinder, const std::shared_ptr<RoutingMatrixRequest>& request);
         
         static std::shared_ptr<RoutingResult> CalculateRoute(HTTPClient& httpClient, const std::string& url, const std::shared_ptr<RoutingRequest>& request);
 
@@ -39,6 +42,8 @@ namespace carto {
         static bool TranslateInstructionCode(int instructionCode, RoutingAction::RoutingAction& action);
         
         static std::vector<MapPos> DecodeGeometry(const std::string& encodedGeometry);
+
+        static std::shared_ptr<RoutingResult> TranslateResult(const std::shared_ptr<Projection>& proj, const routing::Result& result, const std::vector<std::shared_ptr<RoutingResult> >& alternatives);
         
         static const double COORDINATE_SCALE;
     };
@@ -7,13 +7,27 @@ namespace carto {
 
     RoutingRequest::RoutingRequest(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& points) :
         _projection(projection),
-        _points(points)
+        _points(points),
+        _alternativeCount(0)
     {
         if (!projection) {
             throw NullArgumentException("Null projection");
         }
     }
 
+    RoutingRequest::RoutingRequest(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& points, int alternativeCount) :
+        _projection(projection),
+        _points(points),
+        _alternativeCount(alternativeCount)
+    {
+        if (!projection) {
+            throw NullArgumentException("Null projection");
+        }
+        if (alternativeCount < 0) {
+            throw InvalidArgumentException("Negative alternative count");
+        }
+    }
+
     RoutingRequest::~RoutingRequest() {
     }
 
@@ -25,6 +39,10 @@ namespace carto {
         return _points;
     }
 
+    int RoutingRequest::getAlternativeCount() const {
+        return _alternativeCount;
+    }
+
 }
 
 #endif
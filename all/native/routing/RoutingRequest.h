@@ -28,6 +28,15 @@ namespace carto {
          * @param points The list of points that the route must pass. Must contains at least 2 elements.
          */
         RoutingRequest(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& points);
+        /**
+         * Constructs a new RoutingRequest instance from projection, via points and the maximum number of alternative routes.
+         * Alternatives are calculated only by offline routing services and only for requests with 2 points,
+         * other services ignore this setting.
+         * @param projection The projection of the points.
+         * @param points The list of points that the route must pass. Must contains at least 2 elements.
+         * @param alternativeCount The maximum number of alternative routes to calculate in addition to the optimal route.
+         */
+        RoutingRequest(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& points, int alternativeCount);
         virtual ~RoutingRequest();
 
         /**
@@ -40,10 +49,17 @@ namespace carto {
          * @return The point list of the request.
          */
         const std::vector<MapPos>& getPoints() const;
+
+        /**
+         * Returns the maximum number of alternative routes to calculate in addition to the optimal route.
+         * @return The maximum number of alternative routes.
+         */
+        int getAlternativeCount() const;
         
     private:
         std::shared_ptr<Projection> _projection;
         std::vector<MapPos> _points;
+        int _alternativeCount;
     };
     
 }
@@ -12,7 +12,19 @@ namespace carto {
     RoutingResult::RoutingResult(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& points, const std::vector<RoutingInstruction>& instructions) :
         _projection(projection),
         _points(points),
-        _instructions(instructions)
+        _instructions(instructions),
+        _alternatives()
+    {
+        if (!projection) {
+            throw NullArgumentException("Null projection");
+        }
+    }
+
+    RoutingResult::RoutingResult(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& points, const std::vector<RoutingInstruction>& instructions, const std::vector<std::shared_ptr<RoutingResult> >& alternatives) :
+        _projection(projection),
+        _points(points),
+        _instructions(instructions),
+        _alternatives(alternatives)
     {
         if (!projection) {
             throw NullArgumentException("Null projection");
@@ -34,6 +46,10 @@ namespace carto {
         return _instructions;
     }
 
+    const std::vector<std::shared_ptr<RoutingResult> >& RoutingResult::getAlternatives() const {
+        return _alternatives;
+    }
+
     double RoutingResult::getTotalDistance() const {
         return std::accumulate(_instructions.begin(), _instructions.end(), 0.0, [](double time, const RoutingInstruction& instruction) {
             return time + instruction.getDistance();
@@ -30,6 +30,14 @@ namespace carto {
          * @param instructions The turn-by-turn instruction list.
          */
         RoutingResult(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& points, const std::vector<RoutingInstruction>& instructions);
+        /**
+         * Constructs a new RoutingResult instance from projection, points, instructions and alternative routes.
+         * @param projection The projection of the routing result (same as the request).
+         * @param points The point list defining the routing path. Instructions refer to this list.
+         * @param instructions The turn-by-turn instruction list.
+         * @param alternatives The list of alternative routes.
+         */
+        RoutingResult(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& points, const std::vector<RoutingInstruction>& instructions, const std::vector<std::shared_ptr<RoutingResult> >& alternatives);
         virtual ~RoutingResult();
 
         /**
@@ -47,6 +55,11 @@ namespace carto {
          * @return The turn-by-turn instruction list.
          */
         const std::vector<RoutingInstruction>& getInstructions() const;
+        /**
+         * Returns the alternative routes, ordered by increasing cost. The list is empty unless alternatives were requested.
+         * @return The list of alternative routes.
+         */
+        const std::vector<std::shared_ptr<RoutingResult> >& getAlternatives() const;
 
         /**
          * Returns the total distance of the path.
@@ -63,6 +76,7 @@ namespace carto {
         std::shared_ptr<Projection> _projection;
         std::vector<MapPos> _points;
         std::vector<RoutingInstruction> _instructions;
+        std::vector<std::shared_ptr<RoutingResult> > _alternatives;
     };
     
 }
@@ -1,6 +1,7 @@
 #ifdef _CARTO_ROUTING_SUPPORT
 
 #include "RoutingService.h"
+#include "components/Exceptions.h"
 
 namespace carto {
 
@@ -10,6 +11,30 @@ namespace carto {
     RoutingService::~RoutingService() {
     }
 
+    std::shared_ptr<RoutingMatrixResult> RoutingService::calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const {
+        if (!request) {
+            throw NullArgumentException("Null request");
+        }
+
+        const std::vector<MapPos>& sourcePoints = request->getSourcePoints();
+        const std::vector<MapPos>& targetPoints = request->getTargetPoints();
+        std::vector<double> times;
+        times.reserve(sourcePoints.size() * targetPoints.size());
+        for (const MapPos& sourcePoint : sourcePoints) {
+            for (const MapPos& targetPoint : targetPoints) {
+                std::vector<MapPos> points { sourcePoint, targetPoint };
+                std::shared_ptr<RoutingResult> result;
+                try {
+                    result = calculateRoute(std::make_shared<RoutingRequest>(request->getProjection(), points));
+                } catch (const std::exception&) {
+                    // No route between the points
+                }
+                times.push_back(result ? result->getTotalTime() : -1.0);
+            }
+        }
+        return std::make_shared<RoutingMatrixResult>(static_cast<int>(sourcePoints.size()), static_cast<int>(targetPoints.size()), times);
+    }
+
 }
 
 #endif
@@ -11,6 +11,8 @@
 
 #include "routing/RoutingRequest.h"
 #include "routing/RoutingResult.h"
+#include "routing/RoutingMatrixRequest.h"
+#include "routing/RoutingMatrixResult.h"
 
 #include <memory>
 
@@ -31,6 +33,15 @@ namespace carto {
          */
         virtual std::shared_ptr<RoutingResult> calculateRoute(const std::shared_ptr<RoutingRequest>& request) const = 0;
 
+        /**
+         * Calculates travel times between all source and target points of the request.
+         * The default implementation calculates a separate route for each pair of points.
+         * @param request The routing matrix request defining source and target points.
+         * @return The matrix result.
+         * @throws std::runtime_error If IO error occured during the calculation.
+         */
+        virtual std::shared_ptr<RoutingMatrixResult> calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const;
+
     protected:
         /**
          * The default constructor.
@@ -45,7 +45,7 @@ namespace carto {
     
     BaseMapView::BaseMapView() :
         _envelopeThreadPool(std::make_shared<CancelableThreadPool>()),
-        _tileThreadPool(std::make_shared<CancelableThreadPool>()),
+        _tileThreadPool(std::make_shared<CancelableThreadPool>(CancelableThreadPool::SchedulingMode::WORK_STEALING)),
         _options(std::make_shared<Options>(_envelopeThreadPool, _tileThreadPool)),
         _layers(std::make_shared<Layers>(_envelopeThreadPool, _tileThreadPool, _options)),
         _mapRenderer(std::make_shared<MapRenderer>(_layers, _options)),
@@ -29,6 +29,7 @@
 #include <mapnikvt/SymbolizerContext.h>
 #include <mapnikvt/MBVTFeatureDecoder.h>
 #include <mapnikvt/MBVTTileReader.h>
+#include <mapnikvt/WorkerPool.h>
 #include <mapnikvt/MapParser.h>
 #include <cartocss/CartoCSSMapLoader.h>
 
@@ -125,7 +126,11 @@ namespace carto {
         _parameterValueMap(),
         _backgroundPattern(),
         _symbolizerContext(),
-        _styleSet(compiledStyleSet)
+        _layerBuildWorkerPool(),
+        _styleSet(compiledStyleSet),
+        _featureDecoderCache(DEFAULT_DECODER_CACHE_CAPACITY),
+        _featureDecoderCacheHits(0),
+        _featureDecoderCacheMisses(0)
     {
         if (!compiledStyleSet) {
             throw NullArgumentException("Null compiledStyleSet");
@@ -144,7 +149,11 @@ namespace carto {
         _parameterValueMap(),
         _backgroundPattern(),
         _symbolizerContext(),
-        _styleSet(cartoCSSStyleSet)
+        _layerBuildWorkerPool(),
+        _styleSet(cartoCSSStyleSet),
+        _featureDecoderCache(DEFAULT_DECODER_CACHE_CAPACITY),
+        _featureDecoderCacheHits(0),
+        _featureDecoderCacheMisses(0)
     {
         if (!cartoCSSStyleSet) {
             throw NullArgumentException("Null cartoCSSStyleSet");
@@ -344,6 +353,40 @@ namespace carto {
         notifyDecoderChanged();
     }
 
+    std::size_t MBVectorTileDecoder::getDecoderCacheCapacity() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _featureDecoderCache.capacity();
+    }
+
+    void MBVectorTileDecoder::setDecoderCacheCapacity(std::size_t capacityInBytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _featureDecoderCache.resize(capacityInBytes);
+    }
+
+    long long MBVectorTileDecoder::getDecoderCacheHitCount() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _featureDecoderCacheHits;
+    }
+
+    long long MBVectorTileDecoder::getDecoderCacheMissCount() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _featureDecoderCacheMisses;
+    }
+
+    int MBVectorTileDecoder::getLayerBuildThreadCount() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _layerBuildWorkerPool ? _layerBuildWorkerPool->getThreadCount() : 0;
+    }
+
+    void MBVectorTileDecoder::setLayerBuildThreadCount(int threadCount) {
+        std::shared_ptr<mvt::WorkerPool> workerPool;
+        if (threadCount > 0) {
+            workerPool = std::make_shared<mvt::WorkerPool>(threadCount);
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _layerBuildWorkerPool = workerPool; // the previous pool is released once pending tiles are finished
+    }
+
     Color MBVectorTileDecoder::getBackgroundColor() const {
         std::lock_guard<std::mutex> lock(_mutex);
         return Color(_map->getSettings().backgroundColor.value());
@@ -372,22 +415,11 @@ namespace carto {
         }
 
         try {
-            std::shared_ptr<mvt::MBVTFeatureDecoder> decoder;
-            {
-                std::unique_lock<std::mutex> lock(_mutex);
-                if (_cachedFeatureDecoder.first != tileData) {
-                    lock.unlock();
-                    decoder = std::make_shared<mvt::MBVTFeatureDecoder>(*tileData->getDataPtr(), _logger);
-                    lock.lock();
-                    _cachedFeatureDecoder = std::make_pair(tileData, decoder);
-                }
-                else {
-                    decoder = _cachedFeatureDecoder.second;
-                }
-            }
+            std::shared_ptr<const mvt::MBVTFeatureDecoder> decoder = getFeatureDecoder(tileData);
 
             std::string mvtLayerName;
             std::shared_ptr<mvt::Feature> mvtFeature = decoder->getFeature(id, mvtLayerName);
+            updateFeatureDecoderCacheSize(tileData, decoder);
             if (!mvtFeature) {
                 return std::shared_ptr<TileFeature>();
             }
@@ -423,6 +455,7 @@ namespace carto {
 
         std::shared_ptr<mvt::Map> map;
         std::shared_ptr<mvt::SymbolizerContext> symbolizerContext;
+        std::shared_ptr<mvt::WorkerPool> layerBuildWorkerPool;
         float buffer;
         bool featureIdOverride;
         std::string layerNameOverride;
@@ -430,23 +463,28 @@ namespace carto {
             std::lock_guard<std::mutex> lock(_mutex);
             map = _map;
             symbolizerContext = _symbolizerContext;
+            layerBuildWorkerPool = _layerBuildWorkerPool;
             buffer = _buffer;
             featureIdOverride = _featureIdOverride;
             layerNameOverride = _layerNameOverride;
         }
     
         try {
-            mvt::MBVTFeatureDecoder decoder(*tileData->getDataPtr(), _logger);
+            std::shared_ptr<const mvt::MBVTFeatureDecoder> sharedDecoder = getFeatureDecoder(tileData);
+            mvt::MBVTFeatureDecoder decoder(*sharedDecoder); // shares the parsed tile, but not the transform and id settings
             decoder.setTransform(calculateTileTransform(tile, targetTile));
             decoder.setBuffer(buffer);
             decoder.setGlobalIdOverride(featureIdOverride, MapTile(tile.x, tile.y, tile.zoom, 0).getTileId());
             
             mvt::MBVTTileReader reader(map, *symbolizerContext, decoder);
             reader.setLayerNameOverride(layerNameOverride);
+            reader.setWorkerPool(layerBuildWorkerPool);
 
-            if (std::shared_ptr<vt::Tile> tile = reader.readTile(targetTile)) {
+            std::shared_ptr<vt::Tile> vtTile = reader.readTile(targetTile);
+            updateFeatureDecoderCacheSize(tileData, sharedDecoder);
+            if (vtTile) {
                 auto tileMap = std::make_shared<TileMap>();
-                (*tileMap)[0] = tile;
+                (*tileMap)[0] = vtTile;
                 return tileMap;
             }
         } catch (const std::exception& ex) {
@@ -455,6 +493,35 @@ namespace carto {
         return std::shared_ptr<TileMap>();
     }
 
+    std::shared_ptr<const mvt::MBVTFeatureDecoder> MBVectorTileDecoder::getFeatureDecoder(const std::shared_ptr<BinaryData>& tileData) const {
+        std::shared_ptr<const mvt::MBVTFeatureDecoder> decoder;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_featureDecoderCache.read(tileData, decoder)) {
+                _featureDecoderCacheHits++;
+                return decoder;
+            }
+            _featureDecoderCacheMisses++;
+        }
+
+        decoder = std::make_shared<mvt::MBVTFeatureDecoder>(tileData->getDataPtr(), _logger);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _featureDecoderCache.put(tileData, decoder, decoder->getResidentSize());
+        }
+        return decoder;
+    }
+
+    void MBVectorTileDecoder::updateFeatureDecoderCacheSize(const std::shared_ptr<BinaryData>& tileData, const std::shared_ptr<const mvt::MBVTFeatureDecoder>& decoder) const {
+        // Layer indices are built lazily by the decoder, so the resident size grows after the entry is inserted
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::shared_ptr<const mvt::MBVTFeatureDecoder> cachedDecoder;
+        if (_featureDecoderCache.peek(tileData, cachedDecoder) && cachedDecoder == decoder) {
+            _featureDecoderCache.put(tileData, decoder, decoder->getResidentSize());
+        }
+    }
+
     void MBVectorTileDecoder::updateCurrentStyle(const boost::variant<std::shared_ptr<CompiledStyleSet>, std::shared_ptr<CartoCSSStyleSet> >& styleSet) {
         std::lock_guard<std::mutex> lock(_mutex);
 
@@ -565,4 +632,5 @@ namespace carto {
     const int MBVectorTileDecoder::DEFAULT_TILE_SIZE = 256;
     const int MBVectorTileDecoder::STROKEMAP_SIZE = 512;
     const int MBVectorTileDecoder::GLYPHMAP_SIZE = 2048;
+    const std::size_t MBVectorTileDecoder::DEFAULT_DECODER_CACHE_CAPACITY = 4 * 1024 * 1024;
 }
@@ -17,6 +17,8 @@
 
 #include <boost/variant.hpp>
 
+#include <stdext/timed_lru_cache.h>
+
 #include <mapnikvt/Value.h>
 
 namespace carto {
@@ -25,6 +27,7 @@ namespace carto {
         class MBVTFeatureDecoder;
         class SymbolizerContext;
         class Logger;
+        class WorkerPool;
     }
 
     class AssetPackage;
@@ -144,6 +147,39 @@ namespace carto {
          */
         void setLayerNameOverride(const std::string& name);
 
+        /**
+         * Returns the capacity of the parsed tile cache. Parsed tiles are shared between rendering, overzooming and feature lookups.
+         * @return The capacity of the parsed tile cache in bytes.
+         */
+        std::size_t getDecoderCacheCapacity() const;
+        /**
+         * Sets the capacity of the parsed tile cache. The default is 4MB.
+         * @param capacityInBytes The new capacity of the parsed tile cache in bytes. If 0, parsed tiles are not cached.
+         */
+        void setDecoderCacheCapacity(std::size_t capacityInBytes);
+        /**
+         * Returns the number of parsed tile cache hits since the decoder was created.
+         * @return The number of parsed tile cache hits.
+         */
+        long long getDecoderCacheHitCount() const;
+        /**
+         * Returns the number of parsed tile cache misses since the decoder was created.
+         * @return The number of parsed tile cache misses.
+         */
+        long long getDecoderCacheMissCount() const;
+
+        /**
+         * Returns the number of worker threads used for building the layers of a single tile concurrently.
+         * @return The number of worker threads. If 0, layers are built sequentially on the calling thread.
+         */
+        int getLayerBuildThreadCount() const;
+        /**
+         * Sets the number of worker threads used for building the layers of a single tile concurrently.
+         * The calling thread also takes part in building, so the number of concurrently built layers is one larger. The default is 0.
+         * @param threadCount The number of worker threads. If 0, layers are built sequentially on the calling thread.
+         */
+        void setLayerBuildThreadCount(int threadCount);
+
         virtual Color getBackgroundColor() const;
     
         virtual std::shared_ptr<const vt::BitmapPattern> getBackgroundPattern() const;
@@ -159,7 +195,11 @@ namespace carto {
     protected:
         void updateCurrentStyle(const boost::variant<std::shared_ptr<CompiledStyleSet>, std::shared_ptr<CartoCSSStyleSet> >& styleSet);
 
+        std::shared_ptr<const mvt::MBVTFeatureDecoder> getFeatureDecoder(const std::shared_ptr<BinaryData>& tileData) const;
+        void updateFeatureDecoderCacheSize(const std::shared_ptr<BinaryData>& tileData, const std::shared_ptr<const mvt::MBVTFeatureDecoder>& decoder) const;
+
         static const int DEFAULT_TILE_SIZE;
+        static const std::size_t DEFAULT_DECODER_CACHE_CAPACITY;
         static const int STROKEMAP_SIZE;
         static const int GLYPHMAP_SIZE;
         
@@ -172,9 +212,12 @@ namespace carto {
         std::shared_ptr<std::map<std::string, mvt::Value> > _parameterValueMap;
         std::shared_ptr<const vt::BitmapPattern> _backgroundPattern;
         std::shared_ptr<mvt::SymbolizerContext> _symbolizerContext;
+        std::shared_ptr<mvt::WorkerPool> _layerBuildWorkerPool;
         boost::variant<std::shared_ptr<CompiledStyleSet>, std::shared_ptr<CartoCSSStyleSet> > _styleSet;
 
-        mutable std::pair<std::shared_ptr<BinaryData>, std::shared_ptr<mvt::MBVTFeatureDecoder> > _cachedFeatureDecoder;
+        mutable cache::timed_lru_cache<std::shared_ptr<BinaryData>, std::shared_ptr<const mvt::MBVTFeatureDecoder> > _featureDecoderCache;
+        mutable long long _featureDecoderCacheHits;
+        mutable long long _featureDecoderCacheMisses;
     
         mutable std::mutex _mutex;
     };
@@ -9,6 +9,7 @@
 #include "utils/Log.h"
 
 #include <vt/Tile.h>
+#include <vt/TileId.h>
 #include <mapnikvt/Value.h>
 #include <mapnikvt/SymbolizerContext.h>
 #include <mapnikvt/TorqueFeatureDecoder.h>
@@ -18,6 +19,33 @@
 #include <boost/lexical_cast.hpp>
 
 namespace carto {
+
+    class TorqueTileDecoder::FrameDecoder : public VectorTileDecoder::TileFrameDecoder {
+    public:
+        FrameDecoder(const std::shared_ptr<mvt::TorqueMap>& map, const std::shared_ptr<mvt::SymbolizerContext>& symbolizerContext, const std::shared_ptr<mvt::TorqueFeatureDecoder>& featureDecoder, const vt::TileId& targetTile) :
+            _map(map),
+            _symbolizerContext(symbolizerContext),
+            _featureDecoder(featureDecoder),
+            _targetTile(targetTile)
+        {
+        }
+
+        virtual int getFrameCount() const {
+            return _map->getTorqueSettings().frameCount;
+        }
+
+        virtual std::shared_ptr<const vt::Tile> decodeFrame(int frame) const {
+            // The parsed feature data is shared between frames, only the styled tile is built per frame
+            mvt::TorqueTileReader reader(_map, frame, true, *_symbolizerContext, *_featureDecoder);
+            return reader.readTile(_targetTile);
+        }
+
+    private:
+        const std::shared_ptr<mvt::TorqueMap> _map;
+        const std::shared_ptr<mvt::SymbolizerContext> _symbolizerContext;
+        const std::shared_ptr<mvt::TorqueFeatureDecoder> _featureDecoder;
+        const vt::TileId _targetTile;
+    };
     
     TorqueTileDecoder::TorqueTileDecoder(const std::shared_ptr<CartoCSSStyleSet>& styleSet) :
         _resolution(256),
@@ -91,12 +119,32 @@ namespace carto {
     }
 
     std::shared_ptr<TorqueTileDecoder::TileMap> TorqueTileDecoder::decodeTile(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<BinaryData>& tileData) const {
-        if (!tileData) {
-            Log::Warn("TorqueTileDecoder::decodeTile: Null tile data");
+        std::shared_ptr<TileFrameDecoder> frameDecoder = createTileFrameDecoder(tile, targetTile, tileData);
+        if (!frameDecoder) {
             return std::shared_ptr<TileMap>();
         }
+
+        try {
+            auto tileMap = std::make_shared<TileMap>();
+            for (int frame = 0; frame < frameDecoder->getFrameCount(); frame++) {
+                if (std::shared_ptr<const vt::Tile> tile = frameDecoder->decodeFrame(frame)) {
+                    (*tileMap)[frame] = tile;
+                }
+            }
+            return tileMap;
+        } catch (const std::exception& ex) {
+            Log::Errorf("TorqueTileDecoder::decodeTile: Exception while decoding: %s", ex.what());
+        }
+        return std::shared_ptr<TileMap>();
+    }
+
+    std::shared_ptr<TorqueTileDecoder::TileFrameDecoder> TorqueTileDecoder::createTileFrameDecoder(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<BinaryData>& tileData) const {
+        if (!tileData) {
+            Log::Warn("TorqueTileDecoder::createTileFrameDecoder: Null tile data");
+            return std::shared_ptr<TileFrameDecoder>();
+        }
         if (tileData->empty()) {
-            return std::shared_ptr<TileMap>();
+            return std::shared_ptr<TileFrameDecoder>();
         }
 
         int resolution;
@@ -111,21 +159,13 @@ namespace carto {
     
         try {
             auto logger = std::make_shared<MapnikVTLogger>("TorqueTileDecoder");
-            mvt::TorqueFeatureDecoder decoder(*tileData->getDataPtr(), resolution, logger);
-            decoder.setTransform(calculateTileTransform(tile, targetTile));
-
-            auto tileMap = std::make_shared<TileMap>();
-            for (int frame = 0; frame < map->getTorqueSettings().frameCount; frame++) {
-                mvt::TorqueTileReader reader(map, frame, true, *symbolizerContext, decoder);
-                if (std::shared_ptr<vt::Tile> tile = reader.readTile(targetTile)) {
-                    (*tileMap)[frame] = tile;
-                }
-            }
-            return tileMap;
+            auto decoder = std::make_shared<mvt::TorqueFeatureDecoder>(*tileData->getDataPtr(), resolution, logger);
+            decoder->setTransform(calculateTileTransform(tile, targetTile));
+            return std::make_shared<FrameDecoder>(map, symbolizerContext, decoder, targetTile);
         } catch (const std::exception& ex) {
-            Log::Errorf("TorqueTileDecoder::decodeTile: Exception while decoding: %s", ex.what());
+            Log::Errorf("TorqueTileDecoder::createTileFrameDecoder: Exception while decoding: %s", ex.what());
         }
-        return std::shared_ptr<TileMap>();
+        return std::shared_ptr<TileFrameDecoder>();
     }
 
     void TorqueTileDecoder::updateCurrentStyle(const std::shared_ptr<CartoCSSStyleSet>& styleSet) {
@@ -78,7 +78,11 @@ namespace carto {
 
         virtual std::shared_ptr<TileMap> decodeTile(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<BinaryData>& tileData) const;
 
+        virtual std::shared_ptr<TileFrameDecoder> createTileFrameDecoder(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<BinaryData>& tileData) const;
+
     protected:
+        class FrameDecoder;
+
         void updateCurrentStyle(const std::shared_ptr<CartoCSSStyleSet>& styleSet);
 
         static const int DEFAULT_TILE_SIZE;
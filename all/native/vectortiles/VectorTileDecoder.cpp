@@ -10,6 +10,10 @@ namespace carto {
     {
     }
 
+    std::shared_ptr<VectorTileDecoder::TileFrameDecoder> VectorTileDecoder::createTileFrameDecoder(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<BinaryData>& tileData) const {
+        return std::shared_ptr<TileFrameDecoder>();
+    }
+
     void VectorTileDecoder::notifyDecoderChanged() {
         std::vector<std::shared_ptr<OnChangeListener> > onChangeListeners;
         {
@@ -48,6 +48,26 @@ namespace carto {
              */
             virtual void onDecoderChanged() = 0;
         };
+
+        /**
+         * Interface for decoding individual frames of a single parsed tile on demand.
+         */
+        struct TileFrameDecoder {
+            virtual ~TileFrameDecoder() { }
+
+            /**
+             * Returns the number of frames in the tile.
+             * @return The number of frames in the tile.
+             */
+            virtual int getFrameCount() const = 0;
+
+            /**
+             * Decodes the specified frame of the tile. Can be called concurrently from multiple threads.
+             * @param frame The frame number to decode.
+             * @return The vector tile data for the frame. If the frame is not available, null is returned.
+             */
+            virtual std::shared_ptr<const vt::Tile> decodeFrame(int frame) const = 0;
+        };
     
         virtual ~VectorTileDecoder();
     
@@ -93,6 +113,16 @@ namespace carto {
          * @return The vector tile data, for each frame. If the tile is not available, null is returned.
          */
         virtual std::shared_ptr<TileMap> decodeTile(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<BinaryData>& tileData) const = 0;
+
+        /**
+         * Parses the specified vector tile and creates a decoder for its frames, so that frames can be decoded lazily.
+         * The default implementation returns null, meaning that the decoder supports only decoding all frames at once.
+         * @param tile The id of the tile to load.
+         * @param targetTile The target tile id that will be created from the data.
+         * @param tileData The tile data to decode.
+         * @return The frame decoder for the tile or null if not supported.
+         */
+        virtual std::shared_ptr<TileFrameDecoder> createTileFrameDecoder(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<BinaryData>& tileData) const;
     
         /**
          * Notifies listeners that the decoder parameters have changed. Action taken depends on the implementation of the
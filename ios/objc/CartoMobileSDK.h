@@ -26,6 +26,7 @@
 #import "NTMemoryCacheTileDataSource.h"
 #import "NTPersistentCacheTileDataSource.h"
 #import "NTLocalVectorDataSource.h"
+#import "NTGeoJSONVectorTileDataSource.h"
 
 #import "NTFeature.h"
 #import "NTFeatureCollection.h"
@@ -151,6 +152,8 @@
 
 #ifdef _CARTO_ROUTING_SUPPORT
 #import "NTRoutingInstruction.h"
+#import "NTRoutingMatrixRequest.h"
+#import "NTRoutingMatrixResult.h"
 #import "NTRoutingRequest.h"
 #import "NTRoutingResult.h"
 #import "NTRoutingService.h"
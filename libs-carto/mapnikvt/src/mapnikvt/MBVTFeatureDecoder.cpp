@@ -4,10 +4,11 @@
 #include "mbvtpackage/MBVTPackage.pb.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
-#include <atomic>
+#include <mutex>
 #include <list>
 #include <vector>
 #include <map>
@@ -18,25 +19,145 @@
 
 #include <stdext/miniz.h>
 
+namespace {
+    bool readVarint(const unsigned char*& ptr, const unsigned char* end, std::uint64_t& value) {
+        value = 0;
+        for (int shift = 0; ptr < end && shift < 64; shift += 7) {
+            unsigned char byte = *ptr++;
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
 namespace carto { namespace mvt {
-    class MBVTFeatureDecoder::MBVTFeatureIterator : public carto::mvt::FeatureDecoder::FeatureIterator {
-    public:
-        explicit MBVTFeatureIterator(const vector_tile::Tile& tile, const vector_tile::Tile::Layer& layer, const std::unordered_set<std::string>* fields, const cglib::mat3x3<float>& transform, const cglib::bbox2<float>& clipBox, float buffer, bool globalIdOverride, long tileIdOffset, std::map<std::vector<int>, std::shared_ptr<FeatureData>>& featureDataCache) :
-            _tile(tile), _layer(layer), _transform(transform), _clipBox(clipBox), _buffer(buffer), _globalIdOverride(globalIdOverride), _tileIdOffset(tileIdOffset), _featureDataCache(featureDataCache)
-        {
-            for (int i = 0; i < tile.layers_size(); i++) {
-                if (&tile.layers(i) == &layer) {
-                    _layerIndexOffset = static_cast<long long>(i) << 32;
+    struct MBVTFeatureDecoder::LayerIndex {
+        std::string name;
+        unsigned int version = 1;
+        unsigned int extent = 4096;
+        std::vector<std::string> keys;
+        std::vector<protobuf::message> values;
+        std::vector<protobuf::message> features;
+
+        explicit LayerIndex(const protobuf::message& layerMsg) {
+            for (protobuf::message msg(layerMsg); msg.next(); ) {
+                if (msg.tag == vector_tile::Tile::Layer::kVersionFieldNumber) {
+                    version = msg.read_uint32();
+                }
+                else if (msg.tag == vector_tile::Tile::Layer::kNameFieldNumber) {
+                    name = msg.read_string();
+                }
+                else if (msg.tag == vector_tile::Tile::Layer::kFeaturesFieldNumber) {
+                    features.emplace_back(msg.read_message());
+                }
+                else if (msg.tag == vector_tile::Tile::Layer::kKeysFieldNumber) {
+                    keys.emplace_back(msg.read_string());
+                }
+                else if (msg.tag == vector_tile::Tile::Layer::kValuesFieldNumber) {
+                    values.emplace_back(msg.read_message());
+                }
+                else if (msg.tag == vector_tile::Tile::Layer::kExtentFieldNumber) {
+                    extent = msg.read_uint32();
+                }
+                else msg.skip();
+            }
+        }
+
+        std::size_t getResidentSize() const {
+            std::size_t size = sizeof(LayerIndex) + name.size();
+            for (const std::string& key : keys) {
+                size += sizeof(std::string) + key.size();
+            }
+            size += (values.size() + features.size()) * sizeof(protobuf::message);
+            return size;
+        }
+    };
+
+    struct MBVTFeatureDecoder::TileIndex {
+        std::shared_ptr<const std::vector<unsigned char>> data;
+        std::vector<std::pair<std::size_t, std::size_t>> layerRanges; // offset and size of each layer message within data
+        std::map<std::string, int> layerMap;
+        std::vector<std::shared_ptr<const LayerIndex>> layerIndices;
+        std::size_t residentSize;
+        std::mutex mutex;
+
+        explicit TileIndex(std::shared_ptr<const std::vector<unsigned char>> tileData, Logger& logger) : data(std::move(tileData)), layerRanges(), layerMap(), layerIndices(), residentSize(0), mutex() {
+            // Scan the top level tile message once, recording only the byte ranges and names of the layers.
+            // The layers themselves are indexed lazily when first accessed.
+            const unsigned char* ptr = data->data();
+            const unsigned char* end = ptr + data->size();
+            while (ptr < end) {
+                std::uint64_t key = 0;
+                if (!readVarint(ptr, end, key)) {
+                    logger.write(Logger::Severity::ERROR, "Truncated vector tile");
                     break;
                 }
+
+                std::uint64_t length = 0;
+                switch (key & 7) {
+                case 0:
+                    if (!readVarint(ptr, end, length)) {
+                        ptr = end;
+                    }
+                    continue;
+                case 1:
+                    ptr += std::min(static_cast<std::ptrdiff_t>(8), end - ptr);
+                    continue;
+                case 5:
+                    ptr += std::min(static_cast<std::ptrdiff_t>(4), end - ptr);
+                    continue;
+                case 2:
+                    if (!readVarint(ptr, end, length) || length > static_cast<std::uint64_t>(end - ptr)) {
+                        logger.write(Logger::Severity::ERROR, "Truncated vector tile");
+                        ptr = end;
+                        continue;
+                    }
+                    break;
+                default:
+                    logger.write(Logger::Severity::ERROR, "Unsupported wire type in vector tile");
+                    ptr = end;
+                    continue;
+                }
+
+                if ((key >> 3) == vector_tile::Tile::kLayersFieldNumber) {
+                    std::size_t offset = static_cast<std::size_t>(ptr - data->data());
+                    std::string name;
+                    for (protobuf::message msg(ptr, static_cast<std::size_t>(length)); msg.next(); ) {
+                        if (msg.tag == vector_tile::Tile::Layer::kNameFieldNumber) {
+                            name = msg.read_string();
+                        }
+                        else msg.skip();
+                    }
+
+                    if (layerMap.find(name) != layerMap.end()) {
+                        logger.write(Logger::Severity::ERROR, "Duplicate layer name: " + name);
+                    }
+                    else {
+                        layerMap[name] = static_cast<int>(layerRanges.size());
+                    }
+                    layerRanges.emplace_back(offset, static_cast<std::size_t>(length));
+                }
+                ptr += length;
             }
+            layerIndices.resize(layerRanges.size());
+            residentSize = data->size() + layerRanges.size() * (sizeof(std::pair<std::size_t, std::size_t>) + sizeof(std::shared_ptr<const LayerIndex>));
+        }
+    };
 
-            for (int i = 0; i < layer.keys_size(); i++) {
-                if (layer.keys(i) == "id" || layer.keys(i) == "cartodb_id") {
+    class MBVTFeatureDecoder::MBVTFeatureIterator : public carto::mvt::FeatureDecoder::FeatureIterator {
+    public:
+        explicit MBVTFeatureIterator(std::shared_ptr<const std::vector<unsigned char>> data, std::shared_ptr<const LayerIndex> layer, int layerIdx, const std::unordered_set<std::string>* fields, const cglib::mat3x3<float>& transform, const cglib::bbox2<float>& clipBox, float buffer, bool globalIdOverride, long long tileIdOffset) :
+            _layerIndexOffset(static_cast<long long>(layerIdx) << 32), _data(std::move(data)), _layer(std::move(layer)), _transform(transform), _clipBox(clipBox), _buffer(buffer), _globalIdOverride(globalIdOverride), _tileIdOffset(tileIdOffset), _featureDataCache()
+        {
+            for (int i = 0; i < static_cast<int>(_layer->keys.size()); i++) {
+                if (_layer->keys[i] == "id" || _layer->keys[i] == "cartodb_id") {
                     _idKey = i;
                 }
                 if (fields) {
-                    auto it = fields->find(layer.keys(i));
+                    auto it = fields->find(_layer->keys[i]);
                     if (it != fields->end()) {
                         _fieldKeys.push_back(i);
                     }
@@ -48,7 +169,7 @@ namespace carto { namespace mvt {
         }
 
         bool findByLocalId(long long localId) {
-            if (localId >= _layerIndexOffset && localId < _layerIndexOffset + _layer.features_size()) {
+            if (localId >= _layerIndexOffset && localId < _layerIndexOffset + static_cast<long long>(_layer->features.size())) {
                 _index = static_cast<int>(localId - _layerIndexOffset);
                 return true;
             }
@@ -56,7 +177,7 @@ namespace carto { namespace mvt {
         }
 
         virtual bool valid() const override {
-            return _index < _layer.features_size();
+            return _index < static_cast<int>(_layer->features.size());
         }
 
         virtual void advance() override {
@@ -72,40 +193,69 @@ namespace carto { namespace mvt {
                 return _tileIdOffset + _layerIndexOffset + _index;
             }
 
-            const vector_tile::Tile::Feature& feature = _layer.features(_index);
-            if (feature.id() != 0) {
-                return feature.id();
-            }
-            for (int i = 0; i + 1 < feature.tags_size(); i += 2) {
-                if (feature.tags(i) == _idKey) {
-                    int valueIdx = feature.tags(i + 1);
-                    if (valueIdx >= 0 && valueIdx < _layer.values_size()) {
-                        const vector_tile::Tile::Value& value = _layer.values(valueIdx);
-                        if (value.has_int_value()) {
-                            return static_cast<long long>(value.int_value());
-                        }
-                        else if (value.has_sint_value()) {
-                            return static_cast<long long>(value.sint_value());
+            std::uint64_t id = 0;
+            int valueIdx = -1;
+            for (protobuf::message msg(_layer->features[_index]); msg.next(); ) {
+                if (msg.tag == vector_tile::Tile::Feature::kIdFieldNumber) {
+                    id = msg.read_uint64();
+                }
+                else if (msg.tag == vector_tile::Tile::Feature::kTagsFieldNumber) {
+                    protobuf::message packedMsg(msg.read_message());
+                    while (packedMsg.valid()) {
+                        int keyIdx = static_cast<int>(packedMsg.read_uint32());
+                        if (!packedMsg.valid()) {
+                            break;
                         }
-                        else if (value.has_uint_value()) {
-                            return static_cast<long long>(value.uint_value());
+                        int tagValueIdx = static_cast<int>(packedMsg.read_uint32());
+                        if (keyIdx == _idKey && valueIdx < 0) {
+                            valueIdx = tagValueIdx;
                         }
-                        return 0;
                     }
                 }
+                else msg.skip();
+            }
+            if (id != 0) {
+                return static_cast<long long>(id);
+            }
+            if (valueIdx >= 0 && valueIdx < static_cast<int>(_layer->values.size())) {
+                for (protobuf::message msg(_layer->values[valueIdx]); msg.next(); ) {
+                    if (msg.tag == vector_tile::Tile::Value::kIntValueFieldNumber) {
+                        return static_cast<long long>(msg.read_int64());
+                    }
+                    else if (msg.tag == vector_tile::Tile::Value::kSintValueFieldNumber) {
+                        return static_cast<long long>(msg.read_sint64());
+                    }
+                    else if (msg.tag == vector_tile::Tile::Value::kUintValueFieldNumber) {
+                        return static_cast<long long>(msg.read_uint64());
+                    }
+                    else msg.skip();
+                }
             }
             return 0;
         }
 
         virtual std::shared_ptr<const FeatureData> getFeatureData() const override {
-            const vector_tile::Tile::Feature& feature = _layer.features(_index);
             std::vector<int> tags(_fieldKeys.size() + 1, -1);
-            tags.back() = static_cast<int>(feature.type());
-            for (int i = 0; i + 1 < feature.tags_size(); i += 2) {
-                auto it = std::find(_fieldKeys.begin(), _fieldKeys.end(), feature.tags(i));
-                if (it != _fieldKeys.end()) {
-                    tags[it - _fieldKeys.begin()] = feature.tags(i + 1);
+            tags.back() = vector_tile::Tile::UNKNOWN;
+            for (protobuf::message msg(_layer->features[_index]); msg.next(); ) {
+                if (msg.tag == vector_tile::Tile::Feature::kTagsFieldNumber) {
+                    protobuf::message packedMsg(msg.read_message());
+                    while (packedMsg.valid()) {
+                        int keyIdx = static_cast<int>(packedMsg.read_uint32());
+                        if (!packedMsg.valid()) {
+                            break;
+                        }
+                        int valueIdx = static_cast<int>(packedMsg.read_uint32());
+                        auto it = std::find(_fieldKeys.begin(), _fieldKeys.end(), keyIdx);
+                        if (it != _fieldKeys.end()) {
+                            tags[it - _fieldKeys.begin()] = valueIdx;
+                        }
+                    }
+                }
+                else if (msg.tag == vector_tile::Tile::Feature::kTypeFieldNumber) {
+                    tags.back() = msg.read_int32();
                 }
+                else msg.skip();
             }
 
             auto it = _featureDataCache.find(tags);
@@ -113,12 +263,12 @@ namespace carto { namespace mvt {
                 return it->second;
             }
 
-            FeatureData::GeometryType geomType = convertGeometryType(feature.type());
+            FeatureData::GeometryType geomType = convertGeometryType(static_cast<vector_tile::Tile::GeomType>(tags.back()));
             std::vector<std::pair<std::string, Value>> dataMap;
             dataMap.reserve(tags.size());
             for (std::size_t i = 0; i < _fieldKeys.size(); i++) {
-                if (tags[i] >= 0 && tags[i] < _layer.values_size()) {
-                    dataMap.emplace_back(_layer.keys(_fieldKeys[i]), convertValue(_layer.values(tags[i])));
+                if (tags[i] >= 0 && tags[i] < static_cast<int>(_layer->values.size())) {
+                    dataMap.emplace_back(_layer->keys[_fieldKeys[i]], convertValue(_layer->values[tags[i]]));
                 }
             }
 
@@ -128,9 +278,18 @@ namespace carto { namespace mvt {
         }
 
         virtual std::shared_ptr<const Geometry> getGeometry() const override {
+            vector_tile::Tile::GeomType type = vector_tile::Tile::UNKNOWN;
             std::vector<std::vector<cglib::vec2<float>>> verticesList;
-            decodeGeometry(_layer.features(_index), verticesList, 1.0f / _layer.extent());
-            if (_buffer > 0 && _layer.features(_index).type() == vector_tile::Tile::LINESTRING) {
+            for (protobuf::message msg(_layer->features[_index]); msg.next(); ) {
+                if (msg.tag == vector_tile::Tile::Feature::kTypeFieldNumber) {
+                    type = static_cast<vector_tile::Tile::GeomType>(msg.read_int32());
+                }
+                else if (msg.tag == vector_tile::Tile::Feature::kGeometryFieldNumber) {
+                    decodeGeometry(msg.read_message(), verticesList, 1.0f / _layer->extent);
+                }
+                else msg.skip();
+            }
+            if (_buffer > 0 && type == vector_tile::Tile::LINESTRING) {
                 bufferGeometry(verticesList, _buffer);
             }
 
@@ -145,7 +304,7 @@ namespace carto { namespace mvt {
                 return std::shared_ptr<Geometry>();
             }
 
-            switch (_layer.features(_index).type()) {
+            switch (type) {
             case vector_tile::Tile::POINT:
                 if (!verticesList.empty()) {
                     return std::make_shared<PointGeometry>(std::move(verticesList.front()));
@@ -155,7 +314,7 @@ namespace carto { namespace mvt {
                 return std::make_shared<LineGeometry>(std::move(verticesList));
             case vector_tile::Tile::POLYGON: {
                 PolygonGeometry::PolygonList polygons;
-                if (_layer.has_version() && _layer.version() > 1) {
+                if (_layer->version > 1) {
                     auto it = std::find_if(verticesList.begin(), verticesList.end(), isRingCCW); // find first outer ring
                     while (it != verticesList.end()) {
                         auto it0 = it++;
@@ -187,39 +346,41 @@ namespace carto { namespace mvt {
             }
         }
 
-        static Value convertValue(const vector_tile::Tile::Value& val) {
-            if (val.has_bool_value()) {
-                return Value(val.bool_value());
-            }
-            else if (val.has_int_value()) {
-                return Value(static_cast<long long>(val.int_value()));
-            }
-            else if (val.has_sint_value()) {
-                return Value(static_cast<long long>(val.sint_value()));
-            }
-            else if (val.has_uint_value()) {
-                return Value(static_cast<long long>(val.uint_value()));
-            }
-            else if (val.has_float_value()) {
-                return Value(static_cast<double>(val.float_value()));
-            }
-            else if (val.has_double_value()) {
-                return Value(val.double_value());
-            }
-            else if (val.has_string_value()) {
-                return Value(val.string_value());
+        static Value convertValue(const protobuf::message& valueMsg) {
+            for (protobuf::message msg(valueMsg); msg.next(); ) {
+                if (msg.tag == vector_tile::Tile::Value::kBoolValueFieldNumber) {
+                    return Value(msg.read_bool());
+                }
+                else if (msg.tag == vector_tile::Tile::Value::kIntValueFieldNumber) {
+                    return Value(static_cast<long long>(msg.read_int64()));
+                }
+                else if (msg.tag == vector_tile::Tile::Value::kSintValueFieldNumber) {
+                    return Value(static_cast<long long>(msg.read_sint64()));
+                }
+                else if (msg.tag == vector_tile::Tile::Value::kUintValueFieldNumber) {
+                    return Value(static_cast<long long>(msg.read_uint64()));
+                }
+                else if (msg.tag == vector_tile::Tile::Value::kFloatValueFieldNumber) {
+                    return Value(static_cast<double>(msg.read_float()));
+                }
+                else if (msg.tag == vector_tile::Tile::Value::kDoubleValueFieldNumber) {
+                    return Value(msg.read_double());
+                }
+                else if (msg.tag == vector_tile::Tile::Value::kStringValueFieldNumber) {
+                    return Value(msg.read_string());
+                }
+                else msg.skip();
             }
             return Value();
         }
 
-        static void decodeGeometry(const vector_tile::Tile::Feature& feature, std::vector<std::vector<cglib::vec2<float>>>& verticesList, float scale) {
+        static void decodeGeometry(const protobuf::message& geometryMsg, std::vector<std::vector<cglib::vec2<float>>>& verticesList, float scale) {
             int cx = 0, cy = 0;
             int cmd = 0, length = 0;
             std::vector<cglib::vec2<float>> vertices;
-            vertices.reserve(feature.geometry_size());
-            for (int i = 0; i < feature.geometry_size(); ) {
+            for (protobuf::message packedMsg(geometryMsg); packedMsg.valid(); ) {
                 if (length == 0) {
-                    int cmdLength = feature.geometry(i++);
+                    int cmdLength = static_cast<int>(packedMsg.read_uint32());
                     length = cmdLength >> 3;
                     cmd = cmdLength & 7;
                     if (length == 0) {
@@ -228,15 +389,21 @@ namespace carto { namespace mvt {
                 }
 
                 length--;
-                if ((cmd == 1 || cmd == 2) && i + 2 <= feature.geometry_size()) {
+                if (cmd == 1 || cmd == 2) {
+                    if (!packedMsg.valid()) {
+                        break;
+                    }
+                    int dx = static_cast<int>(packedMsg.read_uint32());
+                    if (!packedMsg.valid()) {
+                        break;
+                    }
+                    int dy = static_cast<int>(packedMsg.read_uint32());
                     if (cmd == 1) {
                         if (!vertices.empty()) {
                             verticesList.emplace_back();
                             std::swap(verticesList.back(), vertices);
                         }
                     }
-                    int dx = feature.geometry(i++);
-                    int dy = feature.geometry(i++);
                     dx = ((dx >> 1) ^ (-(dx & 1)));
                     dy = ((dy >> 1) ^ (-(dy & 1)));
                     cx += dx;
@@ -299,45 +466,33 @@ namespace carto { namespace mvt {
 
         int _index = 0;
         int _idKey = -1;
-        long long _layerIndexOffset = 0;
+        const long long _layerIndexOffset;
         std::vector<int> _fieldKeys;
-        const vector_tile::Tile& _tile;
-        const vector_tile::Tile::Layer& _layer;
+        const std::shared_ptr<const std::vector<unsigned char>> _data;
+        const std::shared_ptr<const LayerIndex> _layer;
         const cglib::mat3x3<float> _transform;
         const cglib::bbox2<float> _clipBox;
         const float _buffer;
         const bool _globalIdOverride;
         const long long _tileIdOffset;
-        std::map<std::vector<int>, std::shared_ptr<FeatureData>>& _featureDataCache;
-
-        static std::atomic<long long> _idCounter;
+        mutable std::map<std::vector<int>, std::shared_ptr<FeatureData>> _featureDataCache; // owned by the iterator, so iterators can be used concurrently
     };
 
-    std::atomic<long long> MBVTFeatureDecoder::MBVTFeatureIterator::_idCounter = ATOMIC_VAR_INIT(1);
-
     MBVTFeatureDecoder::MBVTFeatureDecoder(const std::vector<unsigned char>& data, std::shared_ptr<Logger> logger) :
-        _transform(cglib::mat3x3<float>::identity()), _clipBox(cglib::vec2<float>(-0.1f, -0.1f), cglib::vec2<float>(1.1f, 1.1f)), _buffer(0), _globalIdOverride(false), _tileIdOffset(0), _tile(), _layerMap(), _logger(std::move(logger))
+        MBVTFeatureDecoder(std::make_shared<std::vector<unsigned char>>(data), std::move(logger))
     {
-        std::vector<unsigned char> uncompressedData;
-        uncompressedData.reserve(data.size());
-        if (miniz::inflate_gzip(data.data(), data.size(), uncompressedData)) {
-            protobuf::message tileMsg(uncompressedData.data(), uncompressedData.size());
-            _tile = std::make_shared<vector_tile::Tile>(tileMsg);
-        }
-        else {
-            protobuf::message tileMsg(data.data(), data.size());
-            _tile = std::make_shared<vector_tile::Tile>(tileMsg);
-        }
+    }
 
-        for (int i = 0; i < _tile->layers_size(); i++) {
-            const std::string& name = _tile->layers(i).name();
-            if (_layerMap.find(name) != _layerMap.end()) {
-                _logger->write(Logger::Severity::ERROR, "Duplicate layer name: " + name);
-            }
-            else {
-                _layerMap[name] = i;
-            }
+    MBVTFeatureDecoder::MBVTFeatureDecoder(std::shared_ptr<const std::vector<unsigned char>> data, std::shared_ptr<Logger> logger) :
+        _transform(cglib::mat3x3<float>::identity()), _clipBox(cglib::vec2<float>(-0.1f, -0.1f), cglib::vec2<float>(1.1f, 1.1f)), _buffer(0), _globalIdOverride(false), _tileIdOffset(0), _tileIndex(), _logger(std::move(logger))
+    {
+        auto uncompressedData = std::make_shared<std::vector<unsigned char>>();
+        uncompressedData->reserve(data->size());
+        if (miniz::inflate_gzip(data->data(), data->size(), *uncompressedData)) {
+            data = uncompressedData;
         }
+
+        _tileIndex = std::make_shared<TileIndex>(std::move(data), *_logger);
     }
 
     void MBVTFeatureDecoder::setTransform(const cglib::mat3x3<float>& transform) {
@@ -357,28 +512,44 @@ namespace carto { namespace mvt {
         _tileIdOffset = tileIdOffset;
     }
 
+    std::size_t MBVTFeatureDecoder::getResidentSize() const {
+        std::lock_guard<std::mutex> lock(_tileIndex->mutex);
+        return _tileIndex->residentSize;
+    }
+
     std::shared_ptr<Feature> MBVTFeatureDecoder::getFeature(long long localId, std::string& layerName) const {
-        for (int i = 0; i < _tile->layers_size(); i++) {
-            std::map<std::vector<int>, std::shared_ptr<FeatureData>> featureDataCache;
-            MBVTFeatureIterator it(*_tile, _tile->layers(i), nullptr, _transform, _clipBox, _buffer, _globalIdOverride, _tileIdOffset, featureDataCache);
-            if (it.findByLocalId(localId)) {
-                 layerName = _tile->layers(i).name();
-                 return std::make_shared<Feature>(it.getGlobalId(), it.getGeometry(), it.getFeatureData());
-            }
+        long long layerIdx = localId >> 32;
+        if (layerIdx < 0 || layerIdx >= static_cast<long long>(_tileIndex->layerRanges.size())) {
+            return std::shared_ptr<Feature>();
+        }
+
+        std::shared_ptr<const LayerIndex> layer = getLayerIndex(static_cast<int>(layerIdx));
+        MBVTFeatureIterator it(_tileIndex->data, layer, static_cast<int>(layerIdx), nullptr, _transform, _clipBox, _buffer, _globalIdOverride, _tileIdOffset);
+        if (it.findByLocalId(localId)) {
+            layerName = layer->name;
+            return std::make_shared<Feature>(it.getGlobalId(), it.getGeometry(), it.getFeatureData());
         }
         return std::shared_ptr<Feature>();
     }
 
     std::shared_ptr<FeatureDecoder::FeatureIterator> MBVTFeatureDecoder::createLayerFeatureIterator(const std::string& name, const std::unordered_set<std::string>& fields) const {
-        auto layerIt = _layerMap.find(name);
-        if (layerIt == _layerMap.end()) {
+        auto layerIt = _tileIndex->layerMap.find(name);
+        if (layerIt == _tileIndex->layerMap.end()) {
             return std::shared_ptr<FeatureIterator>();
         }
-        if (_layerFeatureDataCache.find(name) == _layerFeatureDataCache.end()) { // flush the cache if previous layer was different
-            _layerFeatureDataCache.clear();
+        std::shared_ptr<const LayerIndex> layer = getLayerIndex(layerIt->second);
+        return std::make_shared<MBVTFeatureIterator>(_tileIndex->data, layer, layerIt->second, &fields, _transform, _clipBox, _buffer, _globalIdOverride, _tileIdOffset);
+    }
+
+    std::shared_ptr<const MBVTFeatureDecoder::LayerIndex> MBVTFeatureDecoder::getLayerIndex(int layerIdx) const {
+        std::lock_guard<std::mutex> lock(_tileIndex->mutex);
+        std::shared_ptr<const LayerIndex>& layer = _tileIndex->layerIndices[layerIdx];
+        if (!layer) {
+            const std::pair<std::size_t, std::size_t>& range = _tileIndex->layerRanges[layerIdx];
+            auto layerIndex = std::make_shared<LayerIndex>(protobuf::message(_tileIndex->data->data() + range.first, range.second));
+            _tileIndex->residentSize += layerIndex->getResidentSize();
+            layer = layerIndex;
         }
-        const vector_tile::Tile::Layer& layer = _tile->layers(layerIt->second);
-        std::map<std::vector<int>, std::shared_ptr<FeatureData>>& featureDataCache = _layerFeatureDataCache[name];
-        return std::make_shared<MBVTFeatureIterator>(*_tile, layer, &fields, _transform, _clipBox, _buffer, _globalIdOverride, _tileIdOffset, featureDataCache);
+        return layer;
     }
 } }
@@ -17,37 +17,38 @@
 #include <cglib/bbox.h>
 #include <cglib/mat.h>
 
-namespace vector_tile {
-    class Tile;
-}
-
 namespace carto { namespace mvt {
     class Logger;
-    
+
     class MBVTFeatureDecoder : public FeatureDecoder {
     public:
         explicit MBVTFeatureDecoder(const std::vector<unsigned char>& data, std::shared_ptr<Logger> logger);
+        explicit MBVTFeatureDecoder(std::shared_ptr<const std::vector<unsigned char>> data, std::shared_ptr<Logger> logger);
 
         void setTransform(const cglib::mat3x3<float>& transform);
         void setClipBox(const cglib::bbox2<float>& clipBox);
         void setBuffer(float buffer);
         void setGlobalIdOverride(bool globalIdOverride, long long tileIdOffset = 0);
 
+        std::size_t getResidentSize() const;
+
         std::shared_ptr<Feature> getFeature(long long localId, std::string& layerName) const;
-        
+
         std::shared_ptr<FeatureIterator> createLayerFeatureIterator(const std::string& name, const std::unordered_set<std::string>& fields) const;
 
     private:
         class MBVTFeatureIterator;
+        struct LayerIndex;
+        struct TileIndex;
+
+        std::shared_ptr<const LayerIndex> getLayerIndex(int layerIdx) const;
 
         cglib::mat3x3<float> _transform;
         cglib::bbox2<float> _clipBox;
         float _buffer;
         bool _globalIdOverride;
         long long _tileIdOffset;
-        std::shared_ptr<vector_tile::Tile> _tile;
-        std::map<std::string, int> _layerMap;
-        mutable std::map<std::string, std::map<std::vector<int>, std::shared_ptr<FeatureData>>> _layerFeatureDataCache;
+        std::shared_ptr<TileIndex> _tileIndex; // shared between copies of the decoder
 
         const std::shared_ptr<Logger> _logger;
     };
@@ -0,0 +1,272 @@
+#include "MBVTTileBuilder.h"
+
+#include "mbvtpackage/MBVTPackage.pb.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+    enum WireType {
+        WIRE_TYPE_VARINT = 0,
+        WIRE_TYPE_FIXED64 = 1,
+        WIRE_TYPE_LENGTH_DELIMITED = 2
+    };
+
+    enum CommandId {
+        COMMAND_MOVE_TO = 1,
+        COMMAND_LINE_TO = 2,
+        COMMAND_CLOSE_PATH = 7
+    };
+
+    std::uint32_t encodeCommand(int id, std::size_t count) {
+        return static_cast<std::uint32_t>((count << 3) | (id & 7));
+    }
+
+    std::uint32_t encodeZigZag(int value) {
+        return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+    }
+}
+
+namespace carto { namespace mvt {
+    MBVTTileBuilder::MBVTTileBuilder(int extent) :
+        _extent(extent), _layers()
+    {
+    }
+
+    int MBVTTileBuilder::createLayer(const std::string& name) {
+        _layers.emplace_back();
+        _layers.back().name = name;
+        return static_cast<int>(_layers.size()) - 1;
+    }
+
+    void MBVTTileBuilder::addPoints(int layerIdx, long long id, const Vertices& points, const Properties& properties) {
+        Coords coords = quantize(points);
+        if (coords.empty()) {
+            return;
+        }
+
+        std::vector<std::uint32_t> geometry;
+        geometry.reserve(coords.size() * 2 + 1);
+        geometry.push_back(encodeCommand(COMMAND_MOVE_TO, coords.size()));
+        cglib::vec2<int> cursor(0, 0);
+        for (const cglib::vec2<int>& coord : coords) {
+            geometry.push_back(encodeZigZag(coord(0) - cursor(0)));
+            geometry.push_back(encodeZigZag(coord(1) - cursor(1)));
+            cursor = coord;
+        }
+        addFeature(layerIdx, id, vector_tile::Tile::POINT, geometry, properties);
+    }
+
+    void MBVTTileBuilder::addLineStrings(int layerIdx, long long id, const VerticesList& verticesList, const Properties& properties) {
+        std::vector<std::uint32_t> geometry;
+        cglib::vec2<int> cursor(0, 0);
+        for (const Vertices& vertices : verticesList) {
+            Coords coords = quantize(vertices);
+            coords.erase(std::unique(coords.begin(), coords.end()), coords.end());
+            if (coords.size() < 2) {
+                continue;
+            }
+            EncodeCoords(coords, false, cursor, geometry);
+        }
+        if (!geometry.empty()) {
+            addFeature(layerIdx, id, vector_tile::Tile::LINESTRING, geometry, properties);
+        }
+    }
+
+    void MBVTTileBuilder::addPolygons(int layerIdx, long long id, const PolygonList& polygons, const Properties& properties) {
+        std::vector<std::uint32_t> geometry;
+        cglib::vec2<int> cursor(0, 0);
+        for (const VerticesList& rings : polygons) {
+            for (std::size_t i = 0; i < rings.size(); i++) {
+                Coords coords = quantize(rings[i]);
+                coords.erase(std::unique(coords.begin(), coords.end()), coords.end());
+                if (coords.size() > 1 && coords.front() == coords.back()) {
+                    coords.pop_back();
+                }
+                if (coords.size() < 3) {
+                    if (i == 0) {
+                        break; // degenerate outer ring, skip the holes too
+                    }
+                    continue;
+                }
+
+                // Outer rings must have positive area, holes negative area
+                long long area = CalculateRingArea(coords);
+                if (area == 0) {
+                    if (i == 0) {
+                        break;
+                    }
+                    continue;
+                }
+                if ((area > 0) != (i == 0)) {
+                    std::reverse(coords.begin(), coords.end());
+                }
+                EncodeCoords(coords, true, cursor, geometry);
+            }
+        }
+        if (!geometry.empty()) {
+            addFeature(layerIdx, id, vector_tile::Tile::POLYGON, geometry, properties);
+        }
+    }
+
+    void MBVTTileBuilder::build(std::vector<unsigned char>& data) const {
+        data.clear();
+        std::vector<unsigned char> layerData;
+        for (const Layer& layer : _layers) {
+            if (layer.featuresData.empty()) {
+                continue;
+            }
+
+            layerData.clear();
+            WriteTag(layerData, vector_tile::Tile::Layer::kVersionFieldNumber, WIRE_TYPE_VARINT);
+            WriteVarint(layerData, 2);
+            WriteBytes(layerData, vector_tile::Tile::Layer::kNameFieldNumber, layer.name.data(), layer.name.size());
+            layerData.insert(layerData.end(), layer.featuresData.begin(), layer.featuresData.end());
+            for (const std::string& key : layer.keys) {
+                WriteBytes(layerData, vector_tile::Tile::Layer::kKeysFieldNumber, key.data(), key.size());
+            }
+            std::vector<unsigned char> valueData;
+            for (const Value& value : layer.values) {
+                valueData.clear();
+                WriteValue(valueData, value);
+                WriteBytes(layerData, vector_tile::Tile::Layer::kValuesFieldNumber, valueData.data(), valueData.size());
+            }
+            WriteTag(layerData, vector_tile::Tile::Layer::kExtentFieldNumber, WIRE_TYPE_VARINT);
+            WriteVarint(layerData, static_cast<std::uint64_t>(_extent));
+
+            WriteBytes(data, vector_tile::Tile::kLayersFieldNumber, layerData.data(), layerData.size());
+        }
+    }
+
+    void MBVTTileBuilder::addFeature(int layerIdx, long long id, int type, const std::vector<std::uint32_t>& geometry, const Properties& properties) {
+        Layer& layer = _layers.at(layerIdx);
+
+        std::vector<std::uint32_t> tags;
+        tags.reserve(properties.size() * 2);
+        for (const std::pair<std::string, Value>& property : properties) {
+            if (boost::get<boost::blank>(&property.second)) {
+                continue; // null values can not be represented
+            }
+
+            auto keyIt = layer.keyIndices.find(property.first);
+            if (keyIt == layer.keyIndices.end()) {
+                keyIt = layer.keyIndices.emplace(property.first, static_cast<int>(layer.keys.size())).first;
+                layer.keys.push_back(property.first);
+            }
+            auto valueIt = layer.valueIndices.find(property.second);
+            if (valueIt == layer.valueIndices.end()) {
+                valueIt = layer.valueIndices.emplace(property.second, static_cast<int>(layer.values.size())).first;
+                layer.values.push_back(property.second);
+            }
+            tags.push_back(static_cast<std::uint32_t>(keyIt->second));
+            tags.push_back(static_cast<std::uint32_t>(valueIt->second));
+        }
+
+        std::vector<unsigned char> featureData;
+        std::vector<unsigned char> packedData;
+        if (id > 0) {
+            WriteTag(featureData, vector_tile::Tile::Feature::kIdFieldNumber, WIRE_TYPE_VARINT);
+            WriteVarint(featureData, static_cast<std::uint64_t>(id));
+        }
+        if (!tags.empty()) {
+            for (std::uint32_t tag : tags) {
+                WriteVarint(packedData, tag);
+            }
+            WriteBytes(featureData, vector_tile::Tile::Feature::kTagsFieldNumber, packedData.data(), packedData.size());
+        }
+        WriteTag(featureData, vector_tile::Tile::Feature::kTypeFieldNumber, WIRE_TYPE_VARINT);
+        WriteVarint(featureData, static_cast<std::uint64_t>(type));
+        packedData.clear();
+        for (std::uint32_t value : geometry) {
+            WriteVarint(packedData, value);
+        }
+        WriteBytes(featureData, vector_tile::Tile::Feature::kGeometryFieldNumber, packedData.data(), packedData.size());
+
+        WriteBytes(layer.featuresData, vector_tile::Tile::Layer::kFeaturesFieldNumber, featureData.data(), featureData.size());
+    }
+
+    MBVTTileBuilder::Coords MBVTTileBuilder::quantize(const Vertices& vertices) const {
+        Coords coords;
+        coords.reserve(vertices.size());
+        for (const cglib::vec2<float>& vertex : vertices) {
+            coords.emplace_back(static_cast<int>(std::floor(vertex(0) * _extent + 0.5f)), static_cast<int>(std::floor(vertex(1) * _extent + 0.5f)));
+        }
+        return coords;
+    }
+
+    void MBVTTileBuilder::EncodeCoords(const Coords& coords, bool closed, cglib::vec2<int>& cursor, std::vector<std::uint32_t>& geometry) {
+        geometry.reserve(geometry.size() + coords.size() * 2 + 3);
+        for (std::size_t i = 0; i < coords.size(); i++) {
+            if (i == 0) {
+                geometry.push_back(encodeCommand(COMMAND_MOVE_TO, 1));
+            }
+            else if (i == 1) {
+                geometry.push_back(encodeCommand(COMMAND_LINE_TO, coords.size() - 1));
+            }
+            geometry.push_back(encodeZigZag(coords[i](0) - cursor(0)));
+            geometry.push_back(encodeZigZag(coords[i](1) - cursor(1)));
+            cursor = coords[i];
+        }
+        if (closed) {
+            geometry.push_back(encodeCommand(COMMAND_CLOSE_PATH, 1));
+        }
+    }
+
+    long long MBVTTileBuilder::CalculateRingArea(const Coords& coords) {
+        long long area = 0;
+        for (std::size_t i = 0; i < coords.size(); i++) {
+            const cglib::vec2<int>& p0 = coords[i];
+            const cglib::vec2<int>& p1 = coords[(i + 1) % coords.size()];
+            area += static_cast<long long>(p0(0)) * p1(1) - static_cast<long long>(p1(0)) * p0(1);
+        }
+        return area;
+    }
+
+    void MBVTTileBuilder::WriteVarint(std::vector<unsigned char>& data, std::uint64_t value) {
+        while (value >= 0x80) {
+            data.push_back(static_cast<unsigned char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        data.push_back(static_cast<unsigned char>(value));
+    }
+
+    void MBVTTileBuilder::WriteTag(std::vector<unsigned char>& data, int fieldNumber, int wireType) {
+        WriteVarint(data, (static_cast<std::uint64_t>(fieldNumber) << 3) | static_cast<std::uint64_t>(wireType));
+    }
+
+    void MBVTTileBuilder::WriteBytes(std::vector<unsigned char>& data, int fieldNumber, const void* bytes, std::size_t size) {
+        WriteTag(data, fieldNumber, WIRE_TYPE_LENGTH_DELIMITED);
+        WriteVarint(data, size);
+        const unsigned char* ptr = static_cast<const unsigned char*>(bytes);
+        data.insert(data.end(), ptr, ptr + size);
+    }
+
+    void MBVTTileBuilder::WriteValue(std::vector<unsigned char>& data, const Value& value) {
+        if (const bool* boolVal = boost::get<bool>(&value)) {
+            WriteTag(data, vector_tile::Tile::Value::kBoolValueFieldNumber, WIRE_TYPE_VARINT);
+            WriteVarint(data, *boolVal ? 1 : 0);
+        }
+        else if (const long long* longVal = boost::get<long long>(&value)) {
+            if (*longVal >= 0) {
+                WriteTag(data, vector_tile::Tile::Value::kUintValueFieldNumber, WIRE_TYPE_VARINT);
+                WriteVarint(data, static_cast<std::uint64_t>(*longVal));
+            }
+            else {
+                WriteTag(data, vector_tile::Tile::Value::kSintValueFieldNumber, WIRE_TYPE_VARINT);
+                WriteVarint(data, (static_cast<std::uint64_t>(*longVal) << 1) ^ static_cast<std::uint64_t>(*longVal >> 63));
+            }
+        }
+        else if (const double* doubleVal = boost::get<double>(&value)) {
+            std::uint64_t bits = 0;
+            std::memcpy(&bits, doubleVal, sizeof(bits));
+            WriteTag(data, vector_tile::Tile::Value::kDoubleValueFieldNumber, WIRE_TYPE_FIXED64);
+            for (int i = 0; i < 8; i++) {
+                data.push_back(static_cast<unsigned char>(bits >> (i * 8)));
+            }
+        }
+        else if (const std::string* strVal = boost::get<std::string>(&value)) {
+            WriteBytes(data, vector_tile::Tile::Value::kStringValueFieldNumber, strVal->data(), strVal->size());
+        }
+    }
+} }
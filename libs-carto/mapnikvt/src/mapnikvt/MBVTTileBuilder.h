@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_MAPNIKVT_MBVTTILEBUILDER_H_
+#define _CARTO_MAPNIKVT_MBVTTILEBUILDER_H_
+
+#include "Value.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include <cglib/vec.h>
+
+namespace carto { namespace mvt {
+    // Encoder for Mapbox vector tiles (version 2). All coordinates are given in normalized tile space, (0, 0) being the top-left corner and (1, 1) the bottom-right corner of the tile.
+    class MBVTTileBuilder final {
+    public:
+        using Vertices = std::vector<cglib::vec2<float>>;
+        using VerticesList = std::vector<Vertices>;
+        using PolygonList = std::vector<VerticesList>;
+        using Properties = std::vector<std::pair<std::string, Value>>;
+
+        explicit MBVTTileBuilder(int extent);
+
+        int createLayer(const std::string& name);
+
+        void addPoints(int layerIdx, long long id, const Vertices& points, const Properties& properties);
+        void addLineStrings(int layerIdx, long long id, const VerticesList& verticesList, const Properties& properties);
+        void addPolygons(int layerIdx, long long id, const PolygonList& polygons, const Properties& properties); // first ring of each polygon is the outer ring, winding order is fixed by the builder
+
+        void build(std::vector<unsigned char>& data) const;
+
+    private:
+        struct Layer {
+            std::string name;
+            std::vector<std::string> keys;
+            std::unordered_map<std::string, int> keyIndices;
+            std::vector<Value> values;
+            std::map<Value, int> valueIndices;
+            std::vector<unsigned char> featuresData;
+        };
+
+        using Coords = std::vector<cglib::vec2<int>>;
+
+        void addFeature(int layerIdx, long long id, int type, const std::vector<std::uint32_t>& geometry, const Properties& properties);
+
+        Coords quantize(const Vertices& vertices) const;
+
+        static void EncodeCoords(const Coords& coords, bool closed, cglib::vec2<int>& cursor, std::vector<std::uint32_t>& geometry);
+        static long long CalculateRingArea(const Coords& coords);
+
+        static void WriteVarint(std::vector<unsigned char>& data, std::uint64_t value);
+        static void WriteTag(std::vector<unsigned char>& data, int fieldNumber, int wireType);
+        static void WriteBytes(std::vector<unsigned char>& data, int fieldNumber, const void* bytes, std::size_t size);
+        static void WriteValue(std::vector<unsigned char>& data, const Value& value);
+
+        int _extent;
+        std::vector<Layer> _layers;
+    };
+} }
+
+#endif
@@ -1,6 +1,9 @@
 #include "Style.h"
 #include "Expression.h"
 #include "Rule.h"
+#include "StyleProgram.h"
+
+#include <map>
 
 namespace carto { namespace mvt {
     Style::Style(std::string name, float opacity, std::string compOp, FilterMode filterMode, std::vector<std::shared_ptr<const Rule>> rules) : _name(std::move(name)), _opacity(opacity), _compOp(std::move(compOp)), _filterMode(filterMode), _rules(std::move(rules)), _zoomRuleMap() {
@@ -12,6 +15,16 @@ namespace carto { namespace mvt {
                 _zoomFieldExprsMap[zoom].insert(fieldExprs.begin(), fieldExprs.end());
             }
         }
+
+        // Compile the filters of each zoom level, sharing the programs between zoom levels with identical rules
+        std::map<std::vector<std::shared_ptr<const Rule>>, std::shared_ptr<const StyleProgram>> rulesProgramMap;
+        for (auto it = _zoomRuleMap.begin(); it != _zoomRuleMap.end(); it++) {
+            std::shared_ptr<const StyleProgram>& program = rulesProgramMap[it->second];
+            if (!program) {
+                program = std::make_shared<StyleProgram>(_filterMode, it->second);
+            }
+            _zoomProgramMap[it->first] = program;
+        }
     }
 
     const std::vector<std::shared_ptr<const Rule>>& Style::getZoomRules(int zoom) const {
@@ -23,6 +36,15 @@ namespace carto { namespace mvt {
         return it->second;
     }
 
+    const std::shared_ptr<const StyleProgram>& Style::getZoomProgram(int zoom) const {
+        static const std::shared_ptr<const StyleProgram> emptyProgram;
+        auto it = _zoomProgramMap.find(zoom);
+        if (it == _zoomProgramMap.end()) {
+            return emptyProgram;
+        }
+        return it->second;
+    }
+
     const std::unordered_set<std::shared_ptr<const Expression>>& Style::getReferencedFields(int zoom) const {
         static const std::unordered_set<std::shared_ptr<const Expression>> emptyFieldExprs;
         auto it = _zoomFieldExprsMap.find(zoom);
@@ -19,6 +19,7 @@
 namespace carto { namespace mvt {
     class Expression;
     class Rule;
+    class StyleProgram;
     
     class Style final {
     public:
@@ -37,6 +38,8 @@ namespace carto { namespace mvt {
             
         const std::vector<std::shared_ptr<const Rule>>& getZoomRules(int zoom) const;
 
+        const std::shared_ptr<const StyleProgram>& getZoomProgram(int zoom) const;
+
         const std::unordered_set<std::shared_ptr<const Expression>>& getReferencedFields(int zoom) const;
 
     private:
@@ -46,6 +49,7 @@ namespace carto { namespace mvt {
         const FilterMode _filterMode;
         const std::vector<std::shared_ptr<const Rule>> _rules;
         std::unordered_map<int, std::vector<std::shared_ptr<const Rule>>> _zoomRuleMap;
+        std::unordered_map<int, std::shared_ptr<const StyleProgram>> _zoomProgramMap;
         std::unordered_map<int, std::unordered_set<std::shared_ptr<const Expression>>> _zoomFieldExprsMap;
     };
 } }
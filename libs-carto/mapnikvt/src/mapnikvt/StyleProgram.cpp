@@ -0,0 +1,251 @@
+#include "StyleProgram.h"
+#include "Rule.h"
+#include "Filter.h"
+
+#include <algorithm>
+
+namespace carto { namespace mvt {
+    StyleProgram::StyleProgram(Style::FilterMode filterMode, const std::vector<std::shared_ptr<const Rule>>& rules) {
+        for (const std::shared_ptr<const Rule>& rule : rules) {
+            int ruleIdx = static_cast<int>(_ruleCount++);
+
+            const std::shared_ptr<const Filter>& filter = rule->getFilter();
+            switch (filter ? filter->getType() : Filter::Type::FILTER) {
+            case Filter::Type::FILTER: {
+                std::size_t jumpIdx = _instructions.size();
+                if (filterMode == Style::FilterMode::FIRST) {
+                    _instructions.emplace_back(OpCode::JUMP_IF_ANY_MATCH, 0, 0);
+                }
+                int reg = allocateRegister();
+                if (filter && filter->getPredicate()) {
+                    compilePredicate(filter->getPredicate(), reg);
+                }
+                else {
+                    _instructions.emplace_back(OpCode::LOAD_CONST, reg, addConstant(Value(true)));
+                }
+                _instructions.emplace_back(OpCode::MATCH_RULE, reg, ruleIdx);
+                if (filterMode == Style::FilterMode::FIRST) {
+                    _instructions[jumpIdx].b = static_cast<int>(_instructions.size());
+                }
+                break;
+            }
+            case Filter::Type::ELSEFILTER:
+                _instructions.emplace_back(OpCode::MATCH_ELSE, 0, ruleIdx);
+                break;
+            case Filter::Type::ALSOFILTER:
+                _instructions.emplace_back(OpCode::MATCH_ALSO, 0, ruleIdx);
+                break;
+            }
+        }
+    }
+
+    void StyleProgram::execute(const ExpressionContext& context, State& state, std::vector<bool>& ruleMatches) const {
+        std::vector<Value>& regs = state._registers;
+        regs.resize(_registerCount);
+        state._variables.resize(_variableNames.size());
+        state._variablesLoaded.assign(_variableNames.size(), false);
+        ruleMatches.assign(_ruleCount, false);
+
+        bool anyMatch = false;
+        for (std::size_t pc = 0; pc < _instructions.size(); ) {
+            const Instruction& instr = _instructions[pc++];
+            switch (instr.opCode) {
+            case OpCode::LOAD_CONST:
+                regs[instr.a] = _constants[instr.b];
+                break;
+            case OpCode::LOAD_VAR:
+                if (!state._variablesLoaded[instr.b]) {
+                    state._variables[instr.b] = context.getVariable(_variableNames[instr.b]);
+                    state._variablesLoaded[instr.b] = true;
+                }
+                regs[instr.a] = state._variables[instr.b];
+                break;
+            case OpCode::EVAL_EXPR:
+                regs[instr.a] = _expressions[instr.b]->evaluate(context);
+                break;
+            case OpCode::APPLY_UNARY:
+                regs[instr.a] = _unaryOps[instr.b]->apply(regs[instr.c]);
+                break;
+            case OpCode::APPLY_BINARY:
+                regs[instr.a] = _binaryOps[instr.b]->apply(regs[instr.c], regs[instr.d]);
+                break;
+            case OpCode::APPLY_TERTIARY:
+                regs[instr.a] = _tertiaryOps[instr.b]->apply(regs[instr.c], regs[instr.d], regs[instr.e]);
+                break;
+            case OpCode::COMPARE:
+                regs[instr.a] = Value(_comparisonOps[instr.b]->apply(regs[instr.c], regs[instr.d]));
+                break;
+            case OpCode::TO_BOOL:
+                regs[instr.a] = Value(ValueConverter<bool>::convert(regs[instr.b]));
+                break;
+            case OpCode::NOT:
+                regs[instr.a] = Value(!ValueConverter<bool>::convert(regs[instr.a]));
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                if (!ValueConverter<bool>::convert(regs[instr.a])) {
+                    pc = instr.b;
+                }
+                break;
+            case OpCode::JUMP_IF_TRUE:
+                if (ValueConverter<bool>::convert(regs[instr.a])) {
+                    pc = instr.b;
+                }
+                break;
+            case OpCode::JUMP_IF_ANY_MATCH:
+                if (anyMatch) {
+                    pc = instr.b;
+                }
+                break;
+            case OpCode::MATCH_RULE:
+                if (ValueConverter<bool>::convert(regs[instr.a])) {
+                    ruleMatches[instr.b] = true;
+                    anyMatch = true;
+                }
+                break;
+            case OpCode::MATCH_ELSE:
+                ruleMatches[instr.b] = !anyMatch;
+                break;
+            case OpCode::MATCH_ALSO:
+                ruleMatches[instr.b] = anyMatch;
+                break;
+            }
+        }
+    }
+
+    int StyleProgram::allocateRegister() {
+        return _registerCount++;
+    }
+
+    int StyleProgram::addConstant(const Value& value) {
+        auto it = std::find(_constants.begin(), _constants.end(), value);
+        if (it != _constants.end()) {
+            return static_cast<int>(it - _constants.begin());
+        }
+        _constants.push_back(value);
+        return static_cast<int>(_constants.size()) - 1;
+    }
+
+    int StyleProgram::addVariable(const std::string& name) {
+        auto it = _variableMap.find(name);
+        if (it != _variableMap.end()) {
+            return it->second;
+        }
+        int slot = static_cast<int>(_variableNames.size());
+        _variableNames.push_back(name);
+        _variableMap[name] = slot;
+        return slot;
+    }
+
+    void StyleProgram::compilePredicate(const std::shared_ptr<const Predicate>& pred, int reg) {
+        if (isConstant(pred)) {
+            FeatureExpressionContext context;
+            _instructions.emplace_back(OpCode::LOAD_CONST, reg, addConstant(Value(pred->evaluate(context))));
+        }
+        else if (auto compPred = std::dynamic_pointer_cast<const ComparisonPredicate>(pred)) {
+            int reg1 = allocateRegister();
+            int reg2 = allocateRegister();
+            compileExpression(compPred->getExpression1(), reg1);
+            compileExpression(compPred->getExpression2(), reg2);
+            _comparisonOps.push_back(compPred->getOperator());
+            _instructions.emplace_back(OpCode::COMPARE, reg, static_cast<int>(_comparisonOps.size()) - 1, reg1, reg2);
+        }
+        else if (auto exprPred = std::dynamic_pointer_cast<const ExpressionPredicate>(pred)) {
+            int reg1 = allocateRegister();
+            compileExpression(exprPred->getExpression(), reg1);
+            _instructions.emplace_back(OpCode::TO_BOOL, reg, reg1);
+        }
+        else if (auto notPred = std::dynamic_pointer_cast<const NotPredicate>(pred)) {
+            compilePredicate(notPred->getPredicate(), reg);
+            _instructions.emplace_back(OpCode::NOT, reg, 0);
+        }
+        else if (auto andPred = std::dynamic_pointer_cast<const AndPredicate>(pred)) {
+            compilePredicate(andPred->getPredicate1(), reg);
+            std::size_t jumpIdx = _instructions.size();
+            _instructions.emplace_back(OpCode::JUMP_IF_FALSE, reg, 0);
+            compilePredicate(andPred->getPredicate2(), reg);
+            _instructions[jumpIdx].b = static_cast<int>(_instructions.size());
+        }
+        else if (auto orPred = std::dynamic_pointer_cast<const OrPredicate>(pred)) {
+            compilePredicate(orPred->getPredicate1(), reg);
+            std::size_t jumpIdx = _instructions.size();
+            _instructions.emplace_back(OpCode::JUMP_IF_TRUE, reg, 0);
+            compilePredicate(orPred->getPredicate2(), reg);
+            _instructions[jumpIdx].b = static_cast<int>(_instructions.size());
+        }
+        else {
+            _expressions.push_back(std::make_shared<PredicateExpression>(pred));
+            _instructions.emplace_back(OpCode::EVAL_EXPR, reg, static_cast<int>(_expressions.size()) - 1);
+        }
+    }
+
+    void StyleProgram::compileExpression(const std::shared_ptr<const Expression>& expr, int reg) {
+        if (auto constExpr = std::dynamic_pointer_cast<const ConstExpression>(expr)) {
+            _instructions.emplace_back(OpCode::LOAD_CONST, reg, addConstant(constExpr->getConstant()));
+        }
+        else if (isConstant(expr)) {
+            FeatureExpressionContext context;
+            _instructions.emplace_back(OpCode::LOAD_CONST, reg, addConstant(expr->evaluate(context)));
+        }
+        else if (auto varExpr = std::dynamic_pointer_cast<const VariableExpression>(expr)) {
+            if (isConstant(varExpr->getVariableExpression())) {
+                FeatureExpressionContext context;
+                _instructions.emplace_back(OpCode::LOAD_VAR, reg, addVariable(varExpr->getVariableName(context)));
+            }
+            else {
+                _expressions.push_back(expr);
+                _instructions.emplace_back(OpCode::EVAL_EXPR, reg, static_cast<int>(_expressions.size()) - 1);
+            }
+        }
+        else if (auto predExpr = std::dynamic_pointer_cast<const PredicateExpression>(expr)) {
+            compilePredicate(predExpr->getPredicate(), reg);
+        }
+        else if (auto unaryExpr = std::dynamic_pointer_cast<const UnaryExpression>(expr)) {
+            int reg1 = allocateRegister();
+            compileExpression(unaryExpr->getExpression(), reg1);
+            _unaryOps.push_back(unaryExpr->getOperator());
+            _instructions.emplace_back(OpCode::APPLY_UNARY, reg, static_cast<int>(_unaryOps.size()) - 1, reg1);
+        }
+        else if (auto binaryExpr = std::dynamic_pointer_cast<const BinaryExpression>(expr)) {
+            int reg1 = allocateRegister();
+            int reg2 = allocateRegister();
+            compileExpression(binaryExpr->getExpression1(), reg1);
+            compileExpression(binaryExpr->getExpression2(), reg2);
+            _binaryOps.push_back(binaryExpr->getOperator());
+            _instructions.emplace_back(OpCode::APPLY_BINARY, reg, static_cast<int>(_binaryOps.size()) - 1, reg1, reg2);
+        }
+        else if (auto tertiaryExpr = std::dynamic_pointer_cast<const TertiaryExpression>(expr)) {
+            int reg1 = allocateRegister();
+            int reg2 = allocateRegister();
+            int reg3 = allocateRegister();
+            compileExpression(tertiaryExpr->getExpression1(), reg1);
+            compileExpression(tertiaryExpr->getExpression2(), reg2);
+            compileExpression(tertiaryExpr->getExpression3(), reg3);
+            _tertiaryOps.push_back(tertiaryExpr->getOperator());
+            _instructions.emplace_back(OpCode::APPLY_TERTIARY, reg, static_cast<int>(_tertiaryOps.size()) - 1, reg1, reg2, reg3);
+        }
+        else {
+            _expressions.push_back(expr);
+            _instructions.emplace_back(OpCode::EVAL_EXPR, reg, static_cast<int>(_expressions.size()) - 1);
+        }
+    }
+
+    bool StyleProgram::isConstant(const std::shared_ptr<const Predicate>& pred) {
+        bool constant = true;
+        pred->fold([&constant](const std::shared_ptr<const Expression>& expr) {
+            if (std::dynamic_pointer_cast<const VariableExpression>(expr) || std::dynamic_pointer_cast<const InterpolateExpression>(expr)) {
+                constant = false;
+            }
+        });
+        return constant;
+    }
+
+    bool StyleProgram::isConstant(const std::shared_ptr<const Expression>& expr) {
+        bool constant = true;
+        expr->fold([&constant](const std::shared_ptr<const Expression>& expr) {
+            if (std::dynamic_pointer_cast<const VariableExpression>(expr) || std::dynamic_pointer_cast<const InterpolateExpression>(expr)) {
+                constant = false;
+            }
+        });
+        return constant;
+    }
+} }
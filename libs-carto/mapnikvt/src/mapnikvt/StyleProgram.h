@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_MAPNIKVT_STYLEPROGRAM_H_
+#define _CARTO_MAPNIKVT_STYLEPROGRAM_H_
+
+#include "Value.h"
+#include "Expression.h"
+#include "Predicate.h"
+#include "ExpressionContext.h"
+#include "Style.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace carto { namespace mvt {
+    class Rule;
+
+    // Flat register-based bytecode for the rule filters of a style at a given zoom level.
+    // Constant subexpressions are folded at compile time and each referenced variable is
+    // resolved at most once per execution.
+    class StyleProgram final {
+    public:
+        class State final {
+        public:
+            State() = default;
+
+        private:
+            friend class StyleProgram;
+
+            std::vector<Value> _registers;
+            std::vector<Value> _variables;
+            std::vector<bool> _variablesLoaded;
+        };
+
+        explicit StyleProgram(Style::FilterMode filterMode, const std::vector<std::shared_ptr<const Rule>>& rules);
+
+        const std::vector<std::string>& getVariableNames() const { return _variableNames; }
+
+        void execute(const ExpressionContext& context, State& state, std::vector<bool>& ruleMatches) const;
+
+    private:
+        enum class OpCode {
+            LOAD_CONST,        // reg[a] = const[b]
+            LOAD_VAR,          // reg[a] = var[b]
+            EVAL_EXPR,         // reg[a] = expr[b]->evaluate()
+            APPLY_UNARY,       // reg[a] = unaryOp[b](reg[c])
+            APPLY_BINARY,      // reg[a] = binaryOp[b](reg[c], reg[d])
+            APPLY_TERTIARY,    // reg[a] = tertiaryOp[b](reg[c], reg[d], reg[e])
+            COMPARE,           // reg[a] = comparisonOp[b](reg[c], reg[d])
+            TO_BOOL,           // reg[a] = bool(reg[b])
+            NOT,               // reg[a] = !reg[a]
+            JUMP_IF_FALSE,     // if (!reg[a]) goto b
+            JUMP_IF_TRUE,      // if (reg[a]) goto b
+            JUMP_IF_ANY_MATCH, // if (anyMatch) goto b
+            MATCH_RULE,        // match[b] = reg[a], anyMatch |= reg[a]
+            MATCH_ELSE,        // match[b] = !anyMatch
+            MATCH_ALSO         // match[b] = anyMatch
+        };
+
+        struct Instruction {
+            OpCode opCode;
+            int a;
+            int b;
+            int c;
+            int d;
+            int e;
+
+            explicit Instruction(OpCode opCode, int a, int b, int c = 0, int d = 0, int e = 0) : opCode(opCode), a(a), b(b), c(c), d(d), e(e) { }
+        };
+
+        int allocateRegister();
+        int addConstant(const Value& value);
+        int addVariable(const std::string& name);
+
+        void compilePredicate(const std::shared_ptr<const Predicate>& pred, int reg);
+        void compileExpression(const std::shared_ptr<const Expression>& expr, int reg);
+
+        static bool isConstant(const std::shared_ptr<const Predicate>& pred);
+        static bool isConstant(const std::shared_ptr<const Expression>& expr);
+
+        std::vector<Instruction> _instructions;
+        std::vector<Value> _constants;
+        std::vector<std::string> _variableNames;
+        std::map<std::string, int> _variableMap;
+        std::vector<std::shared_ptr<const Expression>> _expressions;
+        std::vector<std::shared_ptr<const UnaryExpression::Operator>> _unaryOps;
+        std::vector<std::shared_ptr<const BinaryExpression::Operator>> _binaryOps;
+        std::vector<std::shared_ptr<const TertiaryExpression::Operator>> _tertiaryOps;
+        std::vector<std::shared_ptr<const ComparisonPredicate::Operator>> _comparisonOps;
+        int _registerCount = 0;
+        std::size_t _ruleCount = 0;
+    };
+} }
+
+#endif
@@ -5,62 +5,142 @@
 #include "Expression.h"
 #include "ExpressionContext.h"
 #include "Rule.h"
-#include "Filter.h"
 #include "Map.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 
 namespace carto { namespace mvt {
     TileReader::TileReader(std::shared_ptr<const Map> map, const SymbolizerContext& symbolizerContext) :
-        _map(std::move(map)), _symbolizerContext(symbolizerContext), _trueFilter(std::make_shared<Filter>(Filter::Type::FILTER, std::make_shared<ConstPredicate>(true)))
+        _map(std::move(map)), _symbolizerContext(symbolizerContext)
     {
     }
 
+    void TileReader::setWorkerPool(std::shared_ptr<WorkerPool> workerPool) {
+        _workerPool = std::move(workerPool);
+    }
+
     std::shared_ptr<vt::Tile> TileReader::readTile(const vt::TileId& tileId) const {
         FeatureExpressionContext exprContext;
         exprContext.setZoom(tileId.zoom + static_cast<int>(_symbolizerContext.getSettings().getZoomLevelBias()));
         exprContext.setNutiParameterValueMap(_symbolizerContext.getSettings().getNutiParameterValueMap());
-        vt::TileLayerBuilder tileLayerBuilder(tileId, _symbolizerContext.getSettings().getTileSize(), _symbolizerContext.getSettings().getGeometryScale());
 
-        std::vector<std::shared_ptr<vt::TileLayer>> tileLayers;
-        int layerIdx = 0;
-        for (const std::shared_ptr<Layer>& layer : _map->getLayers()) {
-            int styleIdx = 0;
-            for (const std::string& styleName : layer->getStyleNames()) {
-                const std::shared_ptr<Style>& style = _map->getStyle(styleName);
-                if (!style) {
-                    continue;
+        const std::vector<std::shared_ptr<Layer>>& layers = _map->getLayers();
+        std::vector<std::vector<std::shared_ptr<vt::TileLayer>>> layerTileLayers(layers.size());
+        if (_workerPool && _workerPool->getThreadCount() > 0 && layers.size() > 1) {
+            // Each worker claims the next unbuilt layer and uses its own builder and expression context.
+            // The calling thread participates too, so progress is guaranteed even if the pool is busy.
+            // The caller waits only for the claimed layers, helpers that start later find no layers left and
+            // exit without touching anything but the shared state, so they are not waited for.
+            struct SharedState {
+                std::atomic<std::size_t> nextLayerIdx;
+                std::size_t completedLayerCount;
+                std::vector<std::vector<std::shared_ptr<vt::TileLayer>>> layerTileLayers;
+                std::vector<std::exception_ptr> exceptions;
+                std::mutex mutex;
+                std::condition_variable condition;
+
+                explicit SharedState(std::size_t layerCount) : nextLayerIdx(0), completedLayerCount(0), layerTileLayers(layerCount), exceptions(layerCount), mutex(), condition() { }
+            };
+            auto state = std::make_shared<SharedState>(layers.size());
+            auto worker = [state, &layers, &tileId, &exprContext, this]() {
+                std::size_t layerCount = state->layerTileLayers.size();
+                std::size_t i = state->nextLayerIdx++;
+                if (i >= layerCount) {
+                    return;
                 }
-                
-                processLayer(layer, style, exprContext, tileLayerBuilder);
 
-                boost::optional<vt::CompOp> compOp;
-                try {
-                    if (!style->getCompOp().empty()) {
-                        compOp = parseCompOp(style->getCompOp());
+                // Stack data of the caller stays valid until the claimed layer is completed
+                FeatureExpressionContext workerExprContext(exprContext);
+                vt::TileLayerBuilder tileLayerBuilder(tileId, _symbolizerContext.getSettings().getTileSize(), _symbolizerContext.getSettings().getGeometryScale());
+                for (; i < layerCount; i = state->nextLayerIdx++) {
+                    try {
+                        buildLayer(static_cast<int>(i), layers[i], workerExprContext, tileLayerBuilder, state->layerTileLayers[i]);
+                    }
+                    catch (...) {
+                        state->exceptions[i] = std::current_exception();
+                    }
+
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (++state->completedLayerCount == layerCount) {
+                        state->condition.notify_all();
                     }
                 }
-                catch (const ParserException&) {
-                    // ignore the error
-                }
-                
-                float opacity = style->getOpacity();
-                std::shared_ptr<vt::FloatFunction> opacityFn = std::make_shared<vt::FloatFunction>([opacity](const vt::ViewState& viewState) { return opacity; });
-
-                int internalIdx = layerIdx * 65536 + static_cast<int>(layer->getStyleNames().size()) * 256 + styleIdx;
-                std::shared_ptr<vt::TileLayer> tileLayer = tileLayerBuilder.build(getLayerName(layer), internalIdx, opacityFn, compOp);
-                if (!(tileLayer->getBitmaps().empty() && tileLayer->getLabels().empty() && tileLayer->getGeometries().empty() && !compOp)) {
-                    tileLayers.push_back(tileLayer);
+            };
+
+            std::size_t helperCount = std::min(layers.size() - 1, static_cast<std::size_t>(_workerPool->getThreadCount()));
+            for (std::size_t i = 0; i < helperCount; i++) {
+                _workerPool->submit(worker);
+            }
+            worker();
+            {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                state->condition.wait(lock, [&state]() { return state->completedLayerCount == state->layerTileLayers.size(); });
+            }
+
+            for (const std::exception_ptr& exception : state->exceptions) {
+                if (exception) {
+                    std::rethrow_exception(exception);
                 }
-                styleIdx++;
             }
-            layerIdx++;
+            layerTileLayers.swap(state->layerTileLayers);
+        }
+        else {
+            vt::TileLayerBuilder tileLayerBuilder(tileId, _symbolizerContext.getSettings().getTileSize(), _symbolizerContext.getSettings().getGeometryScale());
+            for (std::size_t i = 0; i < layers.size(); i++) {
+                buildLayer(static_cast<int>(i), layers[i], exprContext, tileLayerBuilder, layerTileLayers[i]);
+            }
+        }
+
+        std::vector<std::shared_ptr<vt::TileLayer>> tileLayers;
+        for (const std::vector<std::shared_ptr<vt::TileLayer>>& layerTiles : layerTileLayers) {
+            tileLayers.insert(tileLayers.end(), layerTiles.begin(), layerTiles.end());
         }
         return std::make_shared<vt::Tile>(tileId, tileLayers);
     }
 
+    void TileReader::buildLayer(int layerIdx, const std::shared_ptr<const Layer>& layer, FeatureExpressionContext& exprContext, vt::TileLayerBuilder& layerBuilder, std::vector<std::shared_ptr<vt::TileLayer>>& tileLayers) const {
+        int styleIdx = 0;
+        for (const std::string& styleName : layer->getStyleNames()) {
+            const std::shared_ptr<Style>& style = _map->getStyle(styleName);
+            if (!style) {
+                continue;
+            }
+            
+            processLayer(layer, style, exprContext, layerBuilder);
+
+            boost::optional<vt::CompOp> compOp;
+            try {
+                if (!style->getCompOp().empty()) {
+                    compOp = parseCompOp(style->getCompOp());
+                }
+            }
+            catch (const ParserException&) {
+                // ignore the error
+            }
+            
+            float opacity = style->getOpacity();
+            std::shared_ptr<vt::FloatFunction> opacityFn = std::make_shared<vt::FloatFunction>([opacity](const vt::ViewState& viewState) { return opacity; });
+
+            int internalIdx = layerIdx * 65536 + static_cast<int>(layer->getStyleNames().size()) * 256 + styleIdx;
+            std::shared_ptr<vt::TileLayer> tileLayer = layerBuilder.build(getLayerName(layer), internalIdx, opacityFn, compOp);
+            if (!(tileLayer->getBitmaps().empty() && tileLayer->getLabels().empty() && tileLayer->getGeometries().empty() && !compOp)) {
+                tileLayers.push_back(tileLayer);
+            }
+            styleIdx++;
+        }
+    }
+
     void TileReader::processLayer(const std::shared_ptr<const Layer>& layer, const std::shared_ptr<const Style>& style, FeatureExpressionContext& exprContext, vt::TileLayerBuilder& layerBuilder) const {
         std::shared_ptr<Symbolizer> currentSymbolizer;
         FeatureCollection currentFeatureCollection;
         std::unordered_map<std::shared_ptr<const FeatureData>, std::vector<std::shared_ptr<Symbolizer>>> featureDataSymbolizersMap;
+        StyleProgram::State programState;
+        std::vector<bool> ruleMatches;
         if (auto featureIt = createFeatureIterator(layer, style, exprContext)) {
             for (; featureIt->valid(); featureIt->advance()) {
                 // Cache symbolizer evaluation for each feature data object
@@ -68,7 +148,7 @@ namespace carto { namespace mvt {
                 auto symbolizersIt = featureDataSymbolizersMap.find(featureData);
                 if (symbolizersIt == featureDataSymbolizersMap.end()) {
                     exprContext.setFeatureData(featureData);
-                    std::vector<std::shared_ptr<Symbolizer>> symbolizers = findFeatureSymbolizers(style, exprContext);
+                    std::vector<std::shared_ptr<Symbolizer>> symbolizers = findFeatureSymbolizers(style, exprContext, programState, ruleMatches);
                     symbolizersIt = featureDataSymbolizersMap.emplace(featureData, std::move(symbolizers)).first;
                 }
 
@@ -105,47 +185,19 @@ namespace carto { namespace mvt {
         }
     }
 
-    std::vector<std::shared_ptr<Symbolizer>> TileReader::findFeatureSymbolizers(const std::shared_ptr<const Style>& style, FeatureExpressionContext& exprContext) const {
-        bool anyMatch = false;
+    std::vector<std::shared_ptr<Symbolizer>> TileReader::findFeatureSymbolizers(const std::shared_ptr<const Style>& style, FeatureExpressionContext& exprContext, StyleProgram::State& programState, std::vector<bool>& ruleMatches) const {
         std::vector<std::shared_ptr<Symbolizer>> symbolizers;
-        for (const std::shared_ptr<const Rule>& rule : style->getZoomRules(exprContext.getZoom())) {
-            std::shared_ptr<const Filter> filter = rule->getFilter();
-            if (!filter) {
-                filter = _trueFilter;
-            }
-            
-            // Filter matching logic
-            bool match = true;
-            switch (filter->getType()) {
-            case Filter::Type::FILTER:
-                switch (style->getFilterMode()) {
-                case Style::FilterMode::FIRST:
-                    if (anyMatch) {
-                        match = false;
-                    }
-                    else if (const std::shared_ptr<const Predicate>& pred = filter->getPredicate()) {
-                        match = pred->evaluate(exprContext);
-                    }
-                    break;
-                case Style::FilterMode::ALL:
-                    if (const std::shared_ptr<const Predicate>& pred = filter->getPredicate()) {
-                        match = pred->evaluate(exprContext);
-                    }
-                    break;
-                }
-                anyMatch = anyMatch || match;
-                break;
-            case Filter::Type::ELSEFILTER:
-                match = !anyMatch;
-                break;
-            case Filter::Type::ALSOFILTER:
-                match = anyMatch;
-                break;
-            }
+        const std::shared_ptr<const StyleProgram>& program = style->getZoomProgram(exprContext.getZoom());
+        if (!program) {
+            return symbolizers;
+        }
 
-            // If match, add all rule symbolizers to the symbolizer list
-            if (match) {
-                symbolizers.insert(symbolizers.end(), rule->getSymbolizers().begin(), rule->getSymbolizers().end());
+        // Run the compiled filters, then add symbolizers of all matching rules to the symbolizer list
+        program->execute(exprContext, programState, ruleMatches);
+        const std::vector<std::shared_ptr<const Rule>>& rules = style->getZoomRules(exprContext.getZoom());
+        for (std::size_t i = 0; i < rules.size(); i++) {
+            if (ruleMatches[i]) {
+                symbolizers.insert(symbolizers.end(), rules[i]->getSymbolizers().begin(), rules[i]->getSymbolizers().end());
             }
         }
         return symbolizers;
@@ -8,17 +8,18 @@
 #define _CARTO_MAPNIKVT_TILEREADER_H_
 
 #include "FeatureDecoder.h"
+#include "StyleProgram.h"
 #include "vt/Tile.h"
 #include "vt/TileLayerBuilder.h"
 
 #include <memory>
+#include <vector>
 
 #include <cglib/vec.h>
 #include <cglib/mat.h>
 
 namespace carto { namespace mvt {
     class Map;
-    class Filter;
     class Rule;
     class Expression;
     class FeatureExpressionContext;
@@ -26,19 +27,25 @@ namespace carto { namespace mvt {
     class SymbolizerContext;
     class Layer;
     class Style;
+    class WorkerPool;
     
     class TileReader {
     public:
         virtual ~TileReader() = default;
 
+        // If set, independent map layers are built concurrently on the pool and the calling thread
+        void setWorkerPool(std::shared_ptr<WorkerPool> workerPool);
+
         virtual std::shared_ptr<vt::Tile> readTile(const vt::TileId& tileId) const;
 
     protected:
         explicit TileReader(std::shared_ptr<const Map> map, const SymbolizerContext& symbolizerContext);
 
+        void buildLayer(int layerIdx, const std::shared_ptr<const Layer>& layer, FeatureExpressionContext& exprContext, vt::TileLayerBuilder& layerBuilder, std::vector<std::shared_ptr<vt::TileLayer>>& tileLayers) const;
+
         void processLayer(const std::shared_ptr<const Layer>& layer, const std::shared_ptr<const Style>& style, FeatureExpressionContext& exprContext, vt::TileLayerBuilder& layerBuilder) const;
 
-        std::vector<std::shared_ptr<Symbolizer>> findFeatureSymbolizers(const std::shared_ptr<const Style>& style, FeatureExpressionContext& exprContext) const;
+        std::vector<std::shared_ptr<Symbolizer>> findFeatureSymbolizers(const std::shared_ptr<const Style>& style, FeatureExpressionContext& exprContext, StyleProgram::State& programState, std::vector<bool>& ruleMatches) const;
 
         virtual std::string getLayerName(const std::shared_ptr<const Layer>& layer) const = 0;
         
@@ -46,7 +53,7 @@ namespace carto { namespace mvt {
 
         const std::shared_ptr<const Map> _map;
         const SymbolizerContext& _symbolizerContext;
-        const std::shared_ptr<const Filter> _trueFilter;
+        std::shared_ptr<WorkerPool> _workerPool;
     };
 } }
 
@@ -0,0 +1,49 @@
+#include "WorkerPool.h"
+
+namespace carto { namespace mvt {
+    WorkerPool::WorkerPool(int threadCount) :
+        _stop(false), _tasks(), _threads(), _mutex(), _condition()
+    {
+        for (int i = 0; i < threadCount; i++) {
+            _threads.emplace_back(&WorkerPool::run, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _condition.notify_all();
+        for (std::thread& thread : _threads) {
+            thread.join();
+        }
+    }
+
+    std::future<void> WorkerPool::submit(std::function<void()> task) {
+        std::packaged_task<void()> packagedTask(std::move(task));
+        std::future<void> future = packagedTask.get_future();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push(std::move(packagedTask));
+        }
+        _condition.notify_one();
+        return future;
+    }
+
+    void WorkerPool::run() {
+        while (true) {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this] { return _stop || !_tasks.empty(); });
+                if (_stop && _tasks.empty()) {
+                    return;
+                }
+                task = std::move(_tasks.front());
+                _tasks.pop();
+            }
+            task();
+        }
+    }
+} }
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_MAPNIKVT_WORKERPOOL_H_
+#define _CARTO_MAPNIKVT_WORKERPOOL_H_
+
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <queue>
+#include <vector>
+
+namespace carto { namespace mvt {
+    class WorkerPool final {
+    public:
+        explicit WorkerPool(int threadCount);
+        ~WorkerPool();
+
+        int getThreadCount() const { return static_cast<int>(_threads.size()); }
+
+        std::future<void> submit(std::function<void()> task);
+
+    private:
+        void run();
+
+        bool _stop;
+        std::queue<std::packaged_task<void()>> _tasks;
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+    };
+} }
+
+#endif
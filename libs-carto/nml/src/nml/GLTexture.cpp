@@ -34,6 +34,7 @@
 #endif
 
 #include <cassert>
+#include <algorithm>
 #include <mutex>
 #include <memory>
 #include <string>
@@ -245,6 +246,29 @@ namespace carto { namespace nml {
         updateSampler(texture.has_sampler(), texture.sampler(), texture.mipmaps_size() > 1);
     }
     
+    std::vector<int> GLTexture::getSupportedCompressedFormats() {
+        std::vector<int> formats;
+        if (hasGLExtension("GL_OES_compressed_ETC1_RGB8_texture")) {
+            formats.push_back(Texture::ETC1);
+        }
+        if (hasGLExtension("GL_IMG_texture_compression_pvrtc")) {
+            formats.push_back(Texture::PVRTC);
+        }
+        return formats;
+    }
+
+    bool GLTexture::isUncompressionNeeded(const Texture& texture, const std::vector<int>& supportedCompressedFormats) {
+        switch (texture.format()) {
+        case Texture::ETC1:
+            return std::find(supportedCompressedFormats.begin(), supportedCompressedFormats.end(), Texture::ETC1) == supportedCompressedFormats.end();
+        case Texture::PVRTC:
+            // Non-square PVRTC textures are always uncompressed, see updateMipLevel
+            return std::find(supportedCompressedFormats.begin(), supportedCompressedFormats.end(), Texture::PVRTC) == supportedCompressedFormats.end() || texture.width() != texture.height();
+        default:
+            return false;
+        }
+    }
+    
     void GLTexture::uncompressTexture(Texture& texture) {
         switch (texture.format()) {
         case Texture::ETC1:
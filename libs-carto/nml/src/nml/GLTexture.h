@@ -12,6 +12,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace carto { namespace nml {
     class Texture;
@@ -28,6 +29,8 @@ namespace carto { namespace nml {
 
         int getTextureSize() const;
 
+        static std::vector<int> getSupportedCompressedFormats(); // must be called from GL thread
+        static bool isUncompressionNeeded(const Texture& texture, const std::vector<int>& supportedCompressedFormats);
         static void uncompressTexture(Texture& texture);
 
     private:
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTING_BLOCKCACHE_H_
+#define _CARTO_ROUTING_BLOCKCACHE_H_
+
+#include <memory>
+#include <mutex>
+#include <future>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include <stdext/lru_cache.h>
+
+namespace carto { namespace routing {
+    template <typename Key, typename Block, typename Hash>
+    class BlockCache final {
+    public:
+        using Loader = std::function<std::shared_ptr<Block>(const Key&)>;
+
+        explicit BlockCache(std::size_t capacity) : _shards() {
+            std::size_t shardCount = capacity / MIN_SHARD_CAPACITY;
+            shardCount = (shardCount < 1 ? 1 : (shardCount > MAX_SHARD_COUNT ? MAX_SHARD_COUNT : shardCount));
+            std::size_t shardCapacity = (capacity + shardCount - 1) / shardCount;
+            shardCapacity = (shardCapacity < 1 ? 1 : shardCapacity);
+            for (std::size_t i = 0; i < shardCount; i++) {
+                _shards.emplace_back(new Shard(shardCapacity));
+            }
+        }
+
+        std::shared_ptr<Block> get(const Key& key, const Loader& loader) const {
+            Shard& shard = *_shards[Hash()(key) % _shards.size()];
+
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            std::shared_ptr<Block> block;
+            if (shard.cache.read(key, block)) {
+                return block;
+            }
+
+            // If another thread is already loading the block, wait for it instead of loading it twice
+            auto it = shard.pendingBlocks.find(key);
+            if (it != shard.pendingBlocks.end()) {
+                std::shared_future<std::shared_ptr<Block>> pendingBlock = it->second;
+                lock.unlock();
+                return pendingBlock.get();
+            }
+
+            std::promise<std::shared_ptr<Block>> promise;
+            shard.pendingBlocks[key] = promise.get_future().share();
+            int generation = shard.generation;
+            lock.unlock();
+
+            try {
+                block = loader(key);
+            }
+            catch (...) {
+                lock.lock();
+                shard.pendingBlocks.erase(key);
+                promise.set_exception(std::current_exception());
+                throw;
+            }
+
+            lock.lock();
+            if (shard.generation == generation) {
+                shard.cache.put(key, block);
+            }
+            shard.pendingBlocks.erase(key);
+            promise.set_value(block);
+            return block;
+        }
+
+        void clear() {
+            for (const std::unique_ptr<Shard>& shard : _shards) {
+                std::lock_guard<std::mutex> lock(shard->mutex);
+                shard->cache.clear();
+                shard->generation++;
+            }
+        }
+
+    private:
+        static constexpr std::size_t MAX_SHARD_COUNT = 16;
+        static constexpr std::size_t MIN_SHARD_CAPACITY = 8;
+
+        struct Shard {
+            cache::lru_cache<Key, std::shared_ptr<Block>, Hash> cache;
+            std::unordered_map<Key, std::shared_future<std::shared_ptr<Block>>, Hash> pendingBlocks;
+            int generation = 0;
+            std::mutex mutex;
+
+            explicit Shard(std::size_t capacity) : cache(capacity), pendingBlocks(), generation(0), mutex() { }
+        };
+
+        std::vector<std::unique_ptr<Shard>> _shards;
+    };
+} }
+
+#endif
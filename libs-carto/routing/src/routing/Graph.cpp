@@ -2,6 +2,9 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <initializer_list>
 #include <list>
 #include <queue>
 #include <unordered_set>
@@ -12,13 +15,14 @@
 
 namespace carto { namespace routing {
     Graph::Graph(const Settings& settings) :
-        _packages(),
+        _packages(std::make_shared<std::vector<Package>>()),
         _nodeBlockCache(settings.nodeBlockCacheSize),
         _geometryBlockCache(settings.geometryBlockCacheSize),
         _nameBlockCache(settings.nameBlockCacheSize),
         _globalNodeBlockCache(settings.globalNodeBlockCacheSize),
         _rtreeNodeBlockCache(settings.rtreeNodeBlockCacheSize),
-        _mutex()
+        _memoryMapped(settings.memoryMapped),
+        _importMutex()
     {
     }
     
@@ -32,14 +36,24 @@ namespace carto { namespace routing {
 #else
         file->open(fileName, std::ios::binary);
 #endif
+        if (_memoryMapped) {
+            return import(file, fileName);
+        }
         return import(file);
     }
 
     bool Graph::import(const std::shared_ptr<std::ifstream>& file) {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return import(file, std::string());
+    }
+
+    bool Graph::import(const std::shared_ptr<std::ifstream>& file, const std::string& mappedFileName) {
+        std::lock_guard<std::mutex> lock(_importMutex);
+
+        std::shared_ptr<const std::vector<Package>> packages = getPackages();
 
         Package package;
-        package.packageId = static_cast<int>(_packages.size());
+        package.packageId = static_cast<int>(packages->size());
+        package.fileMutex = std::make_shared<std::mutex>();
         
         auto graphChunk = std::dynamic_pointer_cast<eiff::form_chunk>(eiff::read_chunk(file, true));
         if (!graphChunk) {
@@ -78,7 +92,25 @@ namespace carto { namespace routing {
         if (!package.nodeChunk || !package.geometryChunk || !package.nameChunk || !package.globalNodeChunk || !package.rtreeNodeChunk) {
             throw std::runtime_error("Graph sections missing");
         }
-        _packages.push_back(std::move(package));
+
+        // Map the file, if requested. If the file can not be mapped, the stream is used instead
+        if (!mappedFileName.empty()) {
+            try {
+                package.mappedFile = std::make_shared<MappedFile>(mappedFileName);
+            }
+            catch (const std::exception&) {
+                package.mappedFile.reset();
+            }
+            for (const std::shared_ptr<eiff::data_chunk>& chunk : { package.nodeChunk, package.geometryChunk, package.nameChunk, package.globalNodeChunk, package.rtreeNodeChunk }) {
+                if (package.mappedFile && !mapChunk(package, file, chunk)) {
+                    package.mappedFile.reset();
+                    package.mappedChunkOffsets.clear();
+                }
+            }
+        }
+        auto newPackages = std::make_shared<std::vector<Package>>(*packages);
+        newPackages->push_back(std::move(package));
+        std::atomic_store(&_packages, std::shared_ptr<const std::vector<Package>>(newPackages));
 
         // Invalidate caches whose contents may depend on other packages
         _nodeBlockCache.clear();
@@ -87,37 +119,23 @@ namespace carto { namespace routing {
     }
 
     Graph::NodePtr Graph::getNode(NodeId nodeId) const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-
-        std::shared_ptr<NodeBlock> nodeBlock;
-        if (!_nodeBlockCache.read(nodeId.blockId, nodeBlock)) {
-            nodeBlock = loadNodeBlock(nodeId.blockId);
-            _nodeBlockCache.put(nodeId.blockId, nodeBlock);
-        }
+        std::shared_ptr<NodeBlock> nodeBlock = _nodeBlockCache.get(nodeId.blockId, std::bind(&Graph::loadNodeBlock, this, std::placeholders::_1));
         return NodePtr(nodeBlock, nodeId.elementIndex);
     }
 
-    std::string Graph::getNodeName(const Node& node) const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
+    std::shared_ptr<const Graph::NodeBlock> Graph::getNodeBlock(BlockId blockId) const {
+        return _nodeBlockCache.get(blockId, std::bind(&Graph::loadNodeBlock, this, std::placeholders::_1));
+    }
 
+    std::string Graph::getNodeName(const Node& node) const {
         NameId nameId = node.nodeData.nameId;
-        std::shared_ptr<NameBlock> nameBlock;
-        if (!_nameBlockCache.read(nameId.blockId, nameBlock)) {
-            nameBlock = loadNameBlock(nameId.blockId);
-            _nameBlockCache.put(nameId.blockId, nameBlock);
-        }
+        std::shared_ptr<NameBlock> nameBlock = _nameBlockCache.get(nameId.blockId, std::bind(&Graph::loadNameBlock, this, std::placeholders::_1));
         return nameBlock->names.at(nameId.elementIndex);
     }
 
     std::vector<WGSPos> Graph::getNodeGeometry(const Node& node) const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-
         GeometryId geometryId = node.nodeData.geometryId;
-        std::shared_ptr<GeometryBlock> geometryBlock;
-        if (!_geometryBlockCache.read(geometryId.blockId, geometryBlock)) {
-            geometryBlock = loadGeometryBlock(geometryId.blockId);
-            _geometryBlockCache.put(geometryId.blockId, geometryBlock);
-        }
+        std::shared_ptr<GeometryBlock> geometryBlock = _geometryBlockCache.get(geometryId.blockId, std::bind(&Graph::loadGeometryBlock, this, std::placeholders::_1));
 
         std::vector<WGSPos> geometry;
         geometry.reserve(geometryBlock->geometries.at(geometryId.elementIndex).size());
@@ -133,11 +151,11 @@ namespace carto { namespace routing {
     std::vector<Graph::NearestNode> Graph::findNearestNode(const WGSPos& pos) const {
         static const double DIST_THRESHOLD = 1.01;
         
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        std::shared_ptr<const std::vector<Package>> packages = getPackages();
 
         // First build a priority queue of the packages, based on distance from package bounding box
         std::priority_queue<SearchRTreeNode> searchRTreeNodeQueue;
-        for (const Package& package : _packages) {
+        for (const Package& package : *packages) {
             double dist = getBBoxDistance(pos, package.bbox);
             searchRTreeNodeQueue.emplace(RTreeNodeId(BlockId(package.packageId, 0), 0), dist);
         }
@@ -165,21 +183,17 @@ namespace carto { namespace routing {
                 }
 
                 BlockId blockId = nodeBlockId.second;
-                std::shared_ptr<NodeBlock> nodeBlock;
-                if (!_nodeBlockCache.read(blockId, nodeBlock)) {
-                    nodeBlock = loadNodeBlock(blockId);
-                    _nodeBlockCache.put(blockId, nodeBlock);
-                }
+                std::shared_ptr<NodeBlock> nodeBlock = _nodeBlockCache.get(blockId, std::bind(&Graph::loadNodeBlock, this, std::placeholders::_1));
 
-                // Fill bounds cache for the node block, if not yet created
-                if (nodeBlock->nodeGeometryBoundsCache.empty()) {
+                // Fill bounds cache for the node block, if not yet created. Other threads may be searching the same block
+                std::call_once(nodeBlock->nodeGeometryBoundsCacheFlag, [this, &nodeBlock]() {
                     nodeBlock->nodeGeometryBoundsCache.reserve(nodeBlock->nodes.size());
                     for (unsigned int i = 0; i < nodeBlock->nodes.size(); i++) {
                         const Node& node = nodeBlock->nodes[i];
                         std::vector<WGSPos> geometry = getNodeGeometry(node);
                         nodeBlock->nodeGeometryBoundsCache.push_back(WGSBounds::make_union(geometry.begin(), geometry.end()));
                     }
-                }
+                });
 
                 // Build priority queue of the nodes within the block, using distance to geometry bounding box
                 std::priority_queue<SearchGeometry> searchGeometryQueue;
@@ -229,19 +243,70 @@ namespace carto { namespace routing {
         return bestNodes;
     }
     
+    std::shared_ptr<const std::vector<Graph::Package>> Graph::getPackages() const {
+        return std::atomic_load(&_packages);
+    }
+
+    bool Graph::mapChunk(Package& package, const std::shared_ptr<std::ifstream>& file, const std::shared_ptr<eiff::data_chunk>& chunk) {
+        // Locate the chunk data within the file by reading its header and the offsets of the first block through the stream.
+        // The EIFF reader does not expose chunk offsets, but chunk data is stored contiguously, so the stream position after the read
+        // gives the chunk offset. The offset is verified by comparing the data read against the mapped data.
+        try {
+            std::vector<unsigned char> header;
+            chunk->read(header, 0, sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t));
+            std::streamoff pos = file->tellg();
+            if (pos < static_cast<std::streamoff>(header.size()) || header.size() != sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t)) {
+                return false;
+            }
+            std::uint64_t chunkOffset = static_cast<std::uint64_t>(pos) - header.size();
+            if (chunkOffset + header.size() > package.mappedFile->size() || !std::equal(header.begin(), header.end(), package.mappedFile->data() + chunkOffset)) {
+                return false;
+            }
+
+            // The first block must be within the mapped file, too
+            std::uint64_t blockOffsets[2];
+            std::memcpy(&blockOffsets[0], header.data() + sizeof(std::uint32_t), sizeof(blockOffsets)); // offsets are not aligned in the header
+            if (blockOffsets[0] > blockOffsets[1] || chunkOffset + blockOffsets[1] > package.mappedFile->size()) {
+                return false;
+            }
+            package.mappedChunkOffsets[chunk.get()] = chunkOffset;
+            return true;
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    void Graph::readChunk(const Package& package, const std::shared_ptr<eiff::data_chunk>& chunk, std::vector<unsigned char>& data, std::uint64_t offset, std::uint64_t size) {
+        if (package.mappedFile) {
+            // Copy directly from the mapping, no locking needed
+            std::uint64_t chunkOffset = package.mappedChunkOffsets.at(chunk.get());
+            if (chunkOffset + offset + size > package.mappedFile->size()) {
+                throw std::runtime_error("Graph block outside of mapped file");
+            }
+            const unsigned char* blockData = package.mappedFile->data() + chunkOffset + offset;
+            data.assign(blockData, blockData + size);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(*package.fileMutex);
+        chunk->read(data, offset, size);
+    }
+
     std::shared_ptr<Graph::NodeBlock> Graph::loadNodeBlock(BlockId blockId) const {
         if (blockId.packageId == -1) {
             throw std::runtime_error("Bad package id");
         }
 
-        const Package& package = _packages.at(blockId.packageId);
+        std::shared_ptr<const std::vector<Package>> packages = getPackages();
+        const Package& package = packages->at(blockId.packageId);
 
         std::vector<unsigned char> blockOffsetData(2 * sizeof(std::uint64_t));
-        package.nodeChunk->read(blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
+        readChunk(package, package.nodeChunk, blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
         const std::uint64_t* blockOffsets = reinterpret_cast<std::uint64_t*>(blockOffsetData.data());
 
         std::vector<unsigned char> block;
-        package.nodeChunk->read(block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
+        readChunk(package, package.nodeChunk, block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
 
         bitstreams::input_bitstream bs(std::move(block));
 
@@ -371,14 +436,15 @@ namespace carto { namespace routing {
             throw std::runtime_error("Bad package id");
         }
 
-        const Package& package = _packages.at(blockId.packageId);
+        std::shared_ptr<const std::vector<Package>> packages = getPackages();
+        const Package& package = packages->at(blockId.packageId);
 
         std::vector<unsigned char> blockOffsetData(2 * sizeof(std::uint64_t));
-        package.geometryChunk->read(blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
+        readChunk(package, package.geometryChunk, blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
         const std::uint64_t* blockOffsets = reinterpret_cast<std::uint64_t*>(blockOffsetData.data());
 
         std::vector<unsigned char> block;
-        package.geometryChunk->read(block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
+        readChunk(package, package.geometryChunk, block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
 
         bitstreams::input_bitstream bs(std::move(block));
 
@@ -421,14 +487,15 @@ namespace carto { namespace routing {
             throw std::runtime_error("Bad package id");
         }
 
-        const Package& package = _packages.at(blockId.packageId);
+        std::shared_ptr<const std::vector<Package>> packages = getPackages();
+        const Package& package = packages->at(blockId.packageId);
 
         std::vector<unsigned char> blockOffsetData(2 * sizeof(std::uint64_t));
-        package.nameChunk->read(blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
+        readChunk(package, package.nameChunk, blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
         const std::uint64_t* blockOffsets = reinterpret_cast<std::uint64_t*>(blockOffsetData.data());
 
         std::vector<unsigned char> block;
-        package.nameChunk->read(block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
+        readChunk(package, package.nameChunk, block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
 
         bitstreams::input_bitstream bs(std::move(block));
 
@@ -458,14 +525,15 @@ namespace carto { namespace routing {
             throw std::runtime_error("Bad package id");
         }
         
-        const Package& package = _packages.at(blockId.packageId);
+        std::shared_ptr<const std::vector<Package>> packages = getPackages();
+        const Package& package = packages->at(blockId.packageId);
         
         std::vector<unsigned char> blockOffsetData(2 * sizeof(std::uint64_t));
-        package.globalNodeChunk->read(blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
+        readChunk(package, package.globalNodeChunk, blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
         const std::uint64_t* blockOffsets = reinterpret_cast<std::uint64_t*>(blockOffsetData.data());
         
         std::vector<unsigned char> block;
-        package.globalNodeChunk->read(block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
+        readChunk(package, package.globalNodeChunk, block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
         
         bitstreams::input_bitstream bs(std::move(block));
         
@@ -487,7 +555,7 @@ namespace carto { namespace routing {
                 packageName.append(1, bs.read_bits<char>(8));
             }
             int packageId = -1;
-            for (const Package& package : _packages) {
+            for (const Package& package : *packages) {
                 if (package.packageName == packageName) {
                     packageId = package.packageId;
                     break;
@@ -520,14 +588,15 @@ namespace carto { namespace routing {
             throw std::runtime_error("Bad package id");
         }
         
-        const Package& package = _packages.at(blockId.packageId);
+        std::shared_ptr<const std::vector<Package>> packages = getPackages();
+        const Package& package = packages->at(blockId.packageId);
 
         std::vector<unsigned char> blockOffsetData(2 * sizeof(std::uint64_t));
-        package.rtreeNodeChunk->read(blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
+        readChunk(package, package.rtreeNodeChunk, blockOffsetData, sizeof(std::uint32_t) + blockId.blockIndex * sizeof(std::uint64_t), blockOffsetData.size());
         const std::uint64_t* blockOffsets = reinterpret_cast<std::uint64_t*>(blockOffsetData.data());
         
         std::vector<unsigned char> block;
-        package.rtreeNodeChunk->read(block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
+        readChunk(package, package.rtreeNodeChunk, block, blockOffsets[0], blockOffsets[1] - blockOffsets[0]);
         
         bitstreams::input_bitstream bs(std::move(block));
         
@@ -580,20 +649,12 @@ namespace carto { namespace routing {
     }
     
     Graph::NodeId Graph::resolveGlobalNodeId(GlobalNodeId globalNodeId) const {
-        std::shared_ptr<GlobalNodeBlock> globalNodeBlock;
-        if (!_globalNodeBlockCache.read(globalNodeId.blockId, globalNodeBlock)) {
-            globalNodeBlock = loadGlobalNodeBlock(globalNodeId.blockId);
-            _globalNodeBlockCache.put(globalNodeId.blockId, globalNodeBlock);
-        }
+        std::shared_ptr<GlobalNodeBlock> globalNodeBlock = _globalNodeBlockCache.get(globalNodeId.blockId, std::bind(&Graph::loadGlobalNodeBlock, this, std::placeholders::_1));
         return globalNodeBlock->globalNodeIds.at(globalNodeId.elementIndex);
     }
 
     Graph::RTreeNode Graph::loadRTreeNode(RTreeNodeId rtreeNodeId) const {
-        std::shared_ptr<RTreeNodeBlock> rtreeNodeBlock;
-        if (!_rtreeNodeBlockCache.read(rtreeNodeId.blockId, rtreeNodeBlock)) {
-            rtreeNodeBlock = loadRTreeNodeBlock(rtreeNodeId.blockId);
-            _rtreeNodeBlockCache.put(rtreeNodeId.blockId, rtreeNodeBlock);
-        }
+        std::shared_ptr<RTreeNodeBlock> rtreeNodeBlock = _rtreeNodeBlockCache.get(rtreeNodeId.blockId, std::bind(&Graph::loadRTreeNodeBlock, this, std::placeholders::_1));
         return rtreeNodeBlock->rtreeNodes.at(rtreeNodeId.elementIndex);
     }
     
@@ -8,7 +8,10 @@
 #define _CARTO_ROUTING_GRAPH_H_
 
 #include "Base.h"
+#include "BlockCache.h"
+#include "MappedFile.h"
 
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <array>
@@ -16,8 +19,8 @@
 #include <fstream>
 #include <utility>
 #include <functional>
+#include <unordered_map>
 
-#include <stdext/lru_cache.h>
 #include <stdext/eiff_file.h>
 #include <stdext/bitstream.h>
 
@@ -125,6 +128,7 @@ namespace carto { namespace routing {
             std::vector<Node> nodes;
             std::vector<Edge> edges;
             std::vector<WGSBounds> nodeGeometryBoundsCache;
+            std::once_flag nodeGeometryBoundsCacheFlag;
 
             NodeBlock() = default;
         };
@@ -168,6 +172,7 @@ namespace carto { namespace routing {
             std::size_t nameBlockCacheSize = 64;
             std::size_t globalNodeBlockCacheSize = 64;
             std::size_t rtreeNodeBlockCacheSize = 16;
+            bool memoryMapped = false; // map package files into memory instead of reading blocks through file streams
 
             Settings() = default;
         };
@@ -177,8 +182,10 @@ namespace carto { namespace routing {
         
         bool import(const std::string& fileName);
         bool import(const std::shared_ptr<std::ifstream>& file);
+        bool import(const std::shared_ptr<std::ifstream>& file, const std::string& mappedFileName);
 
         NodePtr getNode(NodeId nodeId) const;
+        std::shared_ptr<const NodeBlock> getNodeBlock(BlockId blockId) const;
         std::string getNodeName(const Node& node) const;
         std::vector<WGSPos> getNodeGeometry(const Node& node) const;
         std::vector<NearestNode> findNearestNode(const WGSPos& pos) const;
@@ -197,6 +204,9 @@ namespace carto { namespace routing {
             std::shared_ptr<eiff::data_chunk> nameChunk;
             std::shared_ptr<eiff::data_chunk> globalNodeChunk;
             std::shared_ptr<eiff::data_chunk> rtreeNodeChunk;
+            std::shared_ptr<std::mutex> fileMutex; // serializes chunk reads, as all chunks share the same stream
+            std::shared_ptr<MappedFile> mappedFile;
+            std::unordered_map<const eiff::data_chunk*, std::uint64_t> mappedChunkOffsets;
             
             Package() = default;
         };
@@ -225,6 +235,12 @@ namespace carto { namespace routing {
             }
         };
         
+        std::shared_ptr<const std::vector<Package>> getPackages() const;
+
+        static bool mapChunk(Package& package, const std::shared_ptr<std::ifstream>& file, const std::shared_ptr<eiff::data_chunk>& chunk);
+
+        static void readChunk(const Package& package, const std::shared_ptr<eiff::data_chunk>& chunk, std::vector<unsigned char>& data, std::uint64_t offset, std::uint64_t size);
+
         std::shared_ptr<NodeBlock> loadNodeBlock(BlockId blockId) const;
 
         std::shared_ptr<GeometryBlock> loadGeometryBlock(BlockId blockId) const;
@@ -250,14 +266,15 @@ namespace carto { namespace routing {
         static WGSPos fromPoint(const Point& point);
         static Point toPoint(const WGSPos& pos);
 
-        std::vector<Package> _packages;
+        std::shared_ptr<const std::vector<Package>> _packages; // immutable snapshot, replaced on import
 
-        mutable cache::lru_cache<BlockId, std::shared_ptr<NodeBlock>, BlockId::Hash> _nodeBlockCache;
-        mutable cache::lru_cache<BlockId, std::shared_ptr<GeometryBlock>, BlockId::Hash> _geometryBlockCache;
-        mutable cache::lru_cache<BlockId, std::shared_ptr<NameBlock>, BlockId::Hash> _nameBlockCache;
-        mutable cache::lru_cache<BlockId, std::shared_ptr<GlobalNodeBlock>, BlockId::Hash> _globalNodeBlockCache;
-        mutable cache::lru_cache<BlockId, std::shared_ptr<RTreeNodeBlock>, BlockId::Hash> _rtreeNodeBlockCache;
-        mutable std::recursive_mutex _mutex;
+        BlockCache<BlockId, NodeBlock, BlockId::Hash> _nodeBlockCache;
+        BlockCache<BlockId, GeometryBlock, BlockId::Hash> _geometryBlockCache;
+        BlockCache<BlockId, NameBlock, BlockId::Hash> _nameBlockCache;
+        BlockCache<BlockId, GlobalNodeBlock, BlockId::Hash> _globalNodeBlockCache;
+        BlockCache<BlockId, RTreeNodeBlock, BlockId::Hash> _rtreeNodeBlockCache;
+        const bool _memoryMapped;
+        std::mutex _importMutex;
     };
 } }
 
@@ -0,0 +1,43 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace carto { namespace routing {
+    MappedFile::MappedFile(const std::string& fileName) {
+#ifdef _WIN32
+        throw std::runtime_error("Memory mapped files not supported");
+#else
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open file for mapping");
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to get size of mapped file");
+        }
+        void* data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping stays valid after closing the descriptor
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Failed to map file");
+        }
+        _data = static_cast<const unsigned char*>(data);
+        _size = static_cast<std::uint64_t>(st.st_size);
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+#ifndef _WIN32
+        if (_data) {
+            ::munmap(const_cast<unsigned char*>(_data), static_cast<std::size_t>(_size));
+        }
+#endif
+    }
+} }
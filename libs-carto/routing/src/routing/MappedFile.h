@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTING_MAPPEDFILE_H_
+#define _CARTO_ROUTING_MAPPEDFILE_H_
+
+#include <cstdint>
+#include <string>
+
+namespace carto { namespace routing {
+    class MappedFile final {
+    public:
+        MappedFile() = delete;
+        explicit MappedFile(const std::string& fileName);
+        MappedFile(const MappedFile&) = delete;
+        ~MappedFile();
+
+        const unsigned char* data() const { return _data; }
+        std::uint64_t size() const { return _size; }
+
+        MappedFile& operator = (const MappedFile&) = delete;
+
+    private:
+        const unsigned char* _data = nullptr;
+        std::uint64_t _size = 0;
+    };
+} }
+
+#endif
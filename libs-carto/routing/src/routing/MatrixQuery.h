@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTING_MATRIXQUERY_H_
+#define _CARTO_ROUTING_MATRIXQUERY_H_
+
+#include "Base.h"
+
+#include <vector>
+
+namespace carto { namespace routing {
+    class MatrixQuery final {
+    public:
+        MatrixQuery() = delete;
+        explicit MatrixQuery(std::vector<WGSPos> sources, std::vector<WGSPos> targets) : _sources(std::move(sources)), _targets(std::move(targets)) { }
+
+        const std::vector<WGSPos>& getSources() const {
+            return _sources;
+        }
+
+        const std::vector<WGSPos>& getTargets() const {
+            return _targets;
+        }
+
+    private:
+        std::vector<WGSPos> _sources;
+        std::vector<WGSPos> _targets;
+    };
+} }
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTING_MATRIXRESULT_H_
+#define _CARTO_ROUTING_MATRIXRESULT_H_
+
+#include "Base.h"
+
+#include <vector>
+#include <limits>
+
+namespace carto { namespace routing {
+    class MatrixResult final {
+    public:
+        MatrixResult() = default;
+        explicit MatrixResult(std::size_t sourceCount, std::size_t targetCount) : _sourceCount(sourceCount), _targetCount(targetCount), _times(sourceCount * targetCount, std::numeric_limits<double>::infinity()) { }
+
+        std::size_t getSourceCount() const {
+            return _sourceCount;
+        }
+
+        std::size_t getTargetCount() const {
+            return _targetCount;
+        }
+
+        double getTime(std::size_t sourceIndex, std::size_t targetIndex) const {
+            return _times.at(sourceIndex * _targetCount + targetIndex);
+        }
+
+        void setTime(std::size_t sourceIndex, std::size_t targetIndex, double time) {
+            _times.at(sourceIndex * _targetCount + targetIndex) = time;
+        }
+
+    private:
+        std::size_t _sourceCount = 0;
+        std::size_t _targetCount = 0;
+        std::vector<double> _times; // infinity if target is not reachable from source
+    };
+} }
+
+#endif
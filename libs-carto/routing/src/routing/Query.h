@@ -9,20 +9,25 @@
 
 #include "Base.h"
 
-#include <array>
+#include <vector>
 
 namespace carto { namespace routing {
     class Query final {
     public:
         Query() = delete;
-        explicit Query(const WGSPos& pos0, const WGSPos& pos1) : _points {{ pos0, pos1 }} { }
+        explicit Query(const WGSPos& pos0, const WGSPos& pos1) : _points { pos0, pos1 } { }
+        explicit Query(std::vector<WGSPos> points) : _points(std::move(points)) { }
+
+        int getPosCount() const {
+            return static_cast<int>(_points.size());
+        }
 
         WGSPos getPos(int index) const {
             return _points[index];
         }
 
     private:
-        std::array<WGSPos, 2> _points;
+        std::vector<WGSPos> _points;
     };
 } }
 
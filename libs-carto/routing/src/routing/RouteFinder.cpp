@@ -1,106 +1,319 @@
 #include "RouteFinder.h"
+#include "SearchWorkspace.h"
+
+#include <atomic>
+#include <algorithm>
+#include <unordered_set>
+#include <thread>
+#include <exception>
 
 #include <boost/math/constants/constants.hpp>
 
 namespace carto { namespace routing {
+    RouteFinder::RouteFinder(std::shared_ptr<Graph> graph) :
+        _graph(std::move(graph)),
+        _workspacePool(),
+        _workspacePoolMutex()
+    {
+    }
+
+    RouteFinder::~RouteFinder() {
+    }
+
     Result RouteFinder::find(const Query& query) const {
+        if (query.getPosCount() < 2) {
+            return Result();
+        }
+
+        // Snap all waypoints first, snapped nodes are shared by adjacent legs
+        std::vector<std::vector<Graph::NearestNode>> nearestNodes(query.getPosCount());
+        for (int i = 0; i < query.getPosCount(); i++) {
+            nearestNodes[i] = _graph->findNearestNode(query.getPos(i));
+            if (nearestNodes[i].empty()) {
+                return Result();
+            }
+        }
+
+        // Route all legs using the same workspace, so that node blocks loaded for one leg are reused by the following legs
+        WorkspacePtr workspace = acquireWorkspace();
+        std::vector<Instruction> instructions;
+        std::vector<WGSPos> geometry;
+        for (std::size_t leg = 0; leg + 1 < nearestNodes.size(); leg++) {
+            workspace->clearSearch();
+            std::unordered_map<Graph::NodeId, PathNode, Graph::NodeId::Hash> pathSuffixMap;
+            float minWeight = initializeSearch(*workspace, nearestNodes[leg], nearestNodes[leg + 1], pathSuffixMap);
+            int bestNodeIndex = searchBidirectional(*workspace, minWeight, 0.0f, nullptr);
+            if (bestNodeIndex == -1) {
+                return Result();
+            }
+            std::vector<PathNode> path;
+            if (!unpackPath(*workspace, bestNodeIndex, pathSuffixMap, path)) {
+                return Result();
+            }
+            Result legResult = buildResult(path, nearestNodes[leg], nearestNodes[leg + 1]);
+
+            // Merge the leg into the full route, final instructions of intermediate legs are replaced with via location instructions
+            std::size_t geometryOffset = geometry.size();
+            for (const Instruction& instruction : legResult.getInstructions()) {
+                Instruction::Type type = instruction.getType();
+                if (type == Instruction::Type::REACHED_YOUR_DESTINATION && leg + 2 < nearestNodes.size()) {
+                    type = Instruction::Type::REACH_VIA_LOCATION;
+                }
+                instructions.emplace_back(type, instruction.getTravelMode(), instruction.getAddress(), instruction.getDistance(), instruction.getTime(), instruction.getGeometryIndex() + geometryOffset);
+            }
+            geometry.insert(geometry.end(), legResult.getGeometry().begin(), legResult.getGeometry().end());
+        }
+
+        return Result(std::move(instructions), std::move(geometry));
+    }
+
+    std::vector<Result> RouteFinder::findAlternatives(const Query& query, int maxAlternatives) const {
+        std::vector<Result> results;
+        if (query.getPosCount() != 2) {
+            Result result = find(query);
+            if (result.getStatus() == Result::Status::SUCCESS) {
+                results.push_back(std::move(result));
+            }
+            return results;
+        }
+
         std::array<std::vector<Graph::NearestNode>, 2> nearestNodes;
-        std::array<std::priority_queue<SearchNode>, 2> heaps;
-        std::unordered_map<Graph::NodeId, PathNode, Graph::NodeId::Hash> pathSuffixMap;
-        float minWeight = 0.0f;
         for (int i = 0; i < 2; i++) {
             nearestNodes[i] = _graph->findNearestNode(query.getPos(i));
             if (nearestNodes[i].empty()) {
-                return Result();
+                return results;
             }
+        }
 
-            for (const Graph::NearestNode& nearestNode : nearestNodes[i]) {
-                Graph::NodePtr node = _graph->getNode(nearestNode.nodeId);
+        // Run the search without the usual pruning, all nodes where the search spaces meet are via-node candidates
+        WorkspacePtr workspace = acquireWorkspace();
+        std::unordered_map<Graph::NodeId, PathNode, Graph::NodeId::Hash> pathSuffixMap;
+        float minWeight = initializeSearch(*workspace, nearestNodes[0], nearestNodes[1], pathSuffixMap);
+        std::vector<int> meetingNodeIndices;
+        int bestNodeIndex = searchBidirectional(*workspace, minWeight, MAX_ALTERNATIVE_STRETCH, &meetingNodeIndices);
+        if (bestNodeIndex == -1) {
+            return results;
+        }
+
+        auto getTotalWeight = [&workspace](int nodeIndex) {
+            const SearchWorkspace::NodeState& nodeState = workspace->getNodeState(nodeIndex);
+            return nodeState.weights[0] + nodeState.weights[1];
+        };
+        float maxWeight = getTotalWeight(bestNodeIndex) * (1.0f + MAX_ALTERNATIVE_STRETCH);
+        std::stable_sort(meetingNodeIndices.begin(), meetingNodeIndices.end(), [&getTotalWeight](int nodeIndex1, int nodeIndex2) {
+            return getTotalWeight(nodeIndex1) < getTotalWeight(nodeIndex2);
+        });
+        meetingNodeIndices.insert(meetingNodeIndices.begin(), bestNodeIndex);
+
+        // Accept the candidates in the order of increasing weight, as long as they do not share too much with already accepted routes
+        std::vector<std::unordered_set<Graph::NodeId, Graph::NodeId::Hash>> acceptedPathNodeIds;
+        int candidateCount = 0;
+        for (int nodeIndex : meetingNodeIndices) {
+            if (static_cast<int>(results.size()) > maxAlternatives || getTotalWeight(nodeIndex) > maxWeight || candidateCount++ >= MAX_ALTERNATIVE_CANDIDATES) {
+                break;
+            }
+            if (nodeIndex == bestNodeIndex && !results.empty()) {
+                continue;
+            }
+
+            std::vector<PathNode> path;
+            if (!unpackPath(*workspace, nodeIndex, pathSuffixMap, path)) {
+                continue;
+            }
+
+            // Reject paths that visit the same node twice, these contain detours around the via-node
+            std::unordered_set<Graph::NodeId, Graph::NodeId::Hash> pathNodeIds;
+            float pathWeight = 0.0f;
+            bool loop = false;
+            for (const PathNode& pathNode : path) {
+                if (!pathNodeIds.insert(pathNode.nextNodeId).second) {
+                    loop = true;
+                    break;
+                }
+                pathWeight += pathNode.edge.edgeData.weight;
+            }
+            if (loop) {
+                continue;
+            }
+
+            bool shared = false;
+            for (const std::unordered_set<Graph::NodeId, Graph::NodeId::Hash>& otherPathNodeIds : acceptedPathNodeIds) {
+                float sharedWeight = 0.0f;
+                for (const PathNode& pathNode : path) {
+                    if (otherPathNodeIds.count(pathNode.nextNodeId) > 0) {
+                        sharedWeight += pathNode.edge.edgeData.weight;
+                    }
+                }
+                if (sharedWeight > pathWeight * MAX_ALTERNATIVE_SHARING) {
+                    shared = true;
+                    break;
+                }
+            }
+            if (shared) {
+                continue;
+            }
+
+            results.push_back(buildResult(path, nearestNodes[0], nearestNodes[1]));
+            acceptedPathNodeIds.push_back(std::move(pathNodeIds));
+        }
+        return results;
+    }
+
+    MatrixResult RouteFinder::findMatrix(const MatrixQuery& query, int threadCount) const {
+        const std::vector<WGSPos>& sources = query.getSources();
+        const std::vector<WGSPos>& targets = query.getTargets();
+        MatrixResult result(sources.size(), targets.size());
+
+        std::vector<std::vector<Graph::NearestNode>> sourceNearestNodes(sources.size());
+        runParallel(sources.size(), threadCount, [&](std::size_t i) {
+            sourceNearestNodes[i] = _graph->findNearestNode(sources[i]);
+        });
+        std::vector<std::vector<Graph::NearestNode>> targetNearestNodes(targets.size());
+        runParallel(targets.size(), threadCount, [&](std::size_t j) {
+            targetNearestNodes[j] = _graph->findNearestNode(targets[j]);
+        });
+
+        // Run backward search from each target and store the reached nodes in buckets
+        std::vector<std::vector<std::pair<Graph::NodeId, float>>> targetSearchSpaces(targets.size());
+        runParallel(targets.size(), threadCount, [&](std::size_t j) {
+            searchUpward(targetNearestNodes[j], false, [&](Graph::NodeId nodeId, float weight) {
+                targetSearchSpaces[j].emplace_back(nodeId, weight);
+            });
+        });
+
+        std::unordered_map<Graph::NodeId, std::vector<BucketEntry>, Graph::NodeId::Hash> buckets;
+        for (std::size_t j = 0; j < targetSearchSpaces.size(); j++) {
+            for (const std::pair<Graph::NodeId, float>& searchSpaceNode : targetSearchSpaces[j]) {
+                buckets[searchSpaceNode.first].emplace_back(static_cast<int>(j), searchSpaceNode.second);
+            }
+            std::vector<std::pair<Graph::NodeId, float>>().swap(targetSearchSpaces[j]);
+        }
+
+        // Run forward search from each source and scan the buckets of the reached nodes
+        runParallel(sources.size(), threadCount, [&](std::size_t i) {
+            std::vector<float> bestWeights(targets.size(), std::numeric_limits<float>::infinity());
+
+            // Special case: source and target are on the same node. The searches may not meet at the node because of stalling, so use the direct weight along the node
+            for (std::size_t j = 0; j < targets.size(); j++) {
+                for (const Graph::NearestNode& sourceNearestNode : sourceNearestNodes[i]) {
+                    for (const Graph::NearestNode& targetNearestNode : targetNearestNodes[j]) {
+                        if (sourceNearestNode.nodeId == targetNearestNode.nodeId && sourceNearestNode.geometryRelPos <= targetNearestNode.geometryRelPos) {
+                            Graph::NodePtr node = _graph->getNode(sourceNearestNode.nodeId);
+                            float weight = (targetNearestNode.geometryRelPos - sourceNearestNode.geometryRelPos) * node->nodeData.weight;
+                            bestWeights[j] = std::min(bestWeights[j], weight);
+                        }
+                    }
+                }
+
+                // Special case: target is behind the source on the same node. The route must leave the node and return to it,
+                // which needs the extra initialization of the point-to-point search, so run a separate search for this pair
+                if (isTargetBehindSource(sourceNearestNodes[i], targetNearestNodes[j])) {
+                    WorkspacePtr workspace = acquireWorkspace();
+                    std::unordered_map<Graph::NodeId, PathNode, Graph::NodeId::Hash> pathSuffixMap;
+                    float minWeight = initializeSearch(*workspace, sourceNearestNodes[i], targetNearestNodes[j], pathSuffixMap);
+                    int bestNodeIndex = searchBidirectional(*workspace, minWeight, 0.0f, nullptr);
+                    if (bestNodeIndex != -1) {
+                        const SearchWorkspace::NodeState& nodeState = workspace->getNodeState(bestNodeIndex);
+                        bestWeights[j] = std::min(bestWeights[j], nodeState.weights[0] + nodeState.weights[1]);
+                    }
+                }
+            }
+
+            searchUpward(sourceNearestNodes[i], true, [&](Graph::NodeId nodeId, float weight) {
+                auto it = buckets.find(nodeId);
+                if (it != buckets.end()) {
+                    for (const BucketEntry& bucketEntry : it->second) {
+                        float totalWeight = weight + bucketEntry.weight;
+                        if (totalWeight >= 0 && totalWeight < bestWeights[bucketEntry.targetIndex]) {
+                            bestWeights[bucketEntry.targetIndex] = totalWeight;
+                        }
+                    }
+                }
+            });
+            for (std::size_t j = 0; j < targets.size(); j++) {
+                if (bestWeights[j] != std::numeric_limits<float>::infinity()) {
+                    result.setTime(i, j, bestWeights[j] / 10.0);
+                }
+            }
+        });
+
+        return result;
+    }
+
+    float RouteFinder::initializeSearch(SearchWorkspace& workspace, const std::vector<Graph::NearestNode>& sourceNearestNodes, const std::vector<Graph::NearestNode>& targetNearestNodes, std::unordered_map<Graph::NodeId, PathNode, Graph::NodeId::Hash>& pathSuffixMap) const {
+        std::array<const std::vector<Graph::NearestNode>*, 2> nearestNodes {{ &sourceNearestNodes, &targetNearestNodes }};
+        float minWeight = 0.0f;
+        for (int i = 0; i < 2; i++) {
+            for (const Graph::NearestNode& nearestNode : *nearestNodes[i]) {
+                int nodeIndex = workspace.getNodeIndex(nearestNode.nodeId);
+                const Graph::Node& node = workspace.getNode(*_graph, nodeIndex);
 
                 // Calculate end-point weights
-                float weight = (i == 0 ? -nearestNode.geometryRelPos : nearestNode.geometryRelPos) * node->nodeData.weight;
+                float weight = (i == 0 ? -nearestNode.geometryRelPos : nearestNode.geometryRelPos) * node.nodeData.weight;
                 minWeight = std::min(minWeight, weight);
 
                 // Special case: we have already added same node but the node is inaccessible along the current direction
-                if (i == 1 && nearestNodes[0].size() == 1 && nearestNodes[1].size() == 1) {
-                    const Graph::NearestNode& otherNearestNode = nearestNodes[1 - i][0];
-                    if (nearestNode.nodeId == otherNearestNode.nodeId && nearestNode.geometryRelPos < otherNearestNode.geometryRelPos) {
-                        // Add all backward edges "leading" to current node
-                        for (auto edge = node->firstEdge; edge != node->lastEdge; edge++) {
-                            if (edge->backward) {
-                                heaps[i].emplace(edge->targetNodeId, Graph::NodeId(), weight + edge->edgeData.weight);
+                if (i == 1 && isTargetBehindSource(sourceNearestNodes, targetNearestNodes)) {
+                    // Add all backward edges "leading" to current node
+                    for (auto edge = node.firstEdge; edge != node.lastEdge; edge++) {
+                        if (edge->backward && edge->targetNodeId.blockId.packageId != -1) {
+                            if (workspace.updateHeap(i, workspace.getNodeIndex(edge->targetNodeId), weight + edge->edgeData.weight, -1)) {
                                 pathSuffixMap[edge->targetNodeId] = PathNode(edge->targetNodeId, *edge, nearestNode.nodeId);
                             }
                         }
+                    }
 
-                        // Here comes the tricky part: we must perform another spatial query to find INCOMING edges pointing to current edge
-                        std::vector<WGSPos> geometry = _graph->getNodeGeometry(*node);
-                        std::vector<Graph::NearestNode> nearestNodes2 = _graph->findNearestNode(geometry.front());
-                        for (const Graph::NearestNode& nearestNode2 : nearestNodes2) {
-                            Graph::NodePtr node2 = _graph->getNode(nearestNode2.nodeId);
-                            for (auto edge2 = node2->firstEdge; edge2 != node2->lastEdge; edge2++) {
-                                if (edge2->forward && edge2->targetNodeId == nearestNode.nodeId) {
-                                    heaps[i].emplace(nearestNode2.nodeId, Graph::NodeId(), weight + edge2->edgeData.weight);
+                    // Here comes the tricky part: we must perform another spatial query to find INCOMING edges pointing to current edge
+                    std::vector<WGSPos> geometry = _graph->getNodeGeometry(node);
+                    std::vector<Graph::NearestNode> nearestNodes2 = _graph->findNearestNode(geometry.front());
+                    for (const Graph::NearestNode& nearestNode2 : nearestNodes2) {
+                        int nodeIndex2 = workspace.getNodeIndex(nearestNode2.nodeId);
+                        const Graph::Node& node2 = workspace.getNode(*_graph, nodeIndex2);
+                        for (auto edge2 = node2.firstEdge; edge2 != node2.lastEdge; edge2++) {
+                            if (edge2->forward && edge2->targetNodeId == nearestNode.nodeId) {
+                                if (workspace.updateHeap(i, nodeIndex2, weight + edge2->edgeData.weight, -1)) {
                                     pathSuffixMap[nearestNode2.nodeId] = PathNode(nearestNode2.nodeId, *edge2, nearestNode.nodeId);
                                 }
                             }
                         }
-
-                        continue;
                     }
+
+                    continue;
                 }
 
                 // Add the node to heap, if other nodes were not already added
-                heaps[i].emplace(nearestNode.nodeId, Graph::NodeId(), weight);
+                workspace.updateHeap(i, nodeIndex, weight, -1);
             }
         }
+        return minWeight;
+    }
 
-        // Apply bidirectional Dijkstra
-        Graph::NodeId bestNodeId;
+    int RouteFinder::searchBidirectional(SearchWorkspace& workspace, float minWeight, float maxStretch, std::vector<int>* meetingNodeIndices) const {
+        // Apply bidirectional Dijkstra. Nodes are settled only once, as the heap supports decreasing the weights of queued nodes
+        int bestNodeIndex = -1;
         float bestWeight = std::numeric_limits<float>::infinity();
-        std::array<std::unordered_map<Graph::NodeId, SearchNode, Graph::NodeId::Hash>, 2> settledNodes;
-        for (int i = 0; !(heaps[0].empty() && heaps[1].empty()); i = 1 - i) {
-            if (heaps[i].empty()) {
-                continue;
-            }
-            SearchNode searchNode = heaps[i].top();
-            heaps[i].pop();
-            
-            // Skip all invalid nodes
-            if (searchNode.nodeId.blockId.packageId == -1) {
+        for (int i = 0; !(workspace.isHeapEmpty(0) && workspace.isHeapEmpty(1)); i = 1 - i) {
+            if (workspace.isHeapEmpty(i)) {
                 continue;
             }
+            int nodeIndex = workspace.popHeap(i);
+            float weight = workspace.getNodeState(nodeIndex).weights[i];
 
-            // Already shorter path found? In that case we can stop searching in the given direction
-            if (searchNode.weight + minWeight > bestWeight) {
-                while (!heaps[i].empty()) {
-                    heaps[i].pop();
-                }
+            // Already shorter path found (allowing the given stretch)? In that case we can stop searching in the given direction
+            if (weight + minWeight > bestWeight * (1.0f + maxStretch)) {
+                workspace.clearHeap(i);
                 continue;
             }
-            
-            // Best path to give node?
-            auto it0 = settledNodes[i].find(searchNode.nodeId);
-            if (it0 != settledNodes[i].end()) {
-                if (searchNode.weight >= it0->second.weight) { // not sure if the check is required
-                    continue;
-                }
-            }
 
-            // Settle the node
-            settledNodes[i][searchNode.nodeId] = searchNode;
-            
-            // Stalling optimization. This implementation is not optimal, we should also look at non-settled heap nodes
-            Graph::NodePtr node = _graph->getNode(searchNode.nodeId);
+            // Stalling optimization. Tentative weights of queued nodes are also upper bounds, so these can be used for stalling, too
+            const Graph::Node& node = workspace.getNode(*_graph, nodeIndex);
             bool stall = false;
-            for (auto edge = node->firstEdge; edge != node->lastEdge; edge++) {
+            for (auto edge = node.firstEdge; edge != node.lastEdge; edge++) {
                 if ((i == 0 && edge->backward) || (i != 0 && edge->forward)) {
-                    auto it = settledNodes[i].find(edge->targetNodeId);
-                    if (it != settledNodes[i].end()) {
-                        if (it->second.weight + edge->edgeData.weight < searchNode.weight) {
-                            stall = true;
-                            break;
-                        }
+                    int targetNodeIndex = workspace.findNodeIndex(edge->targetNodeId);
+                    if (targetNodeIndex != -1 && workspace.getNodeState(targetNodeIndex).weights[i] + edge->edgeData.weight < weight) {
+                        stall = true;
+                        break;
                     }
                 }
             }
@@ -109,42 +322,42 @@ namespace carto { namespace routing {
             }
 
             // Recalculate shortest path and middle node
-            auto it1 = settledNodes[1 - i].find(searchNode.nodeId);
-            if (it1 != settledNodes[1 - i].end()) {
-                float totalWeight = searchNode.weight + it1->second.weight;
+            if (workspace.isSettled(1 - i, nodeIndex)) {
+                float totalWeight = weight + workspace.getNodeState(nodeIndex).weights[1 - i];
                 if (totalWeight >= 0 && totalWeight < bestWeight) {
                     bestWeight = totalWeight;
-                    bestNodeId = searchNode.nodeId;
+                    bestNodeIndex = nodeIndex;
+                }
+                if (totalWeight >= 0 && meetingNodeIndices) {
+                    meetingNodeIndices->push_back(nodeIndex);
                 }
             }
 
             // Add target nodes to heap
-            for (auto edge = node->firstEdge; edge != node->lastEdge; edge++) {
+            for (auto edge = node.firstEdge; edge != node.lastEdge; edge++) {
                 if ((i == 0 && edge->forward) || (i != 0 && edge->backward)) {
-                    heaps[i].emplace(edge->targetNodeId, searchNode.nodeId, searchNode.weight + edge->edgeData.weight);
+                    if (edge->targetNodeId.blockId.packageId != -1) {
+                        workspace.updateHeap(i, workspace.getNodeIndex(edge->targetNodeId), weight + edge->edgeData.weight, nodeIndex);
+                    }
                 }
             }
         }
+        return bestNodeIndex;
+    }
 
-        // Check that path was found
-        if (bestNodeId.blockId.packageId == -1) {
-            return Result();
-        }
-
+    bool RouteFinder::unpackPath(const SearchWorkspace& workspace, int bestNodeIndex, const std::unordered_map<Graph::NodeId, PathNode, Graph::NodeId::Hash>& pathSuffixMap, std::vector<PathNode>& path) const {
         // Unpack path
         std::array<std::vector<PathNode>, 2> paths;
         for (int i = 0; i < 2; i++) {
             std::stack<std::pair<Graph::NodeId, Graph::NodeId>> stack;
-            Graph::NodeId nodeId = bestNodeId;
+            int nodeIndex = bestNodeIndex;
             while (true) {
-                auto it = settledNodes[i].find(nodeId);
-                assert(it != settledNodes[i].end());
-                Graph::NodeId prevNodeId = it->second.prevNodeId;
-                if (prevNodeId.blockId.packageId == -1) {
+                int prevNodeIndex = workspace.getNodeState(nodeIndex).prevIndices[i];
+                if (prevNodeIndex == -1) {
                     break;
                 }
-                stack.emplace(prevNodeId, nodeId);
-                nodeId = prevNodeId;
+                stack.emplace(workspace.getNodeState(prevNodeIndex).nodeId, workspace.getNodeState(nodeIndex).nodeId);
+                nodeIndex = prevNodeIndex;
             }
 
             while (!stack.empty()) {
@@ -193,7 +406,7 @@ namespace carto { namespace routing {
                 if (matchedEdge) {
                     if (matchedEdge->contracted) {
                         if (matchedEdge->contractedNodeId.blockId.packageId == -1) {
-                            return Result(); // Contracted node is not available, packing failed
+                            return false; // Contracted node is not available, packing failed
                         }
                         stack.emplace(matchedEdge->contractedNodeId, nodeIds.second);
                         stack.emplace(nodeIds.first, matchedEdge->contractedNodeId);
@@ -202,13 +415,13 @@ namespace carto { namespace routing {
                         paths[i].emplace_back(nodeIds.first, *matchedEdge, nodeIds.second);
                     }
                 } else {
-                    return Result(); // NOTE: this should not happen, unless the graph is broken
+                    return false; // NOTE: this should not happen, unless the graph is broken
                 }
             }
         }
 
         // Build joined path. Add pseudo-node at the beginning to simplify processing and add final node, if rerouting in case of one-way street
-        std::vector<PathNode> path;
+        Graph::NodeId bestNodeId = workspace.getNodeState(bestNodeIndex).nodeId;
         path = paths[0];
         for (auto it = paths[1].rbegin(); it != paths[1].rend(); it++) {
             path.emplace_back(it->nextNodeId, it->edge, it->prevNodeId);
@@ -225,7 +438,10 @@ namespace carto { namespace routing {
         if (finalNodeIt != pathSuffixMap.end()) {
             path.push_back(finalNodeIt->second);
         }
+        return true;
+    }
 
+    Result RouteFinder::buildResult(const std::vector<PathNode>& path, const std::vector<Graph::NearestNode>& sourceNearestNodes, const std::vector<Graph::NearestNode>& targetNearestNodes) const {
         // Construct query result
         std::vector<Instruction> instructions;
         std::vector<WGSPos> routeVertices;
@@ -239,10 +455,10 @@ namespace carto { namespace routing {
 
             std::size_t firstNNIndex = std::numeric_limits<std::size_t>::max();
             if (j == 0) {
-                for (std::size_t k = 0; k < nearestNodes[0].size(); k++) {
-                    if (nearestNodes[0][k].nodeId == nodeId) {
-                        geometryIndex.first = nearestNodes[0][k].geometrySegmentIndex;
-                        geometryRelPos.first = nearestNodes[0][k].geometryRelPos;
+                for (std::size_t k = 0; k < sourceNearestNodes.size(); k++) {
+                    if (sourceNearestNodes[k].nodeId == nodeId) {
+                        geometryIndex.first = sourceNearestNodes[k].geometrySegmentIndex;
+                        geometryRelPos.first = sourceNearestNodes[k].geometryRelPos;
                         firstNNIndex = k;
                         break;
                     }
@@ -251,10 +467,10 @@ namespace carto { namespace routing {
 
             std::size_t lastNNIndex = std::numeric_limits<std::size_t>::max();
             if (j == path.size() - 1) {
-                for (std::size_t k = 0; k < nearestNodes[1].size(); k++) {
-                    if (nearestNodes[1][k].nodeId == nodeId) {
-                        geometryIndex.second = nearestNodes[1][k].geometrySegmentIndex;
-                        geometryRelPos.second = nearestNodes[1][k].geometryRelPos;
+                for (std::size_t k = 0; k < targetNearestNodes.size(); k++) {
+                    if (targetNearestNodes[k].nodeId == nodeId) {
+                        geometryIndex.second = targetNearestNodes[k].geometrySegmentIndex;
+                        geometryRelPos.second = targetNearestNodes[k].geometryRelPos;
                         lastNNIndex = k;
                         break;
                     }
@@ -268,7 +484,7 @@ namespace carto { namespace routing {
             // Initial route instruction/vertex
             if (firstNNIndex != std::numeric_limits<std::size_t>::max()) {
                 instructions.emplace_back(Instruction::Type::HEAD_ON, Instruction::TravelMode::DEFAULT, streetName, dist, time, routeVertices.size());
-                routeVertices.push_back(nearestNodes[0][firstNNIndex].nodePos);
+                routeVertices.push_back(sourceNearestNodes[firstNNIndex].nodePos);
             }
             
             // Middle instructions/vertices
@@ -288,13 +504,122 @@ namespace carto { namespace routing {
             // Final instruction/vertex
             if (lastNNIndex != std::numeric_limits<std::size_t>::max()) {
                 instructions.emplace_back(Instruction::Type::REACHED_YOUR_DESTINATION, Instruction::TravelMode::DEFAULT, "", 0, 0, routeVertices.size());
-                routeVertices.push_back(nearestNodes[1][lastNNIndex].nodePos);
+                routeVertices.push_back(targetNearestNodes[lastNNIndex].nodePos);
             }
         }
 
         return Result(std::move(instructions), std::move(routeVertices));
     }
 
+    void RouteFinder::searchUpward(const std::vector<Graph::NearestNode>& nearestNodes, bool forward, const std::function<void(Graph::NodeId, float)>& settleNode) const {
+        WorkspacePtr workspace = acquireWorkspace();
+        for (const Graph::NearestNode& nearestNode : nearestNodes) {
+            int nodeIndex = workspace->getNodeIndex(nearestNode.nodeId);
+            const Graph::Node& node = workspace->getNode(*_graph, nodeIndex);
+            float weight = (forward ? -nearestNode.geometryRelPos : nearestNode.geometryRelPos) * node.nodeData.weight;
+            workspace->updateHeap(0, nodeIndex, weight, -1);
+        }
+
+        // Plain Dijkstra over the upward edges, until the search space is exhausted
+        while (!workspace->isHeapEmpty(0)) {
+            int nodeIndex = workspace->popHeap(0);
+            float weight = workspace->getNodeState(nodeIndex).weights[0];
+
+            // Stalling optimization, same as in the point-to-point search
+            const Graph::Node& node = workspace->getNode(*_graph, nodeIndex);
+            bool stall = false;
+            for (auto edge = node.firstEdge; edge != node.lastEdge; edge++) {
+                if ((forward && edge->backward) || (!forward && edge->forward)) {
+                    int targetNodeIndex = workspace->findNodeIndex(edge->targetNodeId);
+                    if (targetNodeIndex != -1 && workspace->getNodeState(targetNodeIndex).weights[0] + edge->edgeData.weight < weight) {
+                        stall = true;
+                        break;
+                    }
+                }
+            }
+            if (stall) {
+                continue;
+            }
+
+            settleNode(workspace->getNodeState(nodeIndex).nodeId, weight);
+
+            for (auto edge = node.firstEdge; edge != node.lastEdge; edge++) {
+                if ((forward && edge->forward) || (!forward && edge->backward)) {
+                    if (edge->targetNodeId.blockId.packageId != -1) {
+                        workspace->updateHeap(0, workspace->getNodeIndex(edge->targetNodeId), weight + edge->edgeData.weight, nodeIndex);
+                    }
+                }
+            }
+        }
+    }
+
+    RouteFinder::WorkspacePtr RouteFinder::acquireWorkspace() const {
+        std::unique_ptr<SearchWorkspace> workspace;
+        {
+            std::lock_guard<std::mutex> lock(_workspacePoolMutex);
+            if (!_workspacePool.empty()) {
+                workspace = std::move(_workspacePool.back());
+                _workspacePool.pop_back();
+            }
+        }
+        if (!workspace) {
+            workspace.reset(new SearchWorkspace());
+        }
+
+        // Return the workspace to the pool once the search is finished, instead of releasing it
+        return WorkspacePtr(workspace.release(), [this](SearchWorkspace* workspace) {
+            std::unique_ptr<SearchWorkspace> pooledWorkspace(workspace);
+            pooledWorkspace->reset();
+            std::lock_guard<std::mutex> lock(_workspacePoolMutex);
+            _workspacePool.push_back(std::move(pooledWorkspace));
+        });
+    }
+
+    bool RouteFinder::isTargetBehindSource(const std::vector<Graph::NearestNode>& sourceNearestNodes, const std::vector<Graph::NearestNode>& targetNearestNodes) {
+        if (sourceNearestNodes.size() != 1 || targetNearestNodes.size() != 1) {
+            return false;
+        }
+        return sourceNearestNodes[0].nodeId == targetNearestNodes[0].nodeId && targetNearestNodes[0].geometryRelPos < sourceNearestNodes[0].geometryRelPos;
+    }
+
+    void RouteFinder::runParallel(std::size_t count, int threadCount, const std::function<void(std::size_t)>& task) {
+        if (threadCount <= 1 || count <= 1) {
+            for (std::size_t i = 0; i < count; i++) {
+                task(i);
+            }
+            return;
+        }
+
+        std::atomic<std::size_t> nextIndex(0);
+        std::exception_ptr exception;
+        std::mutex exceptionMutex;
+        auto worker = [&]() {
+            for (std::size_t i = nextIndex++; i < count; i = nextIndex++) {
+                try {
+                    task(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(exceptionMutex);
+                    if (!exception) {
+                        exception = std::current_exception();
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < std::min(count, static_cast<std::size_t>(threadCount)); i++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
     double RouteFinder::calculateGeometryLength(const std::vector<WGSPos>& geometry, double t0, double t1) {
         double totalLen = 0;
         for (unsigned int j = 1; j < geometry.size(); j++) {
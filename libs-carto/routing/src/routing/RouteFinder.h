@@ -8,37 +8,43 @@
 #define _CARTO_ROUTING_ROUTEFINDER_H_
 
 #include "Query.h"
+#include "MatrixQuery.h"
 #include "Instruction.h"
 #include "Result.h"
+#include "MatrixResult.h"
 #include "Graph.h"
 
-#include <queue>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <stack>
+#include <functional>
+#include <unordered_map>
 
 namespace carto { namespace routing {
+    class SearchWorkspace;
+
     class RouteFinder final {
     public:
-        explicit RouteFinder(std::shared_ptr<Graph> graph) : _graph(std::move(graph)) { }
+        explicit RouteFinder(std::shared_ptr<Graph> graph);
+        RouteFinder(const RouteFinder&) = delete;
+        ~RouteFinder();
 
         Result find(const Query& query) const;
 
-    private:
-        constexpr static double EARTH_RADIUS = 6372797.560856;
+        // Returns the optimal route followed by up to maxAlternatives alternative routes, found using via-nodes. Only two-point queries are supported, for other queries only the optimal route is returned.
+        std::vector<Result> findAlternatives(const Query& query, int maxAlternatives) const;
 
-        struct SearchNode {
-            Graph::NodeId nodeId;
-            Graph::NodeId prevNodeId;
-            float weight = 0.0f;
+        MatrixResult findMatrix(const MatrixQuery& query, int threadCount = 1) const;
 
-            SearchNode() = default;
-            SearchNode(Graph::NodeId nodeId, Graph::NodeId prevNodeId, float weight) : nodeId(nodeId), prevNodeId(prevNodeId), weight(weight) { }
+        RouteFinder& operator = (const RouteFinder&) = delete;
 
-            bool operator < (const SearchNode& searchNode) const {
-                return weight > searchNode.weight;
-            }
-        };
+    private:
+        constexpr static double EARTH_RADIUS = 6372797.560856;
+        constexpr static float MAX_ALTERNATIVE_STRETCH = 0.25f; // alternatives can be up to 25% longer than the optimal route
+        constexpr static float MAX_ALTERNATIVE_SHARING = 0.75f; // alternatives can share up to 75% of their weight with other routes
+        constexpr static int MAX_ALTERNATIVE_CANDIDATES = 32;
 
         struct PathNode {
             Graph::NodeId prevNodeId;
@@ -49,11 +55,40 @@ namespace carto { namespace routing {
             PathNode(Graph::NodeId prevNodeId, const Graph::Edge& edge, Graph::NodeId nextNodeId) : prevNodeId(prevNodeId), edge(edge), nextNodeId(nextNodeId) { }
         };
 
+        struct BucketEntry {
+            int targetIndex = -1;
+            float weight = 0.0f;
+
+            BucketEntry() = default;
+            BucketEntry(int targetIndex, float weight) : targetIndex(targetIndex), weight(weight) { }
+        };
+
+        using WorkspacePtr = std::unique_ptr<SearchWorkspace, std::function<void(SearchWorkspace*)>>;
+
+        float initializeSearch(SearchWorkspace& workspace, const std::vector<Graph::NearestNode>& sourceNearestNodes, const std::vector<Graph::NearestNode>& targetNearestNodes, std::unordered_map<Graph::NodeId, PathNode, Graph::NodeId::Hash>& pathSuffixMap) const;
+
+        int searchBidirectional(SearchWorkspace& workspace, float minWeight, float maxStretch, std::vector<int>* meetingNodeIndices) const;
+
+        bool unpackPath(const SearchWorkspace& workspace, int bestNodeIndex, const std::unordered_map<Graph::NodeId, PathNode, Graph::NodeId::Hash>& pathSuffixMap, std::vector<PathNode>& path) const;
+
+        Result buildResult(const std::vector<PathNode>& path, const std::vector<Graph::NearestNode>& sourceNearestNodes, const std::vector<Graph::NearestNode>& targetNearestNodes) const;
+
+        void searchUpward(const std::vector<Graph::NearestNode>& nearestNodes, bool forward, const std::function<void(Graph::NodeId, float)>& settleNode) const;
+
+        WorkspacePtr acquireWorkspace() const;
+
+        static bool isTargetBehindSource(const std::vector<Graph::NearestNode>& sourceNearestNodes, const std::vector<Graph::NearestNode>& targetNearestNodes);
+
+        static void runParallel(std::size_t count, int threadCount, const std::function<void(std::size_t)>& task);
+
         static double calculateGeometryLength(const std::vector<WGSPos>& geometry, double t0, double t1);
 
         static double calculateGreatCircleDistance(const WGSPos& p0, const WGSPos& p1);
 
         const std::shared_ptr<Graph> _graph;
+
+        mutable std::vector<std::unique_ptr<SearchWorkspace>> _workspacePool;
+        mutable std::mutex _workspacePoolMutex;
     };
 } }
 
@@ -0,0 +1,195 @@
+#include "SearchWorkspace.h"
+
+#include <limits>
+#include <algorithm>
+
+namespace carto { namespace routing {
+    constexpr int SearchWorkspace::UNREACHED_POSITION;
+    constexpr int SearchWorkspace::SETTLED_POSITION;
+    constexpr std::size_t SearchWorkspace::HEAP_ARITY;
+
+    SearchWorkspace::SearchWorkspace() :
+        _generation(1),
+        _blockSlots(),
+        _loadedBlockIds(),
+        _nodeStates(),
+        _heaps()
+    {
+    }
+
+    void SearchWorkspace::reset() {
+        // Release node blocks referenced by the last searches, but keep all buffers
+        for (const Graph::BlockId& blockId : _loadedBlockIds) {
+            _blockSlots[blockId.packageId][blockId.blockIndex].nodeBlock.reset();
+        }
+        _loadedBlockIds.clear();
+        clearSearch();
+    }
+
+    void SearchWorkspace::clearSearch() {
+        _nodeStates.clear();
+        for (std::vector<int>& heap : _heaps) {
+            heap.clear();
+        }
+
+        if (++_generation == 0) {
+            for (std::vector<BlockSlot>& packageBlockSlots : _blockSlots) {
+                for (BlockSlot& blockSlot : packageBlockSlots) {
+                    blockSlot.generation = 0;
+                }
+            }
+            _generation = 1;
+        }
+    }
+
+    int SearchWorkspace::getNodeIndex(const Graph::NodeId& nodeId) {
+        BlockSlot& blockSlot = getBlockSlot(nodeId.blockId);
+        if (static_cast<std::size_t>(nodeId.elementIndex) >= blockSlot.nodeIndices.size()) {
+            blockSlot.nodeIndices.resize(nodeId.elementIndex + 1, -1);
+        }
+
+        int& nodeIndex = blockSlot.nodeIndices[nodeId.elementIndex];
+        if (nodeIndex == -1) {
+            nodeIndex = static_cast<int>(_nodeStates.size());
+            _nodeStates.emplace_back();
+            NodeState& nodeState = _nodeStates.back();
+            nodeState.nodeId = nodeId;
+            nodeState.weights.fill(std::numeric_limits<float>::infinity());
+            nodeState.prevIndices.fill(-1);
+            nodeState.heapPositions.fill(UNREACHED_POSITION);
+        }
+        return nodeIndex;
+    }
+
+    int SearchWorkspace::findNodeIndex(const Graph::NodeId& nodeId) const {
+        if (nodeId.blockId.packageId < 0 || static_cast<std::size_t>(nodeId.blockId.packageId) >= _blockSlots.size()) {
+            return -1;
+        }
+        const std::vector<BlockSlot>& packageBlockSlots = _blockSlots[nodeId.blockId.packageId];
+        if (nodeId.blockId.blockIndex < 0 || static_cast<std::size_t>(nodeId.blockId.blockIndex) >= packageBlockSlots.size()) {
+            return -1;
+        }
+        const BlockSlot& blockSlot = packageBlockSlots[nodeId.blockId.blockIndex];
+        if (blockSlot.generation != _generation || static_cast<std::size_t>(nodeId.elementIndex) >= blockSlot.nodeIndices.size()) {
+            return -1;
+        }
+        return blockSlot.nodeIndices[nodeId.elementIndex];
+    }
+
+    const Graph::Node& SearchWorkspace::getNode(const Graph& graph, int index) {
+        NodeState& nodeState = _nodeStates[index];
+        if (!nodeState.node) {
+            BlockSlot& blockSlot = getBlockSlot(nodeState.nodeId.blockId);
+            if (!blockSlot.nodeBlock) {
+                blockSlot.nodeBlock = graph.getNodeBlock(nodeState.nodeId.blockId);
+                _loadedBlockIds.push_back(nodeState.nodeId.blockId);
+            }
+            nodeState.node = &blockSlot.nodeBlock->nodes.at(nodeState.nodeId.elementIndex);
+        }
+        return *nodeState.node;
+    }
+
+    bool SearchWorkspace::updateHeap(int dir, int index, float weight, int prevIndex) {
+        NodeState& nodeState = _nodeStates[index];
+        if (nodeState.heapPositions[dir] == SETTLED_POSITION || weight >= nodeState.weights[dir]) {
+            return false;
+        }
+
+        nodeState.weights[dir] = weight;
+        nodeState.prevIndices[dir] = prevIndex;
+        if (nodeState.heapPositions[dir] == UNREACHED_POSITION) {
+            nodeState.heapPositions[dir] = static_cast<int>(_heaps[dir].size());
+            _heaps[dir].push_back(index);
+        }
+        siftUp(dir, nodeState.heapPositions[dir]);
+        return true;
+    }
+
+    int SearchWorkspace::popHeap(int dir) {
+        std::vector<int>& heap = _heaps[dir];
+        int index = heap.front();
+        _nodeStates[index].heapPositions[dir] = SETTLED_POSITION;
+        if (heap.size() > 1) {
+            heap.front() = heap.back();
+            _nodeStates[heap.front()].heapPositions[dir] = 0;
+            heap.pop_back();
+            siftDown(dir, 0);
+        }
+        else {
+            heap.pop_back();
+        }
+        return index;
+    }
+
+    void SearchWorkspace::clearHeap(int dir) {
+        // Nodes left in the heap are treated as unreached from now on
+        for (int index : _heaps[dir]) {
+            _nodeStates[index].heapPositions[dir] = UNREACHED_POSITION;
+            _nodeStates[index].weights[dir] = std::numeric_limits<float>::infinity();
+        }
+        _heaps[dir].clear();
+    }
+
+    SearchWorkspace::BlockSlot& SearchWorkspace::getBlockSlot(const Graph::BlockId& blockId) {
+        if (static_cast<std::size_t>(blockId.packageId) >= _blockSlots.size()) {
+            _blockSlots.resize(blockId.packageId + 1);
+        }
+        std::vector<BlockSlot>& packageBlockSlots = _blockSlots[blockId.packageId];
+        if (static_cast<std::size_t>(blockId.blockIndex) >= packageBlockSlots.size()) {
+            packageBlockSlots.resize(blockId.blockIndex + 1);
+        }
+
+        BlockSlot& blockSlot = packageBlockSlots[blockId.blockIndex];
+        if (blockSlot.generation != _generation) {
+            blockSlot.generation = _generation;
+            std::fill(blockSlot.nodeIndices.begin(), blockSlot.nodeIndices.end(), -1);
+        }
+        return blockSlot;
+    }
+
+    void SearchWorkspace::siftUp(int dir, std::size_t pos) {
+        std::vector<int>& heap = _heaps[dir];
+        int index = heap[pos];
+        float weight = _nodeStates[index].weights[dir];
+        while (pos > 0) {
+            std::size_t parentPos = (pos - 1) / HEAP_ARITY;
+            int parentIndex = heap[parentPos];
+            if (!(weight < _nodeStates[parentIndex].weights[dir])) {
+                break;
+            }
+            heap[pos] = parentIndex;
+            _nodeStates[parentIndex].heapPositions[dir] = static_cast<int>(pos);
+            pos = parentPos;
+        }
+        heap[pos] = index;
+        _nodeStates[index].heapPositions[dir] = static_cast<int>(pos);
+    }
+
+    void SearchWorkspace::siftDown(int dir, std::size_t pos) {
+        std::vector<int>& heap = _heaps[dir];
+        int index = heap[pos];
+        float weight = _nodeStates[index].weights[dir];
+        while (true) {
+            std::size_t firstChildPos = pos * HEAP_ARITY + 1;
+            if (firstChildPos >= heap.size()) {
+                break;
+            }
+            std::size_t lastChildPos = std::min(firstChildPos + HEAP_ARITY, heap.size());
+            std::size_t minChildPos = firstChildPos;
+            for (std::size_t childPos = firstChildPos + 1; childPos < lastChildPos; childPos++) {
+                if (_nodeStates[heap[childPos]].weights[dir] < _nodeStates[heap[minChildPos]].weights[dir]) {
+                    minChildPos = childPos;
+                }
+            }
+            int minChildIndex = heap[minChildPos];
+            if (!(_nodeStates[minChildIndex].weights[dir] < weight)) {
+                break;
+            }
+            heap[pos] = minChildIndex;
+            _nodeStates[minChildIndex].heapPositions[dir] = static_cast<int>(pos);
+            pos = minChildPos;
+        }
+        heap[pos] = index;
+        _nodeStates[index].heapPositions[dir] = static_cast<int>(pos);
+    }
+} }
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTING_SEARCHWORKSPACE_H_
+#define _CARTO_ROUTING_SEARCHWORKSPACE_H_
+
+#include "Graph.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace carto { namespace routing {
+    // Reusable state for graph searches. Node ids are mapped to dense indices via generation-stamped per-block tables,
+    // so that repeated searches do not need hashing nor allocation once the buffers have grown large enough.
+    // A workspace must be used by a single thread at a time.
+    class SearchWorkspace final {
+    public:
+        struct NodeState {
+            Graph::NodeId nodeId;
+            const Graph::Node* node = nullptr;
+            std::array<float, 2> weights;
+            std::array<int, 2> prevIndices;
+            std::array<int, 2> heapPositions;
+
+            NodeState() = default;
+        };
+
+        SearchWorkspace();
+        SearchWorkspace(const SearchWorkspace&) = delete;
+
+        void reset();
+        void clearSearch(); // unlike reset, keeps the node blocks loaded so far
+
+        int getNodeIndex(const Graph::NodeId& nodeId);
+        int findNodeIndex(const Graph::NodeId& nodeId) const;
+
+        const NodeState& getNodeState(int index) const { return _nodeStates[index]; }
+        const Graph::Node& getNode(const Graph& graph, int index);
+
+        bool isReached(int dir, int index) const { return _nodeStates[index].heapPositions[dir] != UNREACHED_POSITION; }
+        bool isSettled(int dir, int index) const { return _nodeStates[index].heapPositions[dir] == SETTLED_POSITION; }
+
+        bool isHeapEmpty(int dir) const { return _heaps[dir].empty(); }
+        bool updateHeap(int dir, int index, float weight, int prevIndex);
+        int popHeap(int dir);
+        void clearHeap(int dir);
+
+        SearchWorkspace& operator = (const SearchWorkspace&) = delete;
+
+    private:
+        constexpr static int UNREACHED_POSITION = -1;
+        constexpr static int SETTLED_POSITION = -2;
+        constexpr static std::size_t HEAP_ARITY = 4;
+
+        struct BlockSlot {
+            unsigned int generation = 0;
+            std::shared_ptr<const Graph::NodeBlock> nodeBlock;
+            std::vector<int> nodeIndices;
+
+            BlockSlot() = default;
+        };
+
+        BlockSlot& getBlockSlot(const Graph::BlockId& blockId);
+
+        void siftUp(int dir, std::size_t pos);
+        void siftDown(int dir, std::size_t pos);
+
+        unsigned int _generation;
+        std::vector<std::vector<BlockSlot>> _blockSlots; // indexed by package id and block index
+        std::vector<Graph::BlockId> _loadedBlockIds;
+        std::vector<NodeState> _nodeStates;
+        std::array<std::vector<int>, 2> _heaps; // 4-ary heaps of node indices, ordered by weight
+    };
+} }
+
+#endif
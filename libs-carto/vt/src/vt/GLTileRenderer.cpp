@@ -1196,29 +1196,41 @@ namespace carto { namespace vt {
 
     cglib::vec3<float> GLTileRenderer::decodePointOffset(const std::shared_ptr<TileGeometry>& geometry, std::size_t index, const cglib::vec3<float>& xAxis, const cglib::vec3<float>& yAxis) const {
         const TileGeometry::GeometryLayoutParameters& geometryLayoutParams = geometry->getGeometryLayoutParameters();
-        std::size_t binormalOffset = index * geometryLayoutParams.vertexSize + geometryLayoutParams.binormalOffset;
-        const short* binormalPtr = reinterpret_cast<const short*>(&geometry->getVertexGeometry()[binormalOffset]);
-        cglib::vec2<float> xy = cglib::vec2<float>(binormalPtr[0], binormalPtr[1]) * (geometry->getGeometryScale() / geometry->getTileSize() / geometryLayoutParams.binormalScale);
+        cglib::vec2<float> xy = decodeBinormal(geometry, index) * (geometry->getGeometryScale() / geometry->getTileSize() / geometryLayoutParams.binormalScale);
         return xAxis * xy(0) + yAxis * xy(1);
     }
 
     cglib::vec3<float> GLTileRenderer::decodeLineBinormal(const std::shared_ptr<TileGeometry>& geometry, std::size_t index) const {
         const TileGeometry::GeometryLayoutParameters& geometryLayoutParams = geometry->getGeometryLayoutParameters();
-        std::size_t binormalOffset = index * geometryLayoutParams.vertexSize + geometryLayoutParams.binormalOffset;
-        const short* binormalPtr = reinterpret_cast<const short*>(&geometry->getVertexGeometry()[binormalOffset]);
         std::size_t attribOffset = index * geometryLayoutParams.vertexSize + geometryLayoutParams.attribsOffset;
         const char* attribPtr = reinterpret_cast<const char*>(&geometry->getVertexGeometry()[attribOffset]);
         float width = 0.5f * (*geometry->getStyleParameters().widthTable[attribPtr[0]])(_viewState) * geometry->getGeometryScale() / geometry->getTileSize();
-        return cglib::vec3<float>(binormalPtr[0], binormalPtr[1], 0) * (width / geometryLayoutParams.binormalScale);
+        cglib::vec2<float> binormal = decodeBinormal(geometry, index);
+        return cglib::vec3<float>(binormal(0), binormal(1), 0) * (width / geometryLayoutParams.binormalScale);
     }
 
     cglib::vec3<float> GLTileRenderer::decodePolygon3DOffset(const std::shared_ptr<TileGeometry>& geometry, std::size_t index) const {
         const TileGeometry::GeometryLayoutParameters& geometryLayoutParams = geometry->getGeometryLayoutParameters();
         std::size_t heightOffset = index * geometryLayoutParams.vertexSize + geometryLayoutParams.heightOffset;
+        if (geometryLayoutParams.heightComponentSize == sizeof(short)) {
+            const short* heightPtr = reinterpret_cast<const short*>(&geometry->getVertexGeometry()[heightOffset]);
+            return cglib::vec3<float>(0, 0, *heightPtr / geometryLayoutParams.heightScale);
+        }
         const float* heightPtr = reinterpret_cast<const float*>(&geometry->getVertexGeometry()[heightOffset]);
         return cglib::vec3<float>(0, 0, *heightPtr);
     }
 
+    cglib::vec2<float> GLTileRenderer::decodeBinormal(const std::shared_ptr<TileGeometry>& geometry, std::size_t index) const {
+        const TileGeometry::GeometryLayoutParameters& geometryLayoutParams = geometry->getGeometryLayoutParameters();
+        std::size_t binormalOffset = index * geometryLayoutParams.vertexSize + geometryLayoutParams.binormalOffset;
+        if (geometryLayoutParams.binormalComponentSize == sizeof(signed char)) {
+            const signed char* binormalPtr = reinterpret_cast<const signed char*>(&geometry->getVertexGeometry()[binormalOffset]);
+            return cglib::vec2<float>(binormalPtr[0], binormalPtr[1]);
+        }
+        const short* binormalPtr = reinterpret_cast<const short*>(&geometry->getVertexGeometry()[binormalOffset]);
+        return cglib::vec2<float>(binormalPtr[0], binormalPtr[1]);
+    }
+
     bool GLTileRenderer::renderBlendNodes2D(const std::vector<std::shared_ptr<BlendNode>>& blendNodes) {
         GLint stencilBits = 0;
         if (_useStencil) {
@@ -1770,7 +1782,7 @@ namespace carto { namespace vt {
         }
         else if (geometry->getType() == TileGeometry::Type::POLYGON3D) {
             glUniform1f(glGetUniformLocation(shaderProgram, "uVertexScale"), 1.0f / geometryLayoutParams.vertexScale);
-            glUniform1f(glGetUniformLocation(shaderProgram, "uHeightScale"), blend * geometryLayoutParams.vertexScale);
+            glUniform1f(glGetUniformLocation(shaderProgram, "uHeightScale"), blend * geometryLayoutParams.vertexScale / geometryLayoutParams.heightScale);
             cglib::vec3<float> lightDir = _lightDir * (1.0f / geometryLayoutParams.binormalScale);
             glUniform3fv(glGetUniformLocation(shaderProgram, "uLightDir"), 1, lightDir.data());
             cglib::mat3x3<float> tileMatrix = cglib::mat3x3<float>::convert(cglib::inverse(calculateTileMatrix2D(targetTileId)) * calculateTileMatrix2D(tileId, 1.0f / geometryLayoutParams.vertexScale));
@@ -1795,12 +1807,12 @@ namespace carto { namespace vt {
             }
             
             if (geometryLayoutParams.binormalOffset >= 0) {
-                glVertexAttribPointer(glGetAttribLocation(shaderProgram, "aVertexBinormal"), 2, GL_SHORT, GL_FALSE, geometryLayoutParams.vertexSize, reinterpret_cast<const GLvoid*>(geometryLayoutParams.binormalOffset));
+                glVertexAttribPointer(glGetAttribLocation(shaderProgram, "aVertexBinormal"), 2, geometryLayoutParams.binormalComponentSize == sizeof(short) ? GL_SHORT : GL_BYTE, GL_FALSE, geometryLayoutParams.vertexSize, reinterpret_cast<const GLvoid*>(geometryLayoutParams.binormalOffset));
                 glEnableVertexAttribArray(glGetAttribLocation(shaderProgram, "aVertexBinormal"));
             }
             
             if (geometryLayoutParams.heightOffset >= 0) {
-                glVertexAttribPointer(glGetAttribLocation(shaderProgram, "aVertexHeight"), 1, GL_FLOAT, GL_FALSE, geometryLayoutParams.vertexSize, reinterpret_cast<const GLvoid*>(geometryLayoutParams.heightOffset));
+                glVertexAttribPointer(glGetAttribLocation(shaderProgram, "aVertexHeight"), 1, geometryLayoutParams.heightComponentSize == sizeof(float) ? GL_FLOAT : GL_SHORT, GL_FALSE, geometryLayoutParams.vertexSize, reinterpret_cast<const GLvoid*>(geometryLayoutParams.heightOffset));
                 glEnableVertexAttribArray(glGetAttribLocation(shaderProgram, "aVertexHeight"));
             }
             
@@ -49,12 +49,15 @@ namespace carto { namespace vt {
             int attribsOffset;
             int texCoordOffset;
             int binormalOffset;
+            int binormalComponentSize; // sizeof(short) or sizeof(signed char) for compact layout
             int heightOffset;
+            int heightComponentSize; // sizeof(float) or sizeof(short) for compact layout
             float vertexScale;
             float texCoordScale;
             float binormalScale;
+            float heightScale;
 
-            GeometryLayoutParameters() : vertexSize(0), vertexOffset(-1), attribsOffset(-1), texCoordOffset(-1), binormalOffset(-1), heightOffset(-1), vertexScale(0), texCoordScale(0), binormalScale(0) { }
+            GeometryLayoutParameters() : vertexSize(0), vertexOffset(-1), attribsOffset(-1), texCoordOffset(-1), binormalOffset(-1), binormalComponentSize(sizeof(short)), heightOffset(-1), heightComponentSize(sizeof(float)), vertexScale(0), texCoordScale(0), binormalScale(0), heightScale(1) { }
         };
 
         explicit TileGeometry(Type type, float tileSize, float geomScale, const StyleParameters& styleParameters, const GeometryLayoutParameters& geometryLayoutParameters, VertexArray<unsigned char> vertexGeometry, VertexArray<unsigned short> indices, std::vector<std::pair<unsigned int, long long>> ids) : _type(type), _tileSize(tileSize), _geomScale(geomScale), _styleParameters(styleParameters), _geometryLayoutParameters(geometryLayoutParameters), _indicesCount(0), _vertexGeometry(std::move(vertexGeometry)), _indices(std::move(indices)), _ids(std::move(ids)) { _indicesCount = static_cast<unsigned int>(_indices.size()); }
@@ -5,6 +5,8 @@
 #include <list>
 #include <unordered_map>
 #include <memory>
+#include <algorithm>
+#include <cmath>
 
 #include <cglib/vec.h>
 #include <cglib/mat.h>
@@ -49,7 +51,7 @@ namespace {
 
 namespace carto { namespace vt {
     TileLabelCuller::TileLabelCuller(std::shared_ptr<std::mutex> mutex, float scale) :
-        _mvpMatrix(cglib::mat4x4<float>::identity()), _viewState(cglib::mat4x4<double>::identity(), cglib::mat4x4<double>::identity(), 0, 1, scale), _scale(scale), _mutex(std::move(mutex))
+        _mvpMatrix(cglib::mat4x4<float>::identity()), _viewMatrix(cglib::mat4x4<double>::identity()), _viewState(cglib::mat4x4<double>::identity(), cglib::mat4x4<double>::identity(), 0, 1, scale), _lastInvViewMatrix(cglib::mat4x4<double>::identity()), _scale(scale), _mutex(std::move(mutex))
     {
     }
 
@@ -57,76 +59,85 @@ namespace carto { namespace vt {
         std::lock_guard<std::mutex> lock(*_mutex);
 
         _mvpMatrix = cglib::mat4x4<float>::convert(projectionMatrix * calculateLocalViewMatrix(cameraMatrix));
+        _viewMatrix = projectionMatrix * cameraMatrix;
         _viewState = ViewState(projectionMatrix, cameraMatrix, zoom, aspectRatio, _scale);
         _resolution = resolution;
     }
 
     void TileLabelCuller::process(const std::vector<std::shared_ptr<TileLabel>>& labelList) {
-        // Start by collecting valid labels and updating label placements
-        std::vector<std::shared_ptr<TileLabel>> validLabelList;
-        validLabelList.reserve(labelList.size());
-        for (const std::shared_ptr<TileLabel>& label : labelList) {
+        // If neither the label set nor the view has changed noticeably since the last pass, keep the previous placements
+        std::vector<bool> activeFlags(labelList.size());
+        {
             std::lock_guard<std::mutex> lock(*_mutex);
-            
-            // Analyze only active and valid labels
-            if (!label->isActive()) {
-                continue;
+            for (std::size_t i = 0; i < labelList.size(); i++) {
+                activeFlags[i] = labelList[i]->isActive();
             }
-
-            if (label->updatePlacement(_viewState)) {
-                label->setOpacity(0);
-            }
-                
-            if (label->isValid()) {
-                validLabelList.push_back(label);
+            if (labelList == _lastLabelList && activeFlags == _lastActiveFlags && isViewReusable()) {
+                return;
             }
+            _lastInvViewMatrix = cglib::inverse(_viewMatrix);
         }
+        _lastLabelList = labelList;
+        _lastActiveFlags = activeFlags;
 
-        // Sort active labels by priority/opacity
-        {
+        // Collect valid labels and update label placements, one batch per lock
+        std::vector<std::pair<std::pair<int, float>, std::shared_ptr<TileLabel>>> validLabelList;
+        validLabelList.reserve(labelList.size());
+        float maxGroupDistance = 0;
+        for (std::size_t i0 = 0; i0 < labelList.size(); i0 += BATCH_SIZE) {
             std::lock_guard<std::mutex> lock(*_mutex);
-            std::sort(validLabelList.begin(), validLabelList.end(), [](const std::shared_ptr<TileLabel>& label1, const std::shared_ptr<TileLabel>& label2) {
-                return std::pair<int, float>(-label1->getPriority(), label1->getOpacity()) > std::pair<int, float>(-label2->getPriority(), label2->getOpacity());
-            });
-        }
+            for (std::size_t i = i0; i < std::min(i0 + BATCH_SIZE, labelList.size()); i++) {
+                const std::shared_ptr<TileLabel>& label = labelList[i];
 
-        // Update label visibility flag based on overlap analysis
-        clearGrid();
-        std::unordered_map<long long, std::vector<std::shared_ptr<TileLabel>>> groupMap;
-        for (const std::shared_ptr<TileLabel>& label : validLabelList) {
-            std::lock_guard<std::mutex> lock(*_mutex);
+                // Analyze only active and valid labels
+                if (!activeFlags[i]) {
+                    continue;
+                }
 
-            // Label is always visible if its group is set to negative value. Otherwise test visibility against other labels
-            bool visible = label->getGroupId() < 0 || testOverlap(label);
-            if (visible && label->getGroupId() > 0) {
-                cglib::vec3<double> center;
-                if (!label->calculateCenter(center)) {
-                    visible = false;
+                if (label->updatePlacement(_viewState)) {
+                    label->setOpacity(0);
                 }
-                for (const std::shared_ptr<TileLabel>& otherLabel : groupMap[label->getGroupId()]) {
-                    cglib::vec3<double> otherCenter;
-                    if (otherLabel->calculateCenter(otherCenter)) {
-                        float minimumDistance = std::min(label->getMinimumGroupDistance(), otherLabel->getMinimumGroupDistance());
-                        double centerDistance = cglib::length(center - otherCenter);
-                        if (centerDistance * _resolution / _scale < minimumDistance) {
-                            visible = false;
-                            break;
-                        }
+
+                if (label->isValid()) {
+                    validLabelList.emplace_back(std::pair<int, float>(-label->getPriority(), label->getOpacity()), label);
+                    if (label->getGroupId() > 0) {
+                        maxGroupDistance = std::max(maxGroupDistance, label->getMinimumGroupDistance());
                     }
                 }
-                if (visible) {
-                    groupMap[label->getGroupId()].push_back(label);
+            }
+        }
+
+        // Sort active labels by priority/opacity. Sort keys were captured while holding the lock.
+        std::stable_sort(validLabelList.begin(), validLabelList.end(), [](const std::pair<std::pair<int, float>, std::shared_ptr<TileLabel>>& item1, const std::pair<std::pair<int, float>, std::shared_ptr<TileLabel>>& item2) {
+            return item1.first > item2.first;
+        });
+
+        // Update label visibility flag based on overlap analysis. Group distance checks use a hash grid with cells
+        // at least as large as the largest minimum group distance, so only neighbouring cells need to be checked.
+        setupGrid(validLabelList.size());
+        _groupGrid.clear();
+        double groupCellSize = std::max(maxGroupDistance, 1.0f) * _scale / (_resolution > 0 ? _resolution : 1.0f);
+        for (std::size_t i0 = 0; i0 < validLabelList.size(); i0 += BATCH_SIZE) {
+            std::lock_guard<std::mutex> lock(*_mutex);
+            for (std::size_t i = i0; i < std::min(i0 + BATCH_SIZE, validLabelList.size()); i++) {
+                const std::shared_ptr<TileLabel>& label = validLabelList[i].second;
+
+                // Label is always visible if its group is set to negative value. Otherwise test visibility against other labels
+                bool visible = label->getGroupId() < 0 || testOverlap(label);
+                if (visible && label->getGroupId() > 0) {
+                    visible = testGroupDistance(label, groupCellSize);
                 }
+                label->setVisible(visible);
             }
-            label->setVisible(visible);
         }
     }
 
-    void TileLabelCuller::clearGrid() {
-        for (int y = 0; y < GRID_RESOLUTION; y++) {
-            for (int x = 0; x < GRID_RESOLUTION; x++) {
-                _recordGrid[y][x].clear();
-            }
+    void TileLabelCuller::setupGrid(std::size_t labelCount) {
+        int resolution = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(labelCount) / LABELS_PER_GRID_CELL)));
+        _gridResolution = std::min(std::max(resolution, static_cast<int>(MIN_GRID_RESOLUTION)), static_cast<int>(MAX_GRID_RESOLUTION));
+        _recordGrid.resize(_gridResolution * _gridResolution);
+        for (std::vector<Record>& records : _recordGrid) {
+            records.clear();
         }
     }
 
@@ -148,7 +159,7 @@ namespace carto { namespace vt {
         int x1 = getGridIndex(bounds.max(0)), y1 = getGridIndex(bounds.max(1));
         for (int y = y0; y <= y1; y++) {
             for (int x = x0; x <= x1; x++) {
-                for (const Record& record : _recordGrid[y][x]) {
+                for (const Record& record : _recordGrid[y * _gridResolution + x]) {
                     if (record.bounds.inside(bounds)) {
                         if (!findSeparatingAxis(record.envelope, envelope) && !findSeparatingAxis(envelope, record.envelope)) {
                             return false;
@@ -160,21 +171,68 @@ namespace carto { namespace vt {
 
         for (int y = y0; y <= y1; y++) {
             for (int x = x0; x <= x1; x++) {
-                _recordGrid[y][x].emplace_back(bounds, envelope, label);
+                _recordGrid[y * _gridResolution + x].emplace_back(bounds, envelope, label);
+            }
+        }
+        return true;
+    }
+
+    bool TileLabelCuller::testGroupDistance(const std::shared_ptr<TileLabel>& label, double cellSize) {
+        cglib::vec3<double> center;
+        if (!label->calculateCenter(center)) {
+            return false;
+        }
+
+        long long cellX = static_cast<long long>(std::floor(center(0) / cellSize));
+        long long cellY = static_cast<long long>(std::floor(center(1) / cellSize));
+        for (long long y = cellY - 1; y <= cellY + 1; y++) {
+            for (long long x = cellX - 1; x <= cellX + 1; x++) {
+                auto it = _groupGrid.find(GroupCellKey { label->getGroupId(), x, y });
+                if (it == _groupGrid.end()) {
+                    continue;
+                }
+                for (const GroupRecord& record : it->second) {
+                    float minimumDistance = std::min(label->getMinimumGroupDistance(), record.minimumGroupDistance);
+                    double centerDistance = cglib::length(center - record.center);
+                    if (centerDistance * _resolution / _scale < minimumDistance) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        _groupGrid[GroupCellKey { label->getGroupId(), cellX, cellY }].emplace_back(center, label->getMinimumGroupDistance());
+        return true;
+    }
+
+    bool TileLabelCuller::isViewReusable() const {
+        // Unproject reference points of the previous view and check how far they move on screen in the current view.
+        // Matrix elements can not be compared directly, as translation is in world units while rotation is not.
+        static const double refCoords[3] = { -1.0, 0.0, 1.0 };
+        static const double refDepths[2] = { 0.0, 0.9 };
+        for (double z : refDepths) {
+            for (double y : refCoords) {
+                for (double x : refCoords) {
+                    cglib::vec3<double> lastPos(x, y, z);
+                    cglib::vec3<double> pos = cglib::transform_point(cglib::transform_point(lastPos, _lastInvViewMatrix), _viewMatrix);
+                    if (std::abs(pos(0) - lastPos(0)) > VIEW_REUSE_THRESHOLD || std::abs(pos(1) - lastPos(1)) > VIEW_REUSE_THRESHOLD) {
+                        return false;
+                    }
+                }
             }
         }
         return true;
     }
 
-    int TileLabelCuller::getGridIndex(float x) {
+    int TileLabelCuller::getGridIndex(float x) const {
         float v = x * 0.5f + 0.5f;
         if (v < 0) {
             return 0;
         }
         if (v >= 1) {
-            return GRID_RESOLUTION - 1;
+            return _gridResolution - 1;
         }
-        return static_cast<int>(v * GRID_RESOLUTION);
+        return static_cast<int>(v * _gridResolution);
     }
 
     cglib::mat4x4<double> TileLabelCuller::calculateLocalViewMatrix(const cglib::mat4x4<double>& cameraMatrix) {
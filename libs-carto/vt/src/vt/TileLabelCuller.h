@@ -14,6 +14,7 @@
 #include <vector>
 #include <list>
 #include <unordered_map>
+#include <functional>
 #include <memory>
 #include <mutex>
 
@@ -30,7 +31,11 @@ namespace carto { namespace vt {
         void process(const std::vector<std::shared_ptr<TileLabel>>& labelList);
 
     private:
-        constexpr static int GRID_RESOLUTION = 16;
+        constexpr static int MIN_GRID_RESOLUTION = 4;
+        constexpr static int MAX_GRID_RESOLUTION = 64;
+        constexpr static int LABELS_PER_GRID_CELL = 8;
+        constexpr static std::size_t BATCH_SIZE = 256; // number of labels processed per single lock
+        constexpr static double VIEW_REUSE_THRESHOLD = 1.0e-3; // maximum displacement of the view reference points (in normalized device coordinates) for reusing previous results
 
         struct Record {
             cglib::bbox2<float> bounds;
@@ -41,16 +46,44 @@ namespace carto { namespace vt {
             explicit Record(const cglib::bbox2<float>& bounds, const std::array<cglib::vec2<float>, 4>& envelope, std::shared_ptr<TileLabel> label) : bounds(bounds), envelope(envelope), label(std::move(label)) { }
         };
 
-        void clearGrid();
+        struct GroupRecord {
+            cglib::vec3<double> center;
+            float minimumGroupDistance;
+
+            explicit GroupRecord(const cglib::vec3<double>& center, float minimumGroupDistance) : center(center), minimumGroupDistance(minimumGroupDistance) { }
+        };
+
+        struct GroupCellKey {
+            long long groupId;
+            long long x;
+            long long y;
+
+            bool operator == (const GroupCellKey& other) const { return groupId == other.groupId && x == other.x && y == other.y; }
+        };
+
+        struct GroupCellKeyHash {
+            std::size_t operator() (const GroupCellKey& key) const { return std::hash<long long>()(key.groupId) ^ (std::hash<long long>()(key.x) * 31) ^ (std::hash<long long>()(key.y) * 961); }
+        };
+
+        void setupGrid(std::size_t labelCount);
         bool testOverlap(const std::shared_ptr<TileLabel>& label);
+        bool testGroupDistance(const std::shared_ptr<TileLabel>& label, double cellSize);
+        bool isViewReusable() const;
 
-        static int getGridIndex(float x);
+        int getGridIndex(float x) const;
         static cglib::mat4x4<double> calculateLocalViewMatrix(const cglib::mat4x4<double>& cameraMatrix);
 
         cglib::mat4x4<float> _mvpMatrix;
+        cglib::mat4x4<double> _viewMatrix;
         ViewState _viewState;
         float _resolution = 0;
-        std::vector<Record> _recordGrid[GRID_RESOLUTION][GRID_RESOLUTION];
+        int _gridResolution = 0;
+        std::vector<std::vector<Record>> _recordGrid;
+        std::unordered_map<GroupCellKey, std::vector<GroupRecord>, GroupCellKeyHash> _groupGrid;
+
+        cglib::mat4x4<double> _lastInvViewMatrix;
+        std::vector<std::shared_ptr<TileLabel>> _lastLabelList;
+        std::vector<bool> _lastActiveFlags;
 
         const float _scale;
         const std::shared_ptr<std::mutex> _mutex;
@@ -2,6 +2,7 @@
 #include "TextFormatter.h"
 #include "Color.h"
 
+#include <cmath>
 #include <utility>
 #include <algorithm>
 #include <iterator>
@@ -351,7 +352,8 @@ namespace carto { namespace vt {
                 _binormals[i] = cglib::unit(cglib::transform_vector(_binormals[i], invTransTransform)) * cglib::length(_binormals[i]);
             }
         }
-        appendGeometry(calculateScale(_vertices), calculateScale(_binormals), calculateScale(_texCoords), _vertices, _texCoords, _binormals, _heights, _attribs, _indices, _ids, 0, _vertices.size());
+        bool compact = isCompactLayout();
+        appendGeometry(calculateScale(_vertices, 32767.0f), calculateScale(_binormals, compact ? 127.0f : 32767.0f), calculateScale(_texCoords, 32767.0f), compact ? calculateHeightScale(_heights) : 1.0f, _vertices, _texCoords, _binormals, _heights, _attribs, _indices, _ids, 0, _vertices.size());
 
         _builderParameters = BuilderParameters();
         _styleParameters = TileGeometry::StyleParameters();
@@ -364,7 +366,7 @@ namespace carto { namespace vt {
         _ids.clear();
     }
 
-    void TileLayerBuilder::appendGeometry(float verticesScale, float binormalsScale, float texCoordsScale, const VertexArray<cglib::vec2<float>>& vertices, const VertexArray<cglib::vec2<float>>& texCoords, const VertexArray<cglib::vec2<float>>& binormals, const VertexArray<float>& heights, const VertexArray<cglib::vec4<char>>& attribs, const VertexArray<unsigned int>& indices, const VertexArray<long long>& ids, std::size_t offset, std::size_t count) {
+    void TileLayerBuilder::appendGeometry(float verticesScale, float binormalsScale, float texCoordsScale, float heightsScale, const VertexArray<cglib::vec2<float>>& vertices, const VertexArray<cglib::vec2<float>>& texCoords, const VertexArray<cglib::vec2<float>>& binormals, const VertexArray<float>& heights, const VertexArray<cglib::vec4<char>>& attribs, const VertexArray<unsigned int>& indices, const VertexArray<long long>& ids, std::size_t offset, std::size_t count) {
         if (count < 65536) {
             // Build geometry layout info
             TileGeometry::GeometryLayoutParameters geometryLayoutParameters;
@@ -379,19 +381,26 @@ namespace carto { namespace vt {
                 geometryLayoutParameters.vertexSize += 2 * sizeof(short);
             }
 
+            // Compact layout packs binormals into bytes and heights into shorts
+            bool compact = isCompactLayout();
+
             if (!binormals.empty()) {
                 geometryLayoutParameters.binormalOffset = geometryLayoutParameters.vertexSize;
-                geometryLayoutParameters.vertexSize += 2 * sizeof(short);
+                geometryLayoutParameters.binormalComponentSize = (compact ? sizeof(signed char) : sizeof(short));
+                geometryLayoutParameters.vertexSize += 2 * geometryLayoutParameters.binormalComponentSize;
             }
 
             if (!heights.empty()) {
                 geometryLayoutParameters.heightOffset = geometryLayoutParameters.vertexSize;
-                geometryLayoutParameters.vertexSize += sizeof(float);
+                geometryLayoutParameters.heightComponentSize = (compact ? sizeof(short) : sizeof(float));
+                geometryLayoutParameters.vertexSize += geometryLayoutParameters.heightComponentSize;
             }
 
+            geometryLayoutParameters.vertexSize = (geometryLayoutParameters.vertexSize + 3) & ~3; // keep vertices 4-byte aligned
             geometryLayoutParameters.vertexScale = verticesScale;
             geometryLayoutParameters.binormalScale = binormalsScale;
             geometryLayoutParameters.texCoordScale = texCoordsScale;
+            geometryLayoutParameters.heightScale = (compact ? heightsScale : 1.0f);
 
             // Interleave, compress actual geometry data
             VertexArray<unsigned char> compressedVertexGeometry;
@@ -420,15 +429,28 @@ namespace carto { namespace vt {
 
                 if (!binormals.empty()) {
                     const cglib::vec2<float>& binormal = binormals[i + offset];
-                    short* compressedBinormalPtr = reinterpret_cast<short*>(baseCompressedPtr + geometryLayoutParameters.binormalOffset);
-                    compressedBinormalPtr[0] = static_cast<short>(binormal(0) * binormalsScale);
-                    compressedBinormalPtr[1] = static_cast<short>(binormal(1) * binormalsScale);
+                    if (compact) {
+                        signed char* compressedBinormalPtr = reinterpret_cast<signed char*>(baseCompressedPtr + geometryLayoutParameters.binormalOffset);
+                        compressedBinormalPtr[0] = static_cast<signed char>(std::round(binormal(0) * binormalsScale));
+                        compressedBinormalPtr[1] = static_cast<signed char>(std::round(binormal(1) * binormalsScale));
+                    }
+                    else {
+                        short* compressedBinormalPtr = reinterpret_cast<short*>(baseCompressedPtr + geometryLayoutParameters.binormalOffset);
+                        compressedBinormalPtr[0] = static_cast<short>(binormal(0) * binormalsScale);
+                        compressedBinormalPtr[1] = static_cast<short>(binormal(1) * binormalsScale);
+                    }
                 }
 
                 if (!heights.empty()) {
                     float height = heights[i + offset];
-                    float* compressedHeightPtr = reinterpret_cast<float*>(baseCompressedPtr + geometryLayoutParameters.heightOffset);
-                    compressedHeightPtr[0] = height;
+                    if (compact) {
+                        short* compressedHeightPtr = reinterpret_cast<short*>(baseCompressedPtr + geometryLayoutParameters.heightOffset);
+                        compressedHeightPtr[0] = static_cast<short>(std::round(height * heightsScale));
+                    }
+                    else {
+                        float* compressedHeightPtr = reinterpret_cast<float*>(baseCompressedPtr + geometryLayoutParameters.heightOffset);
+                        compressedHeightPtr[0] = height;
+                    }
                 }
             }
                 
@@ -479,23 +501,28 @@ namespace carto { namespace vt {
         indices1.copy(indices, 0, splitPos);
         VertexArray<long long> ids1;
         ids1.copy(ids, 0, splitPos);
-        appendGeometry(verticesScale, binormalsScale, texCoordsScale, vertices, texCoords, binormals, heights, attribs, indices1, ids1, minIndex[0], maxIndex[0] - minIndex[0] + 1);
+        appendGeometry(verticesScale, binormalsScale, texCoordsScale, heightsScale, vertices, texCoords, binormals, heights, attribs, indices1, ids1, minIndex[0], maxIndex[0] - minIndex[0] + 1);
 
         VertexArray<unsigned int> indices2;
         indices2.copy(indices, splitPos, indices.size() - splitPos);
         VertexArray<long long> ids2;
         ids2.copy(ids, splitPos, indices.size() - splitPos);
-        appendGeometry(verticesScale, binormalsScale, texCoordsScale, vertices, texCoords, binormals, heights, attribs, indices2, ids2, minIndex[1], maxIndex[1] - minIndex[1] + 1);
+        appendGeometry(verticesScale, binormalsScale, texCoordsScale, heightsScale, vertices, texCoords, binormals, heights, attribs, indices2, ids2, minIndex[1], maxIndex[1] - minIndex[1] + 1);
+    }
+
+    bool TileLayerBuilder::isCompactLayout() const {
+        // 3D polygon binormals are unit wall normals used only for lighting, so 8 bits of precision are sufficient
+        return _builderParameters.type == TileGeometry::Type::POLYGON3D;
     }
 
-    float TileLayerBuilder::calculateScale(VertexArray<cglib::vec2<float>>& values) const {
+    float TileLayerBuilder::calculateScale(const VertexArray<cglib::vec2<float>>& values, float maxScaledValue) const {
         float maxValue = 0.0f;
         for (const cglib::vec2<float>& value : values) {
             maxValue = std::max(maxValue, std::max(std::abs(value(0)), std::abs(value(1))));
         }
         float scale = 32768.0f;
         while (scale > 1.0f / 65536.0f) {
-            if (maxValue * scale <= 32767.0f) {
+            if (maxValue * scale <= maxScaledValue) {
                 break;
             }
             scale *= 0.5f;
@@ -503,6 +530,15 @@ namespace carto { namespace vt {
         return scale;
     }
 
+    float TileLayerBuilder::calculateHeightScale(const VertexArray<float>& heights) const {
+        // Heights are normalized by world size and can be very small, so the scale is not restricted to powers of 2
+        float maxValue = 0.0f;
+        for (float height : heights) {
+            maxValue = std::max(maxValue, std::abs(height));
+        }
+        return maxValue > 0.0f ? 32767.0f / maxValue : 1.0f;
+    }
+
     bool TileLayerBuilder::tesselateGlyph(const Vertex& vertex, char styleIndex, const cglib::vec2<float>& pen, const Font::Glyph* glyph) {
         float u0 = 0, v0 = 0, u1 = 0, v1 = 0;
         cglib::vec2<float> p0 = pen, p3 = pen;
@@ -525,7 +561,15 @@ namespace carto { namespace vt {
         return true;
     }
 
-    bool TileLayerBuilder::tesselatePolygon(const VerticesList& verticesList, char styleIndex, const PolygonStyle& style) {
+    bool TileLayerBuilder::triangulatePolygon(const VerticesList& verticesList) {
+        _polygonIndices.clear();
+
+        // Fast path for simple rings without holes, vertices are emitted directly from the input ring
+        if (verticesList.size() == 1 && triangulateSimpleRing(verticesList.front())) {
+            _vertices.copy(verticesList.front().begin(), verticesList.front().end());
+            return true;
+        }
+
         if (!_tessPoolAllocator) {
             _tessPoolAllocator = std::unique_ptr<PoolAllocator>(new PoolAllocator);
         }
@@ -555,21 +599,9 @@ namespace carto { namespace vt {
         const int vertexCount = tessGetVertexCount(tess);
         const int elementCount = tessGetElementCount(tess);
 
-        float du_dx = 0.0f, dv_dy = 0.0f;
-        if (style.pattern) {
-            du_dx = _tileSize / (style.pattern->bitmap->width * style.pattern->widthScale);
-            dv_dy = _tileSize / (style.pattern->bitmap->height * style.pattern->heightScale);
-        }
-
-        int offset = static_cast<int>(_vertices.size());
         for (int i = 0; i < vertexCount; i++) {
-            cglib::vec2<float> p(static_cast<float>(coords[i * 2 + 0]), static_cast<float>(coords[i * 2 + 1]));
-            cglib::vec2<float> uv(p(0) * du_dx, p(1) * dv_dy);
-
-            _vertices.append(p);
-            _texCoords.append(uv);
+            _vertices.append(cglib::vec2<float>(static_cast<float>(coords[i * 2 + 0]), static_cast<float>(coords[i * 2 + 1])));
         }
-        _attribs.fill(cglib::vec4<char>(styleIndex, 0, 0, 0), _vertices.size() - offset);
 
         for (int i = 0; i < elementCount * 3; i += 3) {
             int i0 = elements[i + 0];
@@ -578,11 +610,9 @@ namespace carto { namespace vt {
             if (i0 == TESS_UNDEF || i1 == TESS_UNDEF || i2 == TESS_UNDEF) {
                 continue;
             }
-            i0 += offset;
-            i1 += offset;
-            i2 += offset;
-
-            _indices.append(i0, i1, i2);
+            _polygonIndices.push_back(i0);
+            _polygonIndices.push_back(i1);
+            _polygonIndices.push_back(i2);
         }
 
         tessDeleteTess(tess);
@@ -590,6 +620,152 @@ namespace carto { namespace vt {
         return true;
     }
 
+    bool TileLayerBuilder::triangulateSimpleRing(const Vertices& points) {
+        auto cross = [&points](int i0, int i1, int i2) {
+            const cglib::vec2<float>& p0 = points[i0];
+            const cglib::vec2<float>& p1 = points[i1];
+            const cglib::vec2<float>& p2 = points[i2];
+            return (p1(0) - p0(0)) * (p2(1) - p0(1)) - (p1(1) - p0(1)) * (p2(0) - p0(0));
+        };
+
+        // Drop repeated vertices, including the optional closing vertex
+        _ringIndices.clear();
+        for (std::size_t i = 0; i < points.size(); i++) {
+            if (_ringIndices.empty() || points[i] != points[_ringIndices.back()]) {
+                _ringIndices.push_back(static_cast<int>(i));
+            }
+        }
+        while (_ringIndices.size() > 1 && points[_ringIndices.front()] == points[_ringIndices.back()]) {
+            _ringIndices.pop_back();
+        }
+        int n = static_cast<int>(_ringIndices.size());
+        if (n < 3 || n > MAX_EARCLIP_VERTICES) {
+            return false;
+        }
+
+        // Triangles are emitted in the orientation of the ring, like libtess does
+        float area = 0;
+        for (int i = 1; i + 1 < n; i++) {
+            area += cross(_ringIndices[0], _ringIndices[i], _ringIndices[i + 1]);
+        }
+        if (area == 0) {
+            return false;
+        }
+        float orientation = (area > 0 ? 1.0f : -1.0f);
+
+        // Convex rings: all turns have the same sign and each coordinate changes direction at most twice
+        bool convex = true;
+        int xSignChanges = 0, ySignChanges = 0;
+        float prevDx = 0, prevDy = 0;
+        for (int i = 0; i <= n && convex; i++) {
+            int i0 = _ringIndices[i % n], i1 = _ringIndices[(i + 1) % n], i2 = _ringIndices[(i + 2) % n];
+            if (cross(i0, i1, i2) * orientation < 0) {
+                convex = false;
+            }
+            float dx = points[i1](0) - points[i0](0), dy = points[i1](1) - points[i0](1);
+            if (dx != 0) {
+                xSignChanges += (prevDx * dx < 0 ? 1 : 0);
+                prevDx = dx;
+            }
+            if (dy != 0) {
+                ySignChanges += (prevDy * dy < 0 ? 1 : 0);
+                prevDy = dy;
+            }
+        }
+        if (convex && xSignChanges <= 2 && ySignChanges <= 2) {
+            for (int i = 1; i + 1 < n; i++) {
+                _polygonIndices.push_back(_ringIndices[0]);
+                _polygonIndices.push_back(_ringIndices[i]);
+                _polygonIndices.push_back(_ringIndices[i + 1]);
+            }
+            return true;
+        }
+
+        // Ear clipping is only valid for simple rings, leave self-intersecting rings to libtess
+        for (int i = 0; i < n; i++) {
+            int a0 = _ringIndices[i], a1 = _ringIndices[(i + 1) % n];
+            for (int j = i + 2; j < n; j++) {
+                if (i == 0 && j == n - 1) {
+                    continue;
+                }
+                int b0 = _ringIndices[j], b1 = _ringIndices[(j + 1) % n];
+                float d0 = cross(a0, a1, b0), d1 = cross(a0, a1, b1);
+                float d2 = cross(b0, b1, a0), d3 = cross(b0, b1, a1);
+                if (d0 * d1 <= 0 && d2 * d3 <= 0) {
+                    return false;
+                }
+            }
+        }
+
+        int i = 0;
+        while (n > 3) {
+            int attempts = 0;
+            while (true) {
+                int i0 = _ringIndices[(i + n - 1) % n], i1 = _ringIndices[i % n], i2 = _ringIndices[(i + 1) % n];
+                float c = cross(i0, i1, i2) * orientation;
+                if (c == 0) {
+                    break; // zero-area spike or collinear vertex, remove without emitting a triangle
+                }
+                if (c > 0) {
+                    bool ear = true;
+                    for (int j = 0; j < n && ear; j++) {
+                        int k = _ringIndices[j];
+                        if (points[k] == points[i0] || points[k] == points[i1] || points[k] == points[i2]) {
+                            continue;
+                        }
+                        if (cross(i0, i1, k) * orientation >= 0 && cross(i1, i2, k) * orientation >= 0 && cross(i2, i0, k) * orientation >= 0) {
+                            ear = false;
+                        }
+                    }
+                    if (ear) {
+                        _polygonIndices.push_back(i0);
+                        _polygonIndices.push_back(i1);
+                        _polygonIndices.push_back(i2);
+                        break;
+                    }
+                }
+                if (++attempts >= n) {
+                    _polygonIndices.clear(); // numerically degenerate ring, no ear found, drop the ears emitted so far
+                    return false;
+                }
+                i = (i + 1) % n;
+            }
+            _ringIndices.erase(_ringIndices.begin() + (i % n));
+            n--;
+            i = (n > 0 ? i % n : 0);
+        }
+        if (cross(_ringIndices[0], _ringIndices[1], _ringIndices[2]) * orientation > 0) {
+            _polygonIndices.push_back(_ringIndices[0]);
+            _polygonIndices.push_back(_ringIndices[1]);
+            _polygonIndices.push_back(_ringIndices[2]);
+        }
+        return true;
+    }
+
+    bool TileLayerBuilder::tesselatePolygon(const VerticesList& verticesList, char styleIndex, const PolygonStyle& style) {
+        int offset = static_cast<int>(_vertices.size());
+        if (!triangulatePolygon(verticesList)) {
+            return false;
+        }
+
+        float du_dx = 0.0f, dv_dy = 0.0f;
+        if (style.pattern) {
+            du_dx = _tileSize / (style.pattern->bitmap->width * style.pattern->widthScale);
+            dv_dy = _tileSize / (style.pattern->bitmap->height * style.pattern->heightScale);
+        }
+
+        for (std::size_t i = offset; i < _vertices.size(); i++) {
+            const cglib::vec2<float>& p = _vertices[i];
+            _texCoords.append(cglib::vec2<float>(p(0) * du_dx, p(1) * dv_dy));
+        }
+        _attribs.fill(cglib::vec4<char>(styleIndex, 0, 0, 0), _vertices.size() - offset);
+
+        for (std::size_t i = 0; i < _polygonIndices.size(); i += 3) {
+            _indices.append(_polygonIndices[i + 0] + offset, _polygonIndices[i + 1] + offset, _polygonIndices[i + 2] + offset);
+        }
+        return true;
+    }
+
     bool TileLayerBuilder::tesselatePolygon3D(const VerticesList& verticesList, float height, char styleIndex, const Polygon3DStyle& style) {
         if (height != 0) {
             for (const Vertices& points : verticesList) {
@@ -617,61 +793,18 @@ namespace carto { namespace vt {
             }
         }
 
-        if (!_tessPoolAllocator) {
-            _tessPoolAllocator = std::unique_ptr<PoolAllocator>(new PoolAllocator);
-        }
-
-        TESSalloc ma;
-        memset(&ma, 0, sizeof(ma));
-        ma.memalloc = [](void* userData, unsigned int size) { return reinterpret_cast<PoolAllocator*>(userData)->allocate(size); };
-        ma.memfree = [](void* userData, void* ptr) {};
-        ma.userData = _tessPoolAllocator.get();
-        ma.extraVertices = 256; // realloc not provided, allow 256 extra vertices.
-
-        TESStesselator* tess = tessNewTess(&ma);
-        if (!tess) {
+        int offset = static_cast<int>(_vertices.size());
+        if (!triangulatePolygon(verticesList)) {
             return false;
         }
-        for (const Vertices& points : verticesList) {
-            TESSreal* coords = reinterpret_cast<TESSreal*>(_tessPoolAllocator->allocate(points.size() * 2 * sizeof(TESSreal)));
-            for (std::size_t i = 0; i < points.size(); i++) {
-                coords[i * 2 + 0] = static_cast<TESSreal>(points[i](0));
-                coords[i * 2 + 1] = static_cast<TESSreal>(points[i](1));
-            }
-            tessAddContour(tess, 2, coords, 2 * sizeof(TESSreal), static_cast<int>(points.size()));
-        }
-        tessTesselate(tess, TESS_WINDING_ODD, TESS_POLYGONS, 3, 2, 0);
-        const TESSreal* coords = tessGetVertices(tess);
-        const int* elements = tessGetElements(tess);
-        const int vertexCount = tessGetVertexCount(tess);
-        const int elementCount = tessGetElementCount(tess);
 
-        int offset = static_cast<int>(_vertices.size());
-        for (int i = 0; i < vertexCount; i++) {
-            cglib::vec2<float> p(static_cast<float>(coords[i * 2 + 0]), static_cast<float>(coords[i * 2 + 1]));
-
-            _vertices.append(p);
-        }
         _binormals.fill(cglib::vec2<float>(0, 0), _vertices.size() - offset);
         _heights.fill(height, _vertices.size() - offset);
         _attribs.fill(cglib::vec4<char>(styleIndex, 0, 1, 0), _vertices.size() - offset);
 
-        for (int i = 0; i < elementCount * 3; i += 3) {
-            int i0 = elements[i + 0];
-            int i1 = elements[i + 1];
-            int i2 = elements[i + 2];
-            if (i0 == TESS_UNDEF || i1 == TESS_UNDEF || i2 == TESS_UNDEF) {
-                continue;
-            }
-            i0 += offset;
-            i1 += offset;
-            i2 += offset;
-
-            _indices.append(i2, i1, i0);
+        for (std::size_t i = 0; i < _polygonIndices.size(); i += 3) {
+            _indices.append(_polygonIndices[i + 2] + offset, _polygonIndices[i + 1] + offset, _polygonIndices[i + 0] + offset);
         }
-
-        tessDeleteTess(tess);
-        _tessPoolAllocator->reset(); // reuse last allocated block from the start
         return true;
     }
 
@@ -73,6 +73,8 @@ namespace carto { namespace vt {
 
         constexpr static float MIN_MITER_DOT = -0.8f; // minimum allowed dot product result between segment direction vectors, if less, then miter-join is not used
 
+        constexpr static int MAX_EARCLIP_VERTICES = 64; // maximum number of ring vertices for ear clipping, larger rings are tesselated using libtess
+
         struct BuilderParameters {
             TileGeometry::Type type;
             std::array<StrokeMap::StrokeId, TileGeometry::StyleParameters::MAX_PARAMETERS> lineStrokeIds;
@@ -83,10 +85,14 @@ namespace carto { namespace vt {
         };
 
         void appendGeometry();
-        void appendGeometry(float verticesScale, float binormalsScale, float texCoordsScale, const VertexArray<cglib::vec2<float>>& vertices, const VertexArray<cglib::vec2<float>>& texCoords, const VertexArray<cglib::vec2<float>>& binormals, const VertexArray<float>& heights, const VertexArray<cglib::vec4<char>>& attribs, const VertexArray<unsigned int>& indices, const VertexArray<long long>& ids, std::size_t offset, std::size_t count);
-        float calculateScale(VertexArray<cglib::vec2<float>>& values) const;
+        void appendGeometry(float verticesScale, float binormalsScale, float texCoordsScale, float heightsScale, const VertexArray<cglib::vec2<float>>& vertices, const VertexArray<cglib::vec2<float>>& texCoords, const VertexArray<cglib::vec2<float>>& binormals, const VertexArray<float>& heights, const VertexArray<cglib::vec4<char>>& attribs, const VertexArray<unsigned int>& indices, const VertexArray<long long>& ids, std::size_t offset, std::size_t count);
+        bool isCompactLayout() const;
+        float calculateScale(const VertexArray<cglib::vec2<float>>& values, float maxScaledValue) const;
+        float calculateHeightScale(const VertexArray<float>& heights) const;
 
         bool tesselateGlyph(const Vertex& vertex, char styleIndex, const cglib::vec2<float>& pen, const Font::Glyph* glyph);
+        bool triangulatePolygon(const VerticesList& verticesList);
+        bool triangulateSimpleRing(const Vertices& points);
         bool tesselatePolygon(const VerticesList& verticesList, char styleIndex, const PolygonStyle& style);
         bool tesselatePolygon3D(const VerticesList& verticesList, float height, char styleIndex, const Polygon3DStyle& style);
         bool tesselateLine(const Vertices& points, char styleIndex, const StrokeMap::Stroke* stroke, const LineStyle& style);
@@ -111,6 +117,8 @@ namespace carto { namespace vt {
         std::vector<std::shared_ptr<TileLabel>> _labelList;
 
         std::unique_ptr<PoolAllocator> _tessPoolAllocator;
+        std::vector<int> _ringIndices;
+        std::vector<unsigned int> _polygonIndices;
     };
 } }
 
@@ -9,6 +9,7 @@
 
 #include <utility>
 #include <algorithm>
+#include <iterator>
 
 namespace carto { namespace vt {
     template <typename T>
@@ -113,6 +114,17 @@ namespace carto { namespace vt {
             _reserved -= size;
         }
 
+        template <typename Iterator>
+        void copy(Iterator begin, Iterator end) {
+            std::size_t size = static_cast<std::size_t>(std::distance(begin, end));
+            if (_reserved < size) {
+                reserve(size);
+            }
+            std::copy(begin, end, _end);
+            _end += size;
+            _reserved -= size;
+        }
+
         void fill(const T& val, std::size_t n) {
             if (_reserved < n) {
                 reserve(n);